@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+"""Decode CBOR batch messages sent by the asset tracker v2 application.
+
+Messages encoded with CONFIG_CLOUD_CODEC_CBOR_BATCH_COLUMNAR are converted
+back to the structure of JSON batch messages, see cbor_columnar.h for the
+format. Messages in the default CBOR format already have that structure and
+are only converted to JSON.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+# Scale factors of the columnar format, must match cbor_columnar.h.
+SCALE_COORDINATE = 10000000
+SCALE_DISTANCE = 100
+SCALE_HEADING = 100
+SCALE_ENVIRONMENT = 100
+SCALE_ACCELERATION = 100
+
+# Scale factors of numeric columns that are not integers, per data type.
+SCALES = {
+    'gps': {
+        'lng': SCALE_COORDINATE,
+        'lat': SCALE_COORDINATE,
+        'acc': SCALE_DISTANCE,
+        'alt': SCALE_DISTANCE,
+        'spd': SCALE_DISTANCE,
+        'hdg': SCALE_HEADING,
+    },
+    'env': {
+        'temp': SCALE_ENVIRONMENT,
+        'hum': SCALE_ENVIRONMENT,
+    },
+    'acc': {
+        'x': SCALE_ACCELERATION,
+        'y': SCALE_ACCELERATION,
+        'z': SCALE_ACCELERATION,
+    },
+}
+
+TIMESTAMP = 'ts'
+VALUE = 'v'
+NMEA = 'nmea'
+
+BREAK = object()
+
+
+class DecodeError(Exception):
+    pass
+
+
+class CborDecoder:
+    """Minimal decoder for the CBOR subset used by the application."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise DecodeError('Unexpected end of data')
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def argument(self, info):
+        if info < 24:
+            return info
+        if info == 31:
+            return None
+        if info > 27:
+            raise DecodeError(f'Invalid additional information {info}')
+        return int.from_bytes(self.take(1 << (info - 24)), 'big')
+
+    def items(self, length):
+        if length is not None:
+            for _ in range(length):
+                yield self.item()
+            return
+        while True:
+            item = self.item(allow_break=True)
+            if item is BREAK:
+                return
+            yield item
+
+    def item(self, allow_break=False):
+        initial = self.take(1)[0]
+        major = initial >> 5
+        info = initial & 0x1f
+
+        if major == 7:
+            return self.simple(info, allow_break)
+
+        arg = self.argument(info)
+
+        if major == 0:
+            return arg
+        if major == 1:
+            return -1 - arg
+        if major in (2, 3):
+            if arg is None:
+                raise DecodeError('Indefinite length strings are not supported')
+            raw = self.take(arg)
+            return raw if major == 2 else raw.decode('utf-8')
+        if major == 4:
+            return list(self.items(arg))
+        if major == 5:
+            entries = list(self.items(None if arg is None else 2 * arg))
+            if len(entries) % 2:
+                raise DecodeError('Map with a key without value')
+            return dict(zip(entries[::2], entries[1::2]))
+        raise DecodeError(f'Major type {major} is not supported')
+
+    def simple(self, info, allow_break):
+        if info == 20:
+            return False
+        if info == 21:
+            return True
+        if info == 22:
+            return None
+        if info == 25:
+            return struct.unpack('>e', self.take(2))[0]
+        if info == 26:
+            return struct.unpack('>f', self.take(4))[0]
+        if info == 27:
+            return struct.unpack('>d', self.take(8))[0]
+        if info == 31 and allow_break:
+            return BREAK
+        raise DecodeError(f'Simple value {info} is not supported')
+
+    def decode(self):
+        item = self.item()
+        if self.pos != len(self.data):
+            raise DecodeError('Trailing data after the message')
+        return item
+
+
+def column_values(label, key, column):
+    """Undo the delta encoding and scaling of a column."""
+    if not isinstance(column, list):
+        raise DecodeError(f'Column {label}.{key} is not an array')
+
+    scale = SCALES.get(label, {}).get(key)
+    values = []
+    prev = 0
+
+    for item in column:
+        if item is None or isinstance(item, str):
+            # Strings are not delta encoded, nulls do not change the reference value.
+            values.append(item)
+            continue
+        prev += item
+        values.append(prev / scale if scale else prev)
+
+    return values
+
+
+def rows_from_columns(label, columns):
+    """Convert the map of columns of one data type to a list of JSON entries."""
+    if TIMESTAMP not in columns:
+        raise DecodeError(f'Timestamp column of {label} is missing')
+
+    decoded = {key: column_values(label, key, column) for key, column in columns.items()}
+    count = len(decoded[TIMESTAMP])
+
+    for key, values in decoded.items():
+        if len(values) != count:
+            raise DecodeError(f'Column {label}.{key} has {len(values)} items, expected {count}')
+
+    rows = []
+
+    for i in range(count):
+        values = {key: decoded[key][i] for key in decoded
+                  if key != TIMESTAMP and decoded[key][i] is not None}
+
+        if VALUE in values:
+            value = values[VALUE]
+        elif NMEA in values:
+            value = values[NMEA]
+        else:
+            value = values
+
+        rows.append({VALUE: value, TIMESTAMP: decoded[TIMESTAMP][i]})
+
+    return rows
+
+
+def batch_decode(message):
+    if not isinstance(message, dict):
+        raise DecodeError('Batch message is not a map')
+
+    batch = {}
+
+    for label, data in message.items():
+        if isinstance(data, dict):
+            batch[label] = rows_from_columns(label, data)
+        else:
+            batch[label] = data
+
+    return batch
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Decode a CBOR batch message of the asset tracker v2 application to JSON.',
+        allow_abbrev=False)
+    parser.add_argument('input', nargs='?', type=argparse.FileType('rb'),
+                        default=sys.stdin.buffer,
+                        help='File with the message, standard input if not given')
+    parser.add_argument('--hex', action='store_true',
+                        help='Input is hex encoded, for example copied from a log')
+    parser.add_argument('--indent', type=int, default=None,
+                        help='Indentation of the JSON output')
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    data = args.input.read()
+
+    if args.hex:
+        data = bytes.fromhex(data.decode('ascii'))
+
+    try:
+        batch = batch_decode(CborDecoder(data).decode())
+    except (DecodeError, UnicodeDecodeError) as e:
+        sys.exit(f'Failed to decode message: {e}')
+
+    print(json.dumps(batch, indent=args.indent))
+
+
+if __name__ == '__main__':
+    main()
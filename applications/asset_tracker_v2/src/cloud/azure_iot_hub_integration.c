@@ -15,15 +15,24 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_CLOUD_INTEGRATION_LOG_LEVEL);
 #define CLIENT_ID_LEN (sizeof(CONFIG_CLOUD_CLIENT_ID) - 1)
 #endif
 
-#define PROP_BAG_COUNT 1
 #define PROP_BAG_BATCH "batch"
+#define PROP_BAG_CONTENT_TYPE "$.ct"
+#define PROP_BAG_CONTENT_TYPE_CBOR "application%2Fcbor"
 
 #define REQUEST_DEVICE_TWIN_STRING ""
 
-static struct azure_iot_hub_prop_bag prop_bag_batch[PROP_BAG_COUNT] = {
-		[0].key = PROP_BAG_BATCH,
-		[0].value = NULL
+static struct azure_iot_hub_prop_bag prop_bag_batch[] = {
+		{ .key = PROP_BAG_BATCH, .value = NULL },
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+		{ .key = PROP_BAG_CONTENT_TYPE, .value = PROP_BAG_CONTENT_TYPE_CBOR },
+#endif
+};
+
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+static struct azure_iot_hub_prop_bag prop_bag_ui[] = {
+		{ .key = PROP_BAG_CONTENT_TYPE, .value = PROP_BAG_CONTENT_TYPE_CBOR },
 };
+#endif
 static char client_id_buf[CLIENT_ID_LEN + 1];
 static struct azure_iot_hub_config config;
 static cloud_wrap_evt_handler_t wrapper_evt_handler;
@@ -308,7 +317,11 @@ int cloud_wrap_ui_send(char *buf, size_t len)
 		.ptr = buf,
 		.len = len,
 		.qos = MQTT_QOS_0_AT_MOST_ONCE,
-		.topic.type = AZURE_IOT_HUB_TOPIC_EVENT
+		.topic.type = AZURE_IOT_HUB_TOPIC_EVENT,
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+		.topic.prop_bag = prop_bag_ui,
+		.topic.prop_bag_count = ARRAY_SIZE(prop_bag_ui)
+#endif
 	};
 
 	err = azure_iot_hub_send(&msg);
@@ -16,6 +16,7 @@
 #include "json_helpers.h"
 #include "json_common.h"
 #include "json_protocol_names.h"
+#include "cbor_common.h"
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(cloud_codec, CONFIG_CLOUD_CODEC_LOG_LEVEL);
@@ -58,6 +59,10 @@ int cloud_codec_encode_neighbor_cells(struct cloud_codec_data *output,
 	__ASSERT_NO_MSG(output != NULL);
 	__ASSERT_NO_MSG(neighbor_cells != NULL);
 
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR)) {
+		return cbor_common_encode_neighbor_cells(output, neighbor_cells);
+	}
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
@@ -337,6 +342,10 @@ int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
 	int err;
 	char *buffer;
 
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR)) {
+		return cbor_common_encode_ui_data(output, ui_buf);
+	}
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
@@ -391,6 +400,13 @@ int cloud_codec_encode_batch_data(
 	char *buffer;
 	bool object_added = false;
 
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR)) {
+		return cbor_common_encode_batch_data(output, gps_buf, sensor_buf, modem_dyn_buf,
+						     ui_buf, accel_buf, bat_buf, gps_buf_count,
+						     sensor_buf_count, modem_dyn_buf_count,
+						     ui_buf_count, accel_buf_count, bat_buf_count);
+	}
+
 	cJSON *root_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL) {
@@ -0,0 +1,517 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <date_time.h>
+
+#include "cloud_codec.h"
+#include "cbor_columnar.h"
+#include "cbor_helpers.h"
+#include "json_protocol_names.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(cbor_columnar, CONFIG_CLOUD_CODEC_LOG_LEVEL);
+
+struct column_value {
+	bool present;
+	union {
+		int64_t num;
+		const char *str;
+	};
+};
+
+struct column {
+	struct cbor_key key;
+	bool is_str;
+	void (*get)(const void *entry, struct column_value *value);
+};
+
+/* Description of a data type. All functions get a pointer to a single buffer entry. */
+struct table {
+	struct cbor_key label;
+	size_t entry_size;
+	bool (*queued)(const void *entry);
+	void (*unqueue)(void *entry);
+	/* Optional. Queued entries that are not valid are unqueued without being encoded. */
+	bool (*valid)(const void *entry);
+	int64_t (*uptime)(const void *entry);
+	const struct column *columns;
+	size_t column_count;
+};
+
+struct table_buffer {
+	const struct table *table;
+	void *buf;
+	size_t count;
+};
+
+static int64_t scale(double value, int32_t factor)
+{
+	double scaled = value * factor;
+
+	return (int64_t)((scaled < 0) ? (scaled - 0.5) : (scaled + 0.5));
+}
+
+#define ENTRY_FUNCTIONS(_name, _type, _ts)						\
+	static bool _name##_queued(const void *entry)					\
+	{										\
+		return ((const _type *)entry)->queued;					\
+	}										\
+											\
+	static void _name##_unqueue(void *entry)					\
+	{										\
+		((_type *)entry)->queued = false;					\
+	}										\
+											\
+	static int64_t _name##_uptime(const void *entry)				\
+	{										\
+		return ((const _type *)entry)->_ts;					\
+	}
+
+#define NUM_COLUMN(_name, _type, _present, _value)					\
+	static void _name(const void *entry, struct column_value *value)		\
+	{										\
+		const _type *data = entry;						\
+											\
+		value->present = (_present);						\
+		value->num = value->present ? (_value) : 0;				\
+	}
+
+#define STR_COLUMN(_name, _type, _present, _value)					\
+	static void _name(const void *entry, struct column_value *value)		\
+	{										\
+		const _type *data = entry;						\
+											\
+		value->present = (_present);						\
+		value->str = value->present ? (_value) : NULL;				\
+	}
+
+/* GPS */
+
+ENTRY_FUNCTIONS(gps, struct cloud_data_gps, gps_ts)
+
+static bool gps_valid(const void *entry)
+{
+	const struct cloud_data_gps *data = entry;
+
+	return (data->format == CLOUD_CODEC_GPS_FORMAT_PVT) ||
+	       (data->format == CLOUD_CODEC_GPS_FORMAT_NMEA);
+}
+
+#define GPS_PVT(data) ((data)->format == CLOUD_CODEC_GPS_FORMAT_PVT)
+
+NUM_COLUMN(gps_lng, struct cloud_data_gps, GPS_PVT(data),
+	   scale(data->pvt.longi, CBOR_COLUMNAR_SCALE_COORDINATE))
+NUM_COLUMN(gps_lat, struct cloud_data_gps, GPS_PVT(data),
+	   scale(data->pvt.lat, CBOR_COLUMNAR_SCALE_COORDINATE))
+NUM_COLUMN(gps_acc, struct cloud_data_gps, GPS_PVT(data),
+	   scale(data->pvt.acc, CBOR_COLUMNAR_SCALE_DISTANCE))
+NUM_COLUMN(gps_alt, struct cloud_data_gps, GPS_PVT(data),
+	   scale(data->pvt.alt, CBOR_COLUMNAR_SCALE_DISTANCE))
+NUM_COLUMN(gps_spd, struct cloud_data_gps, GPS_PVT(data),
+	   scale(data->pvt.spd, CBOR_COLUMNAR_SCALE_DISTANCE))
+NUM_COLUMN(gps_hdg, struct cloud_data_gps, GPS_PVT(data),
+	   scale(data->pvt.hdg, CBOR_COLUMNAR_SCALE_HEADING))
+STR_COLUMN(gps_nmea, struct cloud_data_gps,
+	   data->format == CLOUD_CODEC_GPS_FORMAT_NMEA, data->nmea)
+
+static const struct column gps_columns[] = {
+	{ CBOR_KEY(DATA_GPS_LONGITUDE), false, gps_lng },
+	{ CBOR_KEY(DATA_GPS_LATITUDE), false, gps_lat },
+	{ CBOR_KEY(DATA_MOVEMENT), false, gps_acc },
+	{ CBOR_KEY(DATA_GPS_ALTITUDE), false, gps_alt },
+	{ CBOR_KEY(DATA_GPS_SPEED), false, gps_spd },
+	{ CBOR_KEY(DATA_GPS_HEADING), false, gps_hdg },
+	{ CBOR_KEY(DATA_GPS_NMEA), true, gps_nmea },
+};
+
+static const struct table gps_table = {
+	.label = CBOR_KEY(DATA_GPS),
+	.entry_size = sizeof(struct cloud_data_gps),
+	.queued = gps_queued,
+	.unqueue = gps_unqueue,
+	.valid = gps_valid,
+	.uptime = gps_uptime,
+	.columns = gps_columns,
+	.column_count = ARRAY_SIZE(gps_columns),
+};
+
+/* Environmental sensors */
+
+ENTRY_FUNCTIONS(sensor, struct cloud_data_sensors, env_ts)
+
+NUM_COLUMN(sensor_temp, struct cloud_data_sensors, true,
+	   scale(data->temp, CBOR_COLUMNAR_SCALE_ENVIRONMENT))
+NUM_COLUMN(sensor_hum, struct cloud_data_sensors, true,
+	   scale(data->hum, CBOR_COLUMNAR_SCALE_ENVIRONMENT))
+
+static const struct column sensor_columns[] = {
+	{ CBOR_KEY(DATA_TEMPERATURE), false, sensor_temp },
+	{ CBOR_KEY(DATA_HUMID), false, sensor_hum },
+};
+
+static const struct table sensor_table = {
+	.label = CBOR_KEY(DATA_ENVIRONMENTALS),
+	.entry_size = sizeof(struct cloud_data_sensors),
+	.queued = sensor_queued,
+	.unqueue = sensor_unqueue,
+	.uptime = sensor_uptime,
+	.columns = sensor_columns,
+	.column_count = ARRAY_SIZE(sensor_columns),
+};
+
+/* Dynamic modem data */
+
+ENTRY_FUNCTIONS(modem_dynamic, struct cloud_data_modem_dynamic, ts)
+
+static bool modem_dynamic_valid(const void *entry)
+{
+	const struct cloud_data_modem_dynamic *data = entry;
+
+	return data->rsrp_fresh || data->area_code_fresh || data->mccmnc_fresh ||
+	       data->cell_id_fresh || data->ip_address_fresh;
+}
+
+static void modem_dynamic_mccmnc(const void *entry, struct column_value *value)
+{
+	const struct cloud_data_modem_dynamic *data = entry;
+	char *end_ptr;
+
+	value->present = false;
+
+	if (!data->mccmnc_fresh) {
+		return;
+	}
+
+	errno = 0;
+	value->num = strtoul(data->mccmnc, &end_ptr, 10);
+
+	if ((errno == ERANGE) || (*end_ptr != '\0')) {
+		LOG_WRN("MCCMNC string could not be converted.");
+		return;
+	}
+
+	value->present = true;
+}
+
+NUM_COLUMN(modem_dynamic_rsrp, struct cloud_data_modem_dynamic, data->rsrp_fresh, data->rsrp)
+NUM_COLUMN(modem_dynamic_area, struct cloud_data_modem_dynamic, data->area_code_fresh,
+	   data->area)
+NUM_COLUMN(modem_dynamic_cell, struct cloud_data_modem_dynamic, data->cell_id_fresh,
+	   data->cell)
+STR_COLUMN(modem_dynamic_ip, struct cloud_data_modem_dynamic, data->ip_address_fresh,
+	   data->ip)
+
+static const struct column modem_dynamic_columns[] = {
+	{ CBOR_KEY(MODEM_RSRP), false, modem_dynamic_rsrp },
+	{ CBOR_KEY(MODEM_AREA_CODE), false, modem_dynamic_area },
+	{ CBOR_KEY(MODEM_MCCMNC), false, modem_dynamic_mccmnc },
+	{ CBOR_KEY(MODEM_CELL_ID), false, modem_dynamic_cell },
+	{ CBOR_KEY(MODEM_IP_ADDRESS), true, modem_dynamic_ip },
+};
+
+static const struct table modem_dynamic_table = {
+	.label = CBOR_KEY(DATA_MODEM_DYNAMIC),
+	.entry_size = sizeof(struct cloud_data_modem_dynamic),
+	.queued = modem_dynamic_queued,
+	.unqueue = modem_dynamic_unqueue,
+	.valid = modem_dynamic_valid,
+	.uptime = modem_dynamic_uptime,
+	.columns = modem_dynamic_columns,
+	.column_count = ARRAY_SIZE(modem_dynamic_columns),
+};
+
+/* User Interface */
+
+ENTRY_FUNCTIONS(ui, struct cloud_data_ui, btn_ts)
+
+NUM_COLUMN(ui_btn, struct cloud_data_ui, true, data->btn)
+
+static const struct column ui_columns[] = {
+	{ CBOR_KEY(DATA_VALUE), false, ui_btn },
+};
+
+static const struct table ui_table = {
+	.label = CBOR_KEY(DATA_BUTTON),
+	.entry_size = sizeof(struct cloud_data_ui),
+	.queued = ui_queued,
+	.unqueue = ui_unqueue,
+	.uptime = ui_uptime,
+	.columns = ui_columns,
+	.column_count = ARRAY_SIZE(ui_columns),
+};
+
+/* Battery */
+
+ENTRY_FUNCTIONS(battery, struct cloud_data_battery, bat_ts)
+
+NUM_COLUMN(battery_bat, struct cloud_data_battery, true, data->bat)
+
+static const struct column battery_columns[] = {
+	{ CBOR_KEY(DATA_VALUE), false, battery_bat },
+};
+
+static const struct table battery_table = {
+	.label = CBOR_KEY(DATA_BATTERY),
+	.entry_size = sizeof(struct cloud_data_battery),
+	.queued = battery_queued,
+	.unqueue = battery_unqueue,
+	.uptime = battery_uptime,
+	.columns = battery_columns,
+	.column_count = ARRAY_SIZE(battery_columns),
+};
+
+/* Accelerometer */
+
+ENTRY_FUNCTIONS(accel, struct cloud_data_accelerometer, ts)
+
+NUM_COLUMN(accel_x, struct cloud_data_accelerometer, true,
+	   scale(data->values[0], CBOR_COLUMNAR_SCALE_ACCELERATION))
+NUM_COLUMN(accel_y, struct cloud_data_accelerometer, true,
+	   scale(data->values[1], CBOR_COLUMNAR_SCALE_ACCELERATION))
+NUM_COLUMN(accel_z, struct cloud_data_accelerometer, true,
+	   scale(data->values[2], CBOR_COLUMNAR_SCALE_ACCELERATION))
+
+static const struct column accel_columns[] = {
+	{ CBOR_KEY(DATA_MOVEMENT_X), false, accel_x },
+	{ CBOR_KEY(DATA_MOVEMENT_Y), false, accel_y },
+	{ CBOR_KEY(DATA_MOVEMENT_Z), false, accel_z },
+};
+
+static const struct table accel_table = {
+	.label = CBOR_KEY(DATA_MOVEMENT),
+	.entry_size = sizeof(struct cloud_data_accelerometer),
+	.queued = accel_queued,
+	.unqueue = accel_unqueue,
+	.uptime = accel_uptime,
+	.columns = accel_columns,
+	.column_count = ARRAY_SIZE(accel_columns),
+};
+
+static void *entry_get(const struct table_buffer *tb, size_t idx)
+{
+	return (uint8_t *)tb->buf + (idx % tb->count) * tb->table->entry_size;
+}
+
+/* Unqueue entries that cannot be encoded and return the number of the remaining queued entries
+ * and the index of the oldest one. Buffers are ring buffers, so iterating from the oldest entry
+ * keeps the entries ordered by time.
+ */
+static size_t queued_get(const struct table_buffer *tb, size_t *first)
+{
+	const struct table *t = tb->table;
+	size_t count = 0;
+	int64_t oldest = INT64_MAX;
+
+	*first = 0;
+
+	for (size_t i = 0; i < tb->count; i++) {
+		void *entry = entry_get(tb, i);
+
+		if (!t->queued(entry)) {
+			continue;
+		}
+
+		if (t->valid && !t->valid(entry)) {
+			LOG_WRN("Invalid entry unqueued");
+			t->unqueue(entry);
+			continue;
+		}
+
+		if (t->uptime(entry) < oldest) {
+			oldest = t->uptime(entry);
+			*first = i;
+		}
+
+		count++;
+	}
+
+	return count;
+}
+
+/* Get the queued entry at or after index idx and move idx past it. */
+static void *queued_next(const struct table_buffer *tb, size_t *idx)
+{
+	void *entry;
+
+	do {
+		entry = entry_get(tb, (*idx)++);
+	} while (!tb->table->queued(entry));
+
+	return entry;
+}
+
+static int timestamps_add(struct cbor_writer *w, const struct table_buffer *tb, size_t first,
+			  size_t limit)
+{
+	int err;
+	int64_t prev = 0;
+	size_t idx = first;
+
+	cbor_add_key(w, CBOR_KEY(DATA_TIMESTAMP));
+	cbor_array_start(w);
+
+	for (size_t i = 0; i < limit; i++) {
+		int64_t ts = tb->table->uptime(queued_next(tb, &idx));
+
+		/* Converted on a copy, entries that do not fit are encoded again later. */
+		err = date_time_uptime_to_unix_time_ms(&ts);
+		if (err) {
+			LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+			return err;
+		}
+
+		cbor_add_int(w, ts - prev);
+		prev = ts;
+	}
+
+	cbor_container_end(w);
+
+	return 0;
+}
+
+static void column_add(struct cbor_writer *w, const struct table_buffer *tb,
+		       const struct column *col, size_t first, size_t limit)
+{
+	struct column_value value;
+	bool present = false;
+	int64_t prev = 0;
+	size_t idx = first;
+
+	for (size_t i = 0; (i < limit) && !present; i++) {
+		col->get(queued_next(tb, &idx), &value);
+		present = value.present;
+	}
+
+	if (!present) {
+		return;
+	}
+
+	cbor_add_key(w, col->key);
+	cbor_array_start(w);
+
+	idx = first;
+
+	for (size_t i = 0; i < limit; i++) {
+		col->get(queued_next(tb, &idx), &value);
+
+		if (!value.present) {
+			cbor_add_null(w);
+		} else if (col->is_str) {
+			cbor_add_str(w, value.str);
+		} else {
+			cbor_add_int(w, value.num - prev);
+			prev = value.num;
+		}
+	}
+
+	cbor_container_end(w);
+}
+
+static int table_encode(struct cbor_writer *w, const struct table_buffer *tb, size_t first,
+			size_t limit)
+{
+	int err;
+
+	cbor_add_key(w, tb->table->label);
+	cbor_map_start(w);
+
+	err = timestamps_add(w, tb, first, limit);
+	if (err) {
+		return err;
+	}
+
+	for (size_t i = 0; i < tb->table->column_count; i++) {
+		column_add(w, tb, &tb->table->columns[i], first, limit);
+	}
+
+	cbor_container_end(w);
+
+	return w->err;
+}
+
+/* Add the table with all queued entries. If it does not fit in the output buffer, the number of
+ * entries is halved until it fits, the newest entries stay queued and -ENOMEM is returned.
+ */
+static int table_add(struct cbor_writer *w, const struct table_buffer *tb)
+{
+	size_t first;
+	size_t count;
+	size_t limit;
+	size_t idx;
+	int err;
+
+	if ((tb->buf == NULL) || (tb->count == 0)) {
+		return 0;
+	}
+
+	count = queued_get(tb, &first);
+	limit = count;
+
+	while (limit > 0) {
+		struct cbor_writer start = *w;
+
+		err = table_encode(w, tb, first, limit);
+		if (err == 0) {
+			break;
+		}
+
+		*w = start;
+
+		if (err != -ENOMEM) {
+			return err;
+		}
+
+		limit /= 2;
+	}
+
+	idx = first;
+
+	for (size_t i = 0; i < limit; i++) {
+		tb->table->unqueue(queued_next(tb, &idx));
+	}
+
+	return (limit < count) ? -ENOMEM : 0;
+}
+
+int cbor_columnar_batch_data_add(struct cbor_writer *w,
+				 struct cloud_data_gps *gps_buf,
+				 struct cloud_data_sensors *sensor_buf,
+				 struct cloud_data_modem_dynamic *modem_dyn_buf,
+				 struct cloud_data_ui *ui_buf,
+				 struct cloud_data_accelerometer *accel_buf,
+				 struct cloud_data_battery *bat_buf,
+				 size_t gps_buf_count,
+				 size_t sensor_buf_count,
+				 size_t modem_dyn_buf_count,
+				 size_t ui_buf_count,
+				 size_t accel_buf_count,
+				 size_t bat_buf_count)
+{
+	int err;
+	const struct table_buffer tables[] = {
+		{ &modem_dynamic_table, modem_dyn_buf, modem_dyn_buf_count },
+		{ &gps_table, gps_buf, gps_buf_count },
+		{ &sensor_table, sensor_buf, sensor_buf_count },
+		{ &ui_table, ui_buf, ui_buf_count },
+		{ &battery_table, bat_buf, bat_buf_count },
+		{ &accel_table, accel_buf, accel_buf_count },
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(tables); i++) {
+		err = table_add(w, &tables[i]);
+		if (err == -ENOMEM) {
+			LOG_WRN("CBOR output buffer full, remaining entries stay queued");
+			return 0;
+		} else if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
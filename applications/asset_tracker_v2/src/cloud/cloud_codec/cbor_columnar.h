@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**@file
+ * @brief CBOR columnar batch encoding library header.
+ */
+
+#ifndef CBOR_COLUMNAR_H__
+#define CBOR_COLUMNAR_H__
+
+/**@file
+ *
+ * @defgroup CBOR columnar cbor_columnar
+ * @brief    Module encoding batch data in columnar CBOR format.
+ *
+ * Every data type is encoded as a map of columns, instead of an array of entries. The map
+ * contains the timestamp column and one column per value, keyed with the names used by the
+ * JSON protocol. Columns are arrays with one item per entry, entries are ordered from the
+ * oldest one.
+ *
+ * Numeric columns hold integers. Every item is the difference from the previous value in the
+ * same column, the first item is the difference from zero. Slowly changing values are then
+ * encoded with a single byte. Values that are not integers are scaled with the factors below
+ * and rounded. A missing value is encoded as null and does not change the reference value of
+ * the column. A column with no values is left out. String columns are not delta encoded.
+ *
+ * The scripts/cbor_batch_decode.py script in the application directory decodes the format.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+
+#include "cloud_codec.h"
+#include "cbor_helpers.h"
+
+/** Scale of GPS longitude and latitude, 1e-7 degrees. */
+#define CBOR_COLUMNAR_SCALE_COORDINATE	10000000
+/** Scale of GPS altitude, accuracy and speed, centimeters and centimeters per second. */
+#define CBOR_COLUMNAR_SCALE_DISTANCE	100
+/** Scale of GPS heading, 0.01 degree. */
+#define CBOR_COLUMNAR_SCALE_HEADING	100
+/** Scale of temperature and humidity, 0.01 degree Celsius and 0.01 percent. */
+#define CBOR_COLUMNAR_SCALE_ENVIRONMENT	100
+/** Scale of accelerometer values, 0.01 m/s2. */
+#define CBOR_COLUMNAR_SCALE_ACCELERATION 100
+
+/**
+ * @brief Add columns of all queued entries in the passed in buffers to the map that is open in
+ *        the writer.
+ *
+ * Encoded entries are unqueued. If the output buffer becomes full, the entries that did not fit
+ * stay queued, starting with the newest ones, so that they are encoded in the next batch.
+ *
+ * @return 0 on success, also if the output buffer became full or no entry was queued.
+ *         Otherwise a negative error code is returned.
+ */
+int cbor_columnar_batch_data_add(struct cbor_writer *w,
+				 struct cloud_data_gps *gps_buf,
+				 struct cloud_data_sensors *sensor_buf,
+				 struct cloud_data_modem_dynamic *modem_dyn_buf,
+				 struct cloud_data_ui *ui_buf,
+				 struct cloud_data_accelerometer *accel_buf,
+				 struct cloud_data_battery *bat_buf,
+				 size_t gps_buf_count,
+				 size_t sensor_buf_count,
+				 size_t modem_dyn_buf_count,
+				 size_t ui_buf_count,
+				 size_t accel_buf_count,
+				 size_t bat_buf_count);
+
+#ifdef __cplusplus
+}
+#endif
+/**
+ * @}
+ */
+#endif /* CBOR_COLUMNAR_H__ */
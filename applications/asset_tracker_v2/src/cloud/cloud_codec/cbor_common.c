@@ -0,0 +1,588 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <date_time.h>
+
+#include "cloud_codec.h"
+#include "cbor_common.h"
+#include "cbor_columnar.h"
+#include "cbor_helpers.h"
+#include "json_protocol_names.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(cbor_common, CONFIG_CLOUD_CODEC_LOG_LEVEL);
+
+enum entry_type {
+	ENTRY_UI,
+	ENTRY_MODEM_DYNAMIC,
+	ENTRY_GPS,
+	ENTRY_SENSOR,
+	ENTRY_ACCELEROMETER,
+	ENTRY_BATTERY,
+};
+
+struct batch_buffer {
+	struct cbor_key label;
+	enum entry_type type;
+	void *buf;
+	size_t count;
+};
+
+/* Timestamps are converted on a copy, so that an entry that did not fit in the output buffer
+ * keeps its uptime timestamp and can be encoded again later.
+ */
+static int timestamp_get(int64_t uptime, int64_t *ts)
+{
+	int err;
+
+	*ts = uptime;
+
+	err = date_time_uptime_to_unix_time_ms(ts);
+	if (err) {
+		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+	}
+
+	return err;
+}
+
+static void timestamp_add(struct cbor_writer *w, int64_t ts)
+{
+	cbor_add_key(w, CBOR_KEY(DATA_TIMESTAMP));
+	cbor_add_int(w, ts);
+}
+
+static int ui_entry_add(struct cbor_writer *w, struct cloud_data_ui *data)
+{
+	int err;
+	int64_t ts;
+
+	if (!data->queued) {
+		return -ENODATA;
+	}
+
+	err = timestamp_get(data->btn_ts, &ts);
+	if (err) {
+		return err;
+	}
+
+	cbor_map_start(w);
+	cbor_add_key(w, CBOR_KEY(DATA_VALUE));
+	cbor_add_int(w, data->btn);
+	timestamp_add(w, ts);
+	cbor_container_end(w);
+
+	if (w->err) {
+		return w->err;
+	}
+
+	data->queued = false;
+
+	return 0;
+}
+
+static int modem_dynamic_entry_add(struct cbor_writer *w, struct cloud_data_modem_dynamic *data)
+{
+	int err;
+	int64_t ts;
+	uint32_t mccmnc = 0;
+	char *end_ptr;
+
+	if (!data->queued) {
+		return -ENODATA;
+	}
+
+	if (!data->rsrp_fresh && !data->area_code_fresh && !data->mccmnc_fresh &&
+	    !data->cell_id_fresh && !data->ip_address_fresh) {
+		data->queued = false;
+		LOG_WRN("No valid dynamic modem data values present, entry unqueued");
+		return -ENODATA;
+	}
+
+	if (data->mccmnc_fresh) {
+		/* Convert mccmnc to unsigned long integer. */
+		errno = 0;
+		mccmnc = strtoul(data->mccmnc, &end_ptr, 10);
+
+		if ((errno == ERANGE) || (*end_ptr != '\0')) {
+			LOG_ERR("MCCMNC string could not be converted.");
+			return -ENOTEMPTY;
+		}
+	}
+
+	err = timestamp_get(data->ts, &ts);
+	if (err) {
+		return err;
+	}
+
+	cbor_map_start(w);
+	cbor_add_key(w, CBOR_KEY(DATA_VALUE));
+	cbor_map_start(w);
+
+	if (data->rsrp_fresh) {
+		cbor_add_key(w, CBOR_KEY(MODEM_RSRP));
+		cbor_add_int(w, data->rsrp);
+	}
+
+	if (data->area_code_fresh) {
+		cbor_add_key(w, CBOR_KEY(MODEM_AREA_CODE));
+		cbor_add_uint(w, data->area);
+	}
+
+	if (data->mccmnc_fresh) {
+		cbor_add_key(w, CBOR_KEY(MODEM_MCCMNC));
+		cbor_add_uint(w, mccmnc);
+	}
+
+	if (data->cell_id_fresh) {
+		cbor_add_key(w, CBOR_KEY(MODEM_CELL_ID));
+		cbor_add_uint(w, data->cell);
+	}
+
+	if (data->ip_address_fresh) {
+		cbor_add_key(w, CBOR_KEY(MODEM_IP_ADDRESS));
+		cbor_add_str(w, data->ip);
+	}
+
+	cbor_container_end(w);
+	timestamp_add(w, ts);
+	cbor_container_end(w);
+
+	if (w->err) {
+		return w->err;
+	}
+
+	data->queued = false;
+
+	return 0;
+}
+
+static int gps_entry_add(struct cbor_writer *w, struct cloud_data_gps *data)
+{
+	int err;
+	int64_t ts;
+
+	if (!data->queued) {
+		return -ENODATA;
+	}
+
+	if ((data->format != CLOUD_CODEC_GPS_FORMAT_PVT) &&
+	    (data->format != CLOUD_CODEC_GPS_FORMAT_NMEA)) {
+		LOG_WRN("GPS data format not set");
+		return -EINVAL;
+	}
+
+	err = timestamp_get(data->gps_ts, &ts);
+	if (err) {
+		return err;
+	}
+
+	cbor_map_start(w);
+	cbor_add_key(w, CBOR_KEY(DATA_VALUE));
+
+	if (data->format == CLOUD_CODEC_GPS_FORMAT_PVT) {
+		/* Coordinates need double precision, the remaining values are single precision
+		 * already.
+		 */
+		cbor_map_start(w);
+		cbor_add_key(w, CBOR_KEY(DATA_GPS_LONGITUDE));
+		cbor_add_double(w, data->pvt.longi);
+		cbor_add_key(w, CBOR_KEY(DATA_GPS_LATITUDE));
+		cbor_add_double(w, data->pvt.lat);
+		cbor_add_key(w, CBOR_KEY(DATA_MOVEMENT));
+		cbor_add_float(w, data->pvt.acc);
+		cbor_add_key(w, CBOR_KEY(DATA_GPS_ALTITUDE));
+		cbor_add_float(w, data->pvt.alt);
+		cbor_add_key(w, CBOR_KEY(DATA_GPS_SPEED));
+		cbor_add_float(w, data->pvt.spd);
+		cbor_add_key(w, CBOR_KEY(DATA_GPS_HEADING));
+		cbor_add_float(w, data->pvt.hdg);
+		cbor_container_end(w);
+	} else {
+		cbor_add_str(w, data->nmea);
+	}
+
+	timestamp_add(w, ts);
+	cbor_container_end(w);
+
+	if (w->err) {
+		return w->err;
+	}
+
+	data->queued = false;
+
+	return 0;
+}
+
+static int sensor_entry_add(struct cbor_writer *w, struct cloud_data_sensors *data)
+{
+	int err;
+	int64_t ts;
+
+	if (!data->queued) {
+		return -ENODATA;
+	}
+
+	err = timestamp_get(data->env_ts, &ts);
+	if (err) {
+		return err;
+	}
+
+	/* Single precision covers the sensor resolution. */
+	cbor_map_start(w);
+	cbor_add_key(w, CBOR_KEY(DATA_VALUE));
+	cbor_map_start(w);
+	cbor_add_key(w, CBOR_KEY(DATA_TEMPERATURE));
+	cbor_add_float(w, data->temp);
+	cbor_add_key(w, CBOR_KEY(DATA_HUMID));
+	cbor_add_float(w, data->hum);
+	cbor_container_end(w);
+	timestamp_add(w, ts);
+	cbor_container_end(w);
+
+	if (w->err) {
+		return w->err;
+	}
+
+	data->queued = false;
+
+	return 0;
+}
+
+static int accel_entry_add(struct cbor_writer *w, struct cloud_data_accelerometer *data)
+{
+	int err;
+	int64_t ts;
+
+	if (!data->queued) {
+		return -ENODATA;
+	}
+
+	err = timestamp_get(data->ts, &ts);
+	if (err) {
+		return err;
+	}
+
+	cbor_map_start(w);
+	cbor_add_key(w, CBOR_KEY(DATA_VALUE));
+	cbor_map_start(w);
+	cbor_add_key(w, CBOR_KEY(DATA_MOVEMENT_X));
+	cbor_add_float(w, data->values[0]);
+	cbor_add_key(w, CBOR_KEY(DATA_MOVEMENT_Y));
+	cbor_add_float(w, data->values[1]);
+	cbor_add_key(w, CBOR_KEY(DATA_MOVEMENT_Z));
+	cbor_add_float(w, data->values[2]);
+	cbor_container_end(w);
+	timestamp_add(w, ts);
+	cbor_container_end(w);
+
+	if (w->err) {
+		return w->err;
+	}
+
+	data->queued = false;
+
+	return 0;
+}
+
+static int battery_entry_add(struct cbor_writer *w, struct cloud_data_battery *data)
+{
+	int err;
+	int64_t ts;
+
+	if (!data->queued) {
+		return -ENODATA;
+	}
+
+	err = timestamp_get(data->bat_ts, &ts);
+	if (err) {
+		return err;
+	}
+
+	cbor_map_start(w);
+	cbor_add_key(w, CBOR_KEY(DATA_VALUE));
+	cbor_add_uint(w, data->bat);
+	timestamp_add(w, ts);
+	cbor_container_end(w);
+
+	if (w->err) {
+		return w->err;
+	}
+
+	data->queued = false;
+
+	return 0;
+}
+
+static int entry_add(struct cbor_writer *w, enum entry_type type, void *buf, size_t idx)
+{
+	switch (type) {
+	case ENTRY_UI:
+		return ui_entry_add(w, &((struct cloud_data_ui *)buf)[idx]);
+	case ENTRY_MODEM_DYNAMIC:
+		return modem_dynamic_entry_add(w, &((struct cloud_data_modem_dynamic *)buf)[idx]);
+	case ENTRY_GPS:
+		return gps_entry_add(w, &((struct cloud_data_gps *)buf)[idx]);
+	case ENTRY_SENSOR:
+		return sensor_entry_add(w, &((struct cloud_data_sensors *)buf)[idx]);
+	case ENTRY_ACCELEROMETER:
+		return accel_entry_add(w, &((struct cloud_data_accelerometer *)buf)[idx]);
+	case ENTRY_BATTERY:
+		return battery_entry_add(w, &((struct cloud_data_battery *)buf)[idx]);
+	default:
+		LOG_WRN("Unknown buffer type: %d", type);
+		return -ENODATA;
+	}
+}
+
+/* Add an array with all queued entries of the buffer. Nothing is added if no entry is queued.
+ * If an entry does not fit in the output, the writer is rolled back to the end of the previous
+ * entry and -ENOMEM is returned.
+ */
+static int batch_add(struct cbor_writer *w, const struct batch_buffer *batch)
+{
+	struct cbor_writer start = *w;
+	size_t added = 0;
+	bool full = false;
+	int err;
+
+	cbor_add_key(w, batch->label);
+	cbor_array_start(w);
+
+	if (w->err) {
+		*w = start;
+		return -ENOMEM;
+	}
+
+	for (size_t i = 0; i < batch->count; i++) {
+		struct cbor_writer entry_start = *w;
+
+		err = entry_add(w, batch->type, batch->buf, i);
+		if (err == -ENODATA) {
+			continue;
+		} else if (err == -ENOMEM) {
+			/* This and the following entries stay queued. */
+			*w = entry_start;
+			full = true;
+			break;
+		} else if (err) {
+			return err;
+		}
+
+		added++;
+	}
+
+	if (added == 0) {
+		*w = start;
+	} else {
+		cbor_container_end(w);
+	}
+
+	return full ? -ENOMEM : 0;
+}
+
+static int batch_entries_add(struct cbor_writer *w, const struct batch_buffer *batch,
+			     size_t batch_count)
+{
+	int err;
+
+	for (size_t i = 0; i < batch_count; i++) {
+		err = batch_add(w, &batch[i]);
+		if (err == -ENOMEM) {
+			LOG_WRN("CBOR output buffer full, remaining entries stay queued");
+			return 0;
+		} else if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static int output_init(struct cbor_writer *w)
+{
+	uint8_t *buf = k_malloc(CONFIG_CLOUD_CODEC_CBOR_BUF_SIZE);
+
+	if (buf == NULL) {
+		LOG_ERR("Failed to allocate memory for CBOR output");
+		return -ENOMEM;
+	}
+
+	cbor_writer_init(w, buf, CONFIG_CLOUD_CODEC_CBOR_BUF_SIZE);
+
+	return 0;
+}
+
+static int output_finish(struct cloud_codec_data *output, struct cbor_writer *w, int err)
+{
+	if (!err) {
+		err = w->err;
+	}
+
+	if (err) {
+		k_free(w->buf);
+		return err;
+	}
+
+	LOG_HEXDUMP_DBG(w->buf, w->len, "Encoded message:");
+
+	output->buf = (char *)w->buf;
+	output->len = w->len;
+
+	return 0;
+}
+
+int cbor_common_encode_ui_data(struct cloud_codec_data *output,
+			       struct cloud_data_ui *ui_buf)
+{
+	int err;
+	struct cbor_writer w;
+
+	if (!ui_buf->queued) {
+		return -ENODATA;
+	}
+
+	err = output_init(&w);
+	if (err) {
+		return err;
+	}
+
+	cbor_map_start(&w);
+	cbor_add_key(&w, CBOR_KEY(DATA_BUTTON));
+	err = ui_entry_add(&w, ui_buf);
+	cbor_container_end(&w);
+
+	return output_finish(output, &w, err);
+}
+
+int cbor_common_encode_neighbor_cells(struct cloud_codec_data *output,
+				      struct cloud_data_neighbor_cells *neighbor_cells)
+{
+	int err;
+	int64_t ts;
+	struct cbor_writer w;
+	struct lte_lc_cell *cell = &neighbor_cells->cell_data.current_cell;
+
+	if (!neighbor_cells->queued) {
+		return -ENODATA;
+	}
+
+	err = timestamp_get(neighbor_cells->ts, &ts);
+	if (err) {
+		return err;
+	}
+
+	err = output_init(&w);
+	if (err) {
+		return err;
+	}
+
+	cbor_map_start(&w);
+	cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_MCC));
+	cbor_add_int(&w, cell->mcc);
+	cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_MNC));
+	cbor_add_int(&w, cell->mnc);
+	cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_CID));
+	cbor_add_uint(&w, cell->id);
+	cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_TAC));
+	cbor_add_uint(&w, cell->tac);
+	cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_EARFCN));
+	cbor_add_uint(&w, cell->earfcn);
+	cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_TIMING));
+	cbor_add_uint(&w, cell->timing_advance);
+	cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_RSRP));
+	cbor_add_int(&w, cell->rsrp);
+	cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_RSRQ));
+	cbor_add_int(&w, cell->rsrq);
+	timestamp_add(&w, ts);
+
+	if (neighbor_cells->cell_data.ncells_count > 0) {
+		cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_NEIGHBOR_MEAS));
+		cbor_array_start(&w);
+
+		for (size_t i = 0; i < neighbor_cells->cell_data.ncells_count; i++) {
+			struct lte_lc_ncell *ncell = &neighbor_cells->neighbor_cells[i];
+
+			cbor_map_start(&w);
+			cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_EARFCN));
+			cbor_add_uint(&w, ncell->earfcn);
+			cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_PCI));
+			cbor_add_uint(&w, ncell->phys_cell_id);
+			cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_RSRP));
+			cbor_add_int(&w, ncell->rsrp);
+			cbor_add_key(&w, CBOR_KEY(DATA_NEIGHBOR_CELLS_RSRQ));
+			cbor_add_int(&w, ncell->rsrq);
+			cbor_container_end(&w);
+		}
+
+		cbor_container_end(&w);
+	}
+
+	cbor_container_end(&w);
+
+	err = output_finish(output, &w, 0);
+	if (err) {
+		return err;
+	}
+
+	neighbor_cells->queued = false;
+
+	return 0;
+}
+
+int cbor_common_encode_batch_data(struct cloud_codec_data *output,
+				  struct cloud_data_gps *gps_buf,
+				  struct cloud_data_sensors *sensor_buf,
+				  struct cloud_data_modem_dynamic *modem_dyn_buf,
+				  struct cloud_data_ui *ui_buf,
+				  struct cloud_data_accelerometer *accel_buf,
+				  struct cloud_data_battery *bat_buf,
+				  size_t gps_buf_count,
+				  size_t sensor_buf_count,
+				  size_t modem_dyn_buf_count,
+				  size_t ui_buf_count,
+				  size_t accel_buf_count,
+				  size_t bat_buf_count)
+{
+	int err = 0;
+	size_t empty_len;
+	struct cbor_writer w;
+	const struct batch_buffer batch[] = {
+		{ CBOR_KEY(DATA_MODEM_DYNAMIC), ENTRY_MODEM_DYNAMIC,
+		  modem_dyn_buf, modem_dyn_buf_count },
+		{ CBOR_KEY(DATA_GPS), ENTRY_GPS, gps_buf, gps_buf_count },
+		{ CBOR_KEY(DATA_ENVIRONMENTALS), ENTRY_SENSOR, sensor_buf, sensor_buf_count },
+		{ CBOR_KEY(DATA_BUTTON), ENTRY_UI, ui_buf, ui_buf_count },
+		{ CBOR_KEY(DATA_BATTERY), ENTRY_BATTERY, bat_buf, bat_buf_count },
+		{ CBOR_KEY(DATA_MOVEMENT), ENTRY_ACCELEROMETER, accel_buf, accel_buf_count },
+	};
+
+	err = output_init(&w);
+	if (err) {
+		return err;
+	}
+
+	cbor_map_start(&w);
+	empty_len = w.len;
+
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR_BATCH_COLUMNAR)) {
+		err = cbor_columnar_batch_data_add(&w, gps_buf, sensor_buf, modem_dyn_buf, ui_buf,
+						   accel_buf, bat_buf, gps_buf_count,
+						   sensor_buf_count, modem_dyn_buf_count,
+						   ui_buf_count, accel_buf_count, bat_buf_count);
+	} else {
+		err = batch_entries_add(&w, batch, ARRAY_SIZE(batch));
+	}
+
+	if (!err && (w.len == empty_len)) {
+		LOG_DBG("No data to encode, CBOR output empty...");
+		err = -ENODATA;
+	}
+
+	cbor_container_end(&w);
+
+	return output_finish(output, &w, err);
+}
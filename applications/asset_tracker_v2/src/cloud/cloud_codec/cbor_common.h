@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**@file
+ * @brief CBOR common library header.
+ */
+
+#ifndef CBOR_COMMON_H__
+#define CBOR_COMMON_H__
+
+/**@file
+ *
+ * @defgroup CBOR common cbor_common
+ * @brief    Module containing common CBOR encoding functions.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+
+#include "cloud_codec.h"
+
+/* Messages encoded by this module have the same structure and keys as the messages encoded by
+ * the JSON common module. Data is streamed directly into a single output buffer of
+ * CONFIG_CLOUD_CODEC_CBOR_BUF_SIZE bytes, that is released using cloud_codec_release_data().
+ */
+
+/**
+ * @brief Encode User Interface data.
+ *
+ * @param[out] output Encoded output.
+ * @param[in] ui_buf Pointer to data that is to be encoded.
+ *
+ * @return 0 on success. -ENODATA if the passed in data is not queued. -ENOMEM if the output buffer
+ *         cannot be allocated or is too small. Otherwise a negative error code is returned.
+ */
+int cbor_common_encode_ui_data(struct cloud_codec_data *output,
+			       struct cloud_data_ui *ui_buf);
+
+/**
+ * @brief Encode neighbor cell data.
+ *
+ * @param[out] output Encoded output.
+ * @param[in] neighbor_cells Pointer to data that is to be encoded.
+ *
+ * @return 0 on success. -ENODATA if the passed in data is not queued. -ENOMEM if the output buffer
+ *         cannot be allocated or is too small. Otherwise a negative error code is returned.
+ */
+int cbor_common_encode_neighbor_cells(struct cloud_codec_data *output,
+				      struct cloud_data_neighbor_cells *neighbor_cells);
+
+/**
+ * @brief Encode all queued entries in the passed in buffers.
+ *
+ * If the output buffer becomes full, the message is closed and the entries that did not fit
+ * stay queued, so that they are encoded in the next batch.
+ *
+ * @return 0 on success. -ENODATA if there is no queued data. -ENOMEM if the output buffer cannot
+ *         be allocated. Otherwise a negative error code is returned.
+ */
+int cbor_common_encode_batch_data(struct cloud_codec_data *output,
+				  struct cloud_data_gps *gps_buf,
+				  struct cloud_data_sensors *sensor_buf,
+				  struct cloud_data_modem_dynamic *modem_dyn_buf,
+				  struct cloud_data_ui *ui_buf,
+				  struct cloud_data_accelerometer *accel_buf,
+				  struct cloud_data_battery *bat_buf,
+				  size_t gps_buf_count,
+				  size_t sensor_buf_count,
+				  size_t modem_dyn_buf_count,
+				  size_t ui_buf_count,
+				  size_t accel_buf_count,
+				  size_t bat_buf_count);
+
+#ifdef __cplusplus
+}
+#endif
+/**
+ * @}
+ */
+#endif /* CBOR_COMMON_H__ */
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/__assert.h>
+
+#include "cbor_helpers.h"
+
+#define MAJOR_UINT	0
+#define MAJOR_NEGINT	1
+#define MAJOR_TEXT	3
+#define MAJOR_ARRAY	4
+#define MAJOR_MAP	5
+#define MAJOR_SIMPLE	7
+
+#define ARG_UINT8	24
+#define ARG_UINT16	25
+#define ARG_UINT32	26
+#define ARG_UINT64	27
+#define ARG_INDEFINITE	31
+
+#define SIMPLE_FALSE	20
+#define SIMPLE_TRUE	21
+#define SIMPLE_NULL	22
+
+#define INITIAL_BYTE(major, arg) ((uint8_t)(((major) << 5) | (arg)))
+#define BREAK_BYTE INITIAL_BYTE(MAJOR_SIMPLE, ARG_INDEFINITE)
+
+/* Check that n more bytes fit next to the reserved break bytes, or set the error. */
+static bool has_space(struct cbor_writer *w, size_t n)
+{
+	if (w->err) {
+		return false;
+	}
+
+	if (w->len + w->reserved + n > w->size) {
+		w->err = -ENOMEM;
+		return false;
+	}
+
+	return true;
+}
+
+/* Get space for n bytes or set the error if the remaining space is too small. */
+static uint8_t *reserve(struct cbor_writer *w, size_t n)
+{
+	if (!has_space(w, n)) {
+		return NULL;
+	}
+
+	uint8_t *ptr = &w->buf[w->len];
+
+	w->len += n;
+
+	return ptr;
+}
+
+static void put_be(uint8_t *ptr, uint64_t value, size_t n)
+{
+	for (size_t i = n; i > 0; i--) {
+		ptr[i - 1] = (uint8_t)value;
+		value >>= 8;
+	}
+}
+
+static void put_head(struct cbor_writer *w, uint8_t major, uint64_t arg)
+{
+	uint8_t info;
+	size_t n;
+
+	if (arg < ARG_UINT8) {
+		info = arg;
+		n = 0;
+	} else if (arg <= UINT8_MAX) {
+		info = ARG_UINT8;
+		n = sizeof(uint8_t);
+	} else if (arg <= UINT16_MAX) {
+		info = ARG_UINT16;
+		n = sizeof(uint16_t);
+	} else if (arg <= UINT32_MAX) {
+		info = ARG_UINT32;
+		n = sizeof(uint32_t);
+	} else {
+		info = ARG_UINT64;
+		n = sizeof(uint64_t);
+	}
+
+	uint8_t *ptr = reserve(w, 1 + n);
+
+	if (ptr) {
+		ptr[0] = INITIAL_BYTE(major, info);
+		put_be(&ptr[1], arg, n);
+	}
+}
+
+static void container_start(struct cbor_writer *w, uint8_t major)
+{
+	/* The start byte and the break byte ending the container must both fit. */
+	if (!has_space(w, 2)) {
+		return;
+	}
+
+	w->buf[w->len++] = INITIAL_BYTE(major, ARG_INDEFINITE);
+	w->reserved++;
+}
+
+void cbor_writer_init(struct cbor_writer *w, uint8_t *buf, size_t size)
+{
+	w->buf = buf;
+	w->size = size;
+	w->len = 0;
+	w->reserved = 0;
+	w->err = 0;
+}
+
+void cbor_map_start(struct cbor_writer *w)
+{
+	container_start(w, MAJOR_MAP);
+}
+
+void cbor_array_start(struct cbor_writer *w)
+{
+	container_start(w, MAJOR_ARRAY);
+}
+
+void cbor_container_end(struct cbor_writer *w)
+{
+	if (w->err) {
+		return;
+	}
+
+	__ASSERT_NO_MSG(w->reserved > 0);
+	__ASSERT_NO_MSG(w->len < w->size);
+
+	/* Space for the break byte was reserved when the container was started. */
+	w->reserved--;
+	w->buf[w->len++] = BREAK_BYTE;
+}
+
+void cbor_add_key(struct cbor_writer *w, struct cbor_key key)
+{
+	__ASSERT_NO_MSG(key.len <= CBOR_KEY_LEN_MAX);
+
+	uint8_t *ptr = reserve(w, 1 + key.len);
+
+	if (ptr) {
+		ptr[0] = INITIAL_BYTE(MAJOR_TEXT, key.len);
+		memcpy(&ptr[1], key.str, key.len);
+	}
+}
+
+void cbor_add_uint(struct cbor_writer *w, uint64_t value)
+{
+	put_head(w, MAJOR_UINT, value);
+}
+
+void cbor_add_int(struct cbor_writer *w, int64_t value)
+{
+	if (value >= 0) {
+		put_head(w, MAJOR_UINT, value);
+	} else {
+		/* Negative integers are encoded as -1 - n. */
+		put_head(w, MAJOR_NEGINT, -1 - value);
+	}
+}
+
+void cbor_add_bool(struct cbor_writer *w, bool value)
+{
+	put_head(w, MAJOR_SIMPLE, value ? SIMPLE_TRUE : SIMPLE_FALSE);
+}
+
+void cbor_add_null(struct cbor_writer *w)
+{
+	put_head(w, MAJOR_SIMPLE, SIMPLE_NULL);
+}
+
+void cbor_add_float(struct cbor_writer *w, float value)
+{
+	uint32_t raw;
+	uint8_t *ptr = reserve(w, 1 + sizeof(raw));
+
+	if (ptr) {
+		memcpy(&raw, &value, sizeof(raw));
+		ptr[0] = INITIAL_BYTE(MAJOR_SIMPLE, ARG_UINT32);
+		put_be(&ptr[1], raw, sizeof(raw));
+	}
+}
+
+void cbor_add_double(struct cbor_writer *w, double value)
+{
+	uint64_t raw;
+	uint8_t *ptr = reserve(w, 1 + sizeof(raw));
+
+	if (ptr) {
+		memcpy(&raw, &value, sizeof(raw));
+		ptr[0] = INITIAL_BYTE(MAJOR_SIMPLE, ARG_UINT64);
+		put_be(&ptr[1], raw, sizeof(raw));
+	}
+}
+
+void cbor_add_str(struct cbor_writer *w, const char *str)
+{
+	size_t len = strlen(str);
+
+	put_head(w, MAJOR_TEXT, len);
+
+	uint8_t *ptr = reserve(w, len);
+
+	if (ptr) {
+		memcpy(ptr, str, len);
+	}
+}
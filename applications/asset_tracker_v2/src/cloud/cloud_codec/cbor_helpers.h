@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CBOR_HELPERS_H__
+#define CBOR_HELPERS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/types.h>
+#include <sys/util.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum length of a key that is encoded with a single byte header. */
+#define CBOR_KEY_LEN_MAX 23
+
+/** @brief CBOR text string used as a map key. */
+struct cbor_key {
+	const char *str;
+	uint8_t len;
+};
+
+/**
+ * @brief Create a map key from a string literal.
+ *
+ * The key length is known at compile time, so adding the key to the output is a single header
+ * byte followed by a copy of the string. Keys longer than CBOR_KEY_LEN_MAX cause a build error.
+ */
+#define CBOR_KEY(_str)								\
+	((struct cbor_key) {							\
+		.str = (_str),							\
+		.len = sizeof(_str) - 1 +					\
+		       ZERO_OR_COMPILE_ERROR(sizeof(_str) <= CBOR_KEY_LEN_MAX + 1) \
+	})
+
+/**
+ * @brief Streaming CBOR writer.
+ *
+ * Items are encoded directly into the output buffer. Maps and arrays are encoded with indefinite
+ * length, so that the number of items does not need to be known in advance. Space for the break
+ * bytes of all open maps and arrays is reserved when they are started, so that a writer that ran
+ * out of space can always be closed.
+ *
+ * Errors are sticky. After the first error all subsequent writes are ignored and the error is
+ * kept in the err member.
+ */
+struct cbor_writer {
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+	/** Number of bytes reserved for break bytes of open maps and arrays. */
+	size_t reserved;
+	int err;
+};
+
+void cbor_writer_init(struct cbor_writer *w, uint8_t *buf, size_t size);
+
+void cbor_map_start(struct cbor_writer *w);
+
+void cbor_array_start(struct cbor_writer *w);
+
+/** @brief End the most recently started map or array. */
+void cbor_container_end(struct cbor_writer *w);
+
+void cbor_add_key(struct cbor_writer *w, struct cbor_key key);
+
+void cbor_add_uint(struct cbor_writer *w, uint64_t value);
+
+void cbor_add_int(struct cbor_writer *w, int64_t value);
+
+void cbor_add_bool(struct cbor_writer *w, bool value);
+
+void cbor_add_null(struct cbor_writer *w);
+
+void cbor_add_float(struct cbor_writer *w, float value);
+
+void cbor_add_double(struct cbor_writer *w, double value);
+
+void cbor_add_str(struct cbor_writer *w, const char *str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CBOR_HELPERS_H__ */
@@ -0,0 +1,471 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <devicetree.h>
+#include <storage/flash_map.h>
+#include <fs/fcb.h>
+
+#include "data_store.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(data_store, CONFIG_DATA_STORE_LOG_LEVEL);
+
+#define DATA_STORE_MAGIC	0x32565441 /* "ATV2" */
+#define DATA_STORE_VERSION	1
+
+#define SECTOR_COUNT_MAX						\
+	(FLASH_AREA_SIZE(data_store) /					\
+	 DT_PROP(DT_CHOSEN(zephyr_flash), erase_block_size))
+
+/* Upper bound of the space taken by the FCB sector header and the entry length and CRC. */
+#define RECORD_OVERHEAD_MAX	32
+
+/* Messages are written in chunks of this size, which is a multiple of the flash write block
+ * size.
+ */
+#define WRITE_CHUNK_SIZE	64
+
+/* Every record holds a type byte followed by the message. */
+#define RECORD_HDR_LEN		1
+
+BUILD_ASSERT(SECTOR_COUNT_MAX <= UINT8_MAX, "Too many sectors in the data store partition");
+
+enum inflight_status {
+	INFLIGHT_PENDING,
+	INFLIGHT_ACKED,
+	INFLIGHT_FAILED
+};
+
+/* Message that has been read and waits for acknowledgment. Ordered from the oldest one. */
+struct inflight {
+	void *buf;
+	size_t len;
+	struct fcb_entry loc;
+	enum inflight_status status;
+};
+
+static struct fcb fcb;
+static struct flash_sector sectors[SECTOR_COUNT_MAX];
+static size_t msg_len_max;
+
+/* Last acknowledged message. Sectors before the one holding the following message can be
+ * erased. A location without a sector points to before the oldest message in flash.
+ */
+static struct fcb_entry acked_loc;
+
+/* Last message that has been read. */
+static struct fcb_entry read_loc;
+
+static struct inflight inflight[CONFIG_DATA_STORE_INFLIGHT_MAX];
+static size_t inflight_count;
+
+static struct data_store_stats stats;
+
+/* Start time and number of acknowledged bytes of an ongoing drain of the store. */
+static int64_t drain_start;
+static uint32_t drain_bytes;
+
+static void inflight_remove(size_t idx)
+{
+	memmove(&inflight[idx], &inflight[idx + 1],
+		(inflight_count - idx - 1) * sizeof(inflight[0]));
+	inflight_count--;
+}
+
+static uint32_t sector_record_count(struct flash_sector *sector)
+{
+	struct fcb_entry loc = {
+		.fe_sector = sector,
+	};
+	uint32_t count = 0;
+
+	while ((fcb_getnext(&fcb, &loc) == 0) && (loc.fe_sector == sector)) {
+		count++;
+	}
+
+	return count;
+}
+
+/* Erase the oldest sector. Locations pointing to messages in the sector are reset. */
+static int sector_erase_oldest(bool drop)
+{
+	int err;
+	struct flash_sector *sector = fcb.f_oldest;
+	uint32_t count = sector_record_count(sector);
+
+	err = fcb_rotate(&fcb);
+	if (err) {
+		LOG_ERR("fcb_rotate, error: %d", err);
+		return err;
+	}
+
+	stats.erase_count++;
+	stats.stored_count -= MIN(count, stats.stored_count);
+
+	if (drop) {
+		stats.dropped_count += count;
+	}
+
+	if (acked_loc.fe_sector == sector) {
+		acked_loc = (struct fcb_entry){ 0 };
+	}
+
+	if (read_loc.fe_sector == sector) {
+		read_loc = (struct fcb_entry){ 0 };
+	}
+
+	/* Acknowledgments of dropped messages are ignored. */
+	for (size_t i = inflight_count; i > 0; i--) {
+		if (inflight[i - 1].loc.fe_sector == sector) {
+			inflight_remove(i - 1);
+		}
+	}
+
+	return 0;
+}
+
+/* Erase the sectors that hold only acknowledged messages. */
+static void acked_sectors_erase(void)
+{
+	int err;
+	struct fcb_entry next = acked_loc;
+
+	if (acked_loc.fe_sector == NULL) {
+		return;
+	}
+
+	if (fcb_getnext(&fcb, &next)) {
+		/* All messages are acknowledged. */
+		while (!fcb_is_empty(&fcb)) {
+			err = sector_erase_oldest(false);
+			if (err) {
+				return;
+			}
+		}
+
+		return;
+	}
+
+	while (fcb.f_oldest != next.fe_sector) {
+		err = sector_erase_oldest(false);
+		if (err) {
+			return;
+		}
+	}
+}
+
+static void drain_finished_check(void)
+{
+	int64_t elapsed;
+
+	if ((drain_start == 0) || !fcb_is_empty(&fcb)) {
+		return;
+	}
+
+	elapsed = MAX(k_uptime_get() - drain_start, 1);
+	stats.drain_throughput = (uint32_t)((drain_bytes * 1000LL) / elapsed);
+
+	LOG_INF("Data store drained, %u bytes in %lld ms", drain_bytes, elapsed);
+
+	drain_start = 0;
+	drain_bytes = 0;
+}
+
+/* Write the type byte followed by the message, in chunks that are a multiple of the flash
+ * write block size. The last chunk is padded with the erase value.
+ */
+static int record_write(const struct fcb_entry *loc, uint8_t type, const uint8_t *buf,
+			size_t len)
+{
+	int err;
+	uint8_t chunk[WRITE_CHUNK_SIZE];
+	off_t offset = FCB_ENTRY_FA_DATA_OFF((*loc));
+	size_t chunk_len = RECORD_HDR_LEN;
+	size_t pos = 0;
+
+	chunk[0] = type;
+
+	while (true) {
+		size_t n = MIN(len - pos, sizeof(chunk) - chunk_len);
+
+		memcpy(&chunk[chunk_len], &buf[pos], n);
+		chunk_len += n;
+		pos += n;
+
+		if (pos == len) {
+			size_t padded = ROUND_UP(chunk_len, fcb.f_align);
+
+			memset(&chunk[chunk_len], fcb.f_erase_value, padded - chunk_len);
+			chunk_len = padded;
+		}
+
+		err = flash_area_write(fcb.fap, offset, chunk, chunk_len);
+		if (err) {
+			LOG_ERR("flash_area_write, error: %d", err);
+			return err;
+		}
+
+		if (pos == len) {
+			return 0;
+		}
+
+		offset += chunk_len;
+		chunk_len = 0;
+	}
+}
+
+static uint32_t record_count(void)
+{
+	struct fcb_entry loc = { 0 };
+	uint32_t count = 0;
+
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		count++;
+	}
+
+	return count;
+}
+
+static int fcb_setup(void)
+{
+	int err;
+	uint32_t sector_count = ARRAY_SIZE(sectors);
+
+	err = flash_area_get_sectors(FLASH_AREA_ID(data_store), &sector_count, sectors);
+	if (err) {
+		LOG_ERR("flash_area_get_sectors, error: %d", err);
+		return err;
+	}
+
+	fcb = (struct fcb) {
+		.f_magic = DATA_STORE_MAGIC,
+		.f_version = DATA_STORE_VERSION,
+		.f_sector_cnt = sector_count,
+		.f_scratch_cnt = 0,
+		.f_sectors = sectors,
+	};
+
+	return fcb_init(FLASH_AREA_ID(data_store), &fcb);
+}
+
+int data_store_init(void)
+{
+	int err;
+
+	/* Messages that were read before are not waiting for acknowledgment anymore. */
+	acked_loc = (struct fcb_entry){ 0 };
+	read_loc = (struct fcb_entry){ 0 };
+	inflight_count = 0;
+	drain_start = 0;
+	drain_bytes = 0;
+	stats = (struct data_store_stats){ 0 };
+
+	err = fcb_setup();
+	if (err) {
+		const struct flash_area *fa;
+
+		LOG_WRN("Data store could not be loaded, error: %d, erasing", err);
+
+		err = flash_area_open(FLASH_AREA_ID(data_store), &fa);
+		if (err) {
+			LOG_ERR("flash_area_open, error: %d", err);
+			return err;
+		}
+
+		err = flash_area_erase(fa, 0, fa->fa_size);
+		flash_area_close(fa);
+		if (err) {
+			LOG_ERR("flash_area_erase, error: %d", err);
+			return err;
+		}
+
+		err = fcb_setup();
+		if (err) {
+			LOG_ERR("fcb_init, error: %d", err);
+			return err;
+		}
+	}
+
+	if (fcb.f_align > WRITE_CHUNK_SIZE) {
+		LOG_ERR("Unsupported flash write block size: %d", fcb.f_align);
+		return -ENOTSUP;
+	}
+
+	msg_len_max = MIN(sectors[0].fs_size - RECORD_OVERHEAD_MAX, FCB_MAX_LEN) -
+		      RECORD_HDR_LEN;
+
+	stats.sectors_total = fcb.f_sector_cnt;
+	stats.stored_count = record_count();
+
+	LOG_INF("Data store initialized, %u stored messages", stats.stored_count);
+
+	return 0;
+}
+
+int data_store_write(uint8_t type, const void *buf, size_t len)
+{
+	int err;
+	struct fcb_entry loc;
+
+	if (len == 0) {
+		return -EINVAL;
+	}
+
+	if (len > msg_len_max) {
+		LOG_ERR("Message of %zu bytes does not fit in the data store", len);
+		return -EMSGSIZE;
+	}
+
+	while (true) {
+		err = fcb_append(&fcb, len + RECORD_HDR_LEN, &loc);
+		if (err != -ENOSPC) {
+			break;
+		}
+
+		LOG_WRN("Data store full, erasing the oldest messages");
+
+		err = sector_erase_oldest(true);
+		if (err) {
+			return err;
+		}
+	}
+
+	if (err) {
+		LOG_ERR("fcb_append, error: %d", err);
+		return err;
+	}
+
+	/* An entry that is not finished has no valid CRC and is skipped when reading. */
+	err = record_write(&loc, type, buf, len);
+	if (err) {
+		return err;
+	}
+
+	err = fcb_append_finish(&fcb, &loc);
+	if (err) {
+		LOG_ERR("fcb_append_finish, error: %d", err);
+		return err;
+	}
+
+	stats.written_count++;
+	stats.written_bytes += len;
+	stats.stored_count++;
+
+	LOG_DBG("Message of %zu bytes stored, %u messages in store", len, stats.stored_count);
+
+	return 0;
+}
+
+int data_store_read(uint8_t *type, void **buf, size_t *len)
+{
+	int err;
+	struct fcb_entry loc = read_loc;
+	size_t msg_len;
+	void *msg;
+
+	if (inflight_count == ARRAY_SIZE(inflight)) {
+		return -EBUSY;
+	}
+
+	do {
+		if (fcb_getnext(&fcb, &loc)) {
+			return -ENODATA;
+		}
+	} while (loc.fe_data_len <= RECORD_HDR_LEN);
+
+	msg_len = loc.fe_data_len - RECORD_HDR_LEN;
+
+	msg = k_malloc(msg_len);
+	if (msg == NULL) {
+		LOG_ERR("Failed to allocate memory for stored message");
+		return -ENOMEM;
+	}
+
+	err = flash_area_read(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), type, RECORD_HDR_LEN);
+	if (!err) {
+		err = flash_area_read(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc) + RECORD_HDR_LEN, msg,
+				      msg_len);
+	}
+
+	if (err) {
+		LOG_ERR("flash_area_read, error: %d", err);
+		k_free(msg);
+		return err;
+	}
+
+	if ((inflight_count == 0) && (drain_start == 0)) {
+		drain_start = k_uptime_get();
+	}
+
+	inflight[inflight_count++] = (struct inflight) {
+		.buf = msg,
+		.len = msg_len,
+		.loc = loc,
+		.status = INFLIGHT_PENDING
+	};
+
+	read_loc = loc;
+
+	*buf = msg;
+	*len = msg_len;
+
+	return 0;
+}
+
+int data_store_ack(const void *buf, bool sent)
+{
+	size_t idx;
+	bool pending = false;
+	bool failed = false;
+
+	for (idx = 0; idx < inflight_count; idx++) {
+		if (inflight[idx].buf == buf) {
+			break;
+		}
+	}
+
+	if (idx == inflight_count) {
+		return -ENOENT;
+	}
+
+	inflight[idx].status = sent ? INFLIGHT_ACKED : INFLIGHT_FAILED;
+
+	/* Messages are removed in the order they were stored. */
+	while ((inflight_count > 0) && (inflight[0].status == INFLIGHT_ACKED)) {
+		acked_loc = inflight[0].loc;
+		stats.acked_count++;
+		stats.acked_bytes += inflight[0].len;
+		drain_bytes += inflight[0].len;
+		inflight_remove(0);
+	}
+
+	for (size_t i = 0; i < inflight_count; i++) {
+		pending = pending || (inflight[i].status == INFLIGHT_PENDING);
+		failed = failed || (inflight[i].status == INFLIGHT_FAILED);
+	}
+
+	if (failed && !pending) {
+		/* Read all messages following the last acknowledged one again. */
+		LOG_WRN("Stored message not sent, %zu messages are read again", inflight_count);
+
+		read_loc = acked_loc;
+		inflight_count = 0;
+	}
+
+	acked_sectors_erase();
+	drain_finished_check();
+
+	return 0;
+}
+
+void data_store_stats_get(struct data_store_stats *data_store_stats)
+{
+	*data_store_stats = stats;
+	data_store_stats->sectors_used = fcb.f_sector_cnt - fcb_free_sector_cnt(&fcb);
+	data_store_stats->sector_id = fcb.f_active_id;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**@file
+ *
+ * @brief   Flash backed store-and-forward queue for asset tracker
+ */
+
+#ifndef DATA_STORE_H__
+#define DATA_STORE_H__
+
+/**
+ * @defgroup data_store Data store
+ * @brief    Append-only log of encoded messages in the data_store flash partition.
+ *
+ * Messages are appended to a flash circular buffer (FCB). Sectors are used in a round-robin
+ * fashion, so that all sectors of the partition wear evenly. Messages are read back in the
+ * order they were written and removed when the cloud has acknowledged them. Removal is done
+ * by erasing the oldest sectors once all messages in them are acknowledged, acknowledged
+ * messages in a sector that still holds unacknowledged messages are sent again after a
+ * reboot. If the partition is full, the oldest sector is erased and its messages are lost.
+ *
+ * The library is not thread safe and is meant to be used by the data module only.
+ * @{
+ */
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Data store statistics. Counters are reset at boot. */
+struct data_store_stats {
+	/** Number of messages written to flash. */
+	uint32_t written_count;
+	/** Number of bytes written to flash. */
+	uint32_t written_bytes;
+	/** Number of stored messages acknowledged by the cloud. */
+	uint32_t acked_count;
+	/** Number of bytes of stored messages acknowledged by the cloud. */
+	uint32_t acked_bytes;
+	/** Number of messages erased before they were acknowledged, because the store was full. */
+	uint32_t dropped_count;
+	/** Number of sector erases. */
+	uint32_t erase_count;
+	/** Number of messages currently in the store. */
+	uint32_t stored_count;
+	/** Number of sectors in use and total number of sectors in the partition. */
+	uint32_t sectors_used;
+	uint32_t sectors_total;
+	/** Number of sectors that have been taken into use since the store was created. Divided
+	 *  by the number of sectors it is the number of erase cycles of every sector. The counter
+	 *  is stored in flash and wraps around at 65536.
+	 */
+	uint16_t sector_id;
+	/** Throughput of the last completed drain of the store, in bytes per second. */
+	uint32_t drain_throughput;
+};
+
+/**
+ * @brief Initialize the data store. Messages stored before a reboot are kept.
+ *
+ * @return 0 on success, otherwise a negative error code.
+ */
+int data_store_init(void);
+
+/**
+ * @brief Append a message to the data store.
+ *
+ * @param[in] type Type of the message, returned by data_store_read().
+ * @param[in] buf Message.
+ * @param[in] len Length of the message.
+ *
+ * @return 0 on success, -EMSGSIZE if the message does not fit in a flash sector, otherwise a
+ *         negative error code.
+ */
+int data_store_write(uint8_t type, const void *buf, size_t len);
+
+/**
+ * @brief Read the oldest message that has not been read yet.
+ *
+ * The message is copied to a buffer allocated with k_malloc(), that is owned by the caller.
+ * The buffer pointer identifies the message in data_store_ack().
+ *
+ * @param[out] type Type of the message.
+ * @param[out] buf Pointer to the allocated buffer.
+ * @param[out] len Length of the message.
+ *
+ * @return 0 on success, -ENODATA if all messages have been read, -EBUSY if
+ *         CONFIG_DATA_STORE_INFLIGHT_MAX messages are waiting for acknowledgment, otherwise a
+ *         negative error code.
+ */
+int data_store_read(uint8_t *type, void **buf, size_t *len);
+
+/**
+ * @brief Report the outcome of sending a message read from the data store.
+ *
+ * Sent messages are erased from flash when all older messages are sent as well. Messages
+ * that were not sent are read again, in order, once all messages read before have been
+ * acknowledged.
+ *
+ * @param[in] buf Buffer returned by data_store_read().
+ * @param[in] sent True if the message was sent, false otherwise.
+ *
+ * @return 0 on success, -ENOENT if the buffer does not belong to a message read from the data
+ *         store.
+ */
+int data_store_ack(const void *buf, bool sent);
+
+/** @brief Get data store statistics. */
+void data_store_stats_get(struct data_store_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* DATA_STORE_H__ */
@@ -10,6 +10,7 @@
 #include <date_time.h>
 
 #include "cloud/cloud_codec/cloud_codec.h"
+#include "data_store/data_store.h"
 
 #define MODULE data_module
 
@@ -148,6 +149,7 @@ static struct module_data self = {
 
 /* Forward declarations */
 static void data_send_work_fn(struct k_work *work);
+static void data_store_drain(void);
 static int config_settings_handler(const char *key, size_t len,
 				   settings_read_cb read_cb, void *cb_arg);
 
@@ -322,6 +324,22 @@ static void data_list_clear_and_free(struct ack_data *list, size_t list_count)
 
 static void data_list_add_failed(void *ptr, size_t len, enum data_type type)
 {
+	/* Only batch data is kept across reboots. Other messages hold the current state or
+	 * configuration of the device, which is outdated once it has been updated or the
+	 * device has rebooted.
+	 */
+	if (IS_ENABLED(CONFIG_DATA_STORE) && (type == BATCH)) {
+		int err = data_store_write(type, ptr, len);
+
+		if (!err) {
+			LOG_DBG("Failed data stored in flash: %p", ptr);
+			k_free(ptr);
+			return;
+		}
+
+		LOG_WRN("Failed data could not be stored in flash, error: %d", err);
+	}
+
 	while (true) {
 		for (size_t i = 0; i < ARRAY_SIZE(failed_data); i++) {
 			if (failed_data[i].ptr == NULL) {
@@ -359,36 +377,60 @@ static void data_list_add_pending(void *ptr, size_t len, enum data_type type)
 	SEND_ERROR(data, DATA_EVT_ERROR, -ENFILE);
 }
 
+static bool data_list_pending_full(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(pending_data); i++) {
+		if (pending_data[i].ptr == NULL) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static int data_event_type_get(enum data_type type, enum data_module_event_type *event_type)
+{
+	switch (type) {
+	case GENERIC:
+		*event_type = DATA_EVT_DATA_SEND;
+		break;
+	case BATCH:
+		*event_type = DATA_EVT_DATA_SEND_BATCH;
+		break;
+	case CONFIG:
+		*event_type = DATA_EVT_CONFIG_SEND;
+		break;
+	case UI:
+		*event_type = DATA_EVT_UI_DATA_SEND;
+		break;
+	case NEIGHBOR_CELLS:
+		*event_type = DATA_EVT_NEIGHBOR_CELLS_DATA_SEND;
+		break;
+	default:
+		LOG_WRN("Unknown associated data type");
+		return -ENODATA;
+	}
+
+	return 0;
+}
+
 static void data_resend(void)
 {
+	int err;
 	struct data_module_event *evt;
+	enum data_module_event_type event_type;
 
 	for (size_t i = 0; i < ARRAY_SIZE(failed_data); i++) {
 		if (failed_data[i].ptr != NULL) {
 
-			evt = new_data_module_event();
-
-			switch (failed_data[i].type) {
-			case GENERIC:
-				evt->type = DATA_EVT_DATA_SEND;
-				break;
-			case BATCH:
-				evt->type = DATA_EVT_DATA_SEND_BATCH;
-				break;
-			case CONFIG:
-				evt->type = DATA_EVT_CONFIG_SEND;
-				break;
-			case UI:
-				evt->type = DATA_EVT_UI_DATA_SEND;
-				break;
-			case NEIGHBOR_CELLS:
-				evt->type = DATA_EVT_NEIGHBOR_CELLS_DATA_SEND;
-			default:
-				LOG_WRN("Unknown associated data type");
-				SEND_ERROR(data, DATA_EVT_ERROR, -ENODATA);
+			err = data_event_type_get(failed_data[i].type, &event_type);
+			if (err) {
+				SEND_ERROR(data, DATA_EVT_ERROR, err);
 				return;
 			}
 
+			evt = new_data_module_event();
+			evt->type = event_type;
 			evt->data.buffer.buf = failed_data[i].ptr;
 			evt->data.buffer.len = failed_data[i].len;
 			LOG_WRN("Resending data: %.*s", failed_data[i].len,
@@ -419,7 +461,14 @@ static void data_ack(void *ptr, bool sent)
 
 	for (size_t i = 0; i < ARRAY_SIZE(pending_data); i++) {
 		if (pending_data[i].ptr == ptr) {
-			if (sent) {
+			if (IS_ENABLED(CONFIG_DATA_STORE) && (data_store_ack(ptr, sent) == 0)) {
+				/* Data read from the data store stays in flash until it
+				 * has been sent.
+				 */
+				k_free(ptr);
+				LOG_DBG("Stored data %s: %p", sent ? "ACKed" : "not sent",
+					pending_data[i].ptr);
+			} else if (sent) {
 				k_free(ptr);
 				LOG_DBG("Pending data ACKed: %p",
 					pending_data[i].ptr);
@@ -433,6 +482,13 @@ static void data_ack(void *ptr, bool sent)
 						     pending_data[i].type);
 			}
 			data_list_clear_entry(&pending_data[i]);
+
+			/* Publish the next stored message when the previous one is sent. */
+			if (IS_ENABLED(CONFIG_DATA_STORE) && sent &&
+			    (state == STATE_CLOUD_CONNECTED)) {
+				data_store_drain();
+			}
+
 			return;
 		}
 	}
@@ -476,6 +532,14 @@ static int setup(void)
 		return err;
 	}
 
+	if (IS_ENABLED(CONFIG_DATA_STORE)) {
+		err = data_store_init();
+		if (err) {
+			LOG_ERR("data_store_init, error: %d", err);
+			return err;
+		}
+	}
+
 	return 0;
 }
 
@@ -518,6 +582,80 @@ static void data_send(enum data_module_event_type event,
 	data->len = 0;
 }
 
+/* Encode queued batch data and move it from the ringbuffers to the data store. */
+static void data_store_batch_save(void)
+{
+	int err;
+	struct cloud_codec_data codec = {0};
+
+	if (!date_time_is_valid()) {
+		/* Data cannot be timestamped and stays in the ringbuffers. */
+		return;
+	}
+
+	/* Entries that do not fit in a single batch message stay queued and are encoded in
+	 * the next iteration.
+	 */
+	while (true) {
+		err = cloud_codec_encode_batch_data(&codec,
+						gps_buf,
+						sensors_buf,
+						modem_dyn_buf,
+						ui_buf,
+						accel_buf,
+						bat_buf,
+						ARRAY_SIZE(gps_buf),
+						ARRAY_SIZE(sensors_buf),
+						ARRAY_SIZE(modem_dyn_buf),
+						ARRAY_SIZE(ui_buf),
+						ARRAY_SIZE(accel_buf),
+						ARRAY_SIZE(bat_buf));
+		if (err == -ENODATA) {
+			return;
+		} else if (err) {
+			LOG_ERR("Error batch-enconding data: %d", err);
+			SEND_ERROR(data, DATA_EVT_ERROR, err);
+			return;
+		}
+
+		data_list_add_failed(codec.buf, codec.len, BATCH);
+	}
+}
+
+/* Publish messages from the data store, as long as the number of messages waiting for
+ * acknowledgment allows it.
+ */
+static void data_store_drain(void)
+{
+	int err;
+	uint8_t type;
+	void *buf;
+	struct cloud_codec_data codec;
+	enum data_module_event_type event_type;
+
+	while (!data_list_pending_full()) {
+		err = data_store_read(&type, &buf, &codec.len);
+		if ((err == -ENODATA) || (err == -EBUSY)) {
+			return;
+		} else if (err) {
+			LOG_ERR("data_store_read, error: %d", err);
+			SEND_ERROR(data, DATA_EVT_ERROR, err);
+			return;
+		}
+
+		err = data_event_type_get(type, &event_type);
+		if (err) {
+			/* Drop the message, it would otherwise block the store. */
+			data_store_ack(buf, true);
+			k_free(buf);
+			continue;
+		}
+
+		codec.buf = buf;
+		data_send(event_type, type, &codec);
+	}
+}
+
 /* This function allocates buffer on the heap, which needs to be freed after use. */
 static void data_encode(void)
 {
@@ -856,6 +994,23 @@ static void on_cloud_state_disconnected(struct data_msg_data *msg)
 	if (IS_EVENT(msg, cloud, CLOUD_EVT_CONNECTED)) {
 		date_time_update_async(date_time_event_handler);
 		state_set(STATE_CLOUD_CONNECTED);
+
+		if (IS_ENABLED(CONFIG_DATA_STORE)) {
+			data_store_drain();
+		}
+
+		return;
+	}
+
+	if (IS_EVENT(msg, data, DATA_EVT_DATA_READY)) {
+		/* Move batch data to flash, where it is kept until the device is connected
+		 * again.
+		 */
+		if (IS_ENABLED(CONFIG_DATA_STORE)) {
+			data_store_batch_save();
+		}
+
+		return;
 	}
 }
 
@@ -866,6 +1021,11 @@ static void on_cloud_state_connected(struct data_msg_data *msg)
 		/* Resend data previously failed to be sent. */
 		data_resend();
 		data_encode();
+
+		if (IS_ENABLED(CONFIG_DATA_STORE)) {
+			data_store_drain();
+		}
+
 		return;
 	}
 
@@ -923,7 +1083,12 @@ static void on_all_states(struct data_msg_data *msg)
 	}
 
 	if (IS_EVENT(msg, util, UTIL_EVT_SHUTDOWN_REQUEST)) {
-		/* The module doesn't have anything to shut down and can
+		/* Keep buffered data across the reboot. */
+		if (IS_ENABLED(CONFIG_DATA_STORE)) {
+			data_store_batch_save();
+		}
+
+		/* The module doesn't have anything else to shut down and can
 		 * report back immediately.
 		 */
 		SEND_SHUTDOWN_ACK(data, DATA_EVT_SHUTDOWN_READY, self.id);
@@ -0,0 +1,839 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+#include <string.h>
+#include <cJSON.h>
+#include <cJSON_os.h>
+
+#include "cloud_codec.h"
+#include "cbor_common.h"
+#include "cbor_columnar.h"
+#include "cbor_helpers.h"
+#include "json_common.h"
+#include "json_protocol_names.h"
+
+#define GPS_NMEA "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47"
+
+/* Number of NMEA entries that does not fit in a single CBOR output buffer. */
+#define GPS_NMEA_COUNT 40
+
+/* Interval between the entries of a filled batch buffer. */
+#define SAMPLE_INTERVAL_MS 60000
+
+/* Unix time of an entry with uptime 1000 ms, see mock/date_time_mock.c. */
+#define UNIX_TIME_OFFSET_MS 1563968746123
+
+/* Value stored by column_decode() for a missing value. */
+#define COLUMN_NULL INT64_MIN
+
+#define MAJOR_TYPE(byte) ((byte) >> 5)
+#define ADDITIONAL_INFO(byte) ((byte) & 0x1f)
+#define BREAK_BYTE 0xff
+#define NULL_BYTE 0xf6
+
+/* Expected encoding of {"btn":{"v":1,"ts":1563968747123}}. */
+static const uint8_t ui_expected[] = {
+	0xbf,
+	0x63, 'b', 't', 'n',
+	0xbf,
+	0x61, 'v', 0x01,
+	0x62, 't', 's', 0x1b, 0x00, 0x00, 0x01, 0x6c, 0x23, 0xcd, 0x36, 0x73,
+	0xff,
+	0xff
+};
+
+static const uint8_t neighbor_cells_expected[] = {
+	0xbf,
+	0x63, 'm', 'c', 'c', 0x18, 0xf2,
+	0x63, 'm', 'n', 'c', 0x01,
+	0x64, 'c', 'e', 'l', 'l', 0x1a, 0x01, 0x4a, 0x03, 0x05,
+	0x64, 'a', 'r', 'e', 'a', 0x19, 0x76, 0xc1,
+	0x66, 'e', 'a', 'r', 'f', 'c', 'n', 0x19, 0x18, 0x9c,
+	0x63, 'a', 'd', 'v', 0x18, 0x50,
+	0x64, 'r', 's', 'r', 'p', 0x38, 0x60,
+	0x64, 'r', 's', 'r', 'q', 0x29,
+	0x62, 't', 's', 0x1b, 0x00, 0x00, 0x01, 0x6c, 0x23, 0xcd, 0x36, 0x73,
+	0x63, 'n', 'm', 'r',
+	0x9f,
+	0xbf,
+	0x66, 'e', 'a', 'r', 'f', 'c', 'n', 0x1a, 0x00, 0x03, 0xff, 0xff,
+	0x64, 'c', 'e', 'l', 'l', 0x19, 0x01, 0xf5,
+	0x64, 'r', 's', 'r', 'p', 0x38, 0x67,
+	0x64, 'r', 's', 'r', 'q', 0x2a,
+	0xff,
+	0xff,
+	0xff
+};
+
+struct batch_data {
+	struct cloud_data_gps gps[10];
+	struct cloud_data_sensors sensors[10];
+	struct cloud_data_modem_dynamic modem_dynamic[3];
+	struct cloud_data_ui ui[3];
+	struct cloud_data_accelerometer accel[3];
+	struct cloud_data_battery bat[3];
+};
+
+static struct batch_data batch;
+static struct cloud_data_gps gps_nmea[GPS_NMEA_COUNT];
+static uint8_t columnar_buf[CONFIG_CLOUD_CODEC_CBOR_BUF_SIZE];
+
+/* Get the argument of a CBOR item head. Returns pointer to the byte following the head. */
+static const uint8_t *head_get(const uint8_t *p, const uint8_t *end, uint64_t *arg)
+{
+	uint8_t info = ADDITIONAL_INFO(*p);
+	size_t n;
+
+	p++;
+
+	if (info < 24) {
+		*arg = info;
+		return p;
+	} else if (info == 31) {
+		*arg = 0;
+		return p;
+	} else if (info > 27) {
+		return NULL;
+	}
+
+	n = 1 << (info - 24);
+	if (end - p < n) {
+		return NULL;
+	}
+
+	*arg = 0;
+	for (size_t i = 0; i < n; i++) {
+		*arg = (*arg << 8) | p[i];
+	}
+
+	return p + n;
+}
+
+/* Skip a single well-formed CBOR data item, as produced by the encoder. Returns pointer to the
+ * following item or NULL if the item is not well-formed. If the item is an array, the number of
+ * its elements is stored in count.
+ */
+static const uint8_t *item_skip(const uint8_t *p, const uint8_t *end, size_t *count)
+{
+	uint64_t arg;
+	uint8_t major;
+	bool indefinite;
+
+	if (p >= end) {
+		return NULL;
+	}
+
+	major = MAJOR_TYPE(*p);
+	indefinite = (ADDITIONAL_INFO(*p) == 31);
+
+	p = head_get(p, end, &arg);
+	if (p == NULL) {
+		return NULL;
+	}
+
+	switch (major) {
+	case 0:
+	case 1:
+		return p;
+	case 3:
+		return (end - p < arg) ? NULL : p + arg;
+	case 4:
+	case 5:
+		/* The encoder uses only indefinite length maps and arrays. */
+		if (!indefinite) {
+			return NULL;
+		}
+
+		*count = 0;
+		while ((p < end) && (*p != BREAK_BYTE)) {
+			size_t nested;
+
+			p = item_skip(p, end, &nested);
+			if ((p != NULL) && (major == 5)) {
+				p = item_skip(p, end, &nested);
+			}
+
+			if (p == NULL) {
+				return NULL;
+			}
+
+			(*count)++;
+		}
+
+		return (p < end) ? p + 1 : NULL;
+	case 7:
+		return p;
+	default:
+		return NULL;
+	}
+}
+
+/* Get the number of entries in the array of the given label in an encoded batch message.
+ * Returns -1 if the message is not well-formed and 0 if the label is not present.
+ */
+static int batch_entries_get(const char *buf, size_t len, const char *label)
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	const uint8_t *end = p + len;
+	size_t count = 0;
+
+	if ((item_skip(p, end, &count) != end) || (*p != 0xbf)) {
+		return -1;
+	}
+
+	p++;
+
+	while (*p != BREAK_BYTE) {
+		size_t label_len = ADDITIONAL_INFO(*p);
+		bool match = (label_len == strlen(label)) &&
+			     (memcmp(p + 1, label, label_len) == 0);
+
+		p = item_skip(p, end, &count);
+		p = item_skip(p, end, &count);
+
+		if (match) {
+			return count;
+		}
+	}
+
+	return 0;
+}
+
+/* Find the value of a key in the map starting at p. Returns NULL if the key is not present. */
+static const uint8_t *map_value_find(const uint8_t *p, const uint8_t *end, const char *key)
+{
+	size_t count;
+
+	if ((p >= end) || (*p != 0xbf)) {
+		return NULL;
+	}
+
+	p++;
+
+	while ((p != NULL) && (p < end) && (*p != BREAK_BYTE)) {
+		size_t key_len = ADDITIONAL_INFO(*p);
+		bool match = (MAJOR_TYPE(*p) == 3) && (key_len == strlen(key)) &&
+			     (memcmp(p + 1, key, key_len) == 0);
+
+		p = item_skip(p, end, &count);
+		if (match) {
+			return p;
+		}
+
+		if (p != NULL) {
+			p = item_skip(p, end, &count);
+		}
+	}
+
+	return NULL;
+}
+
+/* Decode a numeric column of the given label in a columnar batch message. Missing values are
+ * stored as COLUMN_NULL. Returns the number of decoded values, 0 if the column is not present
+ * or -1 if the column is not well-formed.
+ */
+static int column_decode(const uint8_t *buf, size_t len, const char *label, const char *key,
+			 int64_t *values, size_t max)
+{
+	const uint8_t *end = buf + len;
+	const uint8_t *p = map_value_find(buf, end, label);
+	int64_t value = 0;
+	size_t count = 0;
+	uint64_t arg;
+
+	if (p != NULL) {
+		p = map_value_find(p, end, key);
+	}
+
+	if (p == NULL) {
+		return 0;
+	}
+
+	if (*p != 0x9f) {
+		return -1;
+	}
+
+	p++;
+
+	while ((p < end) && (*p != BREAK_BYTE)) {
+		uint8_t major = MAJOR_TYPE(*p);
+
+		if (count == max) {
+			return -1;
+		}
+
+		if (*p == NULL_BYTE) {
+			values[count++] = COLUMN_NULL;
+			p++;
+			continue;
+		}
+
+		p = head_get(p, end, &arg);
+		if ((p == NULL) || (major > 1)) {
+			return -1;
+		}
+
+		/* Items are differences from the previous value in the column. */
+		value += (major == 0) ? (int64_t)arg : -1 - (int64_t)arg;
+		values[count++] = value;
+	}
+
+	return count;
+}
+
+static void batch_data_fill(struct batch_data *data)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(data->gps); i++) {
+		data->gps[i] = (struct cloud_data_gps) {
+			.pvt.longi = 10.4192856 + i / 10000.0,
+			.pvt.lat = 63.4320175 - i / 10000.0,
+			.pvt.acc = 12.5,
+			.pvt.alt = 48.2 + i,
+			.pvt.spd = 0.37,
+			.pvt.hdg = 176.41,
+			.gps_ts = 1000 + i * SAMPLE_INTERVAL_MS,
+			.queued = true,
+			.format = CLOUD_CODEC_GPS_FORMAT_PVT
+		};
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(data->sensors); i++) {
+		data->sensors[i] = (struct cloud_data_sensors) {
+			.temp = 23.26 + i / 10.0,
+			.hum = 48.73,
+			.env_ts = 1000 + i * SAMPLE_INTERVAL_MS,
+			.queued = true
+		};
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(data->modem_dynamic); i++) {
+		data->modem_dynamic[i] = (struct cloud_data_modem_dynamic) {
+			.rsrp = -8 + i,
+			.area = 12,
+			.mccmnc = "24202",
+			.cell = 33703719,
+			.ip = "10.81.183.99",
+			.ts = 1000 + i * SAMPLE_INTERVAL_MS,
+			.queued = true,
+			.area_code_fresh = true,
+			.cell_id_fresh = true,
+			.rsrp_fresh = true,
+			.ip_address_fresh = true,
+			.mccmnc_fresh = true
+		};
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(data->ui); i++) {
+		data->ui[i] = (struct cloud_data_ui) {
+			.btn = 1 + i,
+			.btn_ts = 1000 + i * SAMPLE_INTERVAL_MS,
+			.queued = true
+		};
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(data->accel); i++) {
+		data->accel[i] = (struct cloud_data_accelerometer) {
+			.values = { 0.53 + i, -9.81, 1.27 },
+			.ts = 1000 + i * SAMPLE_INTERVAL_MS,
+			.queued = true
+		};
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(data->bat); i++) {
+		data->bat[i] = (struct cloud_data_battery) {
+			.bat = 3600 + i,
+			.bat_ts = 1000 + i * SAMPLE_INTERVAL_MS,
+			.queued = true
+		};
+	}
+}
+
+static int batch_cbor_encode(struct cloud_codec_data *output, struct batch_data *data)
+{
+	return cbor_common_encode_batch_data(output, data->gps, data->sensors,
+					     data->modem_dynamic, data->ui, data->accel,
+					     data->bat, ARRAY_SIZE(data->gps),
+					     ARRAY_SIZE(data->sensors),
+					     ARRAY_SIZE(data->modem_dynamic),
+					     ARRAY_SIZE(data->ui), ARRAY_SIZE(data->accel),
+					     ARRAY_SIZE(data->bat));
+}
+
+static int batch_columnar_encode(struct cbor_writer *w, struct batch_data *data)
+{
+	int err;
+
+	cbor_writer_init(w, columnar_buf, sizeof(columnar_buf));
+	cbor_map_start(w);
+
+	err = cbor_columnar_batch_data_add(w, data->gps, data->sensors, data->modem_dynamic,
+					   data->ui, data->accel, data->bat,
+					   ARRAY_SIZE(data->gps), ARRAY_SIZE(data->sensors),
+					   ARRAY_SIZE(data->modem_dynamic), ARRAY_SIZE(data->ui),
+					   ARRAY_SIZE(data->accel), ARRAY_SIZE(data->bat));
+
+	cbor_container_end(w);
+
+	return err ? err : w->err;
+}
+
+/* Encode the batch the same way as the JSON codec of AWS IoT and Azure IoT Hub does. */
+static int batch_json_encode(struct cloud_codec_data *output, struct batch_data *data)
+{
+	int err;
+	cJSON *root_obj = cJSON_CreateObject();
+
+	if (root_obj == NULL) {
+		return -ENOMEM;
+	}
+
+	err = json_common_batch_data_add(root_obj, JSON_COMMON_MODEM_DYNAMIC,
+					 data->modem_dynamic, ARRAY_SIZE(data->modem_dynamic),
+					 DATA_MODEM_DYNAMIC);
+	err = err ? err : json_common_batch_data_add(root_obj, JSON_COMMON_GPS,
+						     data->gps, ARRAY_SIZE(data->gps),
+						     DATA_GPS);
+	err = err ? err : json_common_batch_data_add(root_obj, JSON_COMMON_SENSOR,
+						     data->sensors, ARRAY_SIZE(data->sensors),
+						     DATA_ENVIRONMENTALS);
+	err = err ? err : json_common_batch_data_add(root_obj, JSON_COMMON_UI,
+						     data->ui, ARRAY_SIZE(data->ui),
+						     DATA_BUTTON);
+	err = err ? err : json_common_batch_data_add(root_obj, JSON_COMMON_BATTERY,
+						     data->bat, ARRAY_SIZE(data->bat),
+						     DATA_BATTERY);
+	err = err ? err : json_common_batch_data_add(root_obj, JSON_COMMON_ACCELEROMETER,
+						     data->accel, ARRAY_SIZE(data->accel),
+						     DATA_MOVEMENT);
+	if (err) {
+		cJSON_Delete(root_obj);
+		return err;
+	}
+
+	output->buf = cJSON_PrintUnformatted(root_obj);
+	cJSON_Delete(root_obj);
+
+	if (output->buf == NULL) {
+		return -ENOMEM;
+	}
+
+	output->len = strlen(output->buf);
+
+	return 0;
+}
+
+static void test_writer_buffer_boundary(void)
+{
+	/* Encoding of a map holding an integer and an empty map. */
+	static const uint8_t expected[] = { 0xbf, 0x01, 0xbf, 0xff, 0xff };
+	const uint8_t canary = 0xa5;
+	uint8_t buf[sizeof(expected) + 2];
+	struct cbor_writer w;
+
+	for (size_t size = 0; size <= sizeof(expected) + 1; size++) {
+		memset(buf, canary, sizeof(buf));
+		cbor_writer_init(&w, buf, size);
+
+		cbor_map_start(&w);
+		cbor_add_uint(&w, 1);
+		cbor_map_start(&w);
+		cbor_container_end(&w);
+		cbor_container_end(&w);
+
+		zassert_true(w.len <= size, "Length %zu exceeds size %zu", w.len, size);
+		zassert_equal(buf[size], canary, "Write past the buffer of size %zu", size);
+
+		if (size < sizeof(expected)) {
+			zassert_equal(w.err, -ENOMEM, "No error with size %zu", size);
+		} else {
+			zassert_equal(w.err, 0, "Error %d with size %zu", w.err, size);
+			zassert_equal(w.len, sizeof(expected), "Wrong length %zu", w.len);
+			zassert_mem_equal(buf, expected, sizeof(expected), "Wrong encoding");
+		}
+	}
+}
+
+static void test_encode_ui_data(void)
+{
+	int ret;
+	struct cloud_codec_data output;
+	struct cloud_data_ui data = {
+		.btn = 1,
+		.btn_ts = 1000,
+		.queued = true
+	};
+
+	ret = cbor_common_encode_ui_data(&output, &data);
+	zassert_equal(0, ret, "Return value %d is wrong", ret);
+	zassert_false(data.queued, "Entry should be unqueued");
+	zassert_equal(data.btn_ts, 1000, "Uptime timestamp should not be modified");
+	zassert_equal(sizeof(ui_expected), output.len, "Wrong length %zu", output.len);
+	zassert_mem_equal(ui_expected, output.buf, sizeof(ui_expected), "Wrong encoding");
+
+	cloud_codec_release_data(&output);
+
+	ret = cbor_common_encode_ui_data(&output, &data);
+	zassert_equal(-ENODATA, ret, "Return value %d is wrong", ret);
+}
+
+static void test_encode_neighbor_cells(void)
+{
+	int ret;
+	struct cloud_codec_data output;
+	struct cloud_data_neighbor_cells data = {
+		.cell_data = {
+			.current_cell = {
+				.mcc = 242,
+				.mnc = 1,
+				.id = 21627653,
+				.tac = 30401,
+				.earfcn = 6300,
+				.timing_advance = 80,
+				.rsrp = -97,
+				.rsrq = -10
+			},
+			.ncells_count = 1
+		},
+		.neighbor_cells[0] = {
+			.earfcn = 262143,
+			.phys_cell_id = 501,
+			.rsrp = -104,
+			.rsrq = -11
+		},
+		.ts = 1000,
+		.queued = true
+	};
+
+	ret = cbor_common_encode_neighbor_cells(&output, &data);
+	zassert_equal(0, ret, "Return value %d is wrong", ret);
+	zassert_false(data.queued, "Entry should be unqueued");
+	zassert_equal(sizeof(neighbor_cells_expected), output.len, "Wrong length %zu", output.len);
+	zassert_mem_equal(neighbor_cells_expected, output.buf, sizeof(neighbor_cells_expected),
+			  "Wrong encoding");
+
+	cloud_codec_release_data(&output);
+
+	ret = cbor_common_encode_neighbor_cells(&output, &data);
+	zassert_equal(-ENODATA, ret, "Return value %d is wrong", ret);
+}
+
+static void test_encode_batch_data(void)
+{
+	int ret;
+	struct cloud_codec_data output;
+
+	batch_data_fill(&batch);
+
+	/* Entries without fresh values are skipped. */
+	batch.modem_dynamic[1].area_code_fresh = false;
+	batch.modem_dynamic[1].cell_id_fresh = false;
+	batch.modem_dynamic[1].rsrp_fresh = false;
+	batch.modem_dynamic[1].ip_address_fresh = false;
+	batch.modem_dynamic[1].mccmnc_fresh = false;
+
+	/* Not queued entries are skipped. */
+	batch.gps[3].queued = false;
+
+	/* Buffers without queued entries are not added. */
+	for (size_t i = 0; i < ARRAY_SIZE(batch.bat); i++) {
+		batch.bat[i].queued = false;
+	}
+
+	ret = batch_cbor_encode(&output, &batch);
+	zassert_equal(0, ret, "Return value %d is wrong", ret);
+
+	zassert_equal(ARRAY_SIZE(batch.gps) - 1,
+		      batch_entries_get(output.buf, output.len, DATA_GPS), "Wrong GPS count");
+	zassert_equal(ARRAY_SIZE(batch.sensors),
+		      batch_entries_get(output.buf, output.len, DATA_ENVIRONMENTALS),
+		      "Wrong environmental count");
+	zassert_equal(ARRAY_SIZE(batch.modem_dynamic) - 1,
+		      batch_entries_get(output.buf, output.len, DATA_MODEM_DYNAMIC),
+		      "Wrong modem count");
+	zassert_equal(ARRAY_SIZE(batch.ui),
+		      batch_entries_get(output.buf, output.len, DATA_BUTTON), "Wrong UI count");
+	zassert_equal(ARRAY_SIZE(batch.accel),
+		      batch_entries_get(output.buf, output.len, DATA_MOVEMENT),
+		      "Wrong accelerometer count");
+	zassert_equal(0, batch_entries_get(output.buf, output.len, DATA_BATTERY),
+		      "Battery should not be present");
+
+	for (size_t i = 0; i < ARRAY_SIZE(batch.gps); i++) {
+		zassert_false(batch.gps[i].queued, "GPS entry %zu should be unqueued", i);
+	}
+
+	cloud_codec_release_data(&output);
+
+	ret = batch_cbor_encode(&output, &batch);
+	zassert_equal(-ENODATA, ret, "Return value %d is wrong", ret);
+}
+
+static void test_encode_batch_data_buffer_full(void)
+{
+	int ret;
+	int entries;
+	size_t total = 0;
+	size_t messages = 0;
+	struct cloud_codec_data output;
+
+	for (size_t i = 0; i < ARRAY_SIZE(gps_nmea); i++) {
+		gps_nmea[i] = (struct cloud_data_gps) {
+			.nmea = GPS_NMEA,
+			.gps_ts = 1000 + i,
+			.queued = true,
+			.format = CLOUD_CODEC_GPS_FORMAT_NMEA
+		};
+	}
+
+	/* Entries that do not fit stay queued and are encoded in the following messages. */
+	while (true) {
+		ret = cbor_common_encode_batch_data(&output, gps_nmea, NULL, NULL, NULL, NULL,
+						    NULL, ARRAY_SIZE(gps_nmea), 0, 0, 0, 0, 0);
+		if (ret == -ENODATA) {
+			break;
+		}
+
+		zassert_equal(0, ret, "Return value %d is wrong", ret);
+		zassert_true(output.len <= CONFIG_CLOUD_CODEC_CBOR_BUF_SIZE, "Output too long");
+
+		entries = batch_entries_get(output.buf, output.len, DATA_GPS);
+		zassert_true(entries > 0, "Wrong GPS count %d", entries);
+
+		/* Entries are encoded in order. */
+		zassert_false(gps_nmea[total + entries - 1].queued, "Entry should be unqueued");
+		if (total + entries < ARRAY_SIZE(gps_nmea)) {
+			zassert_true(gps_nmea[total + entries].queued, "Entry should be queued");
+			zassert_equal(gps_nmea[total + entries].gps_ts, 1000 + total + entries,
+				      "Uptime timestamp should not be modified");
+		}
+
+		total += entries;
+		messages++;
+
+		cloud_codec_release_data(&output);
+	}
+
+	zassert_equal(ARRAY_SIZE(gps_nmea), total, "Wrong total GPS count %zu", total);
+	zassert_true(messages > 1, "Entries should not fit in a single message");
+}
+
+static void test_encode_batch_data_columnar(void)
+{
+	int ret;
+	struct cbor_writer w;
+	int64_t values[ARRAY_SIZE(batch.gps)];
+	size_t j = 0;
+
+	batch_data_fill(&batch);
+
+	/* Not queued entries are skipped. */
+	batch.gps[3].queued = false;
+
+	/* Values that are not present in an entry are encoded as null. */
+	batch.gps[5].format = CLOUD_CODEC_GPS_FORMAT_NMEA;
+	strcpy(batch.gps[5].nmea, GPS_NMEA);
+	batch.modem_dynamic[2].rsrp_fresh = false;
+
+	/* Entries without fresh values are unqueued without being encoded. */
+	batch.modem_dynamic[1].area_code_fresh = false;
+	batch.modem_dynamic[1].cell_id_fresh = false;
+	batch.modem_dynamic[1].rsrp_fresh = false;
+	batch.modem_dynamic[1].ip_address_fresh = false;
+	batch.modem_dynamic[1].mccmnc_fresh = false;
+
+	/* Entries are encoded from the oldest one in the ring buffer. */
+	batch.bat[0].bat_ts = 1000 + 3 * SAMPLE_INTERVAL_MS;
+
+	ret = batch_columnar_encode(&w, &batch);
+	zassert_equal(0, ret, "Return value %d is wrong", ret);
+
+	ret = column_decode(w.buf, w.len, DATA_GPS, DATA_TIMESTAMP, values, ARRAY_SIZE(values));
+	zassert_equal(ARRAY_SIZE(batch.gps) - 1, ret, "Wrong GPS count %d", ret);
+
+	for (size_t i = 0; i < ARRAY_SIZE(batch.gps); i++) {
+		if (i == 3) {
+			continue;
+		}
+
+		zassert_equal(UNIX_TIME_OFFSET_MS + batch.gps[i].gps_ts, values[j++],
+			      "Wrong GPS timestamp %zu", i);
+		zassert_false(batch.gps[i].queued, "GPS entry %zu should be unqueued", i);
+	}
+
+	ret = column_decode(w.buf, w.len, DATA_GPS, DATA_GPS_LATITUDE, values,
+			    ARRAY_SIZE(values));
+	zassert_equal(ARRAY_SIZE(batch.gps) - 1, ret, "Wrong latitude count %d", ret);
+
+	j = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(batch.gps); i++) {
+		int64_t expected = batch.gps[i].pvt.lat * CBOR_COLUMNAR_SCALE_COORDINATE;
+
+		if (i == 3) {
+			continue;
+		} else if (i == 5) {
+			zassert_equal(COLUMN_NULL, values[j++], "Latitude should be null");
+			continue;
+		}
+
+		zassert_within(expected, values[j++], 1, "Wrong latitude %zu", i);
+	}
+
+	ret = column_decode(w.buf, w.len, DATA_ENVIRONMENTALS, DATA_TEMPERATURE, values,
+			    ARRAY_SIZE(values));
+	zassert_equal(ARRAY_SIZE(batch.sensors), ret, "Wrong temperature count %d", ret);
+
+	for (size_t i = 0; i < ARRAY_SIZE(batch.sensors); i++) {
+		int64_t expected = batch.sensors[i].temp * CBOR_COLUMNAR_SCALE_ENVIRONMENT;
+
+		zassert_within(expected, values[i], 1, "Wrong temperature %zu", i);
+	}
+
+	ret = column_decode(w.buf, w.len, DATA_MODEM_DYNAMIC, MODEM_RSRP, values,
+			    ARRAY_SIZE(values));
+	zassert_equal(2, ret, "Wrong RSRP count %d", ret);
+	zassert_equal(batch.modem_dynamic[0].rsrp, values[0], "Wrong RSRP");
+	zassert_equal(COLUMN_NULL, values[1], "RSRP should be null");
+
+	ret = column_decode(w.buf, w.len, DATA_MODEM_DYNAMIC, MODEM_MCCMNC, values,
+			    ARRAY_SIZE(values));
+	zassert_equal(2, ret, "Wrong MCCMNC count %d", ret);
+	zassert_equal(24202, values[1], "Wrong MCCMNC");
+
+	ret = column_decode(w.buf, w.len, DATA_BATTERY, DATA_VALUE, values, ARRAY_SIZE(values));
+	zassert_equal(ARRAY_SIZE(batch.bat), ret, "Wrong battery count %d", ret);
+	zassert_equal(batch.bat[1].bat, values[0], "Wrong oldest battery value");
+	zassert_equal(batch.bat[2].bat, values[1], "Wrong battery value");
+	zassert_equal(batch.bat[0].bat, values[2], "Wrong newest battery value");
+
+	/* Columns without values are not added. */
+	ret = column_decode(w.buf, w.len, DATA_GPS, DATA_GPS_NMEA, values, ARRAY_SIZE(values));
+	zassert_equal(-1, ret, "NMEA column should hold strings");
+	ret = column_decode(w.buf, w.len, DATA_ENVIRONMENTALS, DATA_GPS_NMEA, values,
+			    ARRAY_SIZE(values));
+	zassert_equal(0, ret, "Empty column should not be present");
+
+	ret = batch_columnar_encode(&w, &batch);
+	zassert_equal(0, ret, "Return value %d is wrong", ret);
+	zassert_equal(2, w.len, "Output should be an empty map");
+}
+
+static void test_encode_batch_data_columnar_buffer_full(void)
+{
+	int ret;
+	int entries;
+	size_t total = 0;
+	size_t messages = 0;
+	struct cbor_writer w;
+	int64_t values[GPS_NMEA_COUNT];
+
+	for (size_t i = 0; i < ARRAY_SIZE(gps_nmea); i++) {
+		gps_nmea[i] = (struct cloud_data_gps) {
+			.nmea = GPS_NMEA,
+			.gps_ts = 1000 + i,
+			.queued = true,
+			.format = CLOUD_CODEC_GPS_FORMAT_NMEA
+		};
+	}
+
+	/* The oldest entries that fit are encoded, the remaining ones stay queued. */
+	while (true) {
+		cbor_writer_init(&w, columnar_buf, sizeof(columnar_buf));
+		cbor_map_start(&w);
+		ret = cbor_columnar_batch_data_add(&w, gps_nmea, NULL, NULL, NULL, NULL, NULL,
+						   ARRAY_SIZE(gps_nmea), 0, 0, 0, 0, 0);
+		cbor_container_end(&w);
+		zassert_equal(0, ret, "Return value %d is wrong", ret);
+		zassert_equal(0, w.err, "Writer error %d", w.err);
+
+		entries = column_decode(w.buf, w.len, DATA_GPS, DATA_TIMESTAMP, values,
+					ARRAY_SIZE(values));
+		if (entries == 0) {
+			break;
+		}
+
+		zassert_true(entries > 0, "Wrong GPS count %d", entries);
+		zassert_equal(UNIX_TIME_OFFSET_MS + 1000 + total, values[0],
+			      "Entries should be encoded in order");
+		zassert_false(gps_nmea[total + entries - 1].queued, "Entry should be unqueued");
+		if (total + entries < ARRAY_SIZE(gps_nmea)) {
+			zassert_true(gps_nmea[total + entries].queued, "Entry should be queued");
+		}
+
+		total += entries;
+		messages++;
+	}
+
+	zassert_equal(ARRAY_SIZE(gps_nmea), total, "Wrong total GPS count %zu", total);
+	zassert_true(messages > 1, "Entries should not fit in a single message");
+}
+
+/* Compare size and encoding time of the same batch encoded with the JSON and CBOR codecs. */
+static void test_encode_batch_data_compared_to_json(void)
+{
+	int ret;
+	uint32_t start;
+	uint32_t json_time;
+	uint32_t cbor_time;
+	uint32_t columnar_time;
+	struct cbor_writer w;
+	struct cloud_codec_data json_output;
+	struct cloud_codec_data cbor_output;
+
+	batch_data_fill(&batch);
+
+	start = k_cycle_get_32();
+	ret = batch_json_encode(&json_output, &batch);
+	json_time = k_cycle_get_32() - start;
+	zassert_equal(0, ret, "Return value %d is wrong", ret);
+
+	batch_data_fill(&batch);
+
+	start = k_cycle_get_32();
+	ret = batch_cbor_encode(&cbor_output, &batch);
+	cbor_time = k_cycle_get_32() - start;
+	zassert_equal(0, ret, "Return value %d is wrong", ret);
+
+	batch_data_fill(&batch);
+
+	start = k_cycle_get_32();
+	ret = batch_columnar_encode(&w, &batch);
+	columnar_time = k_cycle_get_32() - start;
+	zassert_equal(0, ret, "Return value %d is wrong", ret);
+
+	TC_PRINT("Batch size: JSON %zu bytes, CBOR %zu bytes, columnar CBOR %zu bytes\n",
+		 json_output.len, cbor_output.len, w.len);
+	TC_PRINT("Batch encoding time: JSON %u us, CBOR %u us, columnar CBOR %u us\n",
+		 k_cyc_to_us_floor32(json_time), k_cyc_to_us_floor32(cbor_time),
+		 k_cyc_to_us_floor32(columnar_time));
+
+	zassert_true(cbor_output.len < json_output.len, "CBOR output should be smaller");
+	zassert_true(3 * w.len <= json_output.len,
+		     "Columnar CBOR output should be at least three times smaller");
+
+	cloud_codec_release_data(&json_output);
+	cloud_codec_release_data(&cbor_output);
+}
+
+void test_main(void)
+{
+	cJSON_Init();
+
+	ztest_test_suite(cbor_common,
+		ztest_unit_test(test_writer_buffer_boundary),
+		ztest_unit_test(test_encode_ui_data),
+		ztest_unit_test(test_encode_neighbor_cells),
+		ztest_unit_test(test_encode_batch_data),
+		ztest_unit_test(test_encode_batch_data_buffer_full),
+		ztest_unit_test(test_encode_batch_data_columnar),
+		ztest_unit_test(test_encode_batch_data_columnar_buffer_full),
+		ztest_unit_test(test_encode_batch_data_compared_to_json)
+	);
+
+	ztest_run_test_suite(cbor_common);
+}
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+#include <string.h>
+#include <devicetree.h>
+#include <storage/flash_map.h>
+
+#include "data_store.h"
+
+/* Messages are longer than a write chunk of the data store. */
+#define MSG_LEN 100
+
+#define SECTOR_SIZE DT_PROP(DT_CHOSEN(zephyr_flash), erase_block_size)
+
+/* Every message is filled with a pattern that depends on its sequence number, which is also
+ * stored as the type of the message.
+ */
+static void msg_fill(uint8_t *buf, uint32_t seq)
+{
+	for (size_t i = 0; i < MSG_LEN; i++) {
+		buf[i] = (uint8_t)(seq + i);
+	}
+}
+
+static void msg_write(uint32_t seq)
+{
+	uint8_t buf[MSG_LEN];
+
+	msg_fill(buf, seq);
+
+	zassert_ok(data_store_write((uint8_t)seq, buf, sizeof(buf)),
+		   "Cannot write message %u", seq);
+}
+
+/* Read the next message and check that it is the one with the given sequence number. The
+ * returned buffer must be freed by the caller.
+ */
+static void *msg_read(uint32_t seq)
+{
+	uint8_t expected[MSG_LEN];
+	uint8_t type;
+	void *buf;
+	size_t len;
+
+	msg_fill(expected, seq);
+
+	zassert_ok(data_store_read(&type, &buf, &len), "Cannot read message %u", seq);
+	zassert_equal(type, (uint8_t)seq, "Wrong type of message %u", seq);
+	zassert_equal(len, MSG_LEN, "Wrong length of message %u", seq);
+	zassert_mem_equal(buf, expected, MSG_LEN, "Wrong content of message %u", seq);
+
+	return buf;
+}
+
+static void msg_ack(void *buf, bool sent)
+{
+	zassert_ok(data_store_ack(buf, sent), "Cannot acknowledge message");
+	k_free(buf);
+}
+
+static void msg_read_and_ack(uint32_t seq)
+{
+	msg_ack(msg_read(seq), true);
+}
+
+static void no_msg_check(void)
+{
+	uint8_t type;
+	void *buf;
+	size_t len;
+
+	zassert_equal(data_store_read(&type, &buf, &len), -ENODATA, "Unexpected message");
+}
+
+static struct data_store_stats stats_get(void)
+{
+	struct data_store_stats stats;
+
+	data_store_stats_get(&stats);
+
+	return stats;
+}
+
+/* Write messages until the given number of sectors is in use. Returns the number of
+ * written messages and the sequence number of the first message in every sector.
+ */
+static uint32_t sectors_fill(uint32_t sectors_used, uint32_t *sector_seq)
+{
+	uint32_t seq = 0;
+	uint32_t used = stats_get().sectors_used;
+
+	sector_seq[0] = 0;
+
+	while (used < sectors_used) {
+		msg_write(seq);
+
+		if (stats_get().sectors_used != used) {
+			used = stats_get().sectors_used;
+			sector_seq[used - 1] = seq;
+		}
+
+		seq++;
+	}
+
+	return seq;
+}
+
+static void store_erase(void)
+{
+	const struct flash_area *fa;
+
+	zassert_ok(flash_area_open(FLASH_AREA_ID(data_store), &fa),
+		   "Cannot open the data store partition");
+	zassert_ok(flash_area_erase(fa, 0, fa->fa_size),
+		   "Cannot erase the data store partition");
+	flash_area_close(fa);
+
+	zassert_ok(data_store_init(), "Cannot initialize the data store");
+}
+
+static void test_write_read_ack(void)
+{
+	void *buf[3];
+	struct data_store_stats stats;
+
+	for (uint32_t seq = 0; seq < ARRAY_SIZE(buf); seq++) {
+		msg_write(seq);
+	}
+
+	stats = stats_get();
+	zassert_equal(stats.written_count, ARRAY_SIZE(buf), "Wrong written count");
+	zassert_equal(stats.written_bytes, ARRAY_SIZE(buf) * MSG_LEN, "Wrong written bytes");
+	zassert_equal(stats.stored_count, ARRAY_SIZE(buf), "Wrong stored count");
+
+	for (uint32_t seq = 0; seq < ARRAY_SIZE(buf); seq++) {
+		buf[seq] = msg_read(seq);
+	}
+
+	no_msg_check();
+
+	/* Messages are removed in the order they were stored. */
+	msg_ack(buf[1], true);
+	zassert_equal(stats_get().acked_count, 0, "Message acknowledged out of order");
+
+	msg_ack(buf[0], true);
+	zassert_equal(stats_get().acked_count, 2, "Wrong acknowledged count");
+
+	msg_ack(buf[2], true);
+
+	stats = stats_get();
+	zassert_equal(stats.acked_count, ARRAY_SIZE(buf), "Wrong acknowledged count");
+	zassert_equal(stats.acked_bytes, ARRAY_SIZE(buf) * MSG_LEN, "Wrong acknowledged bytes");
+	zassert_equal(stats.stored_count, 0, "Acknowledged messages not erased");
+	zassert_equal(stats.dropped_count, 0, "Messages dropped");
+
+	no_msg_check();
+
+	zassert_equal(data_store_ack(buf, true), -ENOENT, "Unknown message acknowledged");
+}
+
+static void test_invalid_len(void)
+{
+	static uint8_t buf[SECTOR_SIZE];
+
+	zassert_equal(data_store_write(0, buf, 0), -EINVAL, "Empty message written");
+	zassert_equal(data_store_write(0, buf, sizeof(buf)), -EMSGSIZE,
+		      "Message larger than a sector written");
+	zassert_equal(stats_get().written_count, 0, "Wrong written count");
+}
+
+static void test_inflight_limit(void)
+{
+	void *buf[CONFIG_DATA_STORE_INFLIGHT_MAX];
+	uint8_t type;
+	void *extra;
+	size_t len;
+
+	for (uint32_t seq = 0; seq <= ARRAY_SIZE(buf); seq++) {
+		msg_write(seq);
+	}
+
+	for (uint32_t seq = 0; seq < ARRAY_SIZE(buf); seq++) {
+		buf[seq] = msg_read(seq);
+	}
+
+	zassert_equal(data_store_read(&type, &extra, &len), -EBUSY,
+		      "More messages read than allowed");
+
+	msg_ack(buf[0], true);
+	msg_read_and_ack(ARRAY_SIZE(buf));
+
+	for (uint32_t seq = 1; seq < ARRAY_SIZE(buf); seq++) {
+		msg_ack(buf[seq], true);
+	}
+
+	zassert_equal(stats_get().stored_count, 0, "Acknowledged messages not erased");
+}
+
+static void test_failed_read_again(void)
+{
+	void *buf[3];
+
+	for (uint32_t seq = 0; seq < ARRAY_SIZE(buf); seq++) {
+		msg_write(seq);
+		buf[seq] = msg_read(seq);
+	}
+
+	msg_ack(buf[1], false);
+	msg_ack(buf[0], true);
+
+	/* Messages are read again only when all messages read before are acknowledged. */
+	no_msg_check();
+
+	msg_ack(buf[2], true);
+	zassert_equal(stats_get().acked_count, 1, "Wrong acknowledged count");
+
+	/* Messages following the last acknowledged one are read again, in order. */
+	msg_read_and_ack(1);
+	msg_read_and_ack(2);
+	no_msg_check();
+
+	zassert_equal(stats_get().acked_count, ARRAY_SIZE(buf), "Wrong acknowledged count");
+	zassert_equal(stats_get().stored_count, 0, "Acknowledged messages not erased");
+}
+
+static void test_truncation(void)
+{
+	uint32_t sector_seq[3];
+	uint32_t count = sectors_fill(ARRAY_SIZE(sector_seq), sector_seq);
+	struct data_store_stats stats;
+
+	/* A sector is erased only when all messages in it are acknowledged. */
+	for (uint32_t seq = 0; seq < sector_seq[1] - 1; seq++) {
+		msg_read_and_ack(seq);
+	}
+
+	stats = stats_get();
+	zassert_equal(stats.erase_count, 0, "Sector erased before all messages are acknowledged");
+	zassert_equal(stats.sectors_used, 3, "Wrong number of used sectors");
+
+	msg_read_and_ack(sector_seq[1] - 1);
+
+	stats = stats_get();
+	zassert_equal(stats.erase_count, 1, "Sector not erased");
+	zassert_equal(stats.sectors_used, 2, "Wrong number of used sectors");
+	zassert_equal(stats.stored_count, count - sector_seq[1], "Wrong stored count");
+
+	for (uint32_t seq = sector_seq[1]; seq < count; seq++) {
+		msg_read_and_ack(seq);
+	}
+
+	no_msg_check();
+	zassert_equal(stats_get().stored_count, 0, "Acknowledged messages not erased");
+}
+
+static void test_wraparound(void)
+{
+	uint32_t count = 0;
+	struct data_store_stats stats;
+
+	/* Fill the store and wrap around it once more. */
+	while (stats_get().dropped_count == 0) {
+		msg_write(count++);
+	}
+
+	while (stats_get().erase_count < stats_get().sectors_total) {
+		msg_write(count++);
+	}
+
+	stats = stats_get();
+	zassert_equal(stats.written_count, count, "Wrong written count");
+	zassert_equal(stats.sectors_used, stats.sectors_total, "Store not full");
+	zassert_true(stats.sector_id > stats.sectors_total, "Sectors not reused");
+	zassert_equal(stats.stored_count, count - stats.dropped_count, "Wrong stored count");
+
+	/* The oldest messages are lost and the newest ones are read in order. */
+	for (uint32_t seq = stats.dropped_count; seq < count; seq++) {
+		msg_read_and_ack(seq);
+	}
+
+	no_msg_check();
+}
+
+static void test_recovery_after_reinit(void)
+{
+	uint32_t sector_seq[3];
+	uint32_t count = sectors_fill(ARRAY_SIZE(sector_seq), sector_seq);
+	void *buf;
+
+	/* Acknowledge all messages in the first sector and part of the second one. */
+	for (uint32_t seq = 0; seq <= sector_seq[1]; seq++) {
+		msg_read_and_ack(seq);
+	}
+
+	/* Simulate a reboot while a message waits for acknowledgment. */
+	buf = msg_read(sector_seq[1] + 1);
+
+	zassert_ok(data_store_init(), "Cannot initialize the data store");
+	zassert_equal(data_store_ack(buf, true), -ENOENT,
+		      "Message read before the reboot acknowledged");
+	k_free(buf);
+
+	/* Messages in the erased sector are gone, acknowledged messages in the sector that is
+	 * still in use are read again.
+	 */
+	zassert_equal(stats_get().stored_count, count - sector_seq[1], "Wrong stored count");
+
+	msg_write(count);
+
+	for (uint32_t seq = sector_seq[1]; seq <= count; seq++) {
+		msg_read_and_ack(seq);
+	}
+
+	no_msg_check();
+
+	/* No message is left after a reboot once all sectors are erased. */
+	zassert_ok(data_store_init(), "Cannot initialize the data store");
+	zassert_equal(stats_get().stored_count, 0, "Acknowledged messages kept");
+	no_msg_check();
+}
+
+void test_main(void)
+{
+	ztest_test_suite(data_store,
+		ztest_unit_test_setup_teardown(test_write_read_ack, store_erase,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_invalid_len, store_erase,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_inflight_limit, store_erase,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_failed_read_again, store_erase,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_truncation, store_erase,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_wraparound, store_erase,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_recovery_after_reinit, store_erase,
+					       unit_test_noop)
+	);
+
+	ztest_run_test_suite(data_store);
+}
@@ -187,24 +187,46 @@ static int init(void)
 	return err;
 }
 
-static bool handle_sensor_event(const struct sensor_event *event)
+static void add_data(const char *descr, const sensor_event_data_t *data, size_t data_cnt)
 {
-	if ((event->descr != handled_sensor_event_descr) &&
-	    strcmp(event->descr, handled_sensor_event_descr)) {
-		return false;
+	if ((descr != handled_sensor_event_descr) &&
+	    strcmp(descr, handled_sensor_event_descr)) {
+		return;
 	}
 
 	if (state != STATE_ACTIVE) {
-		return false;
+		return;
 	}
 
-	int err = ei_wrapper_add_data(sensor_event_get_data_ptr(event),
-				      sensor_event_get_data_cnt(event));
+#ifdef CONFIG_CAF_SENSOR_EVENT_DATA_FIXED_POINT
+	/* Data is converted to floating-point values by the EI wrapper. */
+	int err = ei_wrapper_add_data_fixed(data, data_cnt, SENSOR_EVENT_DATA_FRAC_BITS);
+#else
+	int err = ei_wrapper_add_data(data, data_cnt);
+#endif
 
 	if (err) {
 		LOG_ERR("Cannot add data for EI wrapper (err %d)", err);
 		report_error();
 	}
+}
+
+static bool handle_sensor_event(const struct sensor_event *event)
+{
+	add_data(event->descr, sensor_event_get_data_ptr(event),
+		 sensor_event_get_data_cnt(event));
+
+	return false;
+}
+
+static bool handle_sensor_batch_event(const struct sensor_batch_event *event)
+{
+	if (event->dropped_cnt > 0) {
+		LOG_WRN("%" PRIu16 " samples dropped", event->dropped_cnt);
+	}
+
+	/* All samples of the batch are added at once. */
+	add_data(event->descr, event->data, sensor_batch_event_get_data_cnt(event));
 
 	return false;
 }
@@ -274,6 +296,10 @@ static bool event_handler(const struct event_header *eh)
 		return handle_sensor_event(cast_sensor_event(eh));
 	}
 
+	if (is_sensor_batch_event(eh)) {
+		return handle_sensor_batch_event(cast_sensor_batch_event(eh));
+	}
+
 	if (APP_CONTROLS_ML_STATE &&
 	    is_ml_state_event(eh)) {
 		return handle_ml_state_event(cast_ml_state_event(eh));
@@ -296,6 +322,7 @@ static bool event_handler(const struct event_header *eh)
 EVENT_LISTENER(MODULE, event_handler);
 EVENT_SUBSCRIBE(MODULE, module_state_event);
 EVENT_SUBSCRIBE(MODULE, sensor_event);
+EVENT_SUBSCRIBE(MODULE, sensor_batch_event);
 EVENT_SUBSCRIBE(MODULE, ml_result_signin_event);
 #if APP_CONTROLS_ML_STATE
 EVENT_SUBSCRIBE(MODULE, ml_state_event);
@@ -20,7 +20,7 @@ static int snprintf_error_check(int res, size_t buf_size)
 	return 0;
 }
 
-int ei_data_forwarder_parse_data(const float *data_ptr, size_t data_cnt,
+int ei_data_forwarder_parse_data(const sensor_event_data_t *data_ptr, size_t data_cnt,
 				 uint8_t *buf, size_t buf_size)
 {
 	int pos = 0;
@@ -29,7 +29,8 @@ int ei_data_forwarder_parse_data(const float *data_ptr, size_t data_cnt,
 		int tmp;
 
 		if ((i % 2) == 0) {
-			tmp = snprintf(&buf[pos], buf_size - pos, "%.2f", data_ptr[i / 2]);
+			tmp = snprintf(&buf[pos], buf_size - pos, "%.2f",
+				       sensor_event_data_to_float(data_ptr[i / 2]));
 		} else if (i == (2 * data_cnt - 1)) {
 			tmp = snprintf(&buf[pos], buf_size - pos, "\r\n");
 		} else {
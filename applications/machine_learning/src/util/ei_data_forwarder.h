@@ -7,8 +7,10 @@
 #ifndef _EI_DATA_FORWARDER_H_
 #define _EI_DATA_FORWARDER_H_
 
+#include <caf/events/sensor_event.h>
 
-int ei_data_forwarder_parse_data(const float *data_ptr, size_t data_cnt,
+
+int ei_data_forwarder_parse_data(const sensor_event_data_t *data_ptr, size_t data_cnt,
 				 uint8_t *buf, size_t buf_size);
 
 #endif /* _EI_DATA_FORWARDER_H_ */
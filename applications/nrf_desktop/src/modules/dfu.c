@@ -8,11 +8,13 @@
 
 #include <zephyr/types.h>
 #include <sys/byteorder.h>
+#include <sys/crc.h>
 #include <storage/flash_map.h>
 #include <pm_config.h>
 
 #include "event_manager.h"
 #include "config_event.h"
+#include "dfu_slot_erase.h"
 #include "hid_event.h"
 #include <caf/events/ble_common_event.h>
 
@@ -30,22 +32,23 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_LOG_LEVEL);
 #define DFU_STATE_CLEANING 0x03
 
 
-#define FLASH_PAGE_SIZE_LOG2	12
-#define FLASH_PAGE_SIZE		BIT(FLASH_PAGE_SIZE_LOG2)
-#define FLASH_PAGE_ID(off)	((off) >> FLASH_PAGE_SIZE_LOG2)
-#define FLASH_CLEAN_VAL		UINT32_MAX
-#define FLASH_READ_CHUNK_SIZE	(FLASH_PAGE_SIZE / 8)
+#define FLASH_PAGE_SIZE		DFU_SLOT_ERASE_PAGE_SIZE
 
 #define DFU_TIMEOUT			K_SECONDS(2)
 #define REBOOT_REQUEST_TIMEOUT		K_MSEC(250)
 #define BACKGROUND_FLASH_ERASE_TIMEOUT	K_SECONDS(15)
 #define BACKGROUND_FLASH_STORE_TIMEOUT	K_MSEC(5)
 
-/* Keep small to avoid blocking the workqueue for long periods of time. */
-#define STORE_CHUNK_SIZE		16 /* bytes */
-
 #define SYNC_BUFFER_SIZE (CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_SYNC_BUFFER_SIZE * sizeof(uint32_t)) /* bytes */
 
+/* Pages that will be written by the ongoing transfer are erased ahead of the
+ * write pointer, so that storing data does not wait for the erase.
+ */
+#define ERASE_AHEAD_SIZE ROUND_UP(2 * SYNC_BUFFER_SIZE, FLASH_PAGE_SIZE)
+
+/* CRC seed used by the host. */
+#define IMG_CRC_INIT	1
+
 #if CONFIG_SECURE_BOOT
  #include <fw_info.h>
  #define IMAGE0_ID		PM_S0_IMAGE_ID
@@ -62,6 +65,15 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_LOG_LEVEL);
  #error Bootloader not supported.
 #endif
 
+#if CONFIG_BOOTLOADER_MCUBOOT
+ /* MCUboot writes the image trailer to the last page of the slot when the
+  * upgrade is requested.
+  */
+ #define IMAGE_TRAILER_SIZE	FLASH_PAGE_SIZE
+#else
+ #define IMAGE_TRAILER_SIZE	0
+#endif
+
 static struct k_work_delayable dfu_timeout;
 static struct k_work_delayable reboot_request;
 static struct k_work_delayable background_erase;
@@ -71,13 +83,22 @@ static const struct flash_area *flash_area;
 static uint32_t cur_offset;
 static uint32_t img_csum;
 static uint32_t img_length;
+static uint32_t img_crc;
+
+struct sync_buffer {
+	uint8_t data[SYNC_BUFFER_SIZE] __aligned(4);
+	uint32_t len;
+	uint32_t crc; /* Image CRC up to the end of the buffered data. */
+};
 
-static uint16_t store_offset;
-static uint16_t sync_offset;
-static char sync_buffer[SYNC_BUFFER_SIZE] __aligned(4);
+/* While one buffer is written to flash, the host fills the other one. */
+static struct sync_buffer sync_buffers[2];
+static struct sync_buffer *rx_buf = &sync_buffers[0];
+static struct sync_buffer *store_buf;
+static uint32_t store_offset;
 
+static struct dfu_slot_erase slot_erase;
 static bool device_in_use;
-static bool is_flash_area_clean;
 
 enum dfu_opt {
 	DFU_OPT_START,
@@ -85,6 +106,7 @@ enum dfu_opt {
 	DFU_OPT_SYNC,
 	DFU_OPT_REBOOT,
 	DFU_OPT_FWINFO,
+	DFU_OPT_SYNC_FAST,
 
 	DFU_OPT_COUNT
 };
@@ -94,7 +116,8 @@ const static char * const opt_descr[] = {
 	[DFU_OPT_DATA] = "data",
 	[DFU_OPT_SYNC] = "sync",
 	[DFU_OPT_REBOOT] = "reboot",
-	[DFU_OPT_FWINFO] = "fwinfo"
+	[DFU_OPT_FWINFO] = "fwinfo",
+	[DFU_OPT_SYNC_FAST] = "sync_fast"
 };
 
 static uint8_t dfu_slot_id(void)
@@ -112,33 +135,6 @@ static uint8_t dfu_slot_id(void)
 #endif
 }
 
-static bool is_page_clean(const struct flash_area *fa, off_t off, size_t len)
-{
-	static const size_t chunk_size = FLASH_READ_CHUNK_SIZE;
-	static const size_t chunk_cnt = FLASH_PAGE_SIZE / chunk_size;
-
-	BUILD_ASSERT(chunk_size * chunk_cnt == FLASH_PAGE_SIZE);
-	BUILD_ASSERT(chunk_size % sizeof(uint32_t) == 0);
-
-	for (size_t i = 0; i < chunk_cnt; i++) {
-		uint32_t buf[chunk_size / sizeof(uint32_t)];
-		int err = flash_area_read(fa, off + i * chunk_size, buf, chunk_size);
-
-		if (err) {
-			LOG_ERR("Cannot read flash");
-			return false;
-		}
-
-		for (size_t j = 0; j < ARRAY_SIZE(buf); j++) {
-			if (buf[j] != FLASH_CLEAN_VAL) {
-				return false;
-			}
-		}
-	}
-
-	return true;
-}
-
 static void terminate_dfu(void)
 {
 	__ASSERT_NO_MSG(flash_area != NULL);
@@ -148,7 +144,8 @@ static void terminate_dfu(void)
 	(void)k_work_cancel_delayable(&dfu_timeout);
 	(void)k_work_cancel_delayable(&background_store);
 	flash_area = NULL;
-	sync_offset = 0;
+	rx_buf->len = 0;
+	store_buf = NULL;
 }
 
 static void dfu_timeout_handler(struct k_work *work)
@@ -170,93 +167,142 @@ static void reboot_request_handler(struct k_work *work)
 	sys_reboot(SYS_REBOOT_WARM);
 }
 
+static void restart_background_erase(void)
+{
+	dfu_slot_erase_restart(&slot_erase);
+	k_work_reschedule(&background_erase, K_NO_WAIT);
+}
+
+static bool is_erase_urgent(void)
+{
+	return (flash_area != NULL) &&
+	       !dfu_slot_erase_is_erased(&slot_erase,
+					 cur_offset + ERASE_AHEAD_SIZE - 1);
+}
+
+static int erase_page(const struct flash_area *fa)
+{
+	int err = dfu_slot_erase_page(&slot_erase, fa);
+
+	if (err) {
+		LOG_ERR("Cannot erase page (%d)", err);
+	} else if (dfu_slot_erase_is_done(&slot_erase)) {
+		LOG_INF("Secondary image slot is clean");
+	}
+
+	return err;
+}
+
 static void background_erase_handler(struct k_work *work)
 {
-	static uint32_t erase_offset;
+	const struct flash_area *fa;
 	int err;
 
-	__ASSERT_NO_MSG(!is_flash_area_clean);
+	/* Pages may also be erased by the data store. */
+	if (dfu_slot_erase_is_done(&slot_erase)) {
+		return;
+	}
 
 	/* During page erase operation CPU stalls. As page erase takes tens of
 	 * milliseconds let's perform it in background, when user is not
-	 * interacting with the device.
+	 * interacting with the device. Pages needed by the ongoing transfer
+	 * are erased as soon as the device is idle.
 	 */
 	if (device_in_use) {
 		device_in_use = false;
 		k_work_reschedule(&background_erase,
-				      BACKGROUND_FLASH_ERASE_TIMEOUT);
+				  is_erase_urgent() ?
+				  BACKGROUND_FLASH_STORE_TIMEOUT :
+				  BACKGROUND_FLASH_ERASE_TIMEOUT);
 		return;
 	}
 
-	if (!flash_area) {
-		err = flash_area_open(dfu_slot_id(), &flash_area);
-		if (err) {
-			LOG_ERR("Cannot open flash area (%d)", err);
-			flash_area = NULL;
-			return;
-		}
+	err = flash_area_open(dfu_slot_id(), &fa);
+	if (err) {
+		LOG_ERR("Cannot open flash area (%d)", err);
+		return;
 	}
 
-	__ASSERT_NO_MSG(erase_offset + FLASH_PAGE_SIZE <= flash_area->fa_size);
+	err = erase_page(fa);
+	flash_area_close(fa);
 
-	if (!is_page_clean(flash_area, erase_offset, FLASH_PAGE_SIZE)) {
-		err = flash_area_erase(flash_area, erase_offset, FLASH_PAGE_SIZE);
-		if (err) {
-			LOG_ERR("Cannot erase page (%d)", err);
-			flash_area_close(flash_area);
-			flash_area = NULL;
-			return;
-		}
+	if (!err && !dfu_slot_erase_is_done(&slot_erase)) {
+		k_work_reschedule(&background_erase, K_NO_WAIT);
 	}
+}
 
-	erase_offset += FLASH_PAGE_SIZE;
-
-	if (erase_offset < flash_area->fa_size) {
+static void erase_ahead(void)
+{
+	if (!dfu_slot_erase_is_done(&slot_erase) && is_erase_urgent()) {
 		k_work_reschedule(&background_erase, K_NO_WAIT);
-	} else {
-		LOG_INF("Secondary image slot is clean");
-
-		is_flash_area_clean = true;
-		erase_offset = 0;
-
-		flash_area_close(flash_area);
-		flash_area = NULL;
 	}
 }
 
 static void complete_dfu_data_store(void)
 {
-	cur_offset += sync_offset;
-	sync_offset = 0;
+	__ASSERT_NO_MSG(store_buf != NULL);
+
+	cur_offset += store_buf->len;
+	img_crc = store_buf->crc;
+	store_buf = NULL;
 	store_offset = 0;
 
 	LOG_DBG("DFU data store complete: %" PRIu32, cur_offset);
 
 	if (cur_offset == img_length) {
+		if (img_crc != img_csum) {
+			LOG_ERR("Invalid image checksum 0x%" PRIx32, img_crc);
+			terminate_dfu();
+			/* Image cannot be resumed, start from scratch. */
+			cur_offset = 0;
+			restart_background_erase();
+			return;
+		}
+
 		LOG_INF("DFU image written");
+
+		/* The transfer may complete before the background erase
+		 * reaches the end of the slot. Stop it, so that it does not
+		 * erase the trailer written by the upgrade request.
+		 */
+		(void)k_work_cancel_delayable(&background_erase);
+
+		int err = dfu_slot_erase_complete(&slot_erase, flash_area);
+
+		if (err) {
+			LOG_ERR("Cannot erase image trailer (err:%d)", err);
+			terminate_dfu();
+			cur_offset = 0;
+			restart_background_erase();
+			return;
+		}
+
 #ifdef CONFIG_BOOTLOADER_MCUBOOT
-		int err = boot_request_upgrade(false);
+		err = boot_request_upgrade(false);
 		if (err) {
 			LOG_ERR("Cannot request the image upgrade (err:%d)", err);
 		}
 #endif
 		terminate_dfu();
+	} else {
+		erase_ahead();
 	}
 }
 
 static void store_dfu_data_chunk(void)
 {
 	/* Some flash may require word alignment. */
-	BUILD_ASSERT((STORE_CHUNK_SIZE % sizeof(uint32_t)) == 0);
-	BUILD_ASSERT((sizeof(sync_buffer) % sizeof(uint32_t)) == 0);
+	BUILD_ASSERT((sizeof(store_buf->data) % sizeof(uint32_t)) == 0);
 
-	__ASSERT_NO_MSG(store_offset <= sync_offset);
+	__ASSERT_NO_MSG(store_offset <= store_buf->len);
 	__ASSERT_NO_MSG(flash_area != NULL);
 
-	size_t store_size = STORE_CHUNK_SIZE;
+	uint32_t addr = cur_offset + store_offset;
+	size_t store_size = store_buf->len - store_offset;
 
-	if (sync_offset - store_offset < store_size) {
-		store_size = sync_offset - store_offset;
+	/* Write the data in one batch up to the end of the flash page. */
+	if (FLASH_PAGE_SIZE - (addr % FLASH_PAGE_SIZE) < store_size) {
+		store_size = FLASH_PAGE_SIZE - (addr % FLASH_PAGE_SIZE);
 	}
 	if ((store_size > sizeof(uint32_t)) &&
 	    ((store_size % sizeof(uint32_t)) != 0)) {
@@ -264,9 +310,9 @@ static void store_dfu_data_chunk(void)
 		store_size = (store_size / sizeof(uint32_t)) * sizeof(uint32_t);
 	}
 
-	LOG_DBG("DFU data store chunk: %" PRIu32, cur_offset + store_offset);
-	int err = flash_area_write(flash_area, cur_offset + store_offset,
-				   &sync_buffer[store_offset], store_size);
+	LOG_DBG("DFU data store chunk: %" PRIu32 " %zu", addr, store_size);
+	int err = flash_area_write(flash_area, addr,
+				   &store_buf->data[store_offset], store_size);
 	if (err) {
 		LOG_ERR("Cannot write data (%d)", err);
 		terminate_dfu();
@@ -279,11 +325,22 @@ static void background_store_handler(struct k_work *work)
 {
 	if (device_in_use) {
 		device_in_use = false;
+	} else if (!dfu_slot_erase_is_erased(&slot_erase,
+					     cur_offset + store_offset)) {
+		/* The background erase did not reach the page yet. */
+		if (erase_page(flash_area)) {
+			terminate_dfu();
+		}
 	} else {
 		store_dfu_data_chunk();
 	}
 
-	if (store_offset < sync_offset) {
+	if (!store_buf) {
+		/* DFU terminated. */
+		return;
+	}
+
+	if (store_offset < store_buf->len) {
 		k_work_reschedule(&background_store, BACKGROUND_FLASH_STORE_TIMEOUT);
 		k_work_reschedule(&dfu_timeout, DFU_TIMEOUT);
 	} else {
@@ -293,23 +350,30 @@ static void background_store_handler(struct k_work *work)
 
 static bool is_dfu_data_store_active(void)
 {
-	return k_work_delayable_is_pending(&background_store);
+	return (store_buf != NULL);
 }
 
 static void start_dfu_data_store(void)
 {
-	LOG_DBG("DFU data store start: %" PRIu32 " %" PRIu32, cur_offset, sync_offset);
+	__ASSERT_NO_MSG(!is_dfu_data_store_active());
+
+	/* Swap buffers, the host can send more data while this one is
+	 * stored.
+	 */
+	store_buf = rx_buf;
+	rx_buf = (store_buf == &sync_buffers[0]) ?
+		 &sync_buffers[1] : &sync_buffers[0];
+	rx_buf->len = 0;
+	rx_buf->crc = store_buf->crc;
+
+	LOG_DBG("DFU data store start: %" PRIu32 " %" PRIu32, cur_offset,
+		store_buf->len);
 	store_offset = 0;
 	k_work_reschedule(&background_store, K_NO_WAIT);
 }
 
 static void handle_dfu_data(const uint8_t *data, size_t size)
 {
-	if (!is_flash_area_clean) {
-		LOG_WRN("Flash is not clean");
-		return;
-	}
-
 	if (!flash_area) {
 		LOG_WRN("DFU was not started");
 		return;
@@ -323,13 +387,14 @@ static void handle_dfu_data(const uint8_t *data, size_t size)
 		return;
 	}
 
-	if (size > sizeof(sync_buffer) - sync_offset) {
+	if (size > sizeof(rx_buf->data) - rx_buf->len) {
 		LOG_WRN("Chunk size truncated");
-		size = sizeof(sync_buffer) - sync_offset;
+		size = sizeof(rx_buf->data) - rx_buf->len;
 	}
-	memcpy(&sync_buffer[sync_offset], data, size);
+	memcpy(&rx_buf->data[rx_buf->len], data, size);
 
-	sync_offset += size;
+	rx_buf->len += size;
+	rx_buf->crc = crc32_ieee_update(rx_buf->crc, data, size);
 
 	LOG_DBG("DFU chunk collected");
 
@@ -350,18 +415,11 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 	BUILD_ASSERT(sizeof(csum) == sizeof(img_csum), "");
 	BUILD_ASSERT(sizeof(offset) == sizeof(cur_offset), "");
 
-	sync_offset = 0;
-
 	if (size < data_size) {
 		LOG_WRN("Invalid DFU start header");
 		return;
 	}
 
-	if (!is_flash_area_clean) {
-		LOG_WRN("Flash is not clean yet.");
-		return;
-	}
-
 	if (flash_area) {
 		LOG_WRN("DFU already in progress");
 		return;
@@ -399,18 +457,15 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 			LOG_INF("Restart DFU");
 		}
 	} else {
-		if (cur_offset != 0) {
-			k_work_reschedule(&background_erase, K_NO_WAIT);
-			is_flash_area_clean = false;
-			cur_offset = 0;
-			img_length = 0;
-			img_csum = 0;
-
-			return;
-		} else {
-			img_length = length;
-			img_csum = csum;
-		}
+		/* Data of the previous transfer is erased ahead of the write
+		 * pointer while the new image is received. Clean pages are
+		 * skipped.
+		 */
+		restart_background_erase();
+		cur_offset = 0;
+		img_length = length;
+		img_csum = csum;
+		img_crc = IMG_CRC_INIT;
 	}
 
 	__ASSERT_NO_MSG(flash_area == NULL);
@@ -427,6 +482,9 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 		terminate_dfu();
 	} else {
 		LOG_INF("DFU started");
+		rx_buf->len = 0;
+		rx_buf->crc = img_crc;
+		erase_ahead();
 		k_work_reschedule(&dfu_timeout, DFU_TIMEOUT);
 	}
 }
@@ -434,18 +492,18 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 static void handle_dfu_sync(uint8_t *data, size_t *size)
 {
 	LOG_INF("DFU sync requested");
-	uint16_t sync_buffer_size = sizeof(sync_buffer);
+	uint16_t sync_buffer_size = sizeof(rx_buf->data);
 
-	bool storing_data = (sync_offset > 0);
+	bool storing_data = is_dfu_data_store_active() || (rx_buf->len > 0);
 	bool dfu_active = (flash_area != NULL);
 
-	if (storing_data && !is_dfu_data_store_active()) {
+	if ((rx_buf->len > 0) && !is_dfu_data_store_active()) {
 		start_dfu_data_store();
 	}
 
 	uint8_t dfu_state;
 
-	if (!is_flash_area_clean) {
+	if (!dfu_slot_erase_is_done(&slot_erase) && !dfu_active) {
 		dfu_state = DFU_STATE_CLEANING;
 	} else if (storing_data) {
 		dfu_state = DFU_STATE_STORING;
@@ -637,6 +695,11 @@ static void fetch_config(const uint8_t opt_id, uint8_t *data, size_t *size)
 		break;
 
 	case DFU_OPT_SYNC:
+	case DFU_OPT_SYNC_FAST:
+		/* Both options perform the same operation. The host uses
+		 * sync_fast to find out that the data can be sent while the
+		 * previously synchronized data is stored.
+		 */
 		handle_dfu_sync(data, size);
 		break;
 
@@ -680,6 +743,7 @@ static bool event_handler(const struct event_header *eh)
 			k_work_init_delayable(&reboot_request, reboot_request_handler);
 			k_work_init_delayable(&background_erase, background_erase_handler);
 			k_work_init_delayable(&background_store, background_store_handler);
+			dfu_slot_erase_init(&slot_erase, IMAGE_TRAILER_SIZE);
 
 			k_work_reschedule(&background_erase, K_NO_WAIT);
 		}
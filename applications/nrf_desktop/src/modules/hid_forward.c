@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
  */
 
+#include <inttypes.h>
 #include <zephyr/types.h>
 #include <sys/slist.h>
 #include <settings/settings.h>
@@ -16,6 +17,8 @@
 
 #include "hid_report_desc.h"
 #include "config_channel_transport.h"
+#include "hid_mouse_report.h"
+#include "drr.h"
 
 #include "hid_event.h"
 #include <caf/events/ble_common_event.h>
@@ -28,6 +31,8 @@
 LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_HID_FORWARD_LOG_LEVEL);
 
 #define MAX_ENQUEUED_ITEMS CONFIG_DESKTOP_HID_FORWARD_MAX_ENQUEUED_REPORTS
+#define DRR_QUANTUM		CONFIG_DESKTOP_HID_FORWARD_DRR_QUANTUM
+#define LATENCY_TARGET		CONFIG_DESKTOP_HID_FORWARD_LATENCY_TARGET
 #define CFG_CHAN_RSP_READ_DELAY		15
 #define CFG_CHAN_MAX_RSP_POLL_CNT	50
 #define CFG_CHAN_UNUSED_PEER_ID		UINT8_MAX
@@ -40,6 +45,7 @@ BUILD_ASSERT(CFG_CHAN_MAX_RSP_POLL_CNT <= UCHAR_MAX);
 struct enqueued_report {
 	sys_snode_t node;
 	struct hid_report_event *report;
+	uint32_t timestamp;
 };
 
 struct counted_list {
@@ -49,7 +55,6 @@ struct counted_list {
 
 struct enqueued_reports {
 	struct counted_list reports[ARRAY_SIZE(input_reports)];
-	uint8_t last_idx;
 };
 
 struct subscriber {
@@ -57,12 +62,22 @@ struct subscriber {
 	uint32_t enabled_reports_bm;
 	struct enqueued_reports enqueued_reports;
 	bool busy;
-	uint8_t last_peripheral_id;
+	uint8_t drr_peripheral_id;
+};
+
+struct forward_stats {
+	uint32_t forwarded;
+	uint32_t coalesced;
+	uint32_t dropped;
+	uint32_t latency_sum;
+	uint32_t latency_max;
 };
 
 struct hids_peripheral {
 	struct bt_hogp hogp;
 	struct enqueued_reports enqueued_reports;
+	uint16_t deficit;
+	struct forward_stats stats;
 
 	struct k_work_delayable read_rsp;
 	struct config_event *cfg_chan_rsp;
@@ -77,6 +92,10 @@ static bt_addr_le_t peripheral_address[CONFIG_BT_MAX_PAIRED];
 static struct hids_peripheral peripherals[CONFIG_BT_MAX_CONN];
 static bool suspended;
 
+#ifdef CONFIG_DESKTOP_HID_FORWARD_STATS
+static struct k_work_delayable stats_log;
+#endif
+
 
 #if CONFIG_USB_HID_DEVICE_COUNT > 1
 static void verify_data(const struct bt_bond_info *info, void *user_data)
@@ -158,11 +177,6 @@ static struct subscriber *get_subscriber(const struct hids_peripheral *per)
 	return &subscribers[per->sub_id];
 }
 
-static size_t next_id(size_t id, size_t max)
-{
-	return (id + 1) % max;
-}
-
 static int get_input_report_idx(uint8_t report_id)
 {
 	for (size_t i = 0; i < ARRAY_SIZE(input_reports); i++) {
@@ -203,6 +217,16 @@ static bool is_any_report_enqueued(struct enqueued_reports *enqueued_reports)
 	return false;
 }
 
+static struct enqueued_report *peek_enqueued_report(struct enqueued_reports *enqueued_reports,
+						    size_t irep_idx)
+{
+	struct counted_list *reports = &enqueued_reports->reports[irep_idx];
+
+	return CONTAINER_OF(sys_slist_peek_head(&reports->list),
+			    struct enqueued_report,
+			    node);
+}
+
 static struct enqueued_report *get_enqueued_report(struct enqueued_reports *enqueued_reports,
 						   size_t irep_idx)
 {
@@ -241,27 +265,52 @@ static void init_enqueued_reports(struct enqueued_reports *enqueued_reports)
 		sys_slist_init(&reports->list);
 		reports->count = 0;
 	}
+}
 
-	enqueued_reports->last_idx = 0;
+/* Reports of every type are enqueued in order of arrival. The oldest report
+ * among the heads of the lists has the earliest deadline.
+ */
+static int get_oldest_enqueued_report_idx(struct enqueued_reports *enqueued_reports)
+{
+	int oldest_idx = -ENOENT;
+	uint32_t oldest_ts = 0;
+
+	for (size_t irep_idx = 0; irep_idx < ARRAY_SIZE(enqueued_reports->reports); irep_idx++) {
+		if (!is_report_enqueued(enqueued_reports, irep_idx)) {
+			continue;
+		}
+
+		uint32_t ts = peek_enqueued_report(enqueued_reports, irep_idx)->timestamp;
+
+		if ((oldest_idx < 0) || ((int32_t)(ts - oldest_ts) < 0)) {
+			oldest_idx = irep_idx;
+			oldest_ts = ts;
+		}
+	}
+
+	return oldest_idx;
 }
 
 static struct enqueued_report *get_next_enqueued_report(struct enqueued_reports *enqueued_reports)
 {
-	struct enqueued_report *item = NULL;
+	int irep_idx = get_oldest_enqueued_report_idx(enqueued_reports);
 
-	for (size_t i = 0; i < ARRAY_SIZE(enqueued_reports->reports); i++) {
-		size_t irep_idx = next_id(enqueued_reports->last_idx + i,
-					  ARRAY_SIZE(enqueued_reports->reports));
+	if (irep_idx < 0) {
+		return NULL;
+	}
 
-		if (is_report_enqueued(enqueued_reports, irep_idx)) {
-			item = get_enqueued_report(enqueued_reports, irep_idx);
+	return get_enqueued_report(enqueued_reports, irep_idx);
+}
 
-			enqueued_reports->last_idx = irep_idx;
-			break;
-		}
+static struct enqueued_report *peek_next_enqueued_report(struct enqueued_reports *enqueued_reports)
+{
+	int irep_idx = get_oldest_enqueued_report_idx(enqueued_reports);
+
+	if (irep_idx < 0) {
+		return NULL;
 	}
 
-	return item;
+	return peek_enqueued_report(enqueued_reports, irep_idx);
 }
 
 static void migrate_enqueued_reports(struct enqueued_reports *dst_reports,
@@ -306,15 +355,17 @@ static void migrate_enqueued_reports(struct enqueued_reports *dst_reports,
 	}
 }
 
-static void enqueue_hid_report(struct enqueued_reports *enqueued_reports,
+static bool enqueue_hid_report(struct enqueued_reports *enqueued_reports,
 			       size_t irep_idx,
-			       struct hid_report_event *report)
+			       struct hid_report_event *report,
+			       uint32_t timestamp)
 {
 	__ASSERT_NO_MSG(irep_idx < ARRAY_SIZE(enqueued_reports->reports));
 
 	struct counted_list *reports = &enqueued_reports->reports[irep_idx];
 
 	struct enqueued_report *item;
+	bool dropped = false;
 
 	if (reports->count < MAX_ENQUEUED_ITEMS) {
 		item = k_malloc(sizeof(*item));
@@ -322,17 +373,60 @@ static void enqueue_hid_report(struct enqueued_reports *enqueued_reports,
 		LOG_WRN("Enqueue dropped the oldest report");
 		item = get_enqueued_report(enqueued_reports, irep_idx);
 		k_free(item->report);
+		dropped = true;
 	}
 
 	if (!item) {
 		LOG_ERR("Dropped HID report");
 		/* Should never happen. */
 		__ASSERT_NO_MSG(false);
+		dropped = true;
 	} else {
 		item->report = report;
+		item->timestamp = timestamp;
 		sys_slist_append(&reports->list, &item->node);
 		reports->count++;
 	}
+
+	return dropped;
+}
+
+/* Merge motion of a mouse report into the newest enqueued mouse report.
+ * Reports are merged only if button state is the same and the sums of
+ * motion fit into the report.
+ */
+static bool coalesce_mouse_report(struct enqueued_reports *enqueued_reports,
+				  size_t irep_idx, const uint8_t *data,
+				  size_t size)
+{
+	struct counted_list *reports = &enqueued_reports->reports[irep_idx];
+
+	if (!IS_ENABLED(CONFIG_DESKTOP_HID_FORWARD_MOUSE_COALESCE) ||
+	    (input_reports[irep_idx] != REPORT_ID_MOUSE) ||
+	    (size != REPORT_SIZE_MOUSE) ||
+	    !is_report_enqueued(enqueued_reports, irep_idx)) {
+		return false;
+	}
+
+	struct enqueued_report *item =
+		CONTAINER_OF(sys_slist_peek_tail(&reports->list),
+			     struct enqueued_report, node);
+	uint8_t *queued = &item->report->dyndata.data[sizeof(uint8_t)];
+
+	return hid_mouse_report_coalesce(queued, data);
+}
+
+static void stats_report_sent(struct hids_peripheral *per, uint32_t timestamp)
+{
+	if (!IS_ENABLED(CONFIG_DESKTOP_HID_FORWARD_STATS)) {
+		return;
+	}
+
+	uint32_t latency = k_uptime_get_32() - timestamp;
+
+	per->stats.forwarded++;
+	per->stats.latency_sum += latency;
+	per->stats.latency_max = MAX(per->stats.latency_max, latency);
 }
 
 static void forward_hid_report(struct hids_peripheral *per, uint8_t report_id,
@@ -363,6 +457,16 @@ static void forward_hid_report(struct hids_peripheral *per, uint8_t report_id,
 		return;
 	}
 
+	uint32_t timestamp = k_uptime_get_32();
+
+	if (sub->busy &&
+	    coalesce_mouse_report(&per->enqueued_reports, irep_idx, data, size)) {
+		if (IS_ENABLED(CONFIG_DESKTOP_HID_FORWARD_STATS)) {
+			per->stats.coalesced++;
+		}
+		return;
+	}
+
 	struct hid_report_event *report = new_hid_report_event(size + sizeof(report_id));
 
 	report->subscriber = sub->id;
@@ -375,10 +479,13 @@ static void forward_hid_report(struct hids_peripheral *per, uint8_t report_id,
 		__ASSERT_NO_MSG(!is_report_enqueued(&per->enqueued_reports, irep_idx));
 
 		EVENT_SUBMIT(report);
-		per->enqueued_reports.last_idx = irep_idx;
+		stats_report_sent(per, timestamp);
 		sub->busy = true;
-	} else {
-		enqueue_hid_report(&per->enqueued_reports, irep_idx, report);
+	} else if (enqueue_hid_report(&per->enqueued_reports, irep_idx, report,
+				      timestamp)) {
+		if (IS_ENABLED(CONFIG_DESKTOP_HID_FORWARD_STATS)) {
+			per->stats.dropped++;
+		}
 	}
 }
 
@@ -928,6 +1035,8 @@ static void disconnect_peripheral(struct hids_peripheral *per)
 	/* Cancel cannot fail if executed from another work's context. */
 	(void)k_work_cancel_delayable(&per->read_rsp);
 	memset(per->hwid, 0, sizeof(per->hwid));
+	memset(&per->stats, 0, sizeof(per->stats));
+	per->deficit = 0;
 	per->cur_poll_cnt = 0;
 	per->cfg_chan_id = CFG_CHAN_UNUSED_PEER_ID;
 	if (per->cfg_chan_rsp) {
@@ -1039,6 +1148,32 @@ static void hogp_pm_update(struct bt_hogp *hids_c)
 	LOG_INF("Protocol mode updated");
 }
 
+#ifdef CONFIG_DESKTOP_HID_FORWARD_STATS
+static void stats_log_fn(struct k_work *work)
+{
+	for (size_t per_id = 0; per_id < ARRAY_SIZE(peripherals); per_id++) {
+		struct hids_peripheral *per = &peripherals[per_id];
+		struct forward_stats *stats = &per->stats;
+
+		if (!is_peripheral_connected(per)) {
+			continue;
+		}
+
+		LOG_INF("Peripheral %zu: forwarded %" PRIu32 ", coalesced %" PRIu32
+			", dropped %" PRIu32 ", latency avg %" PRIu32
+			" ms max %" PRIu32 " ms",
+			per_id, stats->forwarded, stats->coalesced,
+			stats->dropped,
+			stats->forwarded ? (stats->latency_sum / stats->forwarded) : 0,
+			stats->latency_max);
+
+		memset(stats, 0, sizeof(*stats));
+	}
+
+	k_work_reschedule(&stats_log, K_MSEC(CONFIG_DESKTOP_HID_FORWARD_STATS_INTERVAL));
+}
+#endif /* CONFIG_DESKTOP_HID_FORWARD_STATS */
+
 static void init(void)
 {
 	static const struct bt_hogp_init_params params = {
@@ -1058,6 +1193,77 @@ static void init(void)
 	}
 
 	reset_peripheral_address();
+
+#ifdef CONFIG_DESKTOP_HID_FORWARD_STATS
+	k_work_init_delayable(&stats_log, stats_log_fn);
+	k_work_reschedule(&stats_log, K_MSEC(CONFIG_DESKTOP_HID_FORWARD_STATS_INTERVAL));
+#endif
+}
+
+/* Peripheral with the report that exceeded the latency target by the most. */
+static struct hids_peripheral *get_late_peripheral(struct subscriber *sub)
+{
+	struct hids_peripheral *late_per = NULL;
+	uint32_t late_age = 0;
+	uint32_t now = k_uptime_get_32();
+
+	for (size_t per_id = 0; per_id < ARRAY_SIZE(peripherals); per_id++) {
+		struct hids_peripheral *per = &peripherals[per_id];
+
+		if (sub != get_subscriber(per)) {
+			continue;
+		}
+
+		struct enqueued_report *item =
+			peek_next_enqueued_report(&per->enqueued_reports);
+
+		if (!item) {
+			continue;
+		}
+
+		uint32_t age = now - item->timestamp;
+
+		if ((age >= LATENCY_TARGET) && (age > late_age)) {
+			late_per = per;
+			late_age = age;
+		}
+	}
+
+	return late_per;
+}
+
+static uint16_t *get_drr_flow(size_t per_id, size_t *head_size, void *user_data)
+{
+	struct subscriber *sub = user_data;
+	struct hids_peripheral *per = &peripherals[per_id];
+
+	if (sub != get_subscriber(per)) {
+		return NULL;
+	}
+
+	struct enqueued_report *item =
+		peek_next_enqueued_report(&per->enqueued_reports);
+
+	*head_size = item ? item->report->dyndata.size : 0;
+
+	return &per->deficit;
+}
+
+/* Peripherals linked with the subscriber share it using deficit round-robin,
+ * so that a burst of reports from one peripheral cannot delay the others.
+ */
+static struct hids_peripheral *get_drr_peripheral(struct subscriber *sub)
+{
+	size_t per_id = sub->drr_peripheral_id;
+
+	if (drr_next(ARRAY_SIZE(peripherals), &per_id, DRR_QUANTUM,
+		     get_drr_flow, sub) < 0) {
+		return NULL;
+	}
+
+	sub->drr_peripheral_id = per_id;
+
+	return &peripherals[per_id];
 }
 
 static void send_enqueued_report(struct subscriber *sub)
@@ -1067,27 +1273,26 @@ static void send_enqueued_report(struct subscriber *sub)
 	}
 
 	struct enqueued_report *item;
+	struct hids_peripheral *per = NULL;
 
 	/* First try to send report left at subscriber. */
 	item = get_next_enqueued_report(&sub->enqueued_reports);
 
 	if (!item) {
-		/* Look for any report to sent at linked peripherals. */
-		for (size_t i = 0; i < ARRAY_SIZE(peripherals); i++) {
-			size_t per_id = next_id(sub->last_peripheral_id + i,
-						ARRAY_SIZE(peripherals));
-			struct hids_peripheral *per = &peripherals[per_id];
-
-			/* Check if peripheral is linked with the subscriber. */
-			if (sub != get_subscriber(per)) {
-				continue;
-			}
+		/* Reports that missed the latency target are sent first.
+		 * Otherwise linked peripherals share the subscriber fairly.
+		 */
+		per = get_late_peripheral(sub);
 
+		if (per) {
 			item = get_next_enqueued_report(&per->enqueued_reports);
+			/* Charge the report to the peripheral's quantum. */
+			per->deficit -= MIN(per->deficit, item->report->dyndata.size);
+		} else {
+			per = get_drr_peripheral(sub);
 
-			if (item) {
-				sub->last_peripheral_id = per_id;
-				break;
+			if (per) {
+				item = get_next_enqueued_report(&per->enqueued_reports);
 			}
 		}
 	}
@@ -1095,6 +1300,10 @@ static void send_enqueued_report(struct subscriber *sub)
 	if (item) {
 		EVENT_SUBMIT(item->report);
 
+		if (per) {
+			stats_report_sent(per, item->timestamp);
+		}
+
 		k_free(item);
 
 		sub->busy = true;
@@ -14,7 +14,6 @@
 #include <sys/types.h>
 
 #include <zephyr/types.h>
-#include <sys/slist.h>
 #include <sys/util.h>
 #include <sys/byteorder.h>
 
@@ -28,6 +27,8 @@
 #include "hid_keymap.h"
 #include "hid_keymap_def.h"
 #include "hid_report_desc.h"
+#include "hid_eventq.h"
+#include "hid_items.h"
 
 #define MODULE hid_state
 #include <caf/events/module_state_event.h>
@@ -67,34 +68,9 @@ enum state {
 		       MAX(SYSTEM_CTRL_REPORT_KEY_COUNT_MAX,	\
 			   CONSUMER_CTRL_REPORT_KEY_COUNT_MAX))
 
-#define AXIS_COUNT (IS_ENABLED(CONFIG_DESKTOP_HID_REPORT_MOUSE_SUPPORT) * MOUSE_REPORT_AXIS_COUNT)
-
-
-/**@brief HID state item. */
-struct item {
-	uint16_t usage_id; /**< HID usage ID. */
-	int16_t value; /**< HID value. */
-};
-
-/**@brief Structure keeping state for a single target HID report. */
-struct items {
-	uint8_t item_count_max; /**< Maximal numer of items in this set. */
-	uint8_t item_count; /**< Current number of items in this set. */
-	struct item item[ITEM_COUNT]; /**< Items set. Browse from the end. */
-};
-
-/**@brief Enqueued HID state item. */
-struct item_event {
-	sys_snode_t node; /**< Event queue linked list node. */
-	struct item item; /**< HID state item which has been enqueued. */
-	uint32_t timestamp; /**< HID event timestamp. */
-};
+BUILD_ASSERT(ITEM_COUNT <= HID_ITEMS_SIZE);
 
-/**@brief Event queue. */
-struct eventq {
-	sys_slist_t root;
-	size_t len;
-};
+#define AXIS_COUNT (IS_ENABLED(CONFIG_DESKTOP_HID_REPORT_MOUSE_SUPPORT) * MOUSE_REPORT_AXIS_COUNT)
 
 /**@brief Axis data. */
 struct axis_data {
@@ -103,8 +79,8 @@ struct axis_data {
 };
 
 struct report_data {
-	struct items items;
-	struct eventq eventq;
+	struct hid_items items;
+	struct hid_eventq eventq;
 	struct axis_data axes;
 	bool update_needed;
 	struct report_state *linked_rs;
@@ -203,217 +179,13 @@ static struct hid_keymap *hid_keymap_get(uint16_t key_id)
 	return map;
 }
 
-/**@brief Compare two usage values. */
-static int usage_id_compare(const void *a, const void *b)
+static void eventq_cleanup(struct hid_eventq *eventq, uint32_t timestamp)
 {
-	const struct item *p_a = a;
-	const struct item *p_b = b;
+	size_t cnt = hid_eventq_cleanup(eventq, timestamp);
 
-	return (p_a->usage_id - p_b->usage_id);
-}
-
-static void eventq_reset(struct eventq *eventq)
-{
-	struct item_event *event;
-	struct item_event *tmp;
-
-	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&eventq->root, event, tmp, node) {
-		sys_slist_remove(&eventq->root, NULL, &event->node);
-
-		k_free(event);
+	if (cnt > 0) {
+		LOG_WRN("%u stale events removed from the queue!", cnt);
 	}
-
-	sys_slist_init(&eventq->root);
-	eventq->len = 0;
-}
-
-static bool eventq_is_full(const struct eventq *eventq)
-{
-	return (eventq->len >= CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE);
-}
-
-
-static bool eventq_is_empty(struct eventq *eventq)
-{
-	bool empty = sys_slist_is_empty(&eventq->root);
-
-	__ASSERT_NO_MSG(!empty == (eventq->len != 0));
-
-	return empty;
-}
-
-static struct item_event *eventq_get(struct eventq *eventq)
-{
-	sys_snode_t *node = sys_slist_get(&eventq->root);
-
-	if (!node) {
-		return NULL;
-	}
-
-	eventq->len--;
-
-	return CONTAINER_OF(node, struct item_event, node);
-}
-
-static void eventq_append(struct eventq *eventq, uint16_t usage_id, int16_t value)
-{
-	struct item_event *hid_event = k_malloc(sizeof(*hid_event));
-
-	if (!hid_event) {
-		LOG_ERR("Failed to allocate HID event");
-		/* Should never happen. */
-		__ASSERT_NO_MSG(false);
-		return;
-	}
-
-	hid_event->item.usage_id = usage_id;
-	hid_event->item.value = value;
-	hid_event->timestamp = k_uptime_get_32();
-
-	/* Add a new event to the queue. */
-	sys_slist_append(&eventq->root, &hid_event->node);
-
-	eventq->len++;
-}
-
-static void eventq_region_purge(struct eventq *eventq,
-				sys_snode_t *last_to_purge)
-{
-	sys_snode_t *tmp;
-	sys_snode_t *tmp_safe;
-	size_t cnt = 0;
-
-	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, tmp, tmp_safe) {
-		sys_slist_remove(&eventq->root, NULL, tmp);
-
-		k_free(CONTAINER_OF(tmp, struct item_event, node));
-		cnt++;
-
-		if (tmp == last_to_purge) {
-			break;
-		}
-	}
-
-	eventq->len -= cnt;
-
-	LOG_WRN("%u stale events removed from the queue!", cnt);
-}
-
-
-static void eventq_cleanup(struct eventq *eventq, uint32_t timestamp)
-{
-	/* Find timed out events. */
-
-	sys_snode_t *first_valid;
-
-	SYS_SLIST_FOR_EACH_NODE(&eventq->root, first_valid) {
-		uint32_t diff = timestamp - CONTAINER_OF(
-			first_valid, struct item_event, node)->timestamp;
-
-		if (diff < CONFIG_DESKTOP_HID_REPORT_EXPIRATION) {
-			break;
-		}
-	}
-
-	/* Remove events but only if key up was generated for each removed
-	 * key down.
-	 */
-
-	sys_snode_t *maxfound = sys_slist_peek_head(&eventq->root);
-	size_t maxfound_pos = 0;
-
-	sys_snode_t *cur;
-	size_t cur_pos = 0;
-
-	sys_snode_t *tmp_safe;
-
-	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, cur, tmp_safe) {
-		const struct item cur_item =
-			CONTAINER_OF(cur, struct item_event, node)->item;
-
-		if (cur_item.value > 0) {
-			/* Every key down must be paired with key up.
-			 * Set hit count to value as we just detected
-			 * first key down for this usage.
-			 */
-
-			unsigned int hit_count = cur_item.value;
-			sys_snode_t *j = cur;
-			size_t j_pos = cur_pos;
-
-			SYS_SLIST_ITERATE_FROM_NODE(&eventq->root, j) {
-				j_pos++;
-				if (j == first_valid) {
-					break;
-				}
-
-				const struct item item =
-					CONTAINER_OF(j,
-						     struct item_event,
-						     node)->item;
-
-				if (cur_item.usage_id == item.usage_id) {
-					hit_count += item.value;
-
-					if (hit_count == 0) {
-						/* All events with this usage
-						 * are paired.
-						 */
-						break;
-					}
-				}
-			}
-
-			if (j == first_valid) {
-				/* Pair not found. */
-				break;
-			}
-
-			if (j_pos > maxfound_pos) {
-				maxfound = j;
-				maxfound_pos = j_pos;
-			}
-		}
-
-
-		if (cur == first_valid) {
-			break;
-		}
-
-		if (cur == maxfound) {
-			/* All events up to this point have pairs and can
-			 * be deleted.
-			 */
-			eventq_region_purge(eventq, maxfound);
-		}
-
-		cur_pos++;
-	}
-}
-
-static void sort_by_usage_id(struct item items[], size_t array_size)
-{
-	for (size_t k = 0; k < array_size; k++) {
-		size_t id = k;
-
-		for (size_t l = k + 1; l < array_size; l++) {
-			if (items[l].usage_id < items[id].usage_id) {
-				id = l;
-			}
-		}
-		if (id != k) {
-			struct item tmp = items[k];
-
-			items[k] = items[id];
-			items[id] = tmp;
-		}
-	}
-}
-
-static void clear_items(struct items *items)
-{
-	memset(items->item, 0, sizeof(items->item));
-	items->item_count = 0;
 }
 
 static void clear_axes(struct axis_data *axes)
@@ -426,8 +198,8 @@ static void clear_report_data(struct report_data *rd)
 	LOG_INF("Clear report data (%p)", (void *)rd);
 
 	clear_axes(&rd->axes);
-	clear_items(&rd->items);
-	eventq_reset(&rd->eventq);
+	hid_items_clear(&rd->items);
+	hid_eventq_reset(&rd->eventq);
 
 	rd->update_needed = false;
 }
@@ -466,71 +238,24 @@ static struct subscriber *get_subscriber(const void *subscriber_id)
 	return NULL;
 }
 
-static bool key_value_set(struct items *items, uint16_t usage_id, int16_t value)
+/**@brief Update value of the item.
+ *
+ * @return true if the set of recorded usages has changed, so the report
+ *	   content must be updated.
+ */
+static bool key_value_set(struct hid_items *items, uint16_t usage_id, int16_t value)
 {
-	const uint8_t prev_item_count = items->item_count;
-
-	bool update_needed = false;
-	struct item *p_item;
-
-	__ASSERT_NO_MSG(usage_id != 0);
-	__ASSERT_NO_MSG(items->item_count_max > 0);
-
-	/* Report equal to zero brings no change. This should never happen. */
-	__ASSERT_NO_MSG(value != 0);
-
-	p_item = bsearch(&usage_id,
-			 (uint8_t *)items->item,
-			 ARRAY_SIZE(items->item),
-			 sizeof(items->item[0]),
-			 usage_id_compare);
-
-	if (p_item) {
-		/* Item is present in the array - update its value. */
-		p_item->value += value;
-		if (p_item->value == 0) {
-			__ASSERT_NO_MSG(items->item_count != 0);
-			items->item_count -= 1;
-			p_item->usage_id = 0;
-		}
-
-		update_needed = true;
-	} else if (value < 0) {
-		/* For items with absolute value, the value is used as
-		 * a reference counter and must not fall below zero. This
-		 * could happen if a key up event is lost and the state
-		 * receives an unpaired key down event.
-		 */
-	} else if (prev_item_count >= items->item_count_max) {
+	if ((value > 0) && hid_items_is_full(items) &&
+	    !hid_items_find(items, usage_id)) {
 		/* Configuration should allow the HID module to hold data
 		 * about the maximum number of simultaneously pressed keys.
 		 * Generate a warning if an item cannot be recorded.
 		 */
 		LOG_WRN("No place on the list to store HID item!");
-	} else {
-		/* After sort operation, free slots (zeros) are stored
-		 * at the beginning of the array.
-		 */
-		size_t const idx = ARRAY_SIZE(items->item) - prev_item_count - 1;
-
-		__ASSERT_NO_MSG(items->item[idx].usage_id == 0);
-
-		/* Record this value change. */
-		items->item[idx].usage_id = usage_id;
-		items->item[idx].value = value;
-		items->item_count += 1;
-
-		update_needed = true;
-	}
-
-	if (prev_item_count != items->item_count) {
-		/* Sort elements on the list. Use simple algorithm
-		 * with small footprint.
-		 */
-		sort_by_usage_id(items->item, ARRAY_SIZE(items->item));
+		return false;
 	}
 
-	return update_needed;
+	return hid_items_value_set(items, usage_id, value);
 }
 
 static void send_report_keyboard(uint8_t report_id, struct report_data *rd)
@@ -562,30 +287,27 @@ static void send_report_keyboard(uint8_t report_id, struct report_data *rd)
 	event->dyndata.data[0] = report_id;
 	event->dyndata.data[2] = 0; /* Reserved byte */
 
-	uint8_t modifier_bm = 0;
+	uint8_t modifier_bm;
 	uint8_t *keys = &event->dyndata.data[3];
 
-	const size_t max = ARRAY_SIZE(rd->items.item);
+	/* Modifiers are taken directly from the usage bitmask. */
+	BUILD_ASSERT(KEYBOARD_REPORT_LAST_MODIFIER < HID_ITEMS_USAGE_BM_SIZE);
+	BUILD_ASSERT((KEYBOARD_REPORT_FIRST_MODIFIER % 32) + 8 <= 32);
+	modifier_bm = rd->items.usage_bm[KEYBOARD_REPORT_FIRST_MODIFIER / 32] >>
+		      (KEYBOARD_REPORT_FIRST_MODIFIER % 32);
+
 	size_t cnt = 0;
-	for (size_t i = 0; (i < max) && (cnt < KEYBOARD_REPORT_KEY_COUNT_MAX); i++) {
-		struct item item = rd->items.item[max - i - 1];
-
-		if (item.usage_id) {
-			__ASSERT_NO_MSG(item.value > 0);
-			if (item.usage_id <= KEYBOARD_REPORT_LAST_KEY) {
-				__ASSERT_NO_MSG(item.usage_id <= UINT8_MAX);
-				keys[cnt] = item.usage_id;
-				cnt++;
-			} else if ((item.usage_id >= KEYBOARD_REPORT_FIRST_MODIFIER) &&
-				   (item.usage_id <= KEYBOARD_REPORT_LAST_MODIFIER)) {
-				/* Make sure any key bitmask will fit into modifiers. */
-				BUILD_ASSERT(KEYBOARD_REPORT_LAST_MODIFIER - KEYBOARD_REPORT_FIRST_MODIFIER < 8);
-				modifier_bm |= BIT(item.usage_id - KEYBOARD_REPORT_FIRST_MODIFIER);
-			} else {
-				LOG_WRN("Undefined usage 0x%x", item.usage_id);
-			}
-		} else {
-			break;
+	for (size_t i = 0; (i < rd->items.item_count) && (cnt < KEYBOARD_REPORT_KEY_COUNT_MAX); i++) {
+		struct hid_item item = rd->items.item[i];
+
+		__ASSERT_NO_MSG(item.value > 0);
+		if (item.usage_id <= KEYBOARD_REPORT_LAST_KEY) {
+			__ASSERT_NO_MSG(item.usage_id <= UINT8_MAX);
+			keys[cnt] = item.usage_id;
+			cnt++;
+		} else if ((item.usage_id < KEYBOARD_REPORT_FIRST_MODIFIER) ||
+			   (item.usage_id > KEYBOARD_REPORT_LAST_MODIFIER)) {
+			LOG_WRN("Undefined usage 0x%x", item.usage_id);
 		}
 	}
 
@@ -601,6 +323,13 @@ static void send_report_keyboard(uint8_t report_id, struct report_data *rd)
 	rd->update_needed = false;
 }
 
+static uint8_t mouse_button_bm_get(const struct hid_items *items)
+{
+	BUILD_ASSERT(MOUSE_REPORT_BUTTON_COUNT_MAX <= 8);
+
+	return items->usage_bm[0] >> 1;
+}
+
 static void send_report_mouse(uint8_t report_id, struct report_data *rd)
 {
 	__ASSERT_NO_MSG(report_id == REPORT_ID_MOUSE);
@@ -624,20 +353,8 @@ static void send_report_mouse(uint8_t report_id, struct report_data *rd)
 			  MOUSE_REPORT_WHEEL_MIN);
 	rd->axes.axis[MOUSE_REPORT_AXIS_WHEEL] -= wheel * 2;
 
-	/* Traverse pressed keys and build mouse buttons bitmask */
-	uint8_t button_bm = 0;
-	for (size_t i = 0; i < ARRAY_SIZE(rd->items.item); i++) {
-		struct item item = rd->items.item[i];
-
-		if (item.usage_id) {
-			__ASSERT_NO_MSG(item.usage_id <= 8);
-			__ASSERT_NO_MSG(item.value > 0);
-
-			uint8_t mask = 1 << (item.usage_id - 1);
-
-			button_bm |= mask;
-		}
-	}
+	/* Buttons use usages 1 to 8, take them from the usage bitmask. */
+	uint8_t button_bm = mouse_button_bm_get(&rd->items);
 
 
 	/* Encode report. */
@@ -692,20 +409,8 @@ static void send_report_boot_mouse(uint8_t report_id, struct report_data *rd)
 	rd->axes.axis[MOUSE_REPORT_AXIS_Y] += dy;
 	rd->axes.axis[MOUSE_REPORT_AXIS_WHEEL] = 0;
 
-	/* Traverse pressed keys and build mouse buttons bitmask */
-	uint8_t button_bm = 0;
-	for (size_t i = 0; i < ARRAY_SIZE(rd->items.item); i++) {
-		struct item item = rd->items.item[i];
-
-		if (item.usage_id) {
-			__ASSERT_NO_MSG(item.usage_id <= 8);
-			__ASSERT_NO_MSG(item.value > 0);
-
-			uint8_t mask = 1 << (item.usage_id - 1);
-
-			button_bm |= mask;
-		}
-	}
+	/* Buttons use usages 1 to 8, take them from the usage bitmask. */
+	uint8_t button_bm = mouse_button_bm_get(&rd->items);
 
 
 	size_t report_size = sizeof(report_id) + sizeof(dx) + sizeof(dy) +
@@ -755,9 +460,8 @@ static void send_report_ctrl(uint8_t report_id, struct report_data *rd)
 				       sizeof(rd->items.item[0].usage_id));
 	event->dyndata.data[0] = report_id;
 
-	const size_t idx = ARRAY_SIZE(rd->items.item) - 1;
-
-	sys_put_le16(rd->items.item[idx].usage_id,
+	/* Unused item has usage ID equal to zero. */
+	sys_put_le16(rd->items.item[0].usage_id,
 		     &event->dyndata.data[sizeof(report_id)]);
 
 	EVENT_SUBMIT(event);
@@ -769,21 +473,16 @@ static bool update_report(struct report_data *rd)
 {
 	bool update_needed = false;
 
-	while (!update_needed && !eventq_is_empty(&rd->eventq)) {
-		/* There are enqueued events to handle. */
-		struct item_event *event = eventq_get(&rd->eventq);
-
-		__ASSERT_NO_MSG(event);
+	struct hid_eventq_event event;
 
+	while (!update_needed && hid_eventq_get(&rd->eventq, &event)) {
+		/* There are enqueued events to handle. */
 		update_needed = key_value_set(&rd->items,
-					      event->item.usage_id,
-					      event->item.value);
+					      event.usage_id,
+					      event.value);
 
 		rd->update_needed = rd->update_needed || update_needed;
 
-
-		k_free(event);
-
 		/* If no item was changed, try next event. */
 	}
 
@@ -1027,7 +726,7 @@ static void connect(const void *subscriber_id, uint8_t report_id)
 	if (!rd->linked_rs) {
 		rd->linked_rs = rs;
 
-		if (!eventq_is_empty(&rd->eventq)) {
+		if (!hid_eventq_is_empty(&rd->eventq)) {
 			/* Remove all stale events from the queue. */
 			eventq_cleanup(&rd->eventq, k_uptime_get_32());
 		}
@@ -1138,37 +837,21 @@ static void enqueue(struct report_data *rd, uint16_t usage_id, int16_t value,
 {
 	eventq_cleanup(&rd->eventq, k_uptime_get_32());
 
-	if (eventq_is_full(&rd->eventq)) {
+	if (hid_eventq_is_full(&rd->eventq)) {
 		if (!connected) {
 			/* In disconnected state no items are recorded yet.
 			 * Try to remove queued items starting from the
 			 * oldest one.
 			 */
-			sys_snode_t *i;
-
-			SYS_SLIST_FOR_EACH_NODE(&rd->eventq.root, i) {
-				/* Initial cleanup was done above. Queue will
-				 * not contain events with expired timestamp.
-				 */
-				uint32_t timestamp =
-					CONTAINER_OF(i,
-						     struct item_event,
-						     node)->timestamp +
-					CONFIG_DESKTOP_HID_REPORT_EXPIRATION;
-
-				eventq_cleanup(&rd->eventq, timestamp);
-
-				if (!eventq_is_full(&rd->eventq)) {
-					/* At least one element was removed
-					 * from the queue. Do not continue
-					 * list traverse, content was modified!
-					 */
-					break;
-				}
+			size_t cnt = hid_eventq_purge_oldest(&rd->eventq);
+
+			if (cnt > 0) {
+				LOG_WRN("%u oldest events removed from the queue!",
+					cnt);
 			}
 		}
 
-		if (eventq_is_full(&rd->eventq)) {
+		if (hid_eventq_is_full(&rd->eventq)) {
 			/* To maintain the sanity of HID state, clear
 			 * all recorded events and items.
 			 */
@@ -1177,7 +860,7 @@ static void enqueue(struct report_data *rd, uint16_t usage_id, int16_t value,
 		}
 	}
 
-	eventq_append(&rd->eventq, usage_id, value);
+	hid_eventq_append(&rd->eventq, usage_id, value, k_uptime_get_32());
 }
 
 /**@brief Function for updating the value linked to the HID usage. */
@@ -1194,7 +877,7 @@ static void update_key(const struct hid_keymap *map, int16_t value)
 		connected = (rs->state != STATE_DISCONNECTED);
 	}
 
-	if (!connected || !eventq_is_empty(&rd->eventq)) {
+	if (!connected || !hid_eventq_is_empty(&rd->eventq)) {
 		/* Report cannot be sent yet - enqueue this HID event. */
 		enqueue(rd, map->usage_id, value, connected);
 	} else {
@@ -12,6 +12,7 @@
 
 #include <caf/events/led_event.h>
 #include "config_event.h"
+#include "led_keyframes.h"
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_LED_STREAM_LOG_LEVEL);
@@ -21,10 +22,18 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_LED_STREAM_LOG_LEVEL);
 #define FETCH_CONFIG_SIZE 2
 #define LED_ID_POS 7
 
+#define KEYFRAME_LED_ID_POS 0
+#define KEYFRAME_DATA_POS 1
+#define KEYFRAME_SIZE 6
+/* Frame must fit in a pipelined configuration channel request. */
+#define KEYFRAMES_PER_FRAME_MAX 3
+
 #define LED_ID(led) ((led) - &leds[0])
 
 #define STEPS_QUEUE_ARRAY_SIZE (CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE + 1)
 
+BUILD_ASSERT(CONFIG_DESKTOP_LED_STREAM_KEYFRAME_QUEUE_SIZE >= KEYFRAMES_PER_FRAME_MAX);
+
 struct led {
 	const struct led_effect *state_effect;
 	struct led_effect led_stream_effect;
@@ -32,6 +41,9 @@ struct led {
 	uint8_t rx_idx;
 	uint8_t tx_idx;
 	bool streaming;
+
+	struct led_keyframes keyframes;
+	struct led_effect_step keyframe_step;
 };
 
 #define DT_DRV_COMPAT pwm_leds
@@ -46,6 +58,8 @@ static bool initialized;
 enum led_stream_opt {
 	LED_STREAM_OPT_SET_LED_EFFECT,
 	LED_STREAM_OPT_GET_LEDS_STATE,
+	LED_STREAM_OPT_SET_KEYFRAMES,
+	LED_STREAM_OPT_GET_KEYFRAMES_STATE,
 
 	LED_STREAM_OPT_COUNT,
 };
@@ -53,6 +67,8 @@ enum led_stream_opt {
 const static char * const opt_descr[] = {
 	[LED_STREAM_OPT_SET_LED_EFFECT] = "set_led_effect",
 	[LED_STREAM_OPT_GET_LEDS_STATE] = "get_leds_state",
+	[LED_STREAM_OPT_SET_KEYFRAMES] = "set_keyframes",
+	[LED_STREAM_OPT_GET_KEYFRAMES_STATE] = "get_keyframes_state",
 };
 
 
@@ -150,14 +166,22 @@ static void send_data_from_queue(struct led *led)
 	if (!is_queue_empty(led)) {
 		led->led_stream_effect.steps = &led->steps_queue[led->tx_idx];
 		led->led_stream_effect.step_count = 1;
+		led_keyframes_stop(&led->keyframes);
 
 		send_effect(&led->led_stream_effect, led);
 
 		led->tx_idx = next_index(led->tx_idx);
+	} else if (led_keyframes_step_get(&led->keyframes, k_uptime_get_32(),
+					  &led->keyframe_step)) {
+		led->led_stream_effect.steps = &led->keyframe_step;
+		led->led_stream_effect.step_count = 1;
+
+		send_effect(&led->led_stream_effect, led);
 	} else {
 		LOG_INF("No steps ready in queue, stop streaming");
 
 		led->streaming = false;
+		led_keyframes_stop(&led->keyframes);
 
 		send_effect(led->state_effect, led);
 	}
@@ -192,6 +216,72 @@ static void handle_incoming_step(const uint8_t *data, const size_t size)
 	}
 }
 
+static void parse_keyframes(const uint8_t *data, size_t cnt, struct led_keyframe *kf)
+{
+	const uint8_t *pos = &data[KEYFRAME_DATA_POS];
+
+	for (size_t i = 0; i < cnt; i++, pos += KEYFRAME_SIZE) {
+		uint8_t brightness = pos[ARRAY_SIZE(kf[i].color.c)];
+
+		for (size_t j = 0; j < ARRAY_SIZE(kf[i].color.c); j++) {
+			kf[i].color.c[j] =
+				COLOR_BRIGHTNESS_TO_PCT(pos[j] * brightness / UINT8_MAX);
+		}
+
+		kf[i].timestamp = sys_get_le16(&pos[ARRAY_SIZE(kf[i].color.c) +
+						    sizeof(brightness)]);
+	}
+}
+
+static void handle_incoming_keyframes(const uint8_t *data, const size_t size)
+{
+	if (!initialized) {
+		LOG_WRN("Not initialized");
+		return;
+	}
+
+	if ((size <= KEYFRAME_DATA_POS) ||
+	    ((size - KEYFRAME_DATA_POS) % KEYFRAME_SIZE) ||
+	    ((size - KEYFRAME_DATA_POS) / KEYFRAME_SIZE > KEYFRAMES_PER_FRAME_MAX)) {
+		LOG_WRN("Invalid keyframes data size (%zu)", size);
+		return;
+	}
+
+	size_t led_id = data[KEYFRAME_LED_ID_POS];
+
+	if (led_id >= ARRAY_SIZE(leds)) {
+		LOG_WRN("Wrong LED ID: %zu, keyframes ignored", led_id);
+		return;
+	}
+
+	struct led *led = &leds[led_id];
+	size_t cnt = (size - KEYFRAME_DATA_POS) / KEYFRAME_SIZE;
+	struct led_keyframe kf[KEYFRAMES_PER_FRAME_MAX];
+
+	parse_keyframes(data, cnt, kf);
+
+	int err = led_keyframes_add(&led->keyframes, kf, cnt, k_uptime_get_32());
+
+	if (err == -ENOMEM) {
+		LOG_WRN("Keyframe queue is full - drop incoming frame");
+		return;
+	} else if (err) {
+		LOG_WRN("Keyframe timestamps out of order - drop incoming frame");
+		return;
+	}
+
+	LOG_DBG("Enqueued %zu keyframes, free places %zu", cnt,
+		led_keyframes_free_count(&led->keyframes));
+
+	if (!led->streaming) {
+		LOG_DBG("Sending first keyframe for led %zu", led_id);
+
+		led->streaming = true;
+
+		send_data_from_queue(led);
+	}
+}
+
 static void config_set(const uint8_t opt_id, const uint8_t *data, const size_t size)
 {
 	switch (opt_id) {
@@ -199,6 +289,10 @@ static void config_set(const uint8_t opt_id, const uint8_t *data, const size_t s
 		handle_incoming_step(data, size);
 		break;
 
+	case LED_STREAM_OPT_SET_KEYFRAMES:
+		handle_incoming_keyframes(data, size);
+		break;
+
 	default:
 		LOG_WRN("Unknown config set: %" PRIu8, opt_id);
 		break;
@@ -230,6 +324,34 @@ static void fetch_leds_state(uint8_t *data, size_t *size)
 	*size = pos;
 }
 
+static void fetch_keyframes_state(uint8_t *data, size_t *size)
+{
+	uint8_t free_places;
+	uint16_t start_delay = CONFIG_DESKTOP_LED_STREAM_KEYFRAME_DELAY;
+
+	BUILD_ASSERT(sizeof(initialized) + sizeof(start_delay) +
+		     ARRAY_SIZE(leds) * sizeof(free_places) <=
+		     CONFIG_CHANNEL_FETCHED_DATA_MAX_SIZE);
+
+	size_t pos = 0;
+
+	data[pos] = initialized;
+	pos += sizeof(initialized);
+
+	/* Host uses the delay to map keyframe timestamps to its own clock. */
+	sys_put_le16(start_delay, &data[pos]);
+	pos += sizeof(start_delay);
+
+	for (size_t i = 0; i < ARRAY_SIZE(leds); i++) {
+		free_places = led_keyframes_free_count(&leds[i].keyframes);
+
+		data[pos] = free_places;
+		pos += sizeof(free_places);
+	}
+
+	*size = pos;
+}
+
 static void config_get(const uint8_t opt_id, uint8_t *data, size_t *size)
 {
 	switch (opt_id) {
@@ -237,6 +359,10 @@ static void config_get(const uint8_t opt_id, uint8_t *data, size_t *size)
 		fetch_leds_state(data, size);
 		break;
 
+	case LED_STREAM_OPT_GET_KEYFRAMES_STATE:
+		fetch_keyframes_state(data, size);
+		break;
+
 	default:
 		LOG_WRN("Unknown config get: %" PRIu8, opt_id);
 		break;
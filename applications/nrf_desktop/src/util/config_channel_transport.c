@@ -13,6 +13,15 @@
 #define MODULE config_channel_transport
 #define TRANSPORT_HEADER_SIZE		4
 #define CONFIG_STATUS_POS		2
+#define DATA_LEN_POS			3
+
+/* Data length field of a pipelined frame has the flag set. The first data
+ * byte holds the sequence number.
+ */
+#define TRANSPORT_SEQ_FLAG		BIT(7)
+#define TRANSPORT_SEQ_POS		TRANSPORT_HEADER_SIZE
+#define TRANSPORT_SEQ_HEADER_SIZE	(TRANSPORT_HEADER_SIZE + 1)
+#define PIPELINE_DEPTH			CONFIG_DESKTOP_CONFIG_CHANNEL_PIPELINE_DEPTH
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_CONFIG_CHANNEL_LOG_LEVEL);
@@ -154,6 +163,141 @@ static void drop_transactions(struct config_channel_transport *transport)
 	transport->transport_id++;
 }
 
+static void pipeline_reset(struct config_channel_pipeline *pipeline)
+{
+	pipeline->cnt = 0;
+	pipeline->status = CONFIG_STATUS_SUCCESS;
+	pipeline->active = false;
+}
+
+static void pipeline_submit(struct config_channel_transport *transport)
+{
+	struct config_channel_pipeline *pipeline = &transport->pipeline;
+	const uint8_t *frame = pipeline->req[pipeline->head];
+	size_t data_len = frame[DATA_LEN_POS] & ~TRANSPORT_SEQ_FLAG;
+
+	__ASSERT_NO_MSG(pipeline->cnt > 0);
+
+	struct config_event *event = new_config_event(data_len);
+
+	event->recipient = frame[0];
+	event->event_id = frame[1];
+	event->status = frame[CONFIG_STATUS_POS];
+	memcpy(event->dyndata.data, &frame[TRANSPORT_SEQ_HEADER_SIZE], data_len);
+
+	event->transport_id = transport->transport_id;
+	event->is_request = true;
+	EVENT_SUBMIT(event);
+
+	k_work_reschedule(&transport->timeout,
+			  K_SECONDS(CONFIG_DESKTOP_CONFIG_CHANNEL_TIMEOUT));
+	transport->state = CONFIG_CHANNEL_TRANSPORT_WAIT_RSP;
+}
+
+static void pipeline_complete(struct config_channel_transport *transport,
+			      uint8_t status)
+{
+	struct config_channel_pipeline *pipeline = &transport->pipeline;
+
+	__ASSERT_NO_MSG(pipeline->cnt > 0);
+
+	transport->state = CONFIG_CHANNEL_TRANSPORT_IDLE;
+
+	if (status != CONFIG_STATUS_SUCCESS) {
+		/* Drop the queued requests. The host resends them starting
+		 * after the last acknowledged sequence number.
+		 */
+		LOG_WRN("Pipelined request failed (status: %" PRIu8 ")", status);
+		pipeline->status = status;
+		pipeline->cnt = 0;
+		return;
+	}
+
+	pipeline->ack_seq = pipeline->req[pipeline->head][TRANSPORT_SEQ_POS];
+	pipeline->head = (pipeline->head + 1) % PIPELINE_DEPTH;
+	pipeline->cnt--;
+
+	if (pipeline->cnt > 0) {
+		pipeline_submit(transport);
+	}
+}
+
+static int pipeline_set(struct config_channel_transport *transport,
+			const uint8_t *buffer, size_t length)
+{
+	struct config_channel_pipeline *pipeline = &transport->pipeline;
+
+	if (frame_length_check(length) ||
+	    (length < TRANSPORT_SEQ_HEADER_SIZE) ||
+	    ((buffer[DATA_LEN_POS] & ~TRANSPORT_SEQ_FLAG) >
+	     length - TRANSPORT_SEQ_HEADER_SIZE)) {
+		LOG_WRN("Received improper pipelined frame");
+		return -EINVAL;
+	}
+
+	/* Only set requests can be pipelined, the response data of other
+	 * requests could not be returned to the host.
+	 */
+	if (buffer[CONFIG_STATUS_POS] != CONFIG_STATUS_SET) {
+		LOG_WRN("Unsupported pipelined request");
+		return -EINVAL;
+	}
+
+	if ((pipeline->cnt >= PIPELINE_DEPTH) ||
+	    (pipeline->status != CONFIG_STATUS_SUCCESS) ||
+	    ((pipeline->cnt == 0) &&
+	     (transport->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP))) {
+		LOG_WRN("Transport %p busy", (void *)transport);
+		return -EBUSY;
+	}
+
+	uint8_t seq = buffer[TRANSPORT_SEQ_POS];
+
+	if (pipeline->cnt == 0) {
+		/* Host can start the pipeline with any sequence number. */
+		pipeline->ack_seq = seq - 1;
+	} else if (seq != pipeline->next_seq) {
+		LOG_WRN("Unexpected sequence number %" PRIu8 " != %" PRIu8,
+			seq, pipeline->next_seq);
+		return -EINVAL;
+	}
+
+	uint8_t idx = (pipeline->head + pipeline->cnt) % PIPELINE_DEPTH;
+
+	memcpy(pipeline->req[idx], buffer, length);
+	pipeline->cnt++;
+	pipeline->next_seq = seq + 1;
+	pipeline->active = true;
+
+	if (transport->state != CONFIG_CHANNEL_TRANSPORT_WAIT_RSP) {
+		pipeline_submit(transport);
+	}
+
+	return 0;
+}
+
+static void pipeline_ack_fill(struct config_channel_pipeline *pipeline,
+			      uint8_t *buffer, size_t length)
+{
+	uint8_t status;
+
+	if (pipeline->status != CONFIG_STATUS_SUCCESS) {
+		/* Error is reported once. */
+		status = pipeline->status;
+		pipeline->status = CONFIG_STATUS_SUCCESS;
+	} else if (pipeline->cnt > 0) {
+		status = CONFIG_STATUS_PENDING;
+	} else {
+		status = CONFIG_STATUS_SUCCESS;
+	}
+
+	memset(buffer, 0, length);
+	buffer[CONFIG_STATUS_POS] = status;
+	buffer[DATA_LEN_POS] = TRANSPORT_SEQ_FLAG | 2;
+	buffer[TRANSPORT_SEQ_POS] = pipeline->ack_seq;
+	buffer[TRANSPORT_SEQ_POS + 1] = PIPELINE_DEPTH - pipeline->cnt;
+}
+
 static void timeout_fn(struct k_work *work)
 {
 	struct config_channel_transport *transport = CONTAINER_OF(work,
@@ -162,6 +306,12 @@ static void timeout_fn(struct k_work *work)
 
 	__ASSERT_NO_MSG(transport->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP);
 
+	if (transport->pipeline.cnt > 0) {
+		drop_transactions(transport);
+		pipeline_complete(transport, CONFIG_STATUS_TIMEOUT);
+		return;
+	}
+
 	/* Send response with timeout status, without aditional data. */
 	transport->data[CONFIG_STATUS_POS] = CONFIG_STATUS_TIMEOUT;
 	drop_transactions(transport);
@@ -178,6 +328,7 @@ void config_channel_transport_init(struct config_channel_transport *transport)
 
 	__ASSERT_NO_MSG(transport->state == CONFIG_CHANNEL_TRANSPORT_DISABLED);
 	transport->state = CONFIG_CHANNEL_TRANSPORT_IDLE;
+	pipeline_reset(&transport->pipeline);
 	k_work_init_delayable(&transport->timeout, timeout_fn);
 }
 
@@ -186,6 +337,16 @@ int config_channel_transport_get(struct config_channel_transport *transport,
 {
 	__ASSERT_NO_MSG(transport->state != CONFIG_CHANNEL_TRANSPORT_DISABLED);
 
+	if (transport->pipeline.active) {
+		if (length < TRANSPORT_SEQ_HEADER_SIZE + 1) {
+			LOG_ERR("Host fetched incomplete data");
+			return -EMSGSIZE;
+		}
+
+		pipeline_ack_fill(&transport->pipeline, buffer, length);
+		return 0;
+	}
+
 	if (length < transport->data_len) {
 		LOG_ERR("Host fetched incomplete data");
 	}
@@ -204,11 +365,19 @@ int config_channel_transport_set(struct config_channel_transport *transport,
 {
 	__ASSERT_NO_MSG(transport->state != CONFIG_CHANNEL_TRANSPORT_DISABLED);
 
+	if ((length > DATA_LEN_POS) &&
+	    (buffer[DATA_LEN_POS] & TRANSPORT_SEQ_FLAG)) {
+		return pipeline_set(transport, buffer, length);
+	}
+
 	if (transport->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP) {
 		LOG_WRN("Transport %p busy", (void *)transport);
 		return -EBUSY;
 	}
 
+	/* Regular request ends the pipelined transfer. */
+	pipeline_reset(&transport->pipeline);
+
 	if (transport->state == CONFIG_CHANNEL_TRANSPORT_RSP_READY) {
 		LOG_WRN("Host ignored previous response (transport: %p)",
 			(void *)transport);
@@ -254,6 +423,16 @@ bool config_channel_transport_rsp_receive(struct config_channel_transport *trans
 		event->dyndata.size = 0;
 	}
 
+	if (transport->pipeline.cnt > 0) {
+		int err = k_work_cancel_delayable(&transport->timeout);
+
+		__ASSERT_NO_MSG(!err);
+		ARG_UNUSED(err);
+
+		pipeline_complete(transport, event->status);
+		return true;
+	}
+
 	int pos = config_channel_report_fill(transport->data,
 				event->dyndata.size + TRANSPORT_HEADER_SIZE,
 				event);
@@ -280,6 +459,7 @@ void config_channel_transport_disconnect(struct config_channel_transport *transp
 		drop_transactions(transport);
 	}
 	transport->state = CONFIG_CHANNEL_TRANSPORT_IDLE;
+	pipeline_reset(&transport->pipeline);
 
 	int err = k_work_cancel_delayable(&transport->timeout);
 
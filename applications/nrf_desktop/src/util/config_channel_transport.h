@@ -51,6 +51,23 @@ enum config_channel_transport_state {
 	CONFIG_CHANNEL_TRANSPORT_RSP_READY
 };
 
+/** @brief Queue of pipelined configuration channel requests.
+ *
+ * The host can send set requests marked with a sequence number without
+ * waiting for the responses. The requests are passed to the application one
+ * by one. The get operation returns the sequence number of the last request
+ * that was handled successfully.
+ */
+struct config_channel_pipeline {
+	uint8_t req[CONFIG_DESKTOP_CONFIG_CHANNEL_PIPELINE_DEPTH][REPORT_SIZE_USER_CONFIG];
+	uint8_t head; /**< Index of the request that is handled. */
+	uint8_t cnt; /**< Number of queued requests. */
+	uint8_t next_seq; /**< Expected sequence number of the next request. */
+	uint8_t ack_seq; /**< Sequence number of the last handled request. */
+	uint8_t status; /**< Error status that was not yet reported. */
+	bool active;
+};
+
 /** @brief Configuration channel transport. */
 struct config_channel_transport {
 	struct k_work_delayable timeout;
@@ -59,6 +76,7 @@ struct config_channel_transport {
 	uint8_t data[REPORT_SIZE_USER_CONFIG];
 
 	enum config_channel_transport_state state;
+	struct config_channel_pipeline pipeline;
 };
 
 /** @brief Initialize the configuration channel transport instance.
@@ -84,6 +102,9 @@ int config_channel_transport_get(struct config_channel_transport *transport,
 /**
  * @brief Handle a set operation on the configuration channel.
  *
+ * If the request is marked with a sequence number, it is queued and the host
+ * can send the next one without waiting for the response.
+ *
  * @param transport Pointer to the configuration channel transport instance.
  * @param buffer    Pointer to the report buffer to be parsed to handle
  *                  the set request.
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <sys/__assert.h>
+#include <sys/util.h>
+
+#include "dfu_slot_erase.h"
+
+#define FLASH_CLEAN_VAL		UINT32_MAX
+#define FLASH_READ_CHUNK_SIZE	(DFU_SLOT_ERASE_PAGE_SIZE / 8)
+
+
+static bool is_page_clean(const struct flash_area *fa, off_t off)
+{
+	static const size_t chunk_size = FLASH_READ_CHUNK_SIZE;
+	static const size_t chunk_cnt = DFU_SLOT_ERASE_PAGE_SIZE / chunk_size;
+
+	BUILD_ASSERT(FLASH_READ_CHUNK_SIZE * (DFU_SLOT_ERASE_PAGE_SIZE /
+		     FLASH_READ_CHUNK_SIZE) == DFU_SLOT_ERASE_PAGE_SIZE);
+	BUILD_ASSERT(FLASH_READ_CHUNK_SIZE % sizeof(uint32_t) == 0);
+
+	for (size_t i = 0; i < chunk_cnt; i++) {
+		uint32_t buf[FLASH_READ_CHUNK_SIZE / sizeof(uint32_t)];
+		int err = flash_area_read(fa, off + i * chunk_size, buf, chunk_size);
+
+		if (err) {
+			/* Erase the page if it cannot be checked. */
+			return false;
+		}
+
+		for (size_t j = 0; j < ARRAY_SIZE(buf); j++) {
+			if (buf[j] != FLASH_CLEAN_VAL) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void dfu_slot_erase_init(struct dfu_slot_erase *erase, uint32_t trailer_size)
+{
+	__ASSERT_NO_MSG((trailer_size % DFU_SLOT_ERASE_PAGE_SIZE) == 0);
+
+	erase->trailer_size = trailer_size;
+	dfu_slot_erase_restart(erase);
+}
+
+void dfu_slot_erase_restart(struct dfu_slot_erase *erase)
+{
+	erase->offset = 0;
+	erase->done = false;
+}
+
+int dfu_slot_erase_page(struct dfu_slot_erase *erase,
+			const struct flash_area *fa)
+{
+	__ASSERT_NO_MSG(!erase->done);
+	__ASSERT_NO_MSG(erase->offset + DFU_SLOT_ERASE_PAGE_SIZE <= fa->fa_size);
+
+	if (!is_page_clean(fa, erase->offset)) {
+		int err = flash_area_erase(fa, erase->offset,
+					   DFU_SLOT_ERASE_PAGE_SIZE);
+
+		if (err) {
+			return err;
+		}
+	}
+
+	erase->offset += DFU_SLOT_ERASE_PAGE_SIZE;
+
+	if (erase->offset >= fa->fa_size) {
+		erase->done = true;
+	}
+
+	return 0;
+}
+
+int dfu_slot_erase_complete(struct dfu_slot_erase *erase,
+			    const struct flash_area *fa)
+{
+	__ASSERT_NO_MSG(fa->fa_size >= erase->trailer_size);
+
+	uint32_t trailer_offset = fa->fa_size - erase->trailer_size;
+	int err = 0;
+
+	if (erase->done) {
+		return 0;
+	}
+
+	/* Pages holding the image were erased before they were written. */
+	if (erase->offset < trailer_offset) {
+		erase->offset = trailer_offset;
+	}
+
+	if (erase->offset >= fa->fa_size) {
+		erase->done = true;
+	}
+
+	while (!erase->done && !err) {
+		err = dfu_slot_erase_page(erase, fa);
+	}
+
+	return err;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _DFU_SLOT_ERASE_H_
+#define _DFU_SLOT_ERASE_H_
+
+#include <stdbool.h>
+#include <zephyr/types.h>
+#include <storage/flash_map.h>
+
+#define DFU_SLOT_ERASE_PAGE_SIZE_LOG2	12
+#define DFU_SLOT_ERASE_PAGE_SIZE	BIT(DFU_SLOT_ERASE_PAGE_SIZE_LOG2)
+
+/**@brief Erase progress of the DFU slot.
+ *
+ * Pages are erased in order from the start of the slot. Pages below the
+ * erase offset are clean or hold data of the ongoing transfer. Pages that
+ * are already clean are not erased again.
+ */
+struct dfu_slot_erase {
+	uint32_t offset; /**< Offset of the first page not erased yet. */
+	uint32_t trailer_size; /**< Size of the trailer at the end of the slot. */
+	bool done; /**< No more pages need to be erased. */
+};
+
+/**@brief Initialize the erase progress.
+ *
+ * The slot is considered not clean.
+ *
+ * @param trailer_size  Size of the area at the end of the slot that the
+ *                      bootloader writes after the image is stored.
+ *                      Must be a multiple of the page size.
+ */
+void dfu_slot_erase_init(struct dfu_slot_erase *erase, uint32_t trailer_size);
+
+/**@brief Start erasing the slot again from its first page. */
+void dfu_slot_erase_restart(struct dfu_slot_erase *erase);
+
+static inline bool dfu_slot_erase_is_done(const struct dfu_slot_erase *erase)
+{
+	return erase->done;
+}
+
+/**@brief Check if the page holding the given offset was erased. */
+static inline bool dfu_slot_erase_is_erased(const struct dfu_slot_erase *erase,
+					    uint32_t off)
+{
+	return erase->done || (off < erase->offset);
+}
+
+/**@brief Erase the next page of the slot.
+ *
+ * Must not be called when the erase is done.
+ *
+ * @return 0 on success or negative error code.
+ */
+int dfu_slot_erase_page(struct dfu_slot_erase *erase,
+			const struct flash_area *fa);
+
+/**@brief Finish the erase once the image is stored.
+ *
+ * The pages between the image and the trailer hold stale data that is not
+ * used by the bootloader, and are skipped. The trailer pages that were not
+ * erased yet are erased now. Afterwards the erase is done and the trailer
+ * can be written. The erase must be restarted before the next image is
+ * stored.
+ *
+ * @return 0 on success or negative error code.
+ */
+int dfu_slot_erase_complete(struct dfu_slot_erase *erase,
+			    const struct flash_area *fa);
+
+#endif /* _DFU_SLOT_ERASE_H_ */
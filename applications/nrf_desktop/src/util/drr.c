@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <sys/__assert.h>
+#include <sys/util.h>
+
+#include "drr.h"
+
+
+int drr_next(size_t flow_cnt, size_t *cur, uint16_t quantum,
+	     drr_flow_get_t flow_get, void *user_data)
+{
+	size_t flow_id = *cur;
+	uint16_t *deficit;
+	size_t size;
+
+	__ASSERT_NO_MSG(flow_id < flow_cnt);
+
+	for (size_t i = 0; i <= flow_cnt; i++) {
+		deficit = flow_get(flow_id, &size, user_data);
+
+		if (deficit) {
+			if (size == 0) {
+				/* Idle flow cannot save the quantum. */
+				*deficit = 0;
+			} else if (*deficit >= size) {
+				*cur = flow_id;
+				*deficit -= size;
+				return flow_id;
+			}
+		}
+
+		flow_id = (flow_id + 1) % flow_cnt;
+		deficit = flow_get(flow_id, &size, user_data);
+
+		if (deficit && (size > 0)) {
+			*deficit += MAX(quantum, size);
+		}
+	}
+
+	return -ENOENT;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _DRR_H_
+#define _DRR_H_
+
+#include <stddef.h>
+#include <zephyr/types.h>
+
+/**@brief Get a flow of the deficit round-robin.
+ *
+ * @param flow_id        Index of the flow.
+ * @param[out] head_size Size of the next packet of the flow in bytes, or 0
+ *                       if the flow has nothing to send.
+ * @param user_data      Pointer passed to @ref drr_next.
+ *
+ * @return Deficit counter of the flow, or NULL if the flow does not share
+ *         the link.
+ */
+typedef uint16_t *(*drr_flow_get_t)(size_t flow_id, size_t *head_size,
+				    void *user_data);
+
+/**@brief Select the flow that sends the next packet.
+ *
+ * Deficit round-robin. Every flow gets a quantum of bytes when its turn
+ * comes and sends packets as long as its deficit counter allows. A burst
+ * of packets of one flow cannot delay other flows for more than one
+ * quantum. The quantum always allows to send at least one packet. The
+ * size of the packet is charged to the deficit of the selected flow.
+ *
+ * @param flow_cnt   Number of flows.
+ * @param[in,out] cur Flow selected last, updated to the selected flow.
+ * @param quantum    Number of bytes a flow gets for its turn.
+ * @param flow_get   Function used to get the flows.
+ * @param user_data  Pointer passed to @p flow_get.
+ *
+ * @return Index of the selected flow or a negative value if no flow has
+ *         anything to send.
+ */
+int drr_next(size_t flow_cnt, size_t *cur, uint16_t quantum,
+	     drr_flow_get_t flow_get, void *user_data);
+
+#endif /* _DRR_H_ */
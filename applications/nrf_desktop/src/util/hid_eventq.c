@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <sys/__assert.h>
+#include <sys/util.h>
+
+#include "hid_eventq.h"
+
+
+static uint8_t pos_next(uint8_t pos)
+{
+	pos++;
+
+	return (pos >= HID_EVENTQ_SIZE) ? 0 : pos;
+}
+
+static uint8_t pos_add(uint8_t pos, size_t offset)
+{
+	return (pos + offset) % HID_EVENTQ_SIZE;
+}
+
+static size_t pos_distance(uint8_t from, uint8_t to)
+{
+	return (to + HID_EVENTQ_SIZE - from) % HID_EVENTQ_SIZE;
+}
+
+void hid_eventq_reset(struct hid_eventq *eventq)
+{
+	eventq->head = 0;
+	eventq->len = 0;
+	eventq->boundary_head = 0;
+	eventq->boundary_len = 0;
+	eventq->pending_cnt = 0;
+}
+
+/* Update the unpaired key downs and return true if all of them are paired. */
+static bool pending_update(struct hid_eventq *eventq, uint16_t usage_id,
+			   int16_t value)
+{
+	struct hid_eventq_pending *pending = eventq->pending;
+
+	for (size_t i = 0; i < eventq->pending_cnt; i++) {
+		if (pending[i].usage_id == usage_id) {
+			pending[i].cnt += value;
+
+			if (pending[i].cnt <= 0) {
+				/* All key downs of this usage are paired. */
+				eventq->pending_cnt--;
+				pending[i] = pending[eventq->pending_cnt];
+			}
+
+			return (eventq->pending_cnt == 0);
+		}
+	}
+
+	if (value > 0) {
+		/* Key up without previous key down in the queue is not
+		 * tracked.
+		 */
+		if (eventq->pending_cnt < ARRAY_SIZE(eventq->pending)) {
+			pending[eventq->pending_cnt].usage_id = usage_id;
+			pending[eventq->pending_cnt].cnt = value;
+		}
+
+		/* If the array is full, the counter still increases. No
+		 * boundary is then recorded until the queue is emptied.
+		 */
+		eventq->pending_cnt++;
+	}
+
+	return (eventq->pending_cnt == 0);
+}
+
+void hid_eventq_append(struct hid_eventq *eventq, uint16_t usage_id,
+		       int16_t value, uint32_t timestamp)
+{
+	__ASSERT_NO_MSG(!hid_eventq_is_full(eventq));
+
+	uint8_t pos = pos_add(eventq->head, eventq->len);
+	struct hid_eventq_event *event = &eventq->event[pos];
+
+	event->usage_id = usage_id;
+	event->value = value;
+	event->timestamp = timestamp;
+	eventq->len++;
+
+	if (eventq->pending_cnt > ARRAY_SIZE(eventq->pending)) {
+		return;
+	}
+
+	if (pending_update(eventq, usage_id, value)) {
+		/* All key downs up to this event are paired. */
+		__ASSERT_NO_MSG(eventq->boundary_len < HID_EVENTQ_SIZE);
+
+		eventq->boundary[pos_add(eventq->boundary_head,
+					 eventq->boundary_len)] = pos;
+		eventq->boundary_len++;
+	}
+}
+
+bool hid_eventq_get(struct hid_eventq *eventq, struct hid_eventq_event *event)
+{
+	if (hid_eventq_is_empty(eventq)) {
+		return false;
+	}
+
+	*event = eventq->event[eventq->head];
+
+	if ((eventq->boundary_len > 0) &&
+	    (eventq->boundary[eventq->boundary_head] == eventq->head)) {
+		eventq->boundary_head = pos_next(eventq->boundary_head);
+		eventq->boundary_len--;
+	}
+
+	eventq->head = pos_next(eventq->head);
+	eventq->len--;
+
+	/* Key downs removed from the queue stay pending until their key ups
+	 * are appended. Boundaries are then recorded later than needed, but
+	 * never too early.
+	 */
+	if (hid_eventq_is_empty(eventq)) {
+		hid_eventq_reset(eventq);
+	}
+
+	return true;
+}
+
+/* Remove events up to and including the oldest boundary. */
+static size_t purge_to_boundary(struct hid_eventq *eventq)
+{
+	__ASSERT_NO_MSG(eventq->boundary_len > 0);
+
+	uint8_t last = eventq->boundary[eventq->boundary_head];
+	size_t cnt = pos_distance(eventq->head, last) + 1;
+
+	__ASSERT_NO_MSG(cnt <= eventq->len);
+
+	eventq->boundary_head = pos_next(eventq->boundary_head);
+	eventq->boundary_len--;
+
+	eventq->head = pos_next(last);
+	eventq->len -= cnt;
+
+	return cnt;
+}
+
+size_t hid_eventq_cleanup(struct hid_eventq *eventq, uint32_t timestamp)
+{
+	size_t cnt = 0;
+
+	while (eventq->boundary_len > 0) {
+		uint8_t pos = eventq->boundary[eventq->boundary_head];
+		uint32_t diff = timestamp - eventq->event[pos].timestamp;
+
+		/* Events are ordered, so an expired boundary means that all
+		 * events before it have expired too.
+		 */
+		if (diff < CONFIG_DESKTOP_HID_REPORT_EXPIRATION) {
+			break;
+		}
+
+		cnt += purge_to_boundary(eventq);
+	}
+
+	if (hid_eventq_is_empty(eventq)) {
+		hid_eventq_reset(eventq);
+	}
+
+	return cnt;
+}
+
+size_t hid_eventq_purge_oldest(struct hid_eventq *eventq)
+{
+	if (eventq->boundary_len == 0) {
+		return 0;
+	}
+
+	uint8_t pos = eventq->boundary[eventq->boundary_head];
+
+	/* Remove also the following events with the same timestamp. */
+	return hid_eventq_cleanup(eventq, eventq->event[pos].timestamp +
+					  CONFIG_DESKTOP_HID_REPORT_EXPIRATION);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _HID_EVENTQ_H_
+#define _HID_EVENTQ_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/types.h>
+
+#define HID_EVENTQ_SIZE CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE
+
+/**@brief Enqueued HID state item. */
+struct hid_eventq_event {
+	uint16_t usage_id; /**< HID usage ID. */
+	int16_t value; /**< HID value. */
+	uint32_t timestamp; /**< HID event timestamp. */
+};
+
+/**@brief Usage with key down events that are not yet paired with key up. */
+struct hid_eventq_pending {
+	uint16_t usage_id; /**< HID usage ID. */
+	int16_t cnt; /**< Number of unpaired key downs. */
+};
+
+/**@brief HID event queue.
+ *
+ * Events are kept in a ring buffer in timestamp order. The queue also
+ * records the positions after which every key down in the queue is paired
+ * with a key up (boundaries). Events can be dropped only up to a boundary,
+ * so that no key stays pressed when its key up is removed. The oldest
+ * boundary is checked first, so cleanup does not depend on queue depth.
+ */
+struct hid_eventq {
+	struct hid_eventq_event event[HID_EVENTQ_SIZE];
+	uint8_t head; /**< Position of the oldest event. */
+	uint8_t len; /**< Number of events in the queue. */
+
+	uint8_t boundary[HID_EVENTQ_SIZE]; /**< Event positions, oldest first. */
+	uint8_t boundary_head; /**< Position of the oldest boundary. */
+	uint8_t boundary_len; /**< Number of boundaries. */
+
+	struct hid_eventq_pending pending[HID_EVENTQ_SIZE];
+	uint8_t pending_cnt; /**< Number of usages with unpaired key downs. */
+};
+
+/**@brief Remove all events from the queue. */
+void hid_eventq_reset(struct hid_eventq *eventq);
+
+static inline bool hid_eventq_is_full(const struct hid_eventq *eventq)
+{
+	return (eventq->len >= HID_EVENTQ_SIZE);
+}
+
+static inline bool hid_eventq_is_empty(const struct hid_eventq *eventq)
+{
+	return (eventq->len == 0);
+}
+
+/**@brief Append an event to the queue.
+ *
+ * The queue must not be full.
+ */
+void hid_eventq_append(struct hid_eventq *eventq, uint16_t usage_id,
+		       int16_t value, uint32_t timestamp);
+
+/**@brief Get the oldest event from the queue.
+ *
+ * @param[out] event  Removed event.
+ *
+ * @return true if an event was removed, false if the queue was empty.
+ */
+bool hid_eventq_get(struct hid_eventq *eventq, struct hid_eventq_event *event);
+
+/**@brief Remove events that expired at the given time.
+ *
+ * Events are removed only up to the newest expired boundary.
+ *
+ * @return Number of removed events.
+ */
+size_t hid_eventq_cleanup(struct hid_eventq *eventq, uint32_t timestamp);
+
+/**@brief Remove the oldest events that can be removed, even if not expired.
+ *
+ * @return Number of removed events.
+ */
+size_t hid_eventq_purge_oldest(struct hid_eventq *eventq);
+
+#endif /* _HID_EVENTQ_H_ */
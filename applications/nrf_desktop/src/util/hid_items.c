@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <sys/__assert.h>
+#include <sys/util.h>
+
+#include "hid_items.h"
+
+
+static bool usage_bm_test(const struct hid_items *items, uint16_t usage_id)
+{
+	return (items->usage_bm[usage_id / 32] & BIT(usage_id % 32)) != 0;
+}
+
+static void usage_bm_update(struct hid_items *items, uint16_t usage_id, bool set)
+{
+	if (usage_id >= HID_ITEMS_USAGE_BM_SIZE) {
+		return;
+	}
+
+	if (set) {
+		items->usage_bm[usage_id / 32] |= BIT(usage_id % 32);
+	} else {
+		items->usage_bm[usage_id / 32] &= ~BIT(usage_id % 32);
+	}
+}
+
+static void item_remove(struct hid_items *items, struct hid_item *p_item)
+{
+	size_t idx = p_item - items->item;
+
+	__ASSERT_NO_MSG(idx < items->item_count);
+
+	usage_bm_update(items, p_item->usage_id, false);
+
+	/* Keep order of addition for the remaining items. */
+	memmove(p_item, p_item + 1,
+		(items->item_count - idx - 1) * sizeof(items->item[0]));
+
+	items->item_count--;
+	items->item[items->item_count].usage_id = 0;
+	items->item[items->item_count].value = 0;
+}
+
+void hid_items_clear(struct hid_items *items)
+{
+	memset(items->item, 0, sizeof(items->item));
+	memset(items->usage_bm, 0, sizeof(items->usage_bm));
+	items->item_count = 0;
+}
+
+struct hid_item *hid_items_find(struct hid_items *items, uint16_t usage_id)
+{
+	/* Most of the lookups are for usages that are not recorded. The
+	 * bitmask answers them without browsing the items.
+	 */
+	if ((usage_id < HID_ITEMS_USAGE_BM_SIZE) && !usage_bm_test(items, usage_id)) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < items->item_count; i++) {
+		if (items->item[i].usage_id == usage_id) {
+			return &items->item[i];
+		}
+	}
+
+	return NULL;
+}
+
+bool hid_items_value_set(struct hid_items *items, uint16_t usage_id,
+			 int16_t value)
+{
+	bool update_needed = false;
+	struct hid_item *p_item;
+
+	__ASSERT_NO_MSG(usage_id != 0);
+	__ASSERT_NO_MSG(items->item_count_max > 0);
+	__ASSERT_NO_MSG(items->item_count_max <= HID_ITEMS_SIZE);
+
+	/* Report equal to zero brings no change. This should never happen. */
+	__ASSERT_NO_MSG(value != 0);
+
+	p_item = hid_items_find(items, usage_id);
+
+	if (p_item) {
+		/* Item is present in the array - update its value. Reports
+		 * do not change until the value drops to zero.
+		 */
+		p_item->value += value;
+		if (p_item->value == 0) {
+			item_remove(items, p_item);
+			update_needed = true;
+		}
+	} else if (value < 0) {
+		/* For items with absolute value, the value is used as
+		 * a reference counter and must not fall below zero. This
+		 * could happen if a key up event is lost and the state
+		 * receives an unpaired key down event.
+		 */
+	} else if (!hid_items_is_full(items)) {
+		/* Record this value change. */
+		p_item = &items->item[items->item_count];
+		p_item->usage_id = usage_id;
+		p_item->value = value;
+		items->item_count += 1;
+		usage_bm_update(items, usage_id, true);
+
+		update_needed = true;
+	}
+
+	return update_needed;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _HID_ITEMS_H_
+#define _HID_ITEMS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/types.h>
+
+/* Maximum number of items in a set, enough for eight mouse buttons. */
+#define HID_ITEMS_SIZE		8
+
+/* Usages tracked in the usage bitmask. Covers mouse buttons and keyboard
+ * keys including modifiers.
+ */
+#define HID_ITEMS_USAGE_BM_SIZE	256
+
+/**@brief HID state item. */
+struct hid_item {
+	uint16_t usage_id; /**< HID usage ID. */
+	int16_t value; /**< HID value. */
+};
+
+/**@brief Set of items of a single target HID report.
+ *
+ * Items are kept in order of addition. The value of an item is used as
+ * a reference counter of key down events, the item is removed when it
+ * drops to zero.
+ */
+struct hid_items {
+	uint8_t item_count_max; /**< Maximal numer of items in this set. */
+	uint8_t item_count; /**< Current number of items in this set. */
+	struct hid_item item[HID_ITEMS_SIZE]; /**< Items set in order of addition. */
+	uint32_t usage_bm[HID_ITEMS_USAGE_BM_SIZE / 32]; /**< Bitmask of recorded usages. */
+};
+
+/**@brief Remove all items from the set. */
+void hid_items_clear(struct hid_items *items);
+
+static inline bool hid_items_is_full(const struct hid_items *items)
+{
+	return (items->item_count >= items->item_count_max);
+}
+
+/**@brief Find the item of a usage.
+ *
+ * @return Pointer to the item or NULL if the usage is not recorded.
+ */
+struct hid_item *hid_items_find(struct hid_items *items, uint16_t usage_id);
+
+/**@brief Update value of the item of a usage.
+ *
+ * An item is added for a positive value of a usage that is not recorded,
+ * if the set is not full. Values of usages that are not recorded are
+ * ignored otherwise.
+ *
+ * @return true if the set of recorded usages has changed, so the report
+ *	   content must be updated.
+ */
+bool hid_items_value_set(struct hid_items *items, uint16_t usage_id,
+			 int16_t value);
+
+#endif /* _HID_ITEMS_H_ */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+
+#include "hid_report_mouse.h"
+#include "hid_mouse_report.h"
+
+
+/* Buttons, wheel and 12-bit X/Y motion. */
+BUILD_ASSERT(REPORT_SIZE_MOUSE == 5);
+
+static int16_t mouse_xy_get(const uint8_t *data, bool y)
+{
+	uint16_t val;
+
+	if (y) {
+		val = (data[1] >> 4) | (data[2] << 4);
+	} else {
+		val = data[0] | ((data[1] & 0x0f) << 8);
+	}
+
+	/* Extend sign of the 12-bit value. */
+	return (int16_t)(val << 4) >> 4;
+}
+
+static void mouse_xy_put(uint8_t *data, int16_t x, int16_t y)
+{
+	data[0] = x & 0xff;
+	data[1] = ((y & 0x0f) << 4) | ((x >> 8) & 0x0f);
+	data[2] = (y >> 4) & 0xff;
+}
+
+bool hid_mouse_report_coalesce(uint8_t *dst, const uint8_t *src)
+{
+	if (dst[0] != src[0]) {
+		return false;
+	}
+
+	int16_t wheel = (int8_t)dst[1] + (int8_t)src[1];
+	int16_t x = mouse_xy_get(&dst[2], false) + mouse_xy_get(&src[2], false);
+	int16_t y = mouse_xy_get(&dst[2], true) + mouse_xy_get(&src[2], true);
+
+	if ((wheel < MOUSE_REPORT_WHEEL_MIN) || (wheel > MOUSE_REPORT_WHEEL_MAX) ||
+	    (x < MOUSE_REPORT_XY_MIN) || (x > MOUSE_REPORT_XY_MAX) ||
+	    (y < MOUSE_REPORT_XY_MIN) || (y > MOUSE_REPORT_XY_MAX)) {
+		return false;
+	}
+
+	dst[1] = wheel;
+	mouse_xy_put(&dst[2], x, y);
+
+	return true;
+}
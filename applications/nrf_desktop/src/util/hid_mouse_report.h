@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _HID_MOUSE_REPORT_H_
+#define _HID_MOUSE_REPORT_H_
+
+#include <stdbool.h>
+#include <zephyr/types.h>
+
+/**@brief Add the motion of a mouse report to another mouse report.
+ *
+ * Reports are merged only if the button state is the same and the sums of
+ * the motion fit into the report.
+ *
+ * @param[in,out] dst Mouse report data without the report ID, updated with
+ *                    the sum of the motion.
+ * @param[in] src     Mouse report data without the report ID.
+ *
+ * @return true if the reports were merged.
+ */
+bool hid_mouse_report_coalesce(uint8_t *dst, const uint8_t *src);
+
+#endif /* _HID_MOUSE_REPORT_H_ */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/__assert.h>
+#include <sys/util.h>
+
+#include "led_keyframes.h"
+
+#define ARRAY_SIZE_KF (LED_KEYFRAMES_QUEUE_SIZE + 1)
+
+
+static size_t pos_next(size_t pos)
+{
+	return (pos + 1) % ARRAY_SIZE_KF;
+}
+
+static const struct led_keyframe *last_keyframe(const struct led_keyframes *kfs)
+{
+	return &kfs->keyframe[(kfs->rx_idx + ARRAY_SIZE_KF - 1) % ARRAY_SIZE_KF];
+}
+
+void led_keyframes_reset(struct led_keyframes *kfs)
+{
+	memset(kfs, 0, sizeof(*kfs));
+}
+
+size_t led_keyframes_free_count(const struct led_keyframes *kfs)
+{
+	size_t len = (ARRAY_SIZE_KF + kfs->rx_idx - kfs->tx_idx) % ARRAY_SIZE_KF;
+
+	return ARRAY_SIZE_KF - len - 1;
+}
+
+int led_keyframes_add(struct led_keyframes *kfs, const struct led_keyframe *kf,
+		      size_t cnt, uint32_t now)
+{
+	bool new_timeline = led_keyframes_is_empty(kfs) && !kfs->playing;
+	uint16_t prev_ts;
+
+	if (led_keyframes_free_count(kfs) < cnt) {
+		return -ENOMEM;
+	}
+
+	if (cnt == 0) {
+		return 0;
+	}
+
+	if (!led_keyframes_is_empty(kfs)) {
+		prev_ts = last_keyframe(kfs)->timestamp;
+	} else {
+		/* Continue the timeline of the keyframe being displayed. */
+		prev_ts = new_timeline ? kf[0].timestamp : kfs->base_ts;
+	}
+
+	for (size_t i = 0; i < cnt; i++) {
+		if ((uint16_t)(kf[i].timestamp - prev_ts) > LED_KEYFRAMES_TIME_DIFF_MAX) {
+			return -EINVAL;
+		}
+
+		prev_ts = kf[i].timestamp;
+	}
+
+	if (new_timeline) {
+		/* The first keyframe is displayed after a delay, so that the
+		 * host can send the following frames before it is reached.
+		 */
+		kfs->base_time = now + CONFIG_DESKTOP_LED_STREAM_KEYFRAME_DELAY;
+		kfs->base_ts = kf[0].timestamp;
+	}
+
+	for (size_t i = 0; i < cnt; i++) {
+		kfs->keyframe[kfs->rx_idx] = kf[i];
+		kfs->rx_idx = pos_next(kfs->rx_idx);
+	}
+
+	return 0;
+}
+
+bool led_keyframes_step_get(struct led_keyframes *kfs, uint32_t now,
+			    struct led_effect_step *step)
+{
+	if (led_keyframes_is_empty(kfs)) {
+		return false;
+	}
+
+	const struct led_keyframe *kf = &kfs->keyframe[kfs->tx_idx];
+	uint32_t target = kfs->base_time + (uint16_t)(kf->timestamp - kfs->base_ts);
+	int32_t duration = target - now;
+
+	kfs->base_time = target;
+	kfs->base_ts = kf->timestamp;
+
+	step->color = kf->color;
+
+	if (duration <= 0) {
+		/* Late keyframe is displayed at once. */
+		step->substep_count = 1;
+		step->substep_time = 0;
+	} else {
+		step->substep_count = DIV_ROUND_UP(duration,
+					CONFIG_DESKTOP_LED_STREAM_SUBSTEP_TIME);
+		step->substep_time = duration / step->substep_count;
+	}
+
+	kfs->tx_idx = pos_next(kfs->tx_idx);
+	kfs->playing = true;
+
+	return true;
+}
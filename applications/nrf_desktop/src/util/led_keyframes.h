@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _LED_KEYFRAMES_H_
+#define _LED_KEYFRAMES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/types.h>
+#include <caf/led_effect.h>
+
+#define LED_KEYFRAMES_QUEUE_SIZE CONFIG_DESKTOP_LED_STREAM_KEYFRAME_QUEUE_SIZE
+
+/* Keyframes must not be too far apart to detect timestamp wrap. */
+#define LED_KEYFRAMES_TIME_DIFF_MAX INT16_MAX
+
+/**@brief Timestamped LED keyframe. */
+struct led_keyframe {
+	struct led_color color; /**< Color displayed at the timestamp. */
+	uint16_t timestamp; /**< Display time on the host clock [ms]. */
+};
+
+/**@brief Queue of the keyframes of a single LED.
+ *
+ * Keyframe timestamps are mapped to the local time relative to the
+ * keyframe displayed last (base). The first keyframe of a timeline is
+ * displayed CONFIG_DESKTOP_LED_STREAM_KEYFRAME_DELAY after it is received.
+ */
+struct led_keyframes {
+	struct led_keyframe keyframe[LED_KEYFRAMES_QUEUE_SIZE + 1];
+	uint8_t rx_idx; /**< Position of the next added keyframe. */
+	uint8_t tx_idx; /**< Position of the oldest keyframe. */
+	bool playing; /**< A keyframe of the timeline is being displayed. */
+	uint32_t base_time; /**< Local display time of the base keyframe. */
+	uint16_t base_ts; /**< Timestamp of the base keyframe. */
+};
+
+/**@brief Remove all keyframes and end the timeline. */
+void led_keyframes_reset(struct led_keyframes *kfs);
+
+static inline bool led_keyframes_is_empty(const struct led_keyframes *kfs)
+{
+	return (kfs->rx_idx == kfs->tx_idx);
+}
+
+/**@brief Get the number of keyframes that can be added to the queue. */
+size_t led_keyframes_free_count(const struct led_keyframes *kfs);
+
+/**@brief Add keyframes to the queue.
+ *
+ * Keyframes are added only if all of them fit into the queue and follow
+ * the keyframes added before in time. A new timeline is started if no
+ * keyframe is queued or displayed.
+ *
+ * @param kf   Keyframes in display order.
+ * @param cnt  Number of keyframes.
+ * @param now  Current time [ms].
+ *
+ * @retval 0        Keyframes were added.
+ * @retval -ENOMEM  Not enough free places in the queue.
+ * @retval -EINVAL  Keyframe timestamps are out of order.
+ */
+int led_keyframes_add(struct led_keyframes *kfs, const struct led_keyframe *kf,
+		      size_t cnt, uint32_t now);
+
+/**@brief Remove the oldest keyframe and get the LED effect step displaying it.
+ *
+ * The color change from the displayed color is interpolated in substeps of
+ * up to CONFIG_DESKTOP_LED_STREAM_SUBSTEP_TIME, so that the keyframe color
+ * is reached at its display time. The display time is computed from the one
+ * of the previous keyframe, so rounding and delays do not accumulate.
+ *
+ * @param now        Current time [ms].
+ * @param[out] step  LED effect step.
+ *
+ * @return true if a keyframe was removed, false if the queue was empty.
+ */
+bool led_keyframes_step_get(struct led_keyframes *kfs, uint32_t now,
+			    struct led_effect_step *step);
+
+/**@brief Mark that no keyframe is displayed.
+ *
+ * Keyframes added when the queue is empty start a new timeline.
+ */
+static inline void led_keyframes_stop(struct led_keyframes *kfs)
+{
+	kfs->playing = false;
+}
+
+#endif /* _LED_KEYFRAMES_H_ */
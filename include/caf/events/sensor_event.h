@@ -14,12 +14,65 @@
  * @brief CAF Sensor Event.
  */
 
+#include <string.h>
 #include "event_manager.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#ifdef CONFIG_CAF_SENSOR_EVENT_DATA_FIXED_POINT
+/** @brief Sensor data value.
+ *
+ * Signed fixed-point number with @ref SENSOR_EVENT_DATA_FRAC_BITS fractional bits.
+ */
+typedef int32_t sensor_event_data_t;
+
+/** @brief Number of fractional bits of a sensor data value. */
+#define SENSOR_EVENT_DATA_FRAC_BITS CONFIG_CAF_SENSOR_EVENT_DATA_FRAC_BITS
+#else
+/** @brief Sensor data value. */
+typedef float sensor_event_data_t;
+#endif
+
+/** @brief Convert sensor data value to floating-point value.
+ *
+ * @param[in] val         Sensor data value.
+ *
+ * @return Floating-point value.
+ */
+static inline float sensor_event_data_to_float(sensor_event_data_t val)
+{
+#ifdef CONFIG_CAF_SENSOR_EVENT_DATA_FIXED_POINT
+	return (float)val * (1.0f / (1UL << SENSOR_EVENT_DATA_FRAC_BITS));
+#else
+	return val;
+#endif
+}
+
+/** @brief Convert array of sensor data values to floating-point values.
+ *
+ * Use the function only if floating-point values are required. The conversion loop has no
+ * dependencies between iterations, so the compiler can vectorize it.
+ *
+ * @param[out] dst        Pointer to the destination buffer.
+ * @param[in]  src        Pointer to the sensor data values.
+ * @param[in]  cnt        Number of values.
+ */
+static inline void sensor_event_data_to_float_array(float *dst, const sensor_event_data_t *src,
+						    size_t cnt)
+{
+#ifdef CONFIG_CAF_SENSOR_EVENT_DATA_FIXED_POINT
+	const float scale = 1.0f / (1UL << SENSOR_EVENT_DATA_FRAC_BITS);
+
+	for (size_t i = 0; i < cnt; i++) {
+		dst[i] = (float)src[i] * scale;
+	}
+#else
+	memcpy(dst, src, cnt * sizeof(float));
+#endif
+}
+
 /** @brief Sensor states. */
 enum sensor_state {
 	/** Initial state of the sensor. The state is used only before sensor is initialized and
@@ -68,10 +121,12 @@ EVENT_TYPE_DECLARE(sensor_state_event);
  * application. The Common Application Framework does not impose any standard way of describing
  * sensors. Format and content of the sensor description is defined by the application.
  *
- * The dyndata contains sensor readouts represented as array of floating-point values. Content of
- * the array depends only on selected sensor. For example an accelerometer may report acceleration
- * in X, Y and Z axis as three floating-point values. @ref sensor_event_get_data_cnt and @ref
- * sensor_event_get_data_ptr can be used to access the sensor data provided by a given sensor event.
+ * The dyndata contains sensor readouts represented as array of sensor data values. Depending on
+ * configuration, the values are floating-point or fixed-point numbers (see @ref
+ * sensor_event_data_t). Content of the array depends only on selected sensor. For example an
+ * accelerometer may report acceleration in X, Y and Z axis as three values.
+ * @ref sensor_event_get_data_cnt and @ref sensor_event_get_data_ptr can be used to access the
+ * sensor data provided by a given sensor event.
  *
  * @warning The sensor event related to the given sensor must use the same description as
  *          @sensor_state_event related to the sensor.
@@ -80,20 +135,20 @@ struct sensor_event {
 	struct event_header header; /**< Event header. */
 
 	const char *descr; /**< Description of the sensor. */
-	struct event_dyndata dyndata; /**< Sensor data. Provided as floating-point values. */
+	struct event_dyndata dyndata; /**< Sensor data. Provided as sensor data values. */
 };
 
 /** @brief Get size of sensor data.
  *
  * @param[in] event       Pointer to the sensor_event.
  *
- * @return Size of the sensor data, expressed as a number of floating-point values.
+ * @return Size of the sensor data, expressed as a number of sensor data values.
  */
 static inline size_t sensor_event_get_data_cnt(const struct sensor_event *event)
 {
-	__ASSERT_NO_MSG((event->dyndata.size % sizeof(float)) == 0);
+	__ASSERT_NO_MSG((event->dyndata.size % sizeof(sensor_event_data_t)) == 0);
 
-	return (event->dyndata.size / sizeof(float));
+	return (event->dyndata.size / sizeof(sensor_event_data_t));
 }
 
 /** @brief Get pointer to the sensor data.
@@ -102,9 +157,45 @@ static inline size_t sensor_event_get_data_cnt(const struct sensor_event *event)
  *
  * @return Pointer to the sensor data.
  */
-static inline float *sensor_event_get_data_ptr(const struct sensor_event *event)
+static inline sensor_event_data_t *sensor_event_get_data_ptr(const struct sensor_event *event)
+{
+	return (sensor_event_data_t *)event->dyndata.data;
+}
+
+/** @brief Sensor batch event.
+ *
+ * The sensor batch event is submitted instead of @ref sensor_event for a sensor that is configured
+ * to deliver samples in batches. The event contains multiple subsequent samples of the sensor.
+ *
+ * The sensor data is not copied to the event. The data pointer refers to a buffer of the sensor
+ * sampler that is reused after the event is processed. Subscribers must not access the data after
+ * they return from the event handler. The buffer is released by the sensor sampler, which is
+ * the final subscriber of the event, so subscribers must not consume the event.
+ *
+ * @warning The sensor batch event related to the given sensor must use the same description as
+ *          @ref sensor_state_event related to the sensor.
+ */
+struct sensor_batch_event {
+	struct event_header header; /**< Event header. */
+
+	const char *descr; /**< Description of the sensor. */
+	const sensor_event_data_t *data; /**< Samples, one after another. */
+	uint16_t sample_cnt; /**< Number of samples. */
+	uint8_t sample_size; /**< Number of sensor data values in a single sample. */
+	uint16_t dropped_cnt; /**< Number of samples dropped since the previous batch. */
+};
+
+EVENT_TYPE_DECLARE(sensor_batch_event);
+
+/** @brief Get size of sensor batch data.
+ *
+ * @param[in] event       Pointer to the sensor_batch_event.
+ *
+ * @return Size of the sensor data, expressed as a number of sensor data values.
+ */
+static inline size_t sensor_batch_event_get_data_cnt(const struct sensor_batch_event *event)
 {
-	return (float *)event->dyndata.data;
+	return (size_t)event->sample_cnt * event->sample_size;
 }
 
 #ifdef __cplusplus
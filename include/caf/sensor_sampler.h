@@ -41,6 +41,14 @@ struct sensor_config {
 	uint8_t chan_cnt;
 	unsigned int sampling_period_ms;
 	struct trigger *trigger;
+	/* Number of samples delivered in a single sensor_batch_event.
+	 * If set to 0, every sample is delivered in a sensor_event.
+	 */
+	uint16_t batch_size;
+	/* Maximum time between sampling the first sample of a batch and
+	 * submitting the batch. If set to 0, only full batches are submitted.
+	 */
+	unsigned int batch_latency_ms;
 };
 
 #ifdef __cplusplus
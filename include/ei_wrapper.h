@@ -34,6 +34,36 @@ extern "C" {
 typedef void (*ei_wrapper_result_ready_cb)(int err);
 
 
+/** @brief Input window processing statistics. */
+struct ei_wrapper_stats {
+	/** Number of processed input windows. */
+	uint32_t window_cnt;
+
+	/** Number of input windows processed late. A window is late if the data
+	 *  of the following window was already collected when the prediction
+	 *  was started.
+	 */
+	uint32_t late_window_cnt;
+
+	/** Number of input windows that were skipped, because the prediction
+	 *  could not keep up with the input data.
+	 */
+	uint32_t skipped_window_cnt;
+
+	/** Minimum latency in microseconds. Latency is measured from the moment
+	 *  when the input window is ready for processing to the moment when
+	 *  the result is ready.
+	 */
+	uint32_t latency_min;
+
+	/** Maximum latency in microseconds. */
+	uint32_t latency_max;
+
+	/** Sum of latencies in microseconds. */
+	uint64_t latency_sum;
+};
+
+
 /** Check if classifier calculates anomaly value.
  *
  * @retval true If the classifier calculates the anomaly value.
@@ -71,6 +101,23 @@ size_t ei_wrapper_get_window_size(void);
 int ei_wrapper_add_data(const float *data, size_t data_size);
 
 
+/** Add input data in fixed-point format for the library.
+ *
+ * The data is converted to floating-point values while it is stored in the
+ * input buffer. Size of the added data must be divisible by input frame size.
+ *
+ * @param[in] data       Pointer to the buffer with input data. Every value is
+ *                       a signed fixed-point number.
+ * @param[in] data_size  Size of the data (number of fixed-point values).
+ * @param[in] frac_bits  Number of fractional bits of the fixed-point values.
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int ei_wrapper_add_data_fixed(const int32_t *data, size_t data_size,
+			      uint8_t frac_bits);
+
+
 /** Clear all buffered data.
  *
  * The buffer cannot be cleared if the prediction was already started and the
@@ -93,6 +140,13 @@ int ei_wrapper_clear_data(bool *cancelled);
  * If there is not enough data in the input buffer, the prediction start is
  * delayed until the missing data is added.
  *
+ * New data can be added while the prediction is running. The data is stored
+ * outside of the processed input window.
+ *
+ * If the CONFIG_EI_WRAPPER_SKIP_LATE_WINDOWS option is enabled and data of
+ * more input windows is already collected, the input window is shifted
+ * multiple times, so that the newest complete window is processed.
+ *
  * @param[in] window_shift  Number of windows the input window is shifted before
  *                          prediction.
  * @param[in] frame_shift   Number of frames the input window is shifted before
@@ -151,6 +205,18 @@ int ei_wrapper_get_timing(int *dsp_time, int *classification_time,
 			  int *anomaly_time);
 
 
+/** Get input window processing statistics.
+ *
+ * @param[out] stats Pointer to the structure that is used to store
+ *                   the statistics.
+ */
+void ei_wrapper_get_stats(struct ei_wrapper_stats *stats);
+
+
+/** Reset input window processing statistics. */
+void ei_wrapper_reset_stats(void);
+
+
 /** Initialize the Edge Impulse wrapper.
  *
  * @param[in] cb Callback used to receive results.
@@ -209,6 +209,23 @@ struct esb_payload {
 	uint8_t data[CONFIG_ESB_MAX_PAYLOAD_LENGTH]; /**< The payload data. */
 };
 
+/** @brief Reference to a received payload.
+ *
+ *  The payload data stays in the buffer the radio received it into until the
+ *  reference is released with @ref esb_release_rx_payload.
+ */
+struct esb_payload_ref {
+	const uint8_t *data; /**< The payload data. */
+	uint8_t length;      /**< Length of the payload data. */
+	uint8_t pipe;        /**< Pipe used for this payload. */
+	int8_t rssi;         /**< RSSI for the received packet. */
+	uint8_t noack;       /**< Flag indicating that this packet was not
+			      *  acknowledged.
+			      */
+	uint8_t pid;         /**< PID assigned during communication. */
+	uint8_t id;          /**< Receive buffer identifier, used internally. */
+};
+
 /** @brief Enhanced ShockBurst event. */
 struct esb_evt {
 	enum esb_evt_id evt_id;	/**< Enhanced ShockBurst event ID. */
@@ -308,6 +325,34 @@ int esb_write_payload(const struct esb_payload *payload);
  */
 int esb_read_rx_payload(struct esb_payload *payload);
 
+/** @brief Read a payload without copying it.
+ *
+ *  The payload is removed from the RX FIFO, but its buffer is not returned to
+ *  the radio until @ref esb_release_rx_payload is called. While all receive
+ *  buffers are held by the application, incoming packets are not
+ *  acknowledged, so the transmitter retransmits them.
+ *
+ *  @param[out] ref	Reference to the received payload.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int esb_read_rx_payload_ref(struct esb_payload_ref *ref);
+
+/** @brief Release a payload read with @ref esb_read_rx_payload_ref.
+ *
+ *  Each reference must be released exactly once. References are invalidated
+ *  by @ref esb_disable.
+ *
+ *  @param[in] ref	Reference to the payload to release.
+ *
+ * @retval 0 If successful.
+ * @retval -EINVAL If the reference is not held, for example because it was
+ *                 released already.
+ * @retval -EACCES If ESB is not initialized.
+ */
+int esb_release_rx_payload(const struct esb_payload_ref *ref);
+
 /** @brief Start transmitting data.
  *
  * @retval 0 If successful.
@@ -59,6 +59,63 @@ enum execution_status {
 #define AWS_JOBS_TOPIC_MAX_LEN (CONFIG_CLIENT_ID_MAX_LEN + \
 		AWS_JOBS_TOPIC_STATIC_LEN + AWS_JOBS_JOB_ID_MAX_LEN)
 
+/** @brief Length of the topic prefix "$aws/things/<client ID>/jobs/". */
+#define AWS_JOBS_TOPIC_PREFIX_MAX_LEN (AWS_LEN + CONFIG_CLIENT_ID_MAX_LEN + \
+		sizeof("/jobs/") - 1)
+
+/** @brief Types of the AWS IoT Jobs topics that messages are received on. */
+enum aws_jobs_topic_type {
+	AWS_JOBS_TOPIC_UNKNOWN = 0,
+	AWS_JOBS_TOPIC_NOTIFY,
+	AWS_JOBS_TOPIC_NOTIFY_NEXT,
+	/** Get request of the client, received back on its subscription. */
+	AWS_JOBS_TOPIC_GET,
+	AWS_JOBS_TOPIC_GET_ACCEPTED,
+	AWS_JOBS_TOPIC_GET_REJECTED,
+	AWS_JOBS_TOPIC_UPDATE_ACCEPTED,
+	AWS_JOBS_TOPIC_UPDATE_REJECTED,
+};
+
+/** @brief Topics of a client, constructed once for its client ID. */
+struct aws_jobs_topics {
+	/** Prefix shared by all the topics, "$aws/things/<client ID>/jobs/". */
+	char prefix[AWS_JOBS_TOPIC_PREFIX_MAX_LEN + 1];
+	/** Length of the prefix. */
+	size_t prefix_len;
+};
+
+/**
+ * @brief Construct the topics of a client.
+ *
+ * @param[out] topics    Topics to initialize.
+ * @param[in]  client_id Client ID of the MQTT session.
+ *
+ * @retval 0       If successful.
+ * @retval -EINVAL If the provided input parameter is not valid.
+ * @retval -ENOMEM If the client ID is longer than CONFIG_CLIENT_ID_MAX_LEN.
+ */
+int aws_jobs_topics_init(struct aws_jobs_topics *topics, const char *client_id);
+
+/**
+ * @brief Get the type of a topic that a message is received on.
+ *
+ * The topic is classified in a single pass, without comparing it against each
+ * subscribed topic.
+ *
+ * @param[in]  topics     Topics of the client, see aws_jobs_topics_init().
+ * @param[in]  topic      Received topic, does not need to be null-terminated.
+ * @param[in]  topic_len  Length of the received topic.
+ * @param[out] job_id     Job ID in the topic, for the get and update topics.
+ *                        Not null-terminated. Can be NULL.
+ * @param[out] job_id_len Length of the job ID. Can be NULL.
+ *
+ * @return Type of the topic, AWS_JOBS_TOPIC_UNKNOWN if it is not an AWS IoT
+ *         Jobs topic of the client.
+ */
+enum aws_jobs_topic_type aws_jobs_topic_type_get(const struct aws_jobs_topics *topics,
+						 const char *topic, size_t topic_len,
+						 const char **job_id, size_t *job_id_len);
+
 /**
  * @brief Construct the notify-next topic for receiving AWS IoT
  *        jobs.
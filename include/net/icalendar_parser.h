@@ -100,14 +100,47 @@ struct ical_parser_evt {
 typedef int (*icalendar_parser_callback_t)(
 	const struct ical_parser_evt *event);
 
+/** Maximum length of the names of properties and components that are
+ *  parsed.
+ */
+#define ICAL_PARSER_NAME_MAX_LEN 15
+
 /**
  * @brief iCalendar parser instance.
+ *
+ * The parser keeps only the state of the content line that is being parsed
+ * and the component that is being built, so its size does not depend on
+ * the size of the calendar.
  */
 struct icalendar_parser {
-	/** Internal Buffer for parsing incoming data stream */
-	char buf[CONFIG_ICAL_PARSER_BUFFER_SIZE + 1];
-	/** Offset of unparsed data in buf. */
-	size_t offset;
+	/** Component being parsed. */
+	struct ical_parser_evt evt;
+	/** Name of the current content line, or the component name of a
+	 *  BEGIN or END line.
+	 */
+	char name[ICAL_PARSER_NAME_MAX_LEN + 1];
+	/** Length of name. */
+	uint8_t name_len;
+	/** State of the current content line. */
+	uint8_t state;
+	/** Kind of the current content line. */
+	int8_t line;
+	/** Type of the current top-level component, negative if the
+	 *  component is not known.
+	 */
+	int8_t com;
+	/** Nesting depth of components within the iCalendar object. */
+	uint8_t depth;
+	/** Line break seen, the content line ends unless it is folded. */
+	bool eol;
+	/** Inside a quoted property parameter value. */
+	bool quoted;
+	/** The current content line has property parameters. */
+	bool params;
+	/** The current property value does not fit in its buffer. */
+	bool overflow;
+	/** Length of the current property value. */
+	size_t value_len;
 	/** begin of iCalendar object delimiter pair */
 	bool icalobject_begin;
 	/** Event handler. */
@@ -128,11 +161,17 @@ int ical_parser_init(struct icalendar_parser *ical,
 /**
  * @brief Parse the iCalendar data stream. Return the parsed bytes.
  *
+ * The data can be split into fragments at any position. The parser keeps
+ * its state between calls, so the caller does not need to keep any of the
+ * data that has been passed in.
+ *
  * @param[in,out] ical iCalendar parser instance.
  * @param[in] data Input data to be parsed.
  * @param[in] len  Length of input data stream.
  *
- * @retval size_t  Parsed bytes.
+ * @retval size_t  Parsed bytes. This is less than len only if the callback
+ *                 returned non-zero. The remaining data can be passed in
+ *                 again to continue parsing.
  */
 size_t ical_parser_parse(struct icalendar_parser *ical,
 			const char *data, size_t len);
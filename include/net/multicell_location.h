@@ -24,6 +24,20 @@ struct multicell_location {
 	float accuracy;
 };
 
+/* Statistics of the connections to the location service. */
+struct multicell_location_conn_stats {
+	/* Number of connections established, each with a TLS handshake. */
+	uint32_t handshakes;
+	/* Number of requests sent on a connection kept open from an earlier
+	 * request.
+	 */
+	uint32_t reuses;
+	/* Duration of the last TLS handshake, in milliseconds. */
+	uint32_t handshake_time_last;
+	/* Total duration of all TLS handshakes, in milliseconds. */
+	uint32_t handshake_time_total;
+};
+
 /* @brief Send a request for location based on cell measurements to the
  *        selected location service.
  *
@@ -41,6 +55,25 @@ struct multicell_location {
 int multicell_location_get(const struct lte_lc_cells_info *cell_data,
 			   struct multicell_location *location);
 
+/* @brief Remove all cached locations.
+ *
+ * @note Only has effect if CONFIG_MULTICELL_LOCATION_CACHE is enabled.
+ */
+void multicell_location_cache_clear(void);
+
+/* @brief Close the connection to the location service, if it is kept open.
+ *
+ * @note The connection is kept open for CONFIG_MULTICELL_LOCATION_KEEPALIVE_TIME
+ *       seconds after a request, and closed automatically after that.
+ */
+void multicell_location_conn_close(void);
+
+/* @brief Get statistics of the connections to the location service.
+ *
+ * @param stats Storage for the statistics.
+ */
+void multicell_location_conn_stats_get(struct multicell_location_conn_stats *stats);
+
 /* @brief Provision TLS certificate that the selected location service requires
  *	  for HTTPS connections.
  *	  Certificate provisioning must be done before location requests can
@@ -47,6 +47,18 @@ int nrf_cloud_agps_request_all(void);
  */
 int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket);
 
+/**@brief Sets the satellites whose ephemerides are injected first.
+ *
+ * A-GPS data is injected to the modem while it is being parsed. Ephemerides
+ * of the given satellites, for example the ones tracked in the last fix, are
+ * injected before other ephemerides waiting to be injected, which reduces
+ * the time to first fix.
+ *
+ * @param sv_mask Bitmask of satellites, bit 0 is satellite 1. 0 gives all
+ *		  ephemerides the same priority.
+ */
+void nrf_cloud_agps_visible_sv_set(uint32_t sv_mask);
+
 /**@brief Query which A-GPS elements were actually received
  *
  * @param received_elements return copy of requested elements received
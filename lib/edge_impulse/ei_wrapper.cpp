@@ -22,6 +22,7 @@ BUILD_ASSERT(CONFIG_EI_WRAPPER_THREAD_STACK_SIZE > 0);
 #define THREAD_STACK_SIZE	CONFIG_EI_WRAPPER_THREAD_STACK_SIZE
 #define THREAD_PRIORITY 	CONFIG_EI_WRAPPER_THREAD_PRIORITY
 #define DEBUG_MODE		IS_ENABLED(CONFIG_EI_WRAPPER_DEBUG_MODE)
+#define SKIP_LATE_WINDOWS	IS_ENABLED(CONFIG_EI_WRAPPER_SKIP_LATE_WINDOWS)
 
 enum state {
 	STATE_DISABLED,
@@ -31,10 +32,15 @@ enum state {
 };
 
 struct data_buffer {
-	float buf[DATA_BUFFER_SIZE];
+	/* Values stored at the beginning of the buffer are mirrored after its
+	 * end. Thanks to that, every input window is stored contiguously.
+	 */
+	float buf[DATA_BUFFER_SIZE + INPUT_WINDOW_SIZE];
 	size_t process_idx;
 	size_t append_idx;
 	size_t wait_data_size;
+	int64_t process_start;
+	struct ei_wrapper_stats stats;
 	struct k_spinlock lock;
 	enum state state;
 };
@@ -60,17 +66,29 @@ static size_t buf_get_collected_data_count(const struct data_buffer *b)
 		return b->append_idx - b->process_idx;
 	}
 
-	return (ARRAY_SIZE(b->buf) - b->process_idx) + b->append_idx;
+	return (DATA_BUFFER_SIZE - b->process_idx) + b->append_idx;
 }
 
 static size_t buf_calc_free_space(const struct data_buffer *b)
 {
 	if (b->wait_data_size > 0) {
-		return b->wait_data_size + ARRAY_SIZE(b->buf) -
+		return b->wait_data_size + DATA_BUFFER_SIZE -
 		       INPUT_WINDOW_SIZE - 1;
 	}
 
-	return ARRAY_SIZE(b->buf) - buf_get_collected_data_count(b) - 1;
+	return DATA_BUFFER_SIZE - buf_get_collected_data_count(b) - 1;
+}
+
+static void buf_stats_reset(struct data_buffer *b)
+{
+	memset(&b->stats, 0, sizeof(b->stats));
+	b->stats.latency_min = UINT32_MAX;
+}
+
+static void buf_processing_start(struct data_buffer *b)
+{
+	b->state = STATE_PROCESSING;
+	b->process_start = k_uptime_ticks();
 }
 
 static void buf_processing_end(struct data_buffer *b)
@@ -80,6 +98,15 @@ static void buf_processing_end(struct data_buffer *b)
 	__ASSERT_NO_MSG(b->state == STATE_PROCESSING);
 	b->state = STATE_READY;
 
+	uint32_t latency = k_ticks_to_us_floor32(k_uptime_ticks() -
+						 b->process_start);
+	struct ei_wrapper_stats *stats = &b->stats;
+
+	stats->window_cnt++;
+	stats->latency_sum += latency;
+	stats->latency_min = MIN(stats->latency_min, latency);
+	stats->latency_max = MAX(stats->latency_max, latency);
+
 	k_spin_unlock(&b->lock, key);
 }
 
@@ -108,8 +135,20 @@ static int buf_cleanup(struct data_buffer *b, bool *cancelled)
 	return err;
 }
 
-static int buf_append(struct data_buffer *b, const float *data, size_t len,
-		      bool *process_buf)
+static void convert_fixed_data(float *dst, const int32_t *src, size_t len,
+			       float scale)
+{
+	/* No dependencies between iterations, the loop can be vectorized. */
+	for (size_t i = 0; i < len; i++) {
+		dst[i] = (float)src[i] * scale;
+	}
+}
+
+/* Reserve space for len values in the buffer. Index of the first reserved
+ * value is returned using cur_idx.
+ */
+static int buf_reserve(struct data_buffer *b, size_t len, size_t *cur_idx,
+		       bool *process_buf)
 {
 	*process_buf = false;
 
@@ -120,39 +159,86 @@ static int buf_append(struct data_buffer *b, const float *data, size_t len,
 		return -ENOMEM;
 	}
 
-	size_t cur_idx = b->append_idx;
 	size_t new_idx = b->append_idx + len;
-	bool looped = false;
+
+	*cur_idx = b->append_idx;
 
 	if (b->wait_data_size > 0) {
 		if (b->wait_data_size > len) {
 			b->wait_data_size -= len;
 		} else {
 			b->wait_data_size = 0;
-			b->state = STATE_PROCESSING;
+			buf_processing_start(b);
 			*process_buf = true;
 		}
 	}
 
-	if (new_idx >= ARRAY_SIZE(b->buf)) {
-		new_idx -= ARRAY_SIZE(b->buf);
-		looped = true;
+	if (new_idx >= DATA_BUFFER_SIZE) {
+		new_idx -= DATA_BUFFER_SIZE;
 	}
 
 	b->append_idx = new_idx;
 
 	k_spin_unlock(&b->lock, key);
 
-	if (looped) {
-		size_t copy_cnt = ARRAY_SIZE(b->buf) - cur_idx;
+	return 0;
+}
 
-		memcpy(&b->buf[cur_idx], data, copy_cnt * sizeof(b->buf[0]));
-		memcpy(&b->buf[0], data + copy_cnt,
-		      (len - copy_cnt) * sizeof(b->buf[0]));
-	} else {
-		memcpy(&b->buf[cur_idx], data, len * sizeof(b->buf[0]));
+/* Update the mirrored copy of values written to the given buffer part. */
+static void buf_mirror(struct data_buffer *b, size_t idx, size_t len)
+{
+	if (idx < INPUT_WINDOW_SIZE) {
+		size_t mirror_cnt = MIN(len, INPUT_WINDOW_SIZE - idx);
+
+		memcpy(&b->buf[DATA_BUFFER_SIZE + idx], &b->buf[idx],
+		       mirror_cnt * sizeof(b->buf[0]));
+	}
+}
+
+static int buf_append(struct data_buffer *b, const float *data, size_t len,
+		      bool *process_buf)
+{
+	size_t cur_idx;
+	int err = buf_reserve(b, len, &cur_idx, process_buf);
+
+	if (err) {
+		return err;
 	}
 
+	size_t copy_cnt = MIN(len, DATA_BUFFER_SIZE - cur_idx);
+
+	memcpy(&b->buf[cur_idx], data, copy_cnt * sizeof(b->buf[0]));
+	memcpy(&b->buf[0], data + copy_cnt,
+	       (len - copy_cnt) * sizeof(b->buf[0]));
+
+	buf_mirror(b, cur_idx, copy_cnt);
+	buf_mirror(b, 0, len - copy_cnt);
+
+	return 0;
+}
+
+static int buf_append_fixed(struct data_buffer *b, const int32_t *data,
+			    size_t len, uint8_t frac_bits, bool *process_buf)
+{
+	size_t cur_idx;
+	int err = buf_reserve(b, len, &cur_idx, process_buf);
+
+	if (err) {
+		return err;
+	}
+
+	/* Values are converted while copied to the buffer, so no additional
+	 * buffer is needed.
+	 */
+	float scale = 1.0f / (1UL << frac_bits);
+	size_t copy_cnt = MIN(len, DATA_BUFFER_SIZE - cur_idx);
+
+	convert_fixed_data(&b->buf[cur_idx], data, copy_cnt, scale);
+	convert_fixed_data(&b->buf[0], data + copy_cnt, len - copy_cnt, scale);
+
+	buf_mirror(b, cur_idx, copy_cnt);
+	buf_mirror(b, 0, len - copy_cnt);
+
 	return 0;
 }
 
@@ -161,25 +247,14 @@ static void buf_get(const struct data_buffer *b, float *b_res, size_t offset,
 {
 	__ASSERT_NO_MSG((offset + len) <= INPUT_WINDOW_SIZE);
 
-	/* Processing index cannot change while processing is done. */
+	/* Processing index cannot change while processing is done. New data
+	 * is stored outside of the processed window, so the window is stable.
+	 */
 	__ASSERT_NO_MSG(b->state == STATE_PROCESSING);
 
-	size_t read_start = b->process_idx + offset;
-	size_t read_end = read_start + len;
-
-	if ((read_end > ARRAY_SIZE(b->buf)) && (read_start < ARRAY_SIZE(b->buf))) {
-		size_t copy_cnt = ARRAY_SIZE(b->buf) - read_start;
-
-		memcpy(b_res, &b->buf[read_start],
-		       copy_cnt * sizeof(b->buf[0]));
-		memcpy(b_res + copy_cnt, &b->buf[0],
-		       (len - copy_cnt) * sizeof(b->buf[0]));
-	} else {
-		if (read_start >= ARRAY_SIZE(b->buf)) {
-			read_start -= ARRAY_SIZE(b->buf);
-		}
-		memcpy(b_res, &b->buf[read_start], len * sizeof(b->buf[0]));
-	}
+	/* The window is contiguous thanks to the mirrored buffer part. */
+	memcpy(b_res, &b->buf[b->process_idx + offset],
+	       len * sizeof(b->buf[0]));
 }
 
 static int buf_processing_move(struct data_buffer *b, size_t move,
@@ -198,18 +273,33 @@ static int buf_processing_move(struct data_buffer *b, size_t move,
 	}
 
 	size_t max_move = buf_get_collected_data_count(b);
+	size_t processing_end_move = move + INPUT_WINDOW_SIZE;
 
-	b->process_idx += move;
-	if (b->process_idx >= ARRAY_SIZE(b->buf)) {
-		b->process_idx -= ARRAY_SIZE(b->buf);
+	/* The window is late if the data for the following window with the
+	 * same shift was collected before the prediction was started.
+	 */
+	if ((move > 0) && (processing_end_move + move <= max_move)) {
+		if (SKIP_LATE_WINDOWS) {
+			/* Process the newest complete window. */
+			size_t skip_cnt = (max_move - processing_end_move) / move;
+
+			processing_end_move += skip_cnt * move;
+			move += skip_cnt * move;
+			b->stats.skipped_window_cnt += skip_cnt;
+		} else {
+			b->stats.late_window_cnt++;
+		}
 	}
 
-	size_t processing_end_move = move + INPUT_WINDOW_SIZE;
+	b->process_idx += move;
+	if (b->process_idx >= DATA_BUFFER_SIZE) {
+		b->process_idx -= DATA_BUFFER_SIZE;
+	}
 
 	if (processing_end_move > max_move) {
 		b->wait_data_size = processing_end_move - max_move;
 	} else {
-		b->state = STATE_PROCESSING;
+		buf_processing_start(b);
 		*process_buf = true;
 	}
 
@@ -249,6 +339,24 @@ int ei_wrapper_add_data(const float *data, size_t data_size)
 	return err;
 }
 
+int ei_wrapper_add_data_fixed(const int32_t *data, size_t data_size,
+			      uint8_t frac_bits)
+{
+	if ((data_size % INPUT_FRAME_SIZE) || (frac_bits > 31)) {
+		return -EINVAL;
+	}
+
+	bool process_buf;
+	int err = buf_append_fixed(&ei_input, data, data_size, frac_bits,
+				   &process_buf);
+
+	if (!err && process_buf) {
+		k_sem_give(&ei_sem);
+	}
+
+	return err;
+}
+
 int ei_wrapper_clear_data(bool *cancelled)
 {
 	return buf_cleanup(&ei_input, cancelled);
@@ -361,6 +469,24 @@ int ei_wrapper_get_timing(int *dsp_time, int *classification_time,
 	return 0;
 }
 
+void ei_wrapper_get_stats(struct ei_wrapper_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&ei_input.lock);
+
+	*stats = ei_input.stats;
+
+	k_spin_unlock(&ei_input.lock, key);
+}
+
+void ei_wrapper_reset_stats(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&ei_input.lock);
+
+	buf_stats_reset(&ei_input);
+
+	k_spin_unlock(&ei_input.lock, key);
+}
+
 int ei_wrapper_init(ei_wrapper_result_ready_cb cb)
 {
 	if (!cb) {
@@ -380,6 +506,8 @@ int ei_wrapper_init(ei_wrapper_result_ready_cb cb)
 	__ASSERT_NO_MSG(!err);
 	ARG_UNUSED(err);
 
+	buf_stats_reset(&ei_input);
+
 	ei_thread_id = k_thread_create(&thread, thread_stack, THREAD_STACK_SIZE,
 				       (k_thread_entry_t)edge_impulse_thread_fn,
 				       NULL, NULL, NULL,
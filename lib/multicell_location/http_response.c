@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "http_response.h"
+
+#define HEADER_END		"\r\n\r\n"
+/* Last chunk, without trailers, and the end of the chunk before it. */
+#define LAST_CHUNK		"\r\n0\r\n\r\n"
+
+/* Find the value of a header, the name includes the colon. Returns NULL if
+ * the header is not found.
+ */
+static const char *header_value(const char *headers, size_t len,
+				const char *name)
+{
+	size_t name_len = strlen(name);
+	const char *line = headers;
+	const char *end = headers + len;
+
+	while (line < end) {
+		const char *next = strstr(line, "\r\n");
+
+		if ((next == NULL) || (next > end)) {
+			next = end;
+		}
+
+		if (((size_t)(next - line) > name_len) &&
+		    (strncasecmp(line, name, name_len) == 0)) {
+			line += name_len;
+
+			while ((*line == ' ') || (*line == '\t')) {
+				line++;
+			}
+
+			return line;
+		}
+
+		line = next + 2;
+	}
+
+	return NULL;
+}
+
+static bool value_has_token(const char *value, const char *token)
+{
+	size_t token_len = strlen(token);
+
+	for (; (*value != '\r') && (*value != '\0'); value++) {
+		if (strncasecmp(value, token, token_len) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool http_response_complete(const char *buf, size_t len, bool *keep_alive)
+{
+	const char *header_end = strstr(buf, HEADER_END);
+	const char *value;
+	size_t header_len, body_len;
+
+	*keep_alive = false;
+
+	if (header_end == NULL) {
+		return false;
+	}
+
+	header_len = header_end - buf + sizeof(HEADER_END) - 1;
+	body_len = len - header_len;
+
+	/* HTTP/1.0 servers close the connection, unless told otherwise. */
+	if (strncmp(buf, "HTTP/1.1 ", sizeof("HTTP/1.1 ") - 1) == 0) {
+		value = header_value(buf, header_len, "Connection:");
+		*keep_alive = (value == NULL) || !value_has_token(value, "close");
+	}
+
+	value = header_value(buf, header_len, "Content-Length:");
+	if (value != NULL) {
+		return body_len >= strtoul(value, NULL, 10);
+	}
+
+	value = header_value(buf, header_len, "Transfer-Encoding:");
+	if ((value != NULL) && value_has_token(value, "chunked")) {
+		/* The body may consist of only the last chunk. */
+		if (body_len < sizeof(LAST_CHUNK) - 1) {
+			return strcmp(&buf[header_len], &LAST_CHUNK[2]) == 0;
+		}
+
+		return strcmp(&buf[len - sizeof(LAST_CHUNK) + 1], LAST_CHUNK) == 0;
+	}
+
+	/* The response ends when the connection is closed. */
+	*keep_alive = false;
+
+	return false;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef HTTP_RESPONSE_H_
+#define HTTP_RESPONSE_H_
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @brief Check whether a complete HTTP response has been received.
+ *
+ * The end of the response is found from the Content-Length header, or the
+ * last chunk if the chunked transfer encoding is used. Otherwise, the
+ * response ends when the server closes the connection.
+ *
+ * @param buf Null-terminated data received so far.
+ * @param len Length of the data.
+ * @param keep_alive Set to true if the connection can be used for another
+ *		     request once the response is complete.
+ *
+ * @return true if the response is complete, otherwise false.
+ */
+bool http_response_complete(const char *buf, size_t len, bool *keep_alive);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTP_RESPONSE_H_ */
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#if defined(CONFIG_MULTICELL_LOCATION_CACHE_SETTINGS)
+#include <settings/settings.h>
+#include <date_time.h>
+#endif
+
+#include "location_cache.h"
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(multicell_location, CONFIG_MULTICELL_LOCATION_LOG_LEVEL);
+
+struct cell_key {
+	int mcc;
+	int mnc;
+	uint32_t tac;
+	uint32_t id;
+	/* Number of neighbor cells and their fingerprint, which does not depend
+	 * on the order the cells are reported in.
+	 */
+	uint32_t ncells_count;
+	uint32_t ncells_hash;
+};
+
+/* Protects the cache and the request state. */
+static K_MUTEX_DEFINE(state_lock);
+/* Held while a request is in flight. */
+static K_MUTEX_DEFINE(request_lock);
+
+/* The request in flight and the result of the last completed request. */
+static struct {
+	bool active;
+	struct cell_key key;
+	uint32_t seq;
+	uint32_t done_seq;
+	int err;
+	struct multicell_location location;
+} request_state;
+
+static uint32_t ncell_hash(const struct lte_lc_ncell *ncell)
+{
+	/* EARFCN and physical cell ID are unique within 27 bits. The bits are
+	 * mixed, so that the sum of the hashes of several cells does not
+	 * collide for similar cell sets.
+	 */
+	uint32_t hash = (ncell->earfcn << 9) ^ ncell->phys_cell_id;
+
+	hash ^= hash >> 16;
+	hash *= 0x7feb352dU;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bU;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+static void cell_key_get(const struct lte_lc_cells_info *cell_data,
+			 struct cell_key *key)
+{
+	memset(key, 0, sizeof(*key));
+
+	key->mcc = cell_data->current_cell.mcc;
+	key->mnc = cell_data->current_cell.mnc;
+	key->tac = cell_data->current_cell.tac;
+	key->id = cell_data->current_cell.id;
+
+	/* nRF Cloud only uses the serving cell. */
+	if (IS_ENABLED(CONFIG_MULTICELL_LOCATION_SERVICE_NRF_CLOUD) ||
+	    (cell_data->neighbor_cells == NULL)) {
+		return;
+	}
+
+	/* Only the neighbor cells that are used in requests are part of the
+	 * key.
+	 */
+	key->ncells_count = MIN(cell_data->ncells_count,
+				CONFIG_MULTICELL_LOCATION_MAX_NEIGHBORS);
+
+	for (size_t i = 0; i < key->ncells_count; i++) {
+		key->ncells_hash += ncell_hash(&cell_data->neighbor_cells[i]);
+	}
+}
+
+static bool serving_cell_equal(const struct cell_key *a,
+			       const struct cell_key *b)
+{
+	return (a->mcc == b->mcc) && (a->mnc == b->mnc) &&
+	       (a->tac == b->tac) && (a->id == b->id);
+}
+
+static bool cell_key_equal(const struct cell_key *a, const struct cell_key *b)
+{
+	return serving_cell_equal(a, b) &&
+	       (a->ncells_count == b->ncells_count) &&
+	       (a->ncells_hash == b->ncells_hash);
+}
+
+#if defined(CONFIG_MULTICELL_LOCATION_CACHE)
+#define CACHE_MAX_AGE_MS (CONFIG_MULTICELL_LOCATION_CACHE_MAX_AGE * \
+			  (int64_t)MSEC_PER_SEC)
+
+struct cache_entry {
+	struct cell_key key;
+	struct multicell_location location;
+	/* Time the location was received and last used, in milliseconds. */
+	int64_t created;
+	int64_t used;
+	bool valid;
+};
+
+static struct cache_entry cache[CONFIG_MULTICELL_LOCATION_CACHE_SIZE];
+
+static int time_now(int64_t *now)
+{
+#if defined(CONFIG_MULTICELL_LOCATION_CACHE_SETTINGS)
+	/* Stored entries need a time that is valid after a reboot. */
+	return date_time_now(now);
+#else
+	*now = k_uptime_get();
+
+	return 0;
+#endif
+}
+
+#if defined(CONFIG_MULTICELL_LOCATION_CACHE_SETTINGS)
+#define SETTINGS_NAME "mcell_loc"
+#define SETTINGS_KEY_CACHE "cache"
+#define SETTINGS_FULL_CACHE SETTINGS_NAME "/" SETTINGS_KEY_CACHE
+
+static int cache_settings_set(const char *key, size_t len_rd,
+			      settings_read_cb read_cb, void *cb_arg)
+{
+	ssize_t len;
+
+	if (strcmp(key, SETTINGS_KEY_CACHE) != 0) {
+		return -ENOENT;
+	}
+
+	if (len_rd != sizeof(cache)) {
+		LOG_WRN("Stored cache has a different size, ignoring it");
+		return 0;
+	}
+
+	k_mutex_lock(&state_lock, K_FOREVER);
+
+	len = read_cb(cb_arg, cache, sizeof(cache));
+	if (len != sizeof(cache)) {
+		LOG_ERR("Failed to read stored cache: %d", len);
+		memset(cache, 0, sizeof(cache));
+	}
+
+	k_mutex_unlock(&state_lock);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(multicell_location, SETTINGS_NAME, NULL,
+			       cache_settings_set, NULL, NULL);
+
+static void cache_save(void)
+{
+	int err = settings_save_one(SETTINGS_FULL_CACHE, cache, sizeof(cache));
+
+	if (err) {
+		LOG_WRN("Failed to store cache: %d", err);
+	}
+}
+#else
+static void cache_save(void)
+{
+}
+#endif /* CONFIG_MULTICELL_LOCATION_CACHE_SETTINGS */
+
+/* Find the entry for the cells, or if enabled, the newest entry for the
+ * serving cell. Expired entries are removed.
+ */
+static struct cache_entry *cache_find(const struct cell_key *key, int64_t now)
+{
+	struct cache_entry *found = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		struct cache_entry *entry = &cache[i];
+
+		if (!entry->valid) {
+			continue;
+		}
+
+		if ((now - entry->created) > CACHE_MAX_AGE_MS) {
+			entry->valid = false;
+			continue;
+		}
+
+		if (cell_key_equal(&entry->key, key)) {
+			return entry;
+		}
+
+		if (IS_ENABLED(CONFIG_MULTICELL_LOCATION_CACHE_SERVING_CELL) &&
+		    serving_cell_equal(&entry->key, key) &&
+		    ((found == NULL) || (entry->created > found->created))) {
+			found = entry;
+		}
+	}
+
+	return found;
+}
+
+static bool cache_get(const struct cell_key *key,
+		      struct multicell_location *location)
+{
+	struct cache_entry *entry;
+	int64_t now;
+
+	if (time_now(&now)) {
+		return false;
+	}
+
+	entry = cache_find(key, now);
+	if (entry == NULL) {
+		return false;
+	}
+
+	entry->used = now;
+	*location = entry->location;
+
+	LOG_DBG("Location found in cache, age %lld s",
+		(now - entry->created) / MSEC_PER_SEC);
+
+	return true;
+}
+
+static void cache_put(const struct cell_key *key,
+		      const struct multicell_location *location)
+{
+	struct cache_entry *entry = NULL;
+	int64_t now;
+
+	if (time_now(&now)) {
+		LOG_DBG("Time not known, location not cached");
+		return;
+	}
+
+	/* Replace the entry of the same cells, a free entry or the least
+	 * recently used one, in that order.
+	 */
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (cache[i].valid && cell_key_equal(&cache[i].key, key)) {
+			entry = &cache[i];
+			break;
+		}
+
+		if ((entry == NULL) || (entry->valid && !cache[i].valid) ||
+		    (entry->valid && (cache[i].used < entry->used))) {
+			entry = &cache[i];
+		}
+	}
+
+	entry->key = *key;
+	entry->location = *location;
+	entry->created = now;
+	entry->used = now;
+	entry->valid = true;
+
+	cache_save();
+}
+
+void location_cache_clear(void)
+{
+	k_mutex_lock(&state_lock, K_FOREVER);
+	memset(cache, 0, sizeof(cache));
+	cache_save();
+	k_mutex_unlock(&state_lock);
+}
+#else
+static bool cache_get(const struct cell_key *key,
+		      struct multicell_location *location)
+{
+	return false;
+}
+
+static void cache_put(const struct cell_key *key,
+		      const struct multicell_location *location)
+{
+}
+
+void location_cache_clear(void)
+{
+}
+#endif /* CONFIG_MULTICELL_LOCATION_CACHE */
+
+int location_cache_get(const struct lte_lc_cells_info *cell_data,
+		       struct multicell_location *location,
+		       location_cache_request_t request)
+{
+	struct cell_key key;
+	bool joined = false;
+	uint32_t seq = 0;
+	int err;
+
+	cell_key_get(cell_data, &key);
+
+	k_mutex_lock(&state_lock, K_FOREVER);
+
+	if (cache_get(&key, location)) {
+		k_mutex_unlock(&state_lock);
+		return 0;
+	}
+
+	if (request_state.active && cell_key_equal(&request_state.key, &key)) {
+		joined = true;
+		seq = request_state.seq;
+	}
+
+	k_mutex_unlock(&state_lock);
+
+	k_mutex_lock(&request_lock, K_FOREVER);
+	k_mutex_lock(&state_lock, K_FOREVER);
+
+	if (joined && (request_state.done_seq == seq)) {
+		LOG_DBG("Using the result of a concurrent request");
+
+		err = request_state.err;
+		if (err == 0) {
+			*location = request_state.location;
+		}
+
+		goto unlock;
+	}
+
+	/* A concurrent request may have added the location to the cache. */
+	if (cache_get(&key, location)) {
+		err = 0;
+		goto unlock;
+	}
+
+	request_state.active = true;
+	request_state.key = key;
+	seq = ++request_state.seq;
+
+	k_mutex_unlock(&state_lock);
+
+	err = request(cell_data, location);
+
+	k_mutex_lock(&state_lock, K_FOREVER);
+
+	request_state.active = false;
+	request_state.done_seq = seq;
+	request_state.err = err;
+
+	if (err == 0) {
+		request_state.location = *location;
+		cache_put(&key, location);
+	}
+
+unlock:
+	k_mutex_unlock(&state_lock);
+	k_mutex_unlock(&request_lock);
+
+	return err;
+}
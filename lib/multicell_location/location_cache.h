@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LOCATION_CACHE_H_
+#define LOCATION_CACHE_H_
+
+#include <zephyr.h>
+#include <modem/lte_lc.h>
+#include <net/multicell_location.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @brief Function requesting a location from the location service.
+ *
+ * @param cell_data Pointer to neighbor cell data.
+ * @param location Storage for the location.
+ *
+ * @return 0 on success, or negative error code on failure.
+ */
+typedef int (*location_cache_request_t)(const struct lte_lc_cells_info *cell_data,
+					struct multicell_location *location);
+
+/* @brief Get the location for the given cells.
+ *
+ * If CONFIG_MULTICELL_LOCATION_CACHE is enabled, a cached location is
+ * returned if there is one, otherwise a request is made and its result is
+ * cached. The cache is keyed by the serving cell and a fingerprint of the
+ * neighbor cells.
+ *
+ * Only one request is made at a time. A caller asking for the same cells as
+ * the request that is in flight gets the result of that request, instead of
+ * making a new one.
+ *
+ * @param cell_data Pointer to neighbor cell data.
+ * @param location Storage for the location.
+ * @param request Function making a request to the location service.
+ *
+ * @return 0 on success, or negative error code returned by the request.
+ */
+int location_cache_get(const struct lte_lc_cells_info *cell_data,
+		       struct multicell_location *location,
+		       location_cache_request_t request);
+
+/* @brief Remove all locations from the cache. */
+void location_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOCATION_CACHE_H_ */
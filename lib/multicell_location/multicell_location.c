@@ -13,12 +13,18 @@
 #include <net/multicell_location.h>
 
 #include "location_service.h"
+#include "location_cache.h"
+#include "http_response.h"
 
 #include <logging/log.h>
 
 #define TLS_SEC_TAG	CONFIG_MULTICELL_LOCATION_TLS_SEC_TAG
 #define HTTPS_PORT	CONFIG_MULTICELL_LOCATION_HTTPS_PORT
 #define HOSTNAME	CONFIG_MULTICELL_LOCATION_HOSTNAME
+#define KEEPALIVE_TIME	CONFIG_MULTICELL_LOCATION_KEEPALIVE_TIME
+
+/* Delay of the idle connection check while a request is in progress. */
+#define CONN_IDLE_RETRY_TIME_MS	100
 
 LOG_MODULE_REGISTER(multicell_location, CONFIG_MULTICELL_LOCATION_LOG_LEVEL);
 
@@ -28,6 +34,14 @@ BUILD_ASSERT(!IS_ENABLED(CONFIG_MULTICELL_LOCATION_SERVICE_NONE),
 static char http_request[CONFIG_MULTICELL_LOCATION_SEND_BUF_SIZE];
 static char recv_buf[CONFIG_MULTICELL_LOCATION_RECV_BUF_SIZE];
 
+/* Connection to the location service, kept open between requests for
+ * CONFIG_MULTICELL_LOCATION_KEEPALIVE_TIME seconds.
+ */
+static int conn_fd = -1;
+static int64_t conn_last_used;
+static struct multicell_location_conn_stats conn_stats;
+static K_MUTEX_DEFINE(conn_lock);
+
 static int tls_setup(int fd)
 {
 	int err;
@@ -59,13 +73,72 @@ static int tls_setup(int fd)
 		return -errno;
 	}
 
+	if (IS_ENABLED(CONFIG_MULTICELL_LOCATION_TLS_SESSION_CACHE)) {
+		int session_cache = TLS_SESSION_CACHE_ENABLED;
+
+		/* Resume the previous session with an abbreviated handshake */
+		err = setsockopt(fd, SOL_TLS, TLS_SESSION_CACHE, &session_cache,
+				 sizeof(session_cache));
+		if (err) {
+			LOG_ERR("Failed to enable TLS session cache, errno: %d", errno);
+			return -errno;
+		}
+	}
+
 	return 0;
 }
 
-static int execute_http_request(const char *request, size_t request_len)
+static void conn_close(void)
 {
-	int err, fd, bytes;
-	size_t offset = 0;
+	if (conn_fd < 0) {
+		return;
+	}
+
+	LOG_DBG("Closing socket");
+
+	(void)close(conn_fd);
+	conn_fd = -1;
+}
+
+static void conn_idle_work_fn(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	int64_t idle_time;
+
+	/* Do not block the system workqueue for the duration of a request,
+	 * check the connection again later.
+	 */
+	if (k_mutex_lock(&conn_lock, K_NO_WAIT)) {
+		k_work_reschedule(dwork, K_MSEC(CONN_IDLE_RETRY_TIME_MS));
+		return;
+	}
+
+	if (conn_fd < 0) {
+		goto unlock;
+	}
+
+	/* The connection may have been used after the work was submitted. */
+	idle_time = k_uptime_get() - conn_last_used;
+
+	if (idle_time >= (KEEPALIVE_TIME * MSEC_PER_SEC)) {
+		LOG_DBG("Connection idle");
+		conn_close();
+	} else {
+		k_work_reschedule(dwork,
+				  K_MSEC(KEEPALIVE_TIME * MSEC_PER_SEC - idle_time));
+	}
+
+unlock:
+	k_mutex_unlock(&conn_lock);
+}
+
+static K_WORK_DELAYABLE_DEFINE(conn_idle_work, conn_idle_work_fn);
+
+static int conn_open(void)
+{
+	int err, fd;
+	int64_t start;
+	uint32_t handshake_time;
 	struct addrinfo *res;
 	struct addrinfo hints = {
 		.ai_family = AF_INET,
@@ -135,6 +208,9 @@ static int execute_http_request(const char *request, size_t request_len)
 		}
 	}
 
+	/* The TLS handshake is done as part of connect(). */
+	start = k_uptime_get();
+
 	err = connect(fd, res->ai_addr, sizeof(struct sockaddr_in));
 	if (err) {
 		LOG_ERR("connect() failed, errno: %d", errno);
@@ -142,12 +218,42 @@ static int execute_http_request(const char *request, size_t request_len)
 		goto clean_up;
 	}
 
+	handshake_time = k_uptime_get() - start;
+
+	conn_stats.handshakes++;
+	conn_stats.handshake_time_last = handshake_time;
+	conn_stats.handshake_time_total += handshake_time;
+
+	LOG_DBG("Connected in %d ms", handshake_time);
+
+	conn_fd = fd;
+
+clean_up:
+	freeaddrinfo(res);
+
+	if (err && (fd != -1)) {
+		(void)close(fd);
+	}
+
+	return err;
+}
+
+static int conn_exchange(const char *request, size_t request_len,
+			 size_t *received, bool *keep_alive)
+{
+	int err = 0;
+	int bytes;
+	size_t offset = 0;
+	bool complete = false;
+
+	*received = 0;
+	*keep_alive = false;
+
 	do {
-		bytes = send(fd, &request[offset], request_len - offset, 0);
+		bytes = send(conn_fd, &request[offset], request_len - offset, 0);
 		if (bytes < 0) {
 			LOG_ERR("send() failed, errno: %d", errno);
-			err = -errno;
-			goto clean_up;
+			return -errno;
 		}
 
 		offset += bytes;
@@ -158,7 +264,7 @@ static int execute_http_request(const char *request, size_t request_len)
 	offset = 0;
 
 	do {
-		bytes = recv(fd, &recv_buf[offset], sizeof(recv_buf) - offset - 1, 0);
+		bytes = recv(conn_fd, &recv_buf[offset], sizeof(recv_buf) - offset - 1, 0);
 		if (bytes < 0) {
 			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ETIMEDOUT)) {
 				LOG_WRN("Receive timeout, possibly incomplete data received");
@@ -175,16 +281,25 @@ static int execute_http_request(const char *request, size_t request_len)
 
 			LOG_ERR("recv() failed, errno: %d", errno);
 
-			err = -errno;
-			goto clean_up;
+			return -errno;
 		} else {
 			LOG_DBG("Received HTTP response chunk of %d bytes", bytes);
 		}
 
 		offset += bytes;
-	} while (bytes != 0);
+		recv_buf[offset] = '\0';
+
+		/* Stop when the response is complete, instead of waiting for the
+		 * server to close the connection.
+		 */
+		complete = http_response_complete(recv_buf, offset, keep_alive);
+	} while ((bytes != 0) && !complete && (offset < sizeof(recv_buf) - 1));
+
+	if (!complete) {
+		*keep_alive = false;
+	}
 
-	recv_buf[offset] = '\0';
+	*received = offset;
 
 	LOG_DBG("Received %d bytes", offset);
 
@@ -192,35 +307,68 @@ static int execute_http_request(const char *request, size_t request_len)
 		LOG_DBG("HTTP response:\n%s\n", log_strdup(recv_buf));
 	}
 
-	LOG_DBG("Closing socket");
-
-	/* Propagate timeout information */
-	if (err != -ETIMEDOUT) {
-		err = 0;
-	}
-
-clean_up:
-	freeaddrinfo(res);
-	(void)close(fd);
-
 	return err;
 }
 
-int multicell_location_get(const struct lte_lc_cells_info *cell_data,
-			   struct multicell_location *location)
+static int execute_http_request(const char *request, size_t request_len)
 {
 	int err;
+	bool reused, keep_alive;
+	size_t received;
 
-	if ((cell_data == NULL) || (location == NULL)) {
-		return -EINVAL;
+	k_mutex_lock(&conn_lock, K_FOREVER);
+
+	(void)k_work_cancel_delayable(&conn_idle_work);
+
+	reused = (conn_fd >= 0);
+	if (!reused) {
+		err = conn_open();
+		if (err) {
+			goto unlock;
+		}
 	}
 
-	if (cell_data->ncells_count > CONFIG_MULTICELL_LOCATION_MAX_NEIGHBORS) {
-		LOG_WRN("Found %d neighbor cells, but %d cells will be used in location request",
-			cell_data->ncells_count, CONFIG_MULTICELL_LOCATION_MAX_NEIGHBORS);
-		LOG_WRN("Increase CONFIG_MULTICELL_LOCATION_MAX_NEIGHBORS to use more cells");
+	err = conn_exchange(request, request_len, &received, &keep_alive);
+
+	/* The server or the network may have dropped the connection while it
+	 * was idle.
+	 */
+	if (reused && (received == 0)) {
+		LOG_DBG("Connection closed by server, reconnecting");
+
+		conn_close();
+
+		err = conn_open();
+		if (err) {
+			goto unlock;
+		}
+
+		reused = false;
+		err = conn_exchange(request, request_len, &received, &keep_alive);
 	}
 
+	if (reused) {
+		conn_stats.reuses++;
+	}
+
+	if (err || !keep_alive || (KEEPALIVE_TIME == 0)) {
+		conn_close();
+	} else {
+		conn_last_used = k_uptime_get();
+		k_work_reschedule(&conn_idle_work, K_SECONDS(KEEPALIVE_TIME));
+	}
+
+unlock:
+	k_mutex_unlock(&conn_lock);
+
+	return err;
+}
+
+static int location_request(const struct lte_lc_cells_info *cell_data,
+			    struct multicell_location *location)
+{
+	int err;
+
 	err = location_service_generate_request(cell_data, http_request,
 						sizeof(http_request));
 	if (err) {
@@ -247,6 +395,43 @@ int multicell_location_get(const struct lte_lc_cells_info *cell_data,
 	return 0;
 }
 
+int multicell_location_get(const struct lte_lc_cells_info *cell_data,
+			   struct multicell_location *location)
+{
+	if ((cell_data == NULL) || (location == NULL)) {
+		return -EINVAL;
+	}
+
+	if (cell_data->ncells_count > CONFIG_MULTICELL_LOCATION_MAX_NEIGHBORS) {
+		LOG_WRN("Found %d neighbor cells, but %d cells will be used in location request",
+			cell_data->ncells_count, CONFIG_MULTICELL_LOCATION_MAX_NEIGHBORS);
+		LOG_WRN("Increase CONFIG_MULTICELL_LOCATION_MAX_NEIGHBORS to use more cells");
+	}
+
+	/* Requests are serialized, the buffers are shared. */
+	return location_cache_get(cell_data, location, location_request);
+}
+
+void multicell_location_cache_clear(void)
+{
+	location_cache_clear();
+}
+
+void multicell_location_conn_close(void)
+{
+	k_mutex_lock(&conn_lock, K_FOREVER);
+	(void)k_work_cancel_delayable(&conn_idle_work);
+	conn_close();
+	k_mutex_unlock(&conn_lock);
+}
+
+void multicell_location_conn_stats_get(struct multicell_location_conn_stats *stats)
+{
+	k_mutex_lock(&conn_lock, K_FOREVER);
+	*stats = conn_stats;
+	k_mutex_unlock(&conn_lock);
+}
+
 int multicell_location_provision_certificate(bool overwrite)
 {
 	int err;
@@ -259,6 +444,9 @@ int multicell_location_provision_certificate(bool overwrite)
 		return -EFAULT;
 	}
 
+	/* A connection can not be used after the modem has been offline. */
+	multicell_location_conn_close();
+
 	err = modem_key_mgmt_exists(TLS_SEC_TAG,
 				    MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN,
 				    &exists, &unused);
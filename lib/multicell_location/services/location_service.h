@@ -15,6 +15,13 @@
 extern "C" {
 #endif
 
+/* Connection header of HTTP requests. */
+#if CONFIG_MULTICELL_LOCATION_KEEPALIVE_TIME > 0
+#define HTTP_CONNECTION_HEADER "Connection: keep-alive\r\n"
+#else
+#define HTTP_CONNECTION_HEADER "Connection: close\r\n"
+#endif
+
 /* @brief Generate an HTTPS request in the format the location service expects.
  *
  * @param cell_data Pointer to neighbor cell data.
@@ -26,6 +26,12 @@ OPT_DESCR_MODULE_VARIANT = 'module_variant'
 POLL_INTERVAL_DEFAULT = 0.02
 POLL_RETRY_COUNT = 200
 
+# Pipelined frames have the flag set in the data length field. The first data
+# byte holds the sequence number.
+TRANSPORT_SEQ_FLAG = 0x80
+PIPELINED_EVENT_DATA_LEN_MAX = EVENT_DATA_LEN_MAX - 1
+PIPELINE_POLL_INTERVAL = 0.001
+
 END_OF_TRANSFER_CHAR = '\n'
 
 
@@ -115,6 +121,105 @@ class NrfHidTransport():
 
         return (rcpt, event_id, status, event_data)
 
+    @staticmethod
+    def _create_pipelined_report(recipient, event_id, seq, event_data):
+        assert isinstance(event_data, bytes)
+        assert len(event_data) <= PIPELINED_EVENT_DATA_LEN_MAX
+
+        report = struct.pack(NrfHidTransport.HEADER_FORMAT + 'B', REPORT_ID,
+                             recipient, event_id, ConfigStatus.SET,
+                             TRANSPORT_SEQ_FLAG | len(event_data), seq)
+        report += event_data
+        report += b'\0' * (REPORT_SIZE - len(report))
+
+        return report
+
+    @staticmethod
+    def _parse_pipeline_response(response_raw):
+        fmt = NrfHidTransport.HEADER_FORMAT + 'BB'
+
+        if len(response_raw) < struct.calcsize(fmt):
+            logging.error('Response too short')
+            return None
+
+        (report_id, _, _, status, data_len, ack_seq, free) = \
+            struct.unpack(fmt, response_raw[:struct.calcsize(fmt)])
+
+        if report_id != REPORT_ID:
+            logging.error('Improper report ID')
+            return None
+
+        if not (data_len & TRANSPORT_SEQ_FLAG):
+            logging.error('Response is not pipelined')
+            return None
+
+        try:
+            status = ConfigStatus(status)
+        except ValueError:
+            status = ConfigStatus.FAULT
+
+        return (status, ack_seq, free)
+
+    @staticmethod
+    def exchange_pipelined_reports(dev, recipient, event_id, values, seq,
+                                   poll_interval=PIPELINE_POLL_INTERVAL):
+        # Send set requests without waiting for each response. The device
+        # reports the sequence number of the last handled request and the
+        # number of free slots in its queue.
+        in_flight = []
+        window = 1
+        idx = 0
+        retry = 0
+
+        while (idx < len(values)) or in_flight:
+            while (idx < len(values)) and (len(in_flight) < window):
+                report = NrfHidTransport._create_pipelined_report(recipient, event_id,
+                                                                  seq, values[idx])
+                try:
+                    dev.send_feature_report(report)
+                except Exception as e:
+                    logging.debug('Send feature report problem: {}'.format(e))
+                    return False, idx, seq
+
+                in_flight.append(seq)
+                seq = (seq + 1) & 0xff
+                idx += 1
+
+            time.sleep(poll_interval)
+
+            try:
+                response_raw = dev.get_feature_report(REPORT_ID, REPORT_SIZE)
+            except Exception as e:
+                logging.error('Get feature report problem: {}'.format(e))
+                return False, idx, seq
+
+            rsp = NrfHidTransport._parse_pipeline_response(response_raw)
+            if rsp is None:
+                return False, idx, seq
+
+            (status, ack_seq, free) = rsp
+
+            acked = 0
+            while in_flight and (((ack_seq - in_flight[0]) & 0xff) < 0x80):
+                in_flight.pop(0)
+                acked += 1
+
+            if status not in (ConfigStatus.SUCCESS, ConfigStatus.PENDING):
+                logging.warning('Error response code: {}'.format(status.name))
+                return False, idx, seq
+
+            if acked > 0:
+                retry = 0
+            else:
+                retry += 1
+                if retry > POLL_RETRY_COUNT:
+                    logging.warning('Pipelined requests timed out')
+                    return False, idx, seq
+
+            window = len(in_flight) + free
+
+        return True, idx, seq
+
     @staticmethod
     def exchange_feature_report(dev, recipient, event_id, status, event_data,
                                 poll_interval=POLL_INTERVAL_DEFAULT):
@@ -182,6 +287,10 @@ class NrfHidDevice():
         self.board_name = None
         self.hwid = None
 
+        # Pipelined transport support is checked on first use.
+        self.pipeline_supported = None
+        self.seq = 0
+
         board_name, hwid = NrfHidDevice._read_device_info(dev, recipient)
 
         if (board_name is not None) and (hwid is not None):
@@ -492,3 +601,44 @@ class NrfHidDevice():
 
     def config_set(self, module_name, option_name, value, poll_interval=POLL_INTERVAL_DEFAULT):
         return self._config_operation(module_name, option_name, False, value, poll_interval)
+
+    def config_set_pipelined(self, module_name, option_name, values,
+                             poll_interval=PIPELINE_POLL_INTERVAL):
+        # Set the option to the values in order, keeping several requests
+        # in flight. Falls back to regular requests if the device does not
+        # support the pipelined transport.
+        if not self.initialized():
+            print("Device not found")
+            return False
+
+        try:
+            event_id = NrfHidDevice._get_event_id(module_name, option_name, self.dev_config)
+        except KeyError:
+            print("No module: {} or option: {}".format(module_name, option_name))
+            return False
+
+        if len(values) == 0:
+            return True
+
+        if self.pipeline_supported is not False:
+            if any(len(v) > PIPELINED_EVENT_DATA_LEN_MAX for v in values):
+                logging.debug('Data too long for pipelined request')
+            else:
+                success, sent, self.seq = NrfHidTransport.exchange_pipelined_reports(self.dev_ptr,
+                                                                                     self.recipient,
+                                                                                     event_id, values,
+                                                                                     self.seq,
+                                                                                     poll_interval)
+                if (not success) and (sent == 0) and (self.pipeline_supported is None):
+                    # Device rejected the first pipelined frame.
+                    logging.debug('Pipelined transport not supported')
+                    self.pipeline_supported = False
+                else:
+                    self.pipeline_supported = True
+                    return success
+
+        for v in values:
+            if not self.config_set(module_name, option_name, v, poll_interval):
+                return False
+
+        return True
@@ -15,6 +15,7 @@ from modules.config import change_config, fetch_config
 from modules.dfu import DfuImage
 from modules.dfu import fwinfo, fwreboot, dfu_transfer
 from modules.led_stream import send_continuous_led_stream
+from modules.benchmark import run_benchmark
 try:
     from modules.music_led_stream import send_music_led_stream
 except ImportError as e:
@@ -78,7 +79,7 @@ def perform_dfu(dev, args):
             print('Improper user input. Operation terminated.')
             return
 
-    success = dfu_transfer(dev, img_file_bin, progress_bar)
+    success = dfu_transfer(dev, img_file_bin, progress_bar, args.fast)
 
     if success:
         success = fwreboot(dev)
@@ -156,6 +157,13 @@ def perform_led_stream(dev, args):
         send_continuous_led_stream(dev, args.led_id, args.freq)
 
 
+def perform_benchmark(args):
+    success = run_benchmark(args.ops, args.dfu_size)
+
+    if not success:
+        print('Benchmark failed')
+
+
 def parse_arguments():
     parser = argparse.ArgumentParser()
 
@@ -174,10 +182,20 @@ def parse_arguments():
     parser_dfu.add_argument('--autoconfirm',
                             help='Automatically confirm user input',
                             action='store_true')
+    parser_dfu.add_argument('--fast',
+                            help='Send image data while device stores previous data',
+                            action='store_true')
 
     sp_commands.add_parser('fwinfo', help='Obtain information about FW image')
     sp_commands.add_parser('fwreboot', help='Request FW reboot')
 
+    parser_benchmark = sp_commands.add_parser('benchmark',
+                                              help='Measure config channel throughput on simulated device')
+    parser_benchmark.add_argument('--ops', type=int, default=200,
+                                  help='Number of set operations')
+    parser_benchmark.add_argument('--dfu_size', type=int, default=16384,
+                                  help='Size of simulated DFU image (in bytes)')
+
     parser_stream = sp_commands.add_parser('led_stream',
                                     help='Send continuous LED effects stream')
     parser_stream.add_argument('led_id', type=int, help='Stream LED ID')
@@ -223,6 +241,12 @@ def configurator():
     logging.info('Configuration channel for nRF52 Desktop')
 
     args = parse_arguments()
+
+    if args.command == 'benchmark':
+        # Benchmark does not use a real device.
+        perform_benchmark(args)
+        return
+
     backend = NrfHidManager()
 
     if args.device is None:
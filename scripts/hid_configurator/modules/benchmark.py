@@ -0,0 +1,294 @@
+#
+# Copyright (c) 2021 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+import os
+import struct
+import tempfile
+import time
+import zlib
+
+from NrfHidDevice import NrfHidDevice, ConfigStatus
+from NrfHidDevice import REPORT_ID, REPORT_SIZE, LOCAL_RECIPIENT
+from NrfHidDevice import MOD_FIELD_POS, TRANSPORT_SEQ_FLAG
+from modules.dfu import dfu_transfer
+
+# Timing of the simulated device. Every feature report transfer takes one USB
+# frame and the device handles a request within the given time.
+REPORT_TRANSFER_TIME = 0.001
+REQUEST_HANDLE_TIME = 0.0005
+FLASH_WRITE_SPEED = 50000 # bytes per second
+
+PIPELINE_DEPTH = 4
+DFU_SYNC_BUFFER_SIZE = 1024
+
+DFU_STATE_INACTIVE = 0x00
+DFU_STATE_ACTIVE = 0x01
+DFU_STATE_STORING = 0x02
+
+BENCHMARK_LED_STEP = b'\x10\x20\x30\x0a\x00\x0a\x00\x00'
+
+
+class SimulatedDfu:
+    def __init__(self):
+        self.active = False
+        self.img_length = 0
+        self.img_csum = 0
+        self.offset = 0
+        self.crc = 1
+        self.rx_buf = b''
+        self.store_len = 0
+        self.store_done_time = None
+
+    def update(self, now):
+        if (self.store_done_time is not None) and (now >= self.store_done_time):
+            self.offset += self.store_len
+            self.store_len = 0
+            self.store_done_time = None
+
+            if self.offset == self.img_length:
+                if self.crc != self.img_csum:
+                    self.offset = 0
+                self.active = False
+
+    def start(self, data):
+        length, csum, offset = struct.unpack('<III', data[:12])
+
+        if self.active:
+            return
+
+        if offset == 0:
+            self.img_length = length
+            self.img_csum = csum
+            self.offset = 0
+            self.crc = 1
+        elif (offset != self.offset) or (length != self.img_length) or (csum != self.img_csum):
+            return
+
+        self.rx_buf = b''
+        self.active = True
+
+    def data(self, data):
+        if not self.active:
+            return
+
+        data = data[:DFU_SYNC_BUFFER_SIZE - len(self.rx_buf)]
+        self.rx_buf += data
+        self.crc = zlib.crc32(data, self.crc)
+
+    def sync(self, now):
+        storing = (self.store_done_time is not None) or (len(self.rx_buf) > 0)
+
+        if (len(self.rx_buf) > 0) and (self.store_done_time is None):
+            self.store_len = len(self.rx_buf)
+            self.store_done_time = now + self.store_len / FLASH_WRITE_SPEED
+            self.rx_buf = b''
+
+        if storing:
+            state = DFU_STATE_STORING
+        elif self.active:
+            state = DFU_STATE_ACTIVE
+        else:
+            state = DFU_STATE_INACTIVE
+
+        return struct.pack('<BIIIH', state, self.img_length, self.img_csum,
+                           self.offset, DFU_SYNC_BUFFER_SIZE)
+
+
+class SimulatedDevice:
+    # Simulates nRF Desktop device with the configuration channel transport.
+    # The object can be used instead of the HID device by NrfHidDevice.
+    MODULES = (
+        ('dfu', ('start', 'data', 'sync', 'reboot', 'fwinfo', 'sync_fast')),
+        ('led_stream', ('set_led_effect', 'get_leds_state')),
+    )
+
+    def __init__(self):
+        self.dfu = SimulatedDfu()
+        self.descr_idx = [0] * len(SimulatedDevice.MODULES)
+        self.queue = []
+        self.busy_until = 0
+        self.ack_seq = 0
+        self.error = None
+        self.pipelined = False
+        self.response = self._frame(0, 0, ConfigStatus.PENDING, b'')
+
+    @staticmethod
+    def _frame(recipient, event_id, status, data, data_len=None):
+        if data_len is None:
+            data_len = len(data)
+
+        frame = struct.pack('<BBBBB', REPORT_ID, recipient, event_id, status, data_len) + data
+        return frame + b'\0' * (REPORT_SIZE - len(frame))
+
+    def _handle(self, event_id, status, data, now):
+        module_id = event_id >> MOD_FIELD_POS
+        option_id = event_id & ((1 << MOD_FIELD_POS) - 1)
+
+        if status == ConfigStatus.GET_BOARD_NAME:
+            return b'simulated'
+        if status == ConfigStatus.GET_HWID:
+            return bytes(range(8))
+        if status == ConfigStatus.GET_MAX_MOD_ID:
+            return bytes([len(SimulatedDevice.MODULES) - 1])
+
+        if module_id >= len(SimulatedDevice.MODULES):
+            return None
+
+        module_name, options = SimulatedDevice.MODULES[module_id]
+
+        if option_id == 0:
+            # Module description: name, options and end of transfer character.
+            descr = (module_name,) + options + ('\n',)
+            idx = self.descr_idx[module_id]
+            self.descr_idx[module_id] = (idx + 1) % len(descr)
+            return descr[idx].encode('utf-8')
+
+        option = options[option_id - 1]
+
+        self.dfu.update(now)
+
+        if option == 'start':
+            self.dfu.start(data)
+        elif option == 'data':
+            self.dfu.data(data)
+        elif option in ('sync', 'sync_fast'):
+            return self.dfu.sync(now)
+        elif option == 'get_leds_state':
+            return b'\x01\x10'
+
+        return b''
+
+    def _update(self, now):
+        # Complete the queued requests that were handled until now.
+        while self.queue and (self.busy_until <= now):
+            seq, event_id, data = self.queue.pop(0)
+            self._handle(event_id, ConfigStatus.SET, data, self.busy_until)
+            self.ack_seq = seq
+
+            if self.queue:
+                self.busy_until += REQUEST_HANDLE_TIME
+
+    def send_feature_report(self, report):
+        time.sleep(REPORT_TRANSFER_TIME)
+        now = time.monotonic()
+        self._update(now)
+
+        _, recipient, event_id, status, data_len = struct.unpack('<BBBBB', report[:5])
+
+        if data_len & TRANSPORT_SEQ_FLAG:
+            if (status != ConfigStatus.SET) or (len(self.queue) >= PIPELINE_DEPTH):
+                raise IOError('Request rejected')
+
+            seq = report[5]
+            data = report[6:6 + (data_len & ~TRANSPORT_SEQ_FLAG)]
+            if not self.queue:
+                self.ack_seq = (seq - 1) & 0xff
+                self.busy_until = now + REQUEST_HANDLE_TIME
+
+            self.queue.append((seq, event_id, data))
+            self.pipelined = True
+            return len(report)
+
+        if self.queue:
+            raise IOError('Transport busy')
+
+        self.pipelined = False
+        data = report[5:5 + data_len]
+        rsp_data = self._handle(event_id, status, data, now)
+
+        if rsp_data is None:
+            rsp_status = ConfigStatus.DISCONNECTED
+            rsp_data = b''
+        else:
+            rsp_status = ConfigStatus.SUCCESS
+
+        self.busy_until = now + REQUEST_HANDLE_TIME
+        self.response = SimulatedDevice._frame(recipient, event_id, rsp_status, rsp_data)
+
+        return len(report)
+
+    def get_feature_report(self, report_id, size):
+        time.sleep(REPORT_TRANSFER_TIME)
+        now = time.monotonic()
+        self._update(now)
+
+        if self.pipelined:
+            status = ConfigStatus.PENDING if self.queue else ConfigStatus.SUCCESS
+            return SimulatedDevice._frame(0, 0, status,
+                                          bytes([self.ack_seq, PIPELINE_DEPTH - len(self.queue)]),
+                                          TRANSPORT_SEQ_FLAG | 2)
+
+        if now < self.busy_until:
+            return SimulatedDevice._frame(0, 0, ConfigStatus.PENDING, b'')
+
+        return self.response
+
+    def close(self):
+        pass
+
+
+def _measure_ops(dev, ops, pipelined):
+    start = time.monotonic()
+
+    if pipelined:
+        success = dev.config_set_pipelined('led_stream', 'set_led_effect',
+                                           [BENCHMARK_LED_STEP] * ops)
+    else:
+        success = True
+        for _ in range(ops):
+            success = dev.config_set('led_stream', 'set_led_effect',
+                                     BENCHMARK_LED_STEP, poll_interval=0.001)
+            if not success:
+                break
+
+    duration = time.monotonic() - start
+
+    return success, ops / duration
+
+
+def _measure_dfu(img_path, img_length, fast):
+    dev = NrfHidDevice(SimulatedDevice(), LOCAL_RECIPIENT)
+
+    start = time.monotonic()
+    success = dfu_transfer(dev, img_path, lambda permil: None, fast)
+    duration = time.monotonic() - start
+
+    return success, img_length / duration / 1000
+
+
+def run_benchmark(ops, dfu_size):
+    # Compare regular and pipelined config channel transport on a simulated
+    # device. Transfer times of the simulated device are defined above.
+    dev = NrfHidDevice(SimulatedDevice(), LOCAL_RECIPIENT)
+    if not dev.initialized():
+        print('Cannot initialize simulated device')
+        return False
+
+    results = []
+
+    success, rate = _measure_ops(dev, ops, False)
+    results.append(('Set operations, regular', success, '{:.1f} ops/s'.format(rate)))
+
+    success, rate = _measure_ops(dev, ops, True)
+    results.append(('Set operations, pipelined', success, '{:.1f} ops/s'.format(rate)))
+
+    img_file = tempfile.NamedTemporaryFile(delete=False)
+    try:
+        img_file.write(os.urandom(dfu_size))
+        img_file.close()
+
+        success, rate = _measure_dfu(img_file.name, dfu_size, False)
+        results.append(('DFU, regular', success, '{:.2f} kB/s'.format(rate)))
+
+        success, rate = _measure_dfu(img_file.name, dfu_size, True)
+        results.append(('DFU, fast', success, '{:.2f} kB/s'.format(rate)))
+    finally:
+        os.unlink(img_file.name)
+
+    print('Benchmark results (simulated device):')
+    for name, success, result in results:
+        print('  {:<28} {}'.format(name, result if success else 'failed'))
+
+    return all(r[1] for r in results)
@@ -14,11 +14,17 @@ from zipfile import ZipFile
 import tempfile
 import json
 
-from NrfHidDevice import EVENT_DATA_LEN_MAX
+from NrfHidDevice import EVENT_DATA_LEN_MAX, PIPELINED_EVENT_DATA_LEN_MAX
 import imgtool.image
 
 DFU_SYNC_INTERVAL = 1
 
+# In the fast transfer mode, the device stores the data while the next chunks
+# are sent using pipelined requests. Responses are polled more often to reduce
+# round-trip time.
+DFU_FAST_SYNC_INTERVAL = 0.01
+DFU_FAST_POLL_INTERVAL = 0.005
+
 
 class DFUInfo:
     _DFU_STATE_INACTIVE = 0x00
@@ -375,8 +381,20 @@ def fwreboot(dev):
     return success, rebooted
 
 
-def dfu_sync(dev):
-    success, fetched_data = dev.config_get('dfu', 'sync')
+def is_fast_transfer_supported(dev):
+    dev_config = dev.get_device_config()
+    if dev_config is None:
+        return False
+
+    return 'sync_fast' in dev_config.get('dfu', [])
+
+
+def dfu_sync(dev, fast=False):
+    if fast:
+        success, fetched_data = dev.config_get('dfu', 'sync_fast',
+                                               poll_interval=DFU_FAST_POLL_INTERVAL)
+    else:
+        success, fetched_data = dev.config_get('dfu', 'sync')
 
     if success and fetched_data:
         dfu_info = DFUInfo(fetched_data)
@@ -421,14 +439,19 @@ def file_crc(dfu_image):
     return crc32
 
 
-def dfu_sync_wait_until_inactive(dev):
+def dfu_sync_wait_until_inactive(dev, fast=False):
     state_shown = False
 
     while True:
-        dfu_info = dfu_sync(dev)
+        dfu_info = dfu_sync(dev, fast)
         if dfu_info is None:
             break
 
+        if fast and dfu_info.is_cleaning():
+            # Device supporting fast transfer erases the update slot ahead
+            # of the received data.
+            break
+
         if dfu_info.is_cleaning() and not state_shown:
             print('Waiting for device to clean update slot')
             state_shown = True
@@ -437,23 +460,27 @@ def dfu_sync_wait_until_inactive(dev):
             # DFU may be transiting its state. This can happen when previous
             # interrupted DFU operation is timing out. Sleep to allow it
             # to settle the state.
-            time.sleep(DFU_SYNC_INTERVAL)
+            time.sleep(DFU_FAST_SYNC_INTERVAL if fast else DFU_SYNC_INTERVAL)
         else:
             break
 
     return dfu_info
 
 
-def dfu_transfer(dev, dfu_image, progress_callback):
+def dfu_transfer(dev, dfu_image, progress_callback, fast=False):
     img_length = os.stat(dfu_image).st_size
     img_csum = file_crc(dfu_image)
     if not img_csum:
         return False
 
+    if fast and not is_fast_transfer_supported(dev):
+        print('Device does not support fast transfer, using regular transfer')
+        fast = False
+
     while True:
-        dfu_info = dfu_sync_wait_until_inactive(dev)
+        dfu_info = dfu_sync_wait_until_inactive(dev, fast)
 
-        if is_dfu_operation_pending(dfu_info):
+        if is_dfu_operation_pending(dfu_info, fast):
             return False
 
         offset = get_dfu_operation_offset(dfu_image, dfu_info, img_csum)
@@ -470,8 +497,12 @@ def dfu_transfer(dev, dfu_image, progress_callback):
     img_file = open(dfu_image, 'rb')
     img_file.seek(offset)
 
+    start_offset = offset
+    start_time = time.monotonic()
+
     try:
-        success, offset = send_chunks(dev, img_csum, img_file, img_length, offset, dfu_info.get_sync_buffer_size(), progress_callback)
+        success, offset = send_chunks(dev, img_csum, img_file, img_length, offset,
+                                      dfu_info.get_sync_buffer_size(), progress_callback, fast)
     except Exception:
         success = False
 
@@ -481,7 +512,13 @@ def dfu_transfer(dev, dfu_image, progress_callback):
     if success:
         success = False
 
-        dfu_info = dfu_sync_wait_until_inactive(dev)
+        dfu_info = dfu_sync_wait_until_inactive(dev, fast)
+
+        duration = time.monotonic() - start_time
+        if duration > 0:
+            print('Transferred {} bytes in {:.2f} s ({:.2f} kB/s)'.format(offset - start_offset,
+                                                                        duration,
+                                                                        (offset - start_offset) / duration / 1000))
 
         if dfu_info is None:
             print('Lost communication with the device')
@@ -496,14 +533,14 @@ def dfu_transfer(dev, dfu_image, progress_callback):
     return success
 
 
-def send_chunks(dev, img_csum, img_file, img_length, offset, sync_buffer_size, progress_callback):
-    def dfu_checkpoint(img_csum, img_length, offset):
+def send_chunks(dev, img_csum, img_file, img_length, offset, sync_buffer_size, progress_callback, fast=False):
+    def dfu_checkpoint(img_csum, img_length, offset, prev_checkpoint):
         # Sync DFU state at regular intervals to ensure everything
         # is all right.
         store_retry = 0
-        sleep_time = 0.3
+        sleep_time = DFU_FAST_SYNC_INTERVAL if fast else 0.3
         while True:
-            dfu_info = dfu_sync(dev)
+            dfu_info = dfu_sync(dev, fast)
             if dfu_info is None:
                 print('Lost communication with the device')
                 return False
@@ -513,6 +550,10 @@ def send_chunks(dev, img_csum, img_file, img_length, offset, sync_buffer_size, p
             if (not dfu_info.is_busy()) and (dfu_info.get_offset() != img_length):
                 print('DFU interrupted by device')
                 return False
+            if fast and dfu_info.is_storing() and (dfu_info.get_offset() == prev_checkpoint):
+                # Device stores the data sent since the previous checkpoint,
+                # next chunks can be sent.
+                return True
             if dfu_info.is_storing():
                 # DFU store in progress - retry
                 store_retry += 1
@@ -525,6 +566,7 @@ def send_chunks(dev, img_csum, img_file, img_length, offset, sync_buffer_size, p
                 return False
             return True
 
+    prev_checkpoint = offset
     next_checkpoint = offset + sync_buffer_size
     if next_checkpoint > img_length: next_checkpoint = img_length
 
@@ -532,18 +574,36 @@ def send_chunks(dev, img_csum, img_file, img_length, offset, sync_buffer_size, p
         # Set current progress
         progress_callback(int(offset / img_length * 1000))
 
-        # Read data from the file
-        chunk_len = EVENT_DATA_LEN_MAX
-        if next_checkpoint - offset < chunk_len:
-            chunk_len = next_checkpoint - offset
-        chunk_data = img_file.read(chunk_len)
-        chunk_len = len(chunk_data)
-        if chunk_len == 0:
-            break
+        if fast:
+            # Send data up to the checkpoint using pipelined requests
+            chunks = []
+            chunk_len = 0
+            while offset + chunk_len < next_checkpoint:
+                chunk_data = img_file.read(min(PIPELINED_EVENT_DATA_LEN_MAX,
+                                               next_checkpoint - offset - chunk_len))
+                if len(chunk_data) == 0:
+                    break
+                chunks.append(chunk_data)
+                chunk_len += len(chunk_data)
+            if chunk_len == 0:
+                break
+
+            logging.debug('Send DFU requests: offset {}, size {}'.format(offset, chunk_len))
+            success = dev.config_set_pipelined('dfu', 'data', chunks)
+        else:
+            # Read data from the file
+            chunk_len = EVENT_DATA_LEN_MAX
+            if next_checkpoint - offset < chunk_len:
+                chunk_len = next_checkpoint - offset
+            chunk_data = img_file.read(chunk_len)
+            chunk_len = len(chunk_data)
+            if chunk_len == 0:
+                break
+
+            # Send data to the device
+            logging.debug('Send DFU request: offset {}, size {}'.format(offset, chunk_len))
+            success = dev.config_set('dfu', 'data', chunk_data)
 
-        # Send data to the device
-        logging.debug('Send DFU request: offset {}, size {}'.format(offset, chunk_len))
-        success = dev.config_set('dfu', 'data', chunk_data)
         if not success:
             print('Lost communication with the device')
             break
@@ -551,8 +611,9 @@ def send_chunks(dev, img_csum, img_file, img_length, offset, sync_buffer_size, p
         # Progress checkpoint
         offset += chunk_len
         if offset >= next_checkpoint:
-            success = dfu_checkpoint(img_csum, img_length, offset)
+            success = dfu_checkpoint(img_csum, img_length, offset, prev_checkpoint)
             if not success: break
+            prev_checkpoint = offset
             next_checkpoint += sync_buffer_size
             if next_checkpoint > img_length: next_checkpoint = img_length
 
@@ -575,12 +636,15 @@ def get_dfu_operation_offset(dfu_image, dfu_info, img_csum):
     return offset
 
 
-def is_dfu_operation_pending(dfu_info):
+def is_dfu_operation_pending(dfu_info, fast=False):
     # Check there is no other DFU operation.
     if dfu_info is None:
         print('Cannot start DFU, device not responding')
         return True
 
+    if fast and dfu_info.is_cleaning():
+        return False
+
     if dfu_info.is_busy():
         print('Cannot start DFU. DFU in progress or memory is not clean.')
         print('Please stop ongoing DFU and wait until device cleans memory.')
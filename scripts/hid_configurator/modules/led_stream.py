@@ -5,12 +5,16 @@
 
 import struct
 import random
+import time
 
 from NrfHidDevice import EVENT_DATA_LEN_MAX
 
 LED_STREAM_DATA = 0x0
 MS_PER_SEC = 1000
 
+KEYFRAMES_PER_FRAME = 3
+KEYFRAME_TIMESTAMP_MASK = 0xffff
+
 
 class Step:
     def __init__(self, r, g, b, substep_count, substep_time):
@@ -26,6 +30,16 @@ class Step:
         self.b = random.randint(0, 255)
 
 
+class Keyframe:
+    def __init__(self, r, g, b, brightness, timestamp):
+        # Timestamp in milliseconds, on the timeline of the keyframe stream.
+        self.r = r
+        self.g = g
+        self.b = b
+        self.brightness = brightness
+        self.timestamp = timestamp
+
+
 def validate_params(freq, led_id):
     valid_params = False
 
@@ -39,17 +53,85 @@ def validate_params(freq, led_id):
     return valid_params
 
 
-def led_send_single_step(dev, step, led_id):
+def led_step_pack(step, led_id):
     # Chosen data layout for struct is defined using format string.
-    event_data = struct.pack('<BBBHHB', step.r, step.g, step.b,
-                             step.substep_count, step.substep_time, led_id)
+    return struct.pack('<BBBHHB', step.r, step.g, step.b,
+                       step.substep_count, step.substep_time, led_id)
 
-    success = dev.config_set('led_stream', 'set_led_effect', event_data,
-                             poll_interval=0.001)
+
+def led_send_single_step(dev, step, led_id):
+    success = dev.config_set('led_stream', 'set_led_effect',
+                             led_step_pack(step, led_id), poll_interval=0.001)
 
     return success
 
 
+def led_send_steps(dev, steps, led_id):
+    # Steps are sent as pipelined requests, without waiting for each response.
+    values = [led_step_pack(step, led_id) for step in steps]
+
+    return dev.config_set_pipelined('led_stream', 'set_led_effect', values)
+
+
+def is_keyframe_stream_supported(dev):
+    dev_config = dev.get_device_config()
+    if dev_config is None:
+        return False
+
+    return 'set_keyframes' in dev_config.get('led_stream', [])
+
+
+def led_keyframes_pack(keyframes, led_id):
+    # Chosen data layout for struct is defined using format string.
+    data = struct.pack('<B', led_id)
+    for kf in keyframes:
+        data += struct.pack('<BBBBH', kf.r, kf.g, kf.b, kf.brightness,
+                            kf.timestamp & KEYFRAME_TIMESTAMP_MASK)
+
+    return data
+
+
+def led_send_keyframes(dev, keyframes, led_id):
+    # Keyframes are grouped in frames. Device interpolates the color between
+    # subsequent keyframes, so a single frame replaces many LED effect steps.
+    values = []
+    for i in range(0, len(keyframes), KEYFRAMES_PER_FRAME):
+        values.append(led_keyframes_pack(keyframes[i:i + KEYFRAMES_PER_FRAME],
+                                         led_id))
+
+    return dev.config_set_pipelined('led_stream', 'set_keyframes', values)
+
+
+def fetch_free_keyframes_info(dev, led_id):
+    success, fetched_data = dev.config_get('led_stream', 'get_keyframes_state',
+                                           poll_interval=0.001)
+
+    if (not success) or (fetched_data is None):
+        return False, (None, None, None)
+
+    # Chosen data layout for struct is defined using format string.
+    fmt_header = '?H'
+    fmt_single_led = 'B'
+    led_cnt = len(fetched_data) - struct.calcsize('<' + fmt_header)
+
+    if led_cnt <= 0:
+        return False, (None, None, None)
+
+    fmt = '<' + fmt_header + fmt_single_led * led_cnt
+
+    assert struct.calcsize(fmt) <= EVENT_DATA_LEN_MAX
+
+    data_unpacked = struct.unpack(fmt, fetched_data)
+
+    if led_id >= led_cnt:
+        print('Unsupported LED ID')
+        return False, (None, None, None)
+
+    ready, start_delay = data_unpacked[:2]
+
+    return success, (ready, start_delay / MS_PER_SEC, data_unpacked[led_id + 2])
+
+
 def fetch_free_steps_buffer_info(dev, led_id):
     success, fetched_data = dev.config_get('led_stream', 'get_leds_state',
                                            poll_interval=0.001)
@@ -78,10 +160,56 @@ def fetch_free_steps_buffer_info(dev, led_id):
     return success, (data_unpacked[0], data_unpacked[led_id + 1])
 
 
+def send_continuous_keyframe_stream(dev, led_id, freq):
+    period = MS_PER_SEC // freq
+    timestamp = 0
+
+    # LED stream ends on user request (Ctrl+C) or when an error occurrs.
+    print('LED keyframe stream started, press Ctrl+C to interrupt')
+    while True:
+        success, (ready, _, free) = fetch_free_keyframes_info(dev, led_id)
+
+        if not success:
+            break
+
+        if not ready:
+            print('LEDs are not ready')
+            break
+
+        # Only whole frames are sent. Device drops a frame that does not fit
+        # in its keyframe queue.
+        free -= free % KEYFRAMES_PER_FRAME
+        if free == 0:
+            time.sleep(period / MS_PER_SEC)
+            continue
+
+        keyframes = []
+        for _ in range(free):
+            timestamp += period
+            keyframes.append(Keyframe(random.randint(0, 255),
+                                      random.randint(0, 255),
+                                      random.randint(0, 255),
+                                      255, timestamp))
+
+        if not led_send_keyframes(dev, keyframes, led_id):
+            break
+
+
 def send_continuous_led_stream(dev, led_id, freq, substep_cnt = 10):
     if not validate_params(freq, led_id):
         return
 
+    if is_keyframe_stream_supported(dev):
+        try:
+            send_continuous_keyframe_stream(dev, led_id, freq)
+        except Exception as e:
+            print(e)
+        except KeyboardInterrupt as e:
+            pass
+
+        print('LED stream ended')
+        return
+
     try:
         # LED stream ends on user request (Ctrl+C) or when an error occurrs.
         step = Step(
@@ -103,16 +231,15 @@ def send_continuous_led_stream(dev, led_id, freq, substep_cnt = 10):
                 print('LEDs are not ready')
                 break
 
-            while free > 0:
-                # Send steps with random color and predefined duration
+            # Send steps with random color and predefined duration
+            steps = []
+            for _ in range(free):
                 step.generate_random_color()
+                steps.append(Step(step.r, step.g, step.b, step.substep_count,
+                                  step.substep_time))
 
-                success = led_send_single_step(dev, step, led_id)
-
-                if not success:
-                    break
-
-                free -= 1
+            if not led_send_steps(dev, steps, led_id):
+                break
     except Exception as e:
         print(e)
     except KeyboardInterrupt as e:
@@ -15,6 +15,9 @@ from modules.led_stream import MS_PER_SEC
 from modules.led_stream import Step
 from modules.led_stream import validate_params
 from modules.led_stream import fetch_free_steps_buffer_info, led_send_single_step
+from modules.led_stream import Keyframe, KEYFRAMES_PER_FRAME
+from modules.led_stream import is_keyframe_stream_supported
+from modules.led_stream import fetch_free_keyframes_info, led_send_keyframes
 
 
 class MusicLedStream():
@@ -22,7 +25,14 @@ class MusicLedStream():
         if not validate_params(freq, led_id):
             raise ValueError("Invalid music LED stream parameters")
 
-        success, (ready, free) = fetch_free_steps_buffer_info(dev, led_id)
+        self.keyframes = is_keyframe_stream_supported(dev)
+
+        if self.keyframes:
+            success, (ready, start_delay, free) = fetch_free_keyframes_info(dev, led_id)
+        else:
+            success, (ready, free) = fetch_free_steps_buffer_info(dev, led_id)
+            start_delay = None
+
         if not success:
             raise Exception("Device communication problem occurred")
 
@@ -36,6 +46,7 @@ class MusicLedStream():
 
         self.dev_params = {
             'max_free' : free,
+            'start_delay' : start_delay,
             'dev' : dev,
             'led_id' : led_id,
         }
@@ -171,6 +182,89 @@ class MusicLedStream():
 
             self.led_effects['duration_increment'] *= self.led_effects['BASE_DURATION']
 
+    def wait_for_free_keyframes(self, cnt, deadline):
+        while time.time() < deadline:
+            success, (ready, _, free) = fetch_free_keyframes_info(self.dev_params['dev'],
+                                                                 self.dev_params['led_id'])
+
+            if not success or not ready:
+                if not ready:
+                    print("LEDs are not ready")
+                else:
+                    print("Device communication problem")
+                return False
+
+            if free >= cnt:
+                return True
+
+            time.sleep(self.led_effects['BASE_DURATION'] / KEYFRAMES_PER_FRAME)
+
+        # Frame would be displayed too late, device drops it.
+        return True
+
+    def send_led_keyframes(self):
+        # Every audio buffer is described by a keyframe displayed when the
+        # buffer is played by the speaker. Device interpolates the color
+        # between keyframes, so the keyframes are sent in frames and the
+        # device buffer does not have to be monitored after every step.
+        keyframes = []
+        buf_idx = 0
+        timeline_origin = None
+
+        while True:
+            data = self.queue.get()
+
+            if data is None:
+                # LED stream ended
+                return
+
+            while self.led_effects['start_time'] is None:
+                time.sleep(0.001)
+
+            data = np.frombuffer(data, dtype=np.int16)
+            display_time = self.led_effects['start_time'] + \
+                           self.led_effects['out_latency'] + \
+                           buf_idx * self.led_effects['BASE_DURATION']
+            buf_idx += 1
+
+            if timeline_origin is None:
+                # Device displays the first keyframe after a start delay.
+                # If the speaker latency is longer, postpone sending it.
+                # Otherwise, LEDs stay behind the music by the difference.
+                wait = display_time - self.dev_params['start_delay'] - time.time()
+                if wait > 0:
+                    time.sleep(wait)
+                timeline_origin = display_time
+
+            r, g, b = MusicLedStream.gen_led_color(data)
+            peak = min(1, np.abs(np.int32(np.max(data)) - np.min(data)) / np.iinfo(np.int16).max)
+
+            keyframes.append(Keyframe(
+                r = int(r * 255),
+                g = int(g * 255),
+                b = int(b * 255),
+                brightness = int(64 + peak * 191),
+                timestamp = int((display_time - timeline_origin) * MS_PER_SEC)
+            ))
+
+            # The first keyframe is sent alone to start the stream.
+            if (self.led_effects['sent_cnt'] > 0) and \
+               (len(keyframes) < KEYFRAMES_PER_FRAME):
+                continue
+
+            if not self.wait_for_free_keyframes(len(keyframes), display_time):
+                self.send_error_event.set()
+                return
+
+            if not led_send_keyframes(self.dev_params['dev'], keyframes,
+                                      self.dev_params['led_id']):
+                print("Device communication problem")
+                self.send_error_event.set()
+                return
+
+            self.led_effects['sent_cnt'] += len(keyframes)
+            keyframes = []
+
     def music_callback(self, in_data, frame_count, time_info, status):
         if status == pyaudio.paOutputUnderflow:
             print("Underflow occurred. Please lower the stream frequency.")
@@ -198,7 +292,10 @@ class MusicLedStream():
     def stream_start(self):
         try:
             print("Music LED stream started. Press Ctrl+C to interrupt.")
-            self.thread = threading.Thread(target=self.send_led_effects)
+            if self.keyframes:
+                self.thread = threading.Thread(target=self.send_led_keyframes)
+            else:
+                self.thread = threading.Thread(target=self.send_led_effects)
             self.thread.start()
 
             self.stream.start_stream()
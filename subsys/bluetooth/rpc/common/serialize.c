@@ -4,13 +4,19 @@
  * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
  */
 
+#include <zephyr.h>
 #include <nrf_rpc_cbor.h>
+#include <tinycbor/cbor_buf_reader.h>
 
 #include "cbkproxy.h"
 #include "serialize.h"
 
 #define ENCODER_FLAGS_INVALID 0x7FFFFFFF
 
+#if defined(CONFIG_BT_RPC_SCRATCHPAD_POOL)
+K_HEAP_DEFINE(scratchpad_pool, CONFIG_BT_RPC_SCRATCHPAD_POOL_SIZE);
+#endif
+
 static inline bool is_decoder_invalid(CborValue *value)
 {
 	return !value->parser;
@@ -457,6 +463,62 @@ error_exit:
 	return NULL;
 }
 
+const void *ser_decode_buffer_ptr(CborValue *value, size_t *size)
+{
+	CborError err = CborErrorIllegalType;
+	struct cbor_buf_reader *reader;
+	const void *result;
+	size_t len;
+
+	if (is_decoder_invalid(value)) {
+		return NULL;
+	}
+
+	if (cbor_value_is_byte_string(value)) {
+		/* Chunked strings are not contiguous in the packet. */
+		if (!cbor_value_is_length_known(value)) {
+			err = CborErrorUnknownLength;
+			goto error_exit;
+		}
+
+		err = cbor_value_get_string_length(value, &len);
+		if (err != CborNoError) {
+			goto error_exit;
+		}
+
+		err = cbor_value_advance(value);
+		if (err != CborNoError) {
+			goto error_exit;
+		}
+
+		/* nRF RPC decodes packets from a contiguous buffer, so the
+		 * string data ends right before the next value.
+		 */
+		reader = CONTAINER_OF(value->parser->d, struct cbor_buf_reader, r);
+		result = &reader->buffer[value->offset - len];
+	} else if (cbor_value_is_null(value)) {
+		err = cbor_value_advance_fixed(value);
+		if (err != CborNoError) {
+			goto error_exit;
+		}
+
+		len = 0;
+		result = NULL;
+	} else {
+		goto error_exit;
+	}
+
+	if (size) {
+		*size = len;
+	}
+
+	return result;
+
+error_exit:
+	ser_decoder_invalid(value, err);
+	return NULL;
+}
+
 void *ser_decode_buffer_into_scratchpad(struct ser_scratchpad *scratchpad)
 {
 	CborValue *value = scratchpad->value;
@@ -561,6 +623,41 @@ error_exit:
 	return NULL;
 }
 
+void *ser_scratchpad_alloc(CborValue *value, size_t size)
+{
+#if defined(CONFIG_BT_RPC_SCRATCHPAD_POOL)
+	void *data;
+
+	if (size == 0) {
+		return NULL;
+	}
+
+	data = k_heap_alloc(&scratchpad_pool, SCRATCHPAD_ALIGN(size), K_NO_WAIT);
+	if (!data) {
+		ser_decoder_invalid(value, CborErrorOutOfMemory);
+	}
+
+	return data;
+#else
+	ARG_UNUSED(size);
+
+	ser_decoder_invalid(value, CborErrorOutOfMemory);
+	return NULL;
+#endif /* defined(CONFIG_BT_RPC_SCRATCHPAD_POOL) */
+}
+
+void ser_scratchpad_free(void **data)
+{
+#if defined(CONFIG_BT_RPC_SCRATCHPAD_POOL)
+	if (*data) {
+		k_heap_free(&scratchpad_pool, *data);
+		*data = NULL;
+	}
+#else
+	ARG_UNUSED(data);
+#endif /* defined(CONFIG_BT_RPC_SCRATCHPAD_POOL) */
+}
+
 bool ser_decoding_done_and_check(CborValue *value)
 {
 	nrf_rpc_cbor_decoding_done(value);
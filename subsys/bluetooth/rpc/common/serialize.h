@@ -27,6 +27,29 @@
  */
 #define SCRATCHPAD_ALIGN(size) WB_UP(size)
 
+#if defined(CONFIG_BT_RPC_SCRATCHPAD_POOL)
+
+/** @brief Alloc the scratchpad. Scratchpad is used to store a data when decoding serialized data.
+ *
+ *  The scratchpad data is allocated from the shared scratchpad pool and it is
+ *  released automatically when the scratchpad goes out of scope. If the pool is
+ *  exhausted, the decoder is put into an invalid state.
+ *
+ *  @param[in] _scratchpad Scratchpad name.
+ *  @param[in] _value Cbor value to decode. One unsigned integer will be decoded
+ *                    from this value that contains scratchpad buffer size.
+ */
+#define SER_SCRATCHPAD_DECLARE(_scratchpad, _value)                                               \
+	(_scratchpad)->value = _value;                                                          \
+	uint32_t _scratchpad_size = ser_decode_uint(_value);                                    \
+	void *_scratchpad_data __attribute__((__cleanup__(ser_scratchpad_free))) =              \
+		ser_scratchpad_alloc(_value, _scratchpad_size);                                 \
+	net_buf_simple_init_with_data(&(_scratchpad)->buf, _scratchpad_data,                    \
+				      _scratchpad_data ? _scratchpad_size : 0);                 \
+	net_buf_simple_reset(&(_scratchpad)->buf)
+
+#else
+
 /** @brief Alloc the scratchpad. Scratchpad is used to store a data when decoding serialized data.
  *
  *  @param[in] _scratchpad Scratchpad name.
@@ -40,6 +63,8 @@
 	net_buf_simple_init_with_data(&(_scratchpad)->buf, _scratchpad_data, _scratchpad_size); \
 	net_buf_simple_reset(&(_scratchpad)->buf)
 
+#endif /* defined(CONFIG_BT_RPC_SCRATCHPAD_POOL) */
+
 
 /** @brief Scratchpad structure. */
 struct ser_scratchpad {
@@ -60,9 +85,32 @@ struct ser_scratchpad {
  */
 static inline void *ser_scratchpad_add(struct ser_scratchpad *scratchpad, size_t size)
 {
+	if (net_buf_simple_tailroom(&scratchpad->buf) < SCRATCHPAD_ALIGN(size)) {
+		return NULL;
+	}
+
 	return net_buf_simple_add(&scratchpad->buf, SCRATCHPAD_ALIGN(size));
 }
 
+/** @brief Allocate the scratchpad data from the scratchpad pool.
+ *
+ * Use @ref SER_SCRATCHPAD_DECLARE instead of calling this function directly.
+ *
+ * @param[in] value Value parsed from the CBOR stream. It is put into an invalid
+ *                  state if the allocation fails.
+ * @param[in] size Scratchpad size.
+ *
+ * @retval Pointer to the scratchpad data or NULL if the size is 0 or the pool
+ *         is exhausted.
+ */
+void *ser_scratchpad_alloc(CborValue *value, size_t size);
+
+/** @brief Release the scratchpad data allocated with @ref ser_scratchpad_alloc.
+ *
+ * @param[in] data Pointer to the variable holding the scratchpad data pointer.
+ */
+void ser_scratchpad_free(void **data);
+
 /** @brief Encode a null value.
  *
  * @param[in, out] encoder Structure used to encode CBOR stream.
@@ -250,6 +298,21 @@ void *ser_decode_buffer(CborValue *value, void *buffer, size_t buffer_size);
  */
 size_t ser_decode_buffer_size(CborValue *value);
 
+/** @brief Decode a buffer without copying it.
+ *
+ * The returned pointer references the buffer data directly in the received
+ * packet. It is valid only until the packet is released with
+ * nrf_rpc_cbor_decoding_done() or @ref ser_decoding_done_and_check, so
+ * decoding must be checked with @ref ser_decode_valid before it is used.
+ *
+ * @param[in]  value Value parsed from the CBOR stream.
+ * @param[out] size Decoded buffer size. Can be NULL.
+ *
+ * @retval Pointer to the buffer data in the received packet or NULL if
+ *         a null value was decoded.
+ */
+const void *ser_decode_buffer_ptr(CborValue *value, size_t *size);
+
 /** @brief Decode buffer into a scratchpad.
  *
  * @param[in] scratchpad Pointer to the scratchpad.
@@ -292,6 +355,15 @@ void *ser_decode_callback_call(CborValue *value);
  */
 void ser_decoder_invalid(CborValue *value, CborError err);
 
+/** @brief Check if the decoder is still in a valid state. This function will not consume the value.
+ *
+ * @param[in] value Value parsed from the CBOR stream.
+ *
+ * @retval True if no decoding error occurred so far.
+ *         Otherwise, false will be returned.
+ */
+bool ser_decode_valid(CborValue *value);
+
 /** @brief Signalize that decoding is done. Use this function when you finish decoding of the
  *         received serialized packet.
  *
@@ -342,7 +342,12 @@ void bt_data_dec(struct ser_scratchpad *scratchpad, struct bt_data *data)
 
 	data->type = ser_decode_uint(value);
 	data->data_len = ser_decode_uint(value);
-	data->data = ser_decode_buffer_into_scratchpad(scratchpad);
+
+	if (IS_ENABLED(CONFIG_BT_RPC_ZERO_COPY_DECODE)) {
+		data->data = ser_decode_buffer_ptr(value, NULL);
+	} else {
+		data->data = ser_decode_buffer_into_scratchpad(scratchpad);
+	}
 }
 
 void bt_le_scan_param_dec(CborValue *value, struct bt_le_scan_param *data)
@@ -451,12 +456,24 @@ static void bt_le_adv_start_rpc_handler(CborValue *value, void *handler_data)
 		bt_data_dec(&scratchpad, &sd[i]);
 	}
 
-	if (!ser_decoding_done_and_check(value)) {
+	/* Zero-copy advertising data points into the received packet, so the
+	 * packet is released only after the call.
+	 */
+	if (IS_ENABLED(CONFIG_BT_RPC_ZERO_COPY_DECODE)) {
+		if (!ser_decode_valid(value)) {
+			nrf_rpc_cbor_decoding_done(value);
+			goto decoding_error;
+		}
+	} else if (!ser_decoding_done_and_check(value)) {
 		goto decoding_error;
 	}
 
 	result = bt_le_adv_start(&param, ad, ad_len, sd, sd_len);
 
+	if (IS_ENABLED(CONFIG_BT_RPC_ZERO_COPY_DECODE)) {
+		nrf_rpc_cbor_decoding_done(value);
+	}
+
 	ser_rsp_send_int(result);
 
 	return;
@@ -497,12 +514,24 @@ static void bt_le_adv_update_data_rpc_handler(CborValue *value, void *handler_da
 		bt_data_dec(&scratchpad, &sd[i]);
 	}
 
-	if (!ser_decoding_done_and_check(value)) {
+	/* Zero-copy advertising data points into the received packet, so the
+	 * packet is released only after the call.
+	 */
+	if (IS_ENABLED(CONFIG_BT_RPC_ZERO_COPY_DECODE)) {
+		if (!ser_decode_valid(value)) {
+			nrf_rpc_cbor_decoding_done(value);
+			goto decoding_error;
+		}
+	} else if (!ser_decoding_done_and_check(value)) {
 		goto decoding_error;
 	}
 
 	result = bt_le_adv_update_data(ad, ad_len, sd, sd_len);
 
+	if (IS_ENABLED(CONFIG_BT_RPC_ZERO_COPY_DECODE)) {
+		nrf_rpc_cbor_decoding_done(value);
+	}
+
 	ser_rsp_send_int(result);
 
 	return;
@@ -808,7 +837,7 @@ static void bt_le_ext_adv_set_data_rpc_handler(CborValue *value, void *handler_d
 	}
 
 	for (size_t i = 0; i < ad_len; i++) {
-		bt_data_dec(&scratchpad, &ad[_]);
+		bt_data_dec(&scratchpad, &ad[i]);
 	}
 
 	sd_len = ser_decode_uint(value);
@@ -821,12 +850,24 @@ static void bt_le_ext_adv_set_data_rpc_handler(CborValue *value, void *handler_d
 		bt_data_dec(&scratchpad, &sd[i]);
 	}
 
-	if (!ser_decoding_done_and_check(value)) {
+	/* Zero-copy advertising data points into the received packet, so the
+	 * packet is released only after the call.
+	 */
+	if (IS_ENABLED(CONFIG_BT_RPC_ZERO_COPY_DECODE)) {
+		if (!ser_decode_valid(value)) {
+			nrf_rpc_cbor_decoding_done(value);
+			goto decoding_error;
+		}
+	} else if (!ser_decoding_done_and_check(value)) {
 		goto decoding_error;
 	}
 
 	result = bt_le_ext_adv_set_data(adv, ad, ad_len, sd, sd_len);
 
+	if (IS_ENABLED(CONFIG_BT_RPC_ZERO_COPY_DECODE)) {
+		nrf_rpc_cbor_decoding_done(value);
+	}
+
 	ser_rsp_send_int(result);
 
 	return;
@@ -1452,12 +1493,24 @@ static void bt_le_per_adv_set_data_rpc_handler(CborValue *value, void *handler_d
 		bt_data_dec(&scratchpad, &ad[i]);
 	}
 
-	if (!ser_decoding_done_and_check(value)) {
+	/* Zero-copy advertising data points into the received packet, so the
+	 * packet is released only after the call.
+	 */
+	if (IS_ENABLED(CONFIG_BT_RPC_ZERO_COPY_DECODE)) {
+		if (!ser_decode_valid(value)) {
+			nrf_rpc_cbor_decoding_done(value);
+			goto decoding_error;
+		}
+	} else if (!ser_decoding_done_and_check(value)) {
 		goto decoding_error;
 	}
 
 	result = bt_le_per_adv_set_data(adv, ad, ad_len);
 
+	if (IS_ENABLED(CONFIG_BT_RPC_ZERO_COPY_DECODE)) {
+		nrf_rpc_cbor_decoding_done(value);
+	}
+
 	ser_rsp_send_int(result);
 
 	return;
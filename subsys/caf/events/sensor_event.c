@@ -38,6 +38,34 @@ EVENT_TYPE_DEFINE(sensor_event,
 		  &sensor_event_info);
 
 
+static int log_sensor_batch_event(const struct event_header *eh, char *buf, size_t buf_len)
+{
+	const struct sensor_batch_event *event = cast_sensor_batch_event(eh);
+
+	return snprintf(buf, buf_len, "%s samples:%u dropped:%u",
+			event->descr, event->sample_cnt, event->dropped_cnt);
+}
+
+static void profile_sensor_batch_event(struct log_event_buf *buf,
+				       const struct event_header *eh)
+{
+	const struct sensor_batch_event *event = cast_sensor_batch_event(eh);
+
+	profiler_log_encode_u32(buf, event->sample_cnt);
+	profiler_log_encode_u32(buf, event->dropped_cnt);
+}
+
+EVENT_INFO_DEFINE(sensor_batch_event,
+		  ENCODE(PROFILER_ARG_U16, PROFILER_ARG_U16),
+		  ENCODE("sample_cnt", "dropped_cnt"),
+		  profile_sensor_batch_event);
+
+EVENT_TYPE_DEFINE(sensor_batch_event,
+		  IS_ENABLED(CONFIG_CAF_INIT_LOG_SENSOR_EVENTS),
+		  log_sensor_batch_event,
+		  &sensor_batch_event_info);
+
+
 static int log_sensor_state_event(const struct event_header *eh, char *buf, size_t buf_len)
 {
 	const struct sensor_state_event *event = cast_sensor_state_event(eh);
@@ -23,15 +23,26 @@
 #define MODULE buttons
 #include <caf/events/module_state_event.h>
 
+#include "buttons_scan.h"
+
 #include <logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_CAF_BUTTONS_LOG_LEVEL);
 
 #define SCAN_INTERVAL CONFIG_CAF_BUTTONS_SCAN_INTERVAL
 #define DEBOUNCE_INTERVAL CONFIG_CAF_BUTTONS_DEBOUNCE_INTERVAL
 
+#ifdef CONFIG_CAF_BUTTONS_LATENCY_STATS
+  #define LATENCY_STATS_EVENTS CONFIG_CAF_BUTTONS_LATENCY_STATS_EVENTS
+#else
+  #define LATENCY_STATS_EVENTS 0
+#endif
+
 /* For directly connected GPIO, scan rows once. */
 #define COLUMNS MAX(ARRAY_SIZE(col), 1)
 
+BUILD_ASSERT(ARRAY_SIZE(row) <= BUTTONS_SCAN_ROWS_MAX);
+BUILD_ASSERT(ARRAY_SIZE(port_map) <= 32);
+
 enum state {
 	STATE_IDLE,
 	STATE_ACTIVE,
@@ -45,6 +56,10 @@ static struct k_work_delayable matrix_scan;
 static struct k_work_delayable button_pressed;
 static enum state state;
 
+static struct buttons_scan_key keys[COLUMNS * ARRAY_SIZE(row)];
+static struct buttons_scan scan;
+static uint32_t trigger_time;
+
 
 static void scan_fn(struct k_work *work);
 
@@ -80,16 +95,31 @@ static int set_cols(uint32_t mask)
 	return 0;
 }
 
+static uint32_t get_timestamp(void)
+{
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
 static int get_rows(uint32_t *mask)
 {
+	gpio_port_value_t port_val[ARRAY_SIZE(port_map)];
+	uint32_t port_read = 0;
+
+	/* Read every port once instead of reading the rows pin by pin. */
 	for (size_t i = 0; i < ARRAY_SIZE(row); i++) {
-		int val = gpio_pin_get_raw(gpio_devs[row[i].port], row[i].pin);
+		uint8_t port = row[i].port;
 
-		if (val < 0) {
-			LOG_ERR("Cannot get pin");
-			return -EFAULT;
+		if (!(port_read & BIT(port))) {
+			if (gpio_port_get_raw(gpio_devs[port], &port_val[port])) {
+				LOG_ERR("Cannot get port");
+				return -EFAULT;
+			}
+
+			port_read |= BIT(port);
 		}
 
+		int val = (port_val[port] & BIT(row[i].pin)) ? 1 : 0;
+
 		if (IS_ENABLED(CONFIG_CAF_BUTTONS_POLARITY_INVERSED)) {
 			val = !val;
 		}
@@ -215,6 +245,34 @@ static void resume(void)
 	}
 }
 
+static void key_state_changed(uint16_t key_id, bool pressed)
+{
+	struct button_event *event = new_button_event();
+
+	event->key_id = key_id;
+	event->pressed = pressed;
+	EVENT_SUBMIT(event);
+}
+
+static void log_stats(void)
+{
+	const struct buttons_scan_stats *stats = &scan.stats;
+
+	if (stats->event_cnt < LATENCY_STATS_EVENTS) {
+		return;
+	}
+
+	LOG_INF("Latency [us]: min %" PRIu32 " avg %" PRIu32 " max %" PRIu32,
+		stats->latency_min,
+		(uint32_t)(stats->latency_sum / stats->event_cnt),
+		stats->latency_max);
+	LOG_INF("Scans: %" PRIu32 " events: %" PRIu32 " bounces: %" PRIu32
+		" ghosting: %" PRIu32, stats->scan_cnt, stats->event_cnt,
+		stats->bounce_cnt, stats->ghost_cnt);
+
+	buttons_scan_stats_reset(&scan);
+}
+
 static void scan_fn(struct k_work *work)
 {
 	/* Validate state */
@@ -244,65 +302,7 @@ static void scan_fn(struct k_work *work)
 		goto error;
 	}
 
-	static uint32_t settled_state[COLUMNS];
-
-	/* Prevent bouncing */
-	static uint32_t prev_state[COLUMNS];
-	for (size_t i = 0; i < COLUMNS; i++) {
-		uint32_t bounce_mask = prev_state[i] ^ raw_state[i];
-		prev_state[i] = raw_state[i];
-		raw_state[i] &= ~bounce_mask;
-		raw_state[i] |= settled_state[i] & bounce_mask;
-	}
-
-	/* Prevent ghosting */
-	uint32_t cur_state[COLUMNS];
-	for (size_t i = 0; i < COLUMNS; i++) {
-		uint32_t blocking_mask = 0;
-		for (size_t j = 0; j < COLUMNS; j++) {
-			if (i == j) {
-				continue;
-			}
-			blocking_mask |= raw_state[j];
-		}
-		blocking_mask ^= raw_state[i];
-		cur_state[i] = raw_state[i];
-		if (!is_power_of_two(raw_state[i])) {
-			/* Power of two means only one bit is set */
-			cur_state[i] &= blocking_mask;
-		}
-	}
-
-	/* Emit event for any key state change */
-	bool any_pressed = false;
-	size_t evt_limit = 0;
-
-	for (size_t i = 0; i < COLUMNS; i++) {
-		for (size_t j = 0; j < ARRAY_SIZE(row); j++) {
-			bool is_raw_pressed = raw_state[i] & BIT(j);
-			bool is_pressed = cur_state[i] & BIT(j);
-			bool was_pressed = settled_state[i] & BIT(j);
-
-			if ((is_pressed != was_pressed) &&
-			    (is_pressed == is_raw_pressed) &&
-			    (evt_limit < CONFIG_CAF_BUTTONS_EVENT_LIMIT)) {
-				struct button_event *event = new_button_event();
-
-				event->key_id = KEY_ID(i, j);
-				event->pressed = is_pressed;
-				EVENT_SUBMIT(event);
-
-				evt_limit++;
-
-				WRITE_BIT(settled_state[i], j, is_pressed);
-			}
-		}
-
-		any_pressed = any_pressed ||
-			      (prev_state[i] != 0) ||
-			      (settled_state[i] != 0) ||
-			      (cur_state[i] != 0);
-	}
+	bool any_pressed = !buttons_scan_process(&scan, raw_state, get_timestamp());
 
 	if (any_pressed) {
 		/* Schedule next scan */
@@ -312,6 +312,10 @@ static void scan_fn(struct k_work *work)
 
 		int err = 0;
 
+		if (IS_ENABLED(CONFIG_CAF_BUTTONS_LATENCY_STATS)) {
+			log_stats();
+		}
+
 		/* Enable callbacks and switch state, then set pins */
 		switch (state) {
 		case STATE_SCANNING:
@@ -363,6 +367,8 @@ static void button_pressed_isr(const struct device *gpio_dev,
 		err = -EFAULT;
 	}
 
+	trigger_time = get_timestamp();
+
 	/* This is a workaround. Zephyr will set any pin triggering interrupt
 	 * at the moment. Not only our pins.
 	 */
@@ -411,6 +417,7 @@ static void button_pressed_fn(struct k_work *work)
 
 	case STATE_ACTIVE:
 		state = STATE_SCANNING;
+		buttons_scan_trigger(&scan, trigger_time);
 		k_work_reschedule(&matrix_scan, K_MSEC(DEBOUNCE_INTERVAL));
 		break;
 
@@ -451,6 +458,10 @@ static void init_fn(void)
 		}
 	}
 
+	buttons_scan_init(&scan, keys, COLUMNS, ARRAY_SIZE(row),
+			  CONFIG_CAF_BUTTONS_DEBOUNCE_TIME * USEC_PER_MSEC,
+			  CONFIG_CAF_BUTTONS_EVENT_LIMIT, key_state_changed);
+
 	int err = set_trig_mode();
 	if (err) {
 		LOG_ERR("Cannot set interrupt mode");
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <sys/__assert.h>
+#include <sys/util.h>
+
+#include <caf/key_id.h>
+
+#include "buttons_scan.h"
+
+
+void buttons_scan_stats_reset(struct buttons_scan *scan)
+{
+	memset(&scan->stats, 0, sizeof(scan->stats));
+	scan->stats.latency_min = UINT32_MAX;
+}
+
+void buttons_scan_init(struct buttons_scan *scan, struct buttons_scan_key *keys,
+		       size_t col_cnt, size_t row_cnt, uint32_t debounce_time,
+		       uint8_t event_limit, buttons_scan_key_cb key_cb)
+{
+	__ASSERT_NO_MSG(row_cnt <= BUTTONS_SCAN_ROWS_MAX);
+	__ASSERT_NO_MSG(col_cnt <= BIT(_COL_SIZE));
+	__ASSERT_NO_MSG(key_cb);
+
+	scan->keys = keys;
+	scan->col_cnt = col_cnt;
+	scan->row_cnt = row_cnt;
+	scan->event_limit = event_limit;
+	scan->debounce_time = debounce_time;
+	scan->key_cb = key_cb;
+	scan->trigger_valid = false;
+
+	for (size_t i = 0; i < col_cnt * row_cnt; i++) {
+		keys[i].state = BUTTONS_SCAN_KEY_RELEASED;
+		keys[i].change_time = 0;
+	}
+
+	buttons_scan_stats_reset(scan);
+}
+
+void buttons_scan_trigger(struct buttons_scan *scan, uint32_t timestamp)
+{
+	scan->trigger_time = timestamp;
+	scan->trigger_valid = true;
+}
+
+/* Get rows that are pressed in more than one column. */
+static uint32_t get_shared_rows(const struct buttons_scan *scan,
+				const uint32_t *raw_state)
+{
+	uint32_t any = 0;
+	uint32_t shared = 0;
+
+	for (size_t i = 0; i < scan->col_cnt; i++) {
+		shared |= any & raw_state[i];
+		any |= raw_state[i];
+	}
+
+	return shared;
+}
+
+static void report(struct buttons_scan *scan, struct buttons_scan_key *key,
+		   uint16_t key_id, bool pressed, uint32_t timestamp)
+{
+	uint32_t latency = timestamp - key->change_time;
+	struct buttons_scan_stats *stats = &scan->stats;
+
+	key->state = pressed ? BUTTONS_SCAN_KEY_PRESSED : BUTTONS_SCAN_KEY_RELEASED;
+
+	stats->event_cnt++;
+	stats->latency_sum += latency;
+	stats->latency_min = MIN(stats->latency_min, latency);
+	stats->latency_max = MAX(stats->latency_max, latency);
+
+	scan->key_cb(key_id, pressed);
+}
+
+bool buttons_scan_process(struct buttons_scan *scan, const uint32_t *raw_state,
+			  uint32_t timestamp)
+{
+	/* Changes noticed by this scan started at the interrupt, if any. */
+	uint32_t start_time = scan->trigger_valid ? scan->trigger_time : timestamp;
+	uint32_t shared_rows = get_shared_rows(scan, raw_state);
+	size_t evt_cnt = 0;
+	bool ghosting = false;
+	bool idle = true;
+
+	scan->trigger_valid = false;
+	scan->stats.scan_cnt++;
+
+	for (size_t i = 0; i < scan->col_cnt; i++) {
+		/* If more keys are pressed in a column, a key in a row that is
+		 * also pressed in another column may be a ghost. Such keys
+		 * keep their state until the situation is resolved.
+		 */
+		uint32_t blocked = is_power_of_two(raw_state[i]) ?
+				   0 : (raw_state[i] & shared_rows);
+
+		if (blocked) {
+			ghosting = true;
+		}
+
+		if (raw_state[i]) {
+			idle = false;
+		}
+
+		for (size_t j = 0; j < scan->row_cnt; j++) {
+			struct buttons_scan_key *key = &scan->keys[i * scan->row_cnt + j];
+			bool is_raw_pressed = raw_state[i] & BIT(j);
+			bool is_blocked = blocked & BIT(j);
+			bool settled = (timestamp - key->change_time) >= scan->debounce_time;
+			bool can_report = evt_cnt < scan->event_limit;
+
+			switch (key->state) {
+			case BUTTONS_SCAN_KEY_RELEASED:
+				if (is_raw_pressed && !is_blocked) {
+					key->state = BUTTONS_SCAN_KEY_PRESS_DEBOUNCE;
+					key->change_time = start_time;
+				}
+				break;
+
+			case BUTTONS_SCAN_KEY_PRESS_DEBOUNCE:
+				if (!is_raw_pressed) {
+					key->state = BUTTONS_SCAN_KEY_RELEASED;
+					scan->stats.bounce_cnt++;
+				} else if (is_blocked) {
+					key->state = BUTTONS_SCAN_KEY_RELEASED;
+				} else if (settled && can_report) {
+					report(scan, key, KEY_ID(i, j), true, timestamp);
+					evt_cnt++;
+				}
+				break;
+
+			case BUTTONS_SCAN_KEY_PRESSED:
+				if (!is_raw_pressed) {
+					key->state = BUTTONS_SCAN_KEY_RELEASE_DEBOUNCE;
+					key->change_time = start_time;
+				}
+				break;
+
+			case BUTTONS_SCAN_KEY_RELEASE_DEBOUNCE:
+				if (is_raw_pressed) {
+					key->state = BUTTONS_SCAN_KEY_PRESSED;
+					scan->stats.bounce_cnt++;
+				} else if (settled && can_report) {
+					report(scan, key, KEY_ID(i, j), false, timestamp);
+					evt_cnt++;
+				}
+				break;
+
+			default:
+				__ASSERT_NO_MSG(false);
+				break;
+			}
+
+			if (key->state != BUTTONS_SCAN_KEY_RELEASED) {
+				idle = false;
+			}
+		}
+	}
+
+	if (ghosting) {
+		scan->stats.ghost_cnt++;
+	}
+
+	return idle;
+}
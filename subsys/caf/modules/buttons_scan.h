@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _BUTTONS_SCAN_H_
+#define _BUTTONS_SCAN_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/types.h>
+
+/* Hardware independent part of the buttons module. It processes the raw
+ * state of the key matrix read during every scan and reports debounced key
+ * state changes. All timestamps are in microseconds.
+ */
+
+/* Maximum number of rows. Row state of a column is stored in a bitmask. */
+#define BUTTONS_SCAN_ROWS_MAX 32
+
+enum buttons_scan_key_state {
+	BUTTONS_SCAN_KEY_RELEASED,
+	BUTTONS_SCAN_KEY_PRESS_DEBOUNCE,
+	BUTTONS_SCAN_KEY_PRESSED,
+	BUTTONS_SCAN_KEY_RELEASE_DEBOUNCE,
+};
+
+/* Debounce state machine of a single key. */
+struct buttons_scan_key {
+	uint8_t state;
+	uint32_t change_time; /* Time when the debounced change started. */
+};
+
+/* Scan-to-event latency statistics. Latency of a key state change is
+ * measured from the GPIO interrupt or from the scan that first noticed the
+ * change, to the scan that reported it.
+ */
+struct buttons_scan_stats {
+	uint32_t scan_cnt;
+	uint32_t event_cnt;
+	uint32_t latency_min;
+	uint32_t latency_max;
+	uint64_t latency_sum;
+	uint32_t bounce_cnt; /* Changes dropped because pin state bounced. */
+	uint32_t ghost_cnt; /* Scans with keys blocked due to ghosting. */
+};
+
+typedef void (*buttons_scan_key_cb)(uint16_t key_id, bool pressed);
+
+struct buttons_scan {
+	struct buttons_scan_key *keys; /* col_cnt * row_cnt items. */
+	uint8_t col_cnt;
+	uint8_t row_cnt;
+	uint8_t event_limit;
+	uint32_t debounce_time;
+	buttons_scan_key_cb key_cb;
+
+	uint32_t trigger_time;
+	bool trigger_valid;
+
+	struct buttons_scan_stats stats;
+};
+
+/* Initialize the scan state. All keys are released.
+ *
+ * Key state changes are reported once the raw state is stable for the
+ * debounce time. At most event_limit changes are reported by a single scan,
+ * the remaining ones are reported by the following scans.
+ */
+void buttons_scan_init(struct buttons_scan *scan, struct buttons_scan_key *keys,
+		       size_t col_cnt, size_t row_cnt, uint32_t debounce_time,
+		       uint8_t event_limit, buttons_scan_key_cb key_cb);
+
+/* Store the time of the GPIO interrupt that triggered scanning. It is used
+ * as the start of key state changes noticed by the following scan.
+ */
+void buttons_scan_trigger(struct buttons_scan *scan, uint32_t timestamp);
+
+/* Process the raw state of the matrix. Element i of raw_state is the bitmask
+ * of pressed rows in column i.
+ *
+ * @return true if no key is pressed and no change is pending.
+ */
+bool buttons_scan_process(struct buttons_scan *scan, const uint32_t *raw_state,
+			  uint32_t timestamp);
+
+void buttons_scan_stats_reset(struct buttons_scan *scan);
+
+#endif /* _BUTTONS_SCAN_H_ */
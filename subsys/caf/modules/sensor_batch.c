@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <sys/__assert.h>
+#include <sys/util.h>
+
+#include "sensor_batch.h"
+
+
+static uint8_t *get_sample_ptr(const struct sensor_batch *batch, size_t buf_idx,
+			       size_t sample_idx)
+{
+	size_t offset = (buf_idx * batch->batch_size + sample_idx) * batch->sample_size;
+
+	return &batch->buf[offset];
+}
+
+void sensor_batch_init(struct sensor_batch *batch, void *buf, uint8_t buf_cnt,
+		       uint16_t batch_size, size_t sample_size, uint32_t period,
+		       uint32_t latency)
+{
+	__ASSERT_NO_MSG(buf_cnt > 0);
+	__ASSERT_NO_MSG(buf_cnt <= SENSOR_BATCH_BUF_COUNT_MAX);
+	__ASSERT_NO_MSG(batch_size > 0);
+
+	batch->buf = buf;
+	batch->buf_cnt = buf_cnt;
+	batch->batch_size = batch_size;
+	batch->sample_size = sample_size;
+	batch->period = period;
+	batch->latency = latency;
+
+	atomic_clear(&batch->busy);
+	batch->buf_idx = 0;
+	batch->sample_cnt = 0;
+	batch->dropped_cnt = 0;
+	batch->start_time = 0;
+}
+
+void sensor_batch_drop(struct sensor_batch *batch, size_t cnt)
+{
+	if (cnt > (size_t)(UINT16_MAX - batch->dropped_cnt)) {
+		batch->dropped_cnt = UINT16_MAX;
+	} else {
+		batch->dropped_cnt += cnt;
+	}
+}
+
+bool sensor_batch_add(struct sensor_batch *batch, const void *sample,
+		      int64_t timestamp)
+{
+	if (batch->sample_cnt == 0) {
+		size_t i;
+
+		for (i = 0; i < batch->buf_cnt; i++) {
+			if (!atomic_test_and_set_bit(&batch->busy, i)) {
+				break;
+			}
+		}
+
+		if (i == batch->buf_cnt) {
+			/* Previous batches are still processed. */
+			sensor_batch_drop(batch, 1);
+			return false;
+		}
+
+		batch->buf_idx = i;
+		batch->start_time = timestamp;
+	}
+
+	memcpy(get_sample_ptr(batch, batch->buf_idx, batch->sample_cnt), sample,
+	       batch->sample_size);
+	batch->sample_cnt++;
+
+	return ((batch->sample_cnt == batch->batch_size) ||
+		((batch->latency > 0) &&
+		 (timestamp - batch->start_time + batch->period > batch->latency)));
+}
+
+const void *sensor_batch_take(struct sensor_batch *batch, uint16_t *sample_cnt,
+			      uint16_t *dropped_cnt)
+{
+	__ASSERT_NO_MSG(batch->sample_cnt > 0);
+
+	*sample_cnt = batch->sample_cnt;
+	*dropped_cnt = batch->dropped_cnt;
+
+	batch->sample_cnt = 0;
+	batch->dropped_cnt = 0;
+
+	return get_sample_ptr(batch, batch->buf_idx, 0);
+}
+
+bool sensor_batch_release(struct sensor_batch *batch, const void *data)
+{
+	for (size_t i = 0; i < batch->buf_cnt; i++) {
+		if (data == get_sample_ptr(batch, i, 0)) {
+			__ASSERT_NO_MSG(atomic_test_bit(&batch->busy, i));
+			atomic_clear_bit(&batch->busy, i);
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _SENSOR_BATCH_H_
+#define _SENSOR_BATCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/types.h>
+#include <sys/atomic.h>
+
+/* Sample batching of the sensor sampler. Samples are collected in one of
+ * the batch buffers. A buffer is owned by the submitted batch until it is
+ * released. Samples that cannot be stored are counted as dropped and the
+ * count is reported with the next batch. All times are in milliseconds.
+ */
+
+/* Maximum number of batch buffers. Busy buffers are stored in a bitmask. */
+#define SENSOR_BATCH_BUF_COUNT_MAX	(sizeof(atomic_t) * 8)
+
+struct sensor_batch {
+	uint8_t *buf; /* buf_cnt * batch_size * sample_size bytes. */
+	size_t sample_size;
+	uint16_t batch_size;
+	uint8_t buf_cnt;
+	uint32_t period;
+	uint32_t latency;
+
+	atomic_t busy;
+	uint8_t buf_idx;
+	uint16_t sample_cnt;
+	uint16_t dropped_cnt;
+	int64_t start_time;
+};
+
+/* Initialize the batch state. All buffers are free.
+ *
+ * A batch is complete when it holds batch_size samples or, if latency is not
+ * 0, when the next sample, expected after the sampling period, would be
+ * added later than latency after the first sample of the batch.
+ */
+void sensor_batch_init(struct sensor_batch *batch, void *buf, uint8_t buf_cnt,
+		       uint16_t batch_size, size_t sample_size, uint32_t period,
+		       uint32_t latency);
+
+/* Add a sample to the batch. The sample is dropped if all buffers are busy.
+ *
+ * @return true if the batch is complete and must be taken.
+ */
+bool sensor_batch_add(struct sensor_batch *batch, const void *sample,
+		      int64_t timestamp);
+
+/* Count samples that were not sampled in time. */
+void sensor_batch_drop(struct sensor_batch *batch, size_t cnt);
+
+static inline bool sensor_batch_is_empty(const struct sensor_batch *batch)
+{
+	return (batch->sample_cnt == 0);
+}
+
+/* Take the samples of the batch, together with the number of samples dropped
+ * since the previous batch was taken. The batch must not be empty. The
+ * buffer stays busy until it is released.
+ *
+ * @return pointer to the first sample of the batch.
+ */
+const void *sensor_batch_take(struct sensor_batch *batch, uint16_t *sample_cnt,
+			      uint16_t *dropped_cnt);
+
+/* Release the buffer of a batch that was taken.
+ *
+ * @return true if the data belongs to one of the buffers of the batch.
+ */
+bool sensor_batch_release(struct sensor_batch *batch, const void *data);
+
+#endif /* _SENSOR_BATCH_H_ */
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <sys/__assert.h>
+#include <sys/util.h>
+
+#include "sensor_fixed.h"
+
+
+static int32_t saturate(int64_t val)
+{
+	return MAX(MIN(val, INT32_MAX), INT32_MIN);
+}
+
+int32_t sensor_fixed_from_value(const struct sensor_value *val, uint8_t frac_bits)
+{
+	__ASSERT_NO_MSG(frac_bits <= SENSOR_FIXED_FRAC_BITS_MAX);
+
+	int64_t one = BIT64(frac_bits);
+
+	/* No overflow, val1 is a 32-bit value and val2 is below one million. */
+	return saturate((int64_t)val->val1 * one + (int64_t)val->val2 * one / 1000000);
+}
+
+int32_t sensor_fixed_from_float(float val, uint8_t frac_bits)
+{
+	__ASSERT_NO_MSG(frac_bits <= SENSOR_FIXED_FRAC_BITS_MAX);
+
+	float res = val * (float)BIT64(frac_bits);
+
+	/* Limits are powers of two, so they are exact as floats. */
+	if (res >= -(float)INT32_MIN) {
+		return INT32_MAX;
+	} else if (res <= (float)INT32_MIN) {
+		return INT32_MIN;
+	}
+
+	return (int32_t)res;
+}
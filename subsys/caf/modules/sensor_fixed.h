@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _SENSOR_FIXED_H_
+#define _SENSOR_FIXED_H_
+
+#include <zephyr/types.h>
+#include <drivers/sensor.h>
+
+/* Conversion of sensor readouts to signed 32-bit fixed-point numbers with
+ * the given number of fractional bits. Values that do not fit are saturated
+ * and fractional parts are truncated towards zero.
+ */
+
+/* Maximum number of fractional bits. */
+#define SENSOR_FIXED_FRAC_BITS_MAX 30
+
+int32_t sensor_fixed_from_value(const struct sensor_value *val, uint8_t frac_bits);
+
+int32_t sensor_fixed_from_float(float val, uint8_t frac_bits);
+
+#endif /* _SENSOR_FIXED_H_ */
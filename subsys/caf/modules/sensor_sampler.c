@@ -13,6 +13,9 @@
 
 #include CONFIG_CAF_SENSOR_SAMPLER_DEF_PATH
 
+#include "sensor_batch.h"
+#include "sensor_fixed.h"
+
 #define MODULE sensor_sampler
 #include <caf/events/module_state_event.h>
 
@@ -21,15 +24,30 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_CAF_SENSOR_SAMPLER_LOG_LEVEL);
 
 #define SAMPLE_THREAD_STACK_SIZE	CONFIG_CAF_SENSOR_SAMPLER_THREAD_STACK_SIZE
 #define SAMPLE_THREAD_PRIORITY		CONFIG_CAF_SENSOR_SAMPLER_THREAD_PRIORITY
+#define BATCH_BUF_COUNT			CONFIG_CAF_SENSOR_SAMPLER_BATCH_BUF_COUNT
+
+#ifdef CONFIG_CAF_SENSOR_EVENT_DATA_FIXED_POINT
+#define DATA_ONE			((int64_t)BIT64(SENSOR_EVENT_DATA_FRAC_BITS))
+
+/* Values compared to detect activity. Wide enough to hold a difference and
+ * a product of sensor data values without overflow.
+ */
+typedef int64_t act_value_t;
+#else
+typedef float act_value_t;
+#endif
 
 
 struct sensor_data {
 	const struct device *dev;
 	int sampling_period;
 	int64_t sample_timeout;
-	float *prev;
+	sensor_event_data_t *prev;
+	sensor_event_data_t act_thresh;
 	atomic_t state;
 	unsigned int sleep_cnt;
+
+	struct sensor_batch batch;
 };
 
 static struct sensor_data sensor_data[ARRAY_SIZE(sensor_configs)];
@@ -51,15 +69,16 @@ static void update_sensor_state(const struct sensor_config *sc, struct sensor_da
 	EVENT_SUBMIT(event);
 }
 
-static void send_sensor_event(const char *descr, const float *data, const size_t data_cnt)
+static void send_sensor_event(const char *descr, const sensor_event_data_t *data,
+			      const size_t data_cnt)
 {
-	struct sensor_event *event = new_sensor_event(sizeof(float) * data_cnt);
-	float *data_ptr = sensor_event_get_data_ptr(event);
+	struct sensor_event *event = new_sensor_event(sizeof(sensor_event_data_t) * data_cnt);
+	sensor_event_data_t *data_ptr = sensor_event_get_data_ptr(event);
 
 	event->descr = descr;
 
 	__ASSERT_NO_MSG(sensor_event_get_data_cnt(event) == data_cnt);
-	memcpy(data_ptr, data, sizeof(float) * data_cnt);
+	memcpy(data_ptr, data, sizeof(sensor_event_data_t) * data_cnt);
 
 	EVENT_SUBMIT(event);
 }
@@ -107,20 +126,116 @@ static size_t get_sensor_data_cnt(const struct sensor_config *sc)
 	return data_cnt;
 }
 
+static bool is_batching(const struct sensor_config *sc)
+{
+	return (sc->batch_size > 0);
+}
+
+static void batch_submit(const struct sensor_config *sc, struct sensor_data *sd)
+{
+	struct sensor_batch_event *event = new_sensor_batch_event();
+
+	event->descr = sc->event_descr;
+	event->data = sensor_batch_take(&sd->batch, &event->sample_cnt,
+					&event->dropped_cnt);
+	event->sample_size = get_sensor_data_cnt(sc);
+
+	/* Buffer is released when the event is processed by all listeners. */
+	EVENT_SUBMIT(event);
+}
+
+static void batch_add(const struct sensor_config *sc, struct sensor_data *sd,
+		      const sensor_event_data_t *data)
+{
+	if (sensor_batch_add(&sd->batch, data, k_uptime_get())) {
+		batch_submit(sc, sd);
+	}
+}
+
+static void batch_flush(const struct sensor_config *sc, struct sensor_data *sd)
+{
+	if (is_batching(sc) && !sensor_batch_is_empty(&sd->batch)) {
+		batch_submit(sc, sd);
+	}
+}
+
+static void batch_release(const struct sensor_batch_event *event)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(sensor_data); i++) {
+		const struct sensor_config *sc = &sensor_configs[i];
+
+		if (is_batching(sc) &&
+		    sensor_batch_release(&sensor_data[i].batch, event->data)) {
+			return;
+		}
+	}
+
+	__ASSERT_NO_MSG(false);
+}
+
+#ifdef CONFIG_CAF_SENSOR_EVENT_DATA_FIXED_POINT
+BUILD_ASSERT(SENSOR_EVENT_DATA_FRAC_BITS <= SENSOR_FIXED_FRAC_BITS_MAX);
+
+static sensor_event_data_t sensor_value_to_data(const struct sensor_value *val)
+{
+	return sensor_fixed_from_value(val, SENSOR_EVENT_DATA_FRAC_BITS);
+}
+
+static sensor_event_data_t float_to_data(float val)
+{
+	return sensor_fixed_from_float(val, SENSOR_EVENT_DATA_FRAC_BITS);
+}
+
+static act_value_t act_value_abs_diff(sensor_event_data_t a, sensor_event_data_t b)
+{
+	act_value_t diff = (act_value_t)a - b;
+
+	return (diff < 0) ? (-diff) : (diff);
+}
+
+static act_value_t act_value_abs_scale(sensor_event_data_t val, sensor_event_data_t scale)
+{
+	act_value_t res = ((act_value_t)val * scale) / (act_value_t)DATA_ONE;
+
+	return (res < 0) ? (-res) : (res);
+}
+#else
+static sensor_event_data_t sensor_value_to_data(const struct sensor_value *val)
+{
+	/* Avoid double precision arithmetic, the result is a float anyway. */
+	return (float)val->val1 + (float)val->val2 / 1000000.0f;
+}
+
+static sensor_event_data_t float_to_data(float val)
+{
+	return val;
+}
+
+static act_value_t act_value_abs_diff(sensor_event_data_t a, sensor_event_data_t b)
+{
+	return fabsf(a - b);
+}
+
+static act_value_t act_value_abs_scale(sensor_event_data_t val, sensor_event_data_t scale)
+{
+	return fabsf(val * scale);
+}
+#endif
+
 static bool is_active(const struct sensor_config *sc, struct sensor_data *sd,
-		      const float curr, const float prev)
+		      const sensor_event_data_t curr, const sensor_event_data_t prev)
 {
 	enum act_type type = sc->trigger->activation.type;
-	float thresh = sc->trigger->activation.thresh;
 
 	bool is_active = false;
 
 	switch (type) {
 	case ACT_TYPE_PERC:
-		is_active = fabs(curr - prev) > fabs(prev * thresh/100.0);
+		is_active = act_value_abs_diff(curr, prev) >
+			    act_value_abs_scale(prev, sd->act_thresh);
 		break;
 	case ACT_TYPE_ABS:
-		is_active = fabs(curr - prev) > fabs(thresh);
+		is_active = act_value_abs_diff(curr, prev) > sd->act_thresh;
 		break;
 	default:
 		__ASSERT(false, "Invalid configuration");
@@ -133,7 +248,7 @@ static bool is_active(const struct sensor_config *sc, struct sensor_data *sd,
 
 static bool can_sensor_sleep(const struct sensor_config *sc,
 			     struct sensor_data *sd,
-			     const float *curr)
+			     const sensor_event_data_t *curr)
 {
 	size_t data_cnt = get_sensor_data_cnt(sc);
 	bool sleep = true;
@@ -155,7 +270,7 @@ static bool can_sensor_sleep(const struct sensor_config *sc,
 			return true;
 		}
 	} else {
-		memcpy(sd->prev, curr, data_cnt * sizeof(float));
+		memcpy(sd->prev, curr, data_cnt * sizeof(sensor_event_data_t));
 		sd->sleep_cnt = 0;
 	}
 
@@ -183,9 +298,12 @@ static void trigger_handler(const struct device *dev, struct sensor_trigger *tri
 
 static void try_enter_sleep(const struct sensor_config *sc,
 			   struct sensor_data *sd,
-			   const float *curr)
+			   const sensor_event_data_t *curr)
 {
 	if (can_sensor_sleep(sc, sd, curr)) {
+		/* Do not keep the samples until the sensor wakes up. */
+		batch_flush(sc, sd);
+
 		k_sched_lock();
 		int err = sensor_trigger_set(sd->dev, &sc->trigger->cfg, trigger_handler);
 
@@ -204,7 +322,7 @@ static void sample_sensor(struct sensor_data *sd, const struct sensor_config *sc
 	size_t data_idx = 0;
 	size_t data_cnt = get_sensor_data_cnt(sc);
 	struct sensor_value data[data_cnt];
-	float curr[data_cnt];
+	sensor_event_data_t curr[data_cnt];
 
 	int err = sensor_sample_fetch(sd->dev);
 
@@ -216,14 +334,19 @@ static void sample_sensor(struct sensor_data *sd, const struct sensor_config *sc
 	}
 
 	for (size_t i = 0; i < ARRAY_SIZE(curr); i++) {
-		curr[i] = sensor_value_to_double(&data[i]);
+		curr[i] = sensor_value_to_data(&data[i]);
 	}
 
 	if (err) {
 		LOG_ERR("Sensor sampling error (err %d)", err);
 		update_sensor_state(sc, sd, SENSOR_STATE_ERROR);
 	} else {
-		send_sensor_event(sc->event_descr, curr, ARRAY_SIZE(curr));
+		if (is_batching(sc)) {
+			batch_add(sc, sd, curr);
+		} else {
+			send_sensor_event(sc->event_descr, curr, ARRAY_SIZE(curr));
+		}
+
 		if (sc->trigger) {
 			try_enter_sleep(sc, sd, curr);
 		}
@@ -254,6 +377,11 @@ static size_t sample_sensors(int64_t *next_timeout)
 
 			if (drops > 0) {
 				LOG_WRN("%d sample dropped", drops);
+
+				/* Drops are reported with the next batch. */
+				if (is_batching(sc)) {
+					sensor_batch_drop(&sd->batch, drops);
+				}
 			}
 		}
 
@@ -284,8 +412,18 @@ static int sensor_trigger_init(const struct sensor_config *sc, struct sensor_dat
 	}
 
 	size_t data_cnt = get_sensor_data_cnt(sc);
+	float thresh = sc->trigger->activation.thresh;
+
+	/* Threshold is converted once, so that sampling does not require
+	 * floating-point arithmetic.
+	 */
+	if (sc->trigger->activation.type == ACT_TYPE_PERC) {
+		sd->act_thresh = float_to_data(thresh / 100.0f);
+	} else {
+		sd->act_thresh = float_to_data(fabsf(thresh));
+	}
 
-	sd->prev = k_malloc(data_cnt * sizeof(float));
+	sd->prev = k_malloc(data_cnt * sizeof(sensor_event_data_t));
 
 	if (!sd->prev) {
 		LOG_ERR("Failed to allocate memory");
@@ -296,6 +434,29 @@ static int sensor_trigger_init(const struct sensor_config *sc, struct sensor_dat
 	return 0;
 }
 
+static int batch_init(const struct sensor_config *sc, struct sensor_data *sd)
+{
+	size_t sample_size = get_sensor_data_cnt(sc) * sizeof(sensor_event_data_t);
+	size_t buf_size = BATCH_BUF_COUNT * sc->batch_size * sample_size;
+	void *buf;
+
+	__ASSERT(sc->batch_latency_ms == 0 || sc->batch_latency_ms >= sc->sampling_period_ms,
+		 "Batch latency must not be smaller than sampling period");
+
+	buf = k_malloc(buf_size);
+
+	if (!buf) {
+		LOG_ERR("Failed to allocate memory");
+		__ASSERT_NO_MSG(false);
+		return -ENOMEM;
+	}
+
+	sensor_batch_init(&sd->batch, buf, BATCH_BUF_COUNT, sc->batch_size, sample_size,
+			  sc->sampling_period_ms, sc->batch_latency_ms);
+
+	return 0;
+}
+
 static int sensor_init(void)
 {
 	int err = 0;
@@ -321,6 +482,14 @@ static int sensor_init(void)
 			}
 		}
 
+		if (is_batching(sc)) {
+			err = batch_init(sc, sd);
+			if (err) {
+				update_sensor_state(sc, sd, SENSOR_STATE_ERROR);
+				break;
+			}
+		}
+
 		update_sensor_state(sc, sd, SENSOR_STATE_ACTIVE);
 	}
 
@@ -375,6 +544,12 @@ static bool event_handler(const struct event_header *eh)
 		return false;
 	}
 
+	if (is_sensor_batch_event(eh)) {
+		batch_release(cast_sensor_batch_event(eh));
+
+		return false;
+	}
+
 	/* If event is unhandled, unsubscribe. */
 	__ASSERT_NO_MSG(false);
 
@@ -383,3 +558,4 @@ static bool event_handler(const struct event_header *eh)
 
 EVENT_LISTENER(MODULE, event_handler);
 EVENT_SUBSCRIBE(MODULE, module_state_event);
+EVENT_SUBSCRIBE_FINAL(MODULE, sensor_batch_event);
@@ -18,6 +18,8 @@
 #include <string.h>
 #include <nrf_erratas.h>
 
+#include "esb_buf_pool.h"
+
 /* Constants */
 
 /* 2 Mb RX wait for acknowledgment time-out value.
@@ -54,6 +56,16 @@
 
 #define BIT_MASK_UINT_8(x) (0xFF >> (8 - (x)))
 
+/* One receive buffer more than the RX FIFO size, so that the radio always has
+ * a buffer to receive into.
+ */
+#define RX_SLOT_COUNT (CONFIG_ESB_RX_FIFO_SIZE + 1)
+
+BUILD_ASSERT(RX_SLOT_COUNT <= ESB_BUF_POOL_MAX_SIZE,
+	     "CONFIG_ESB_RX_FIFO_SIZE too big");
+BUILD_ASSERT(CONFIG_ESB_TX_FIFO_SIZE <= ESB_BUF_POOL_MAX_SIZE,
+	     "CONFIG_ESB_TX_FIFO_SIZE too big");
+
 #define RADIO_SHORTS_COMMON                                                    \
 	(RADIO_SHORTS_READY_START_Msk | RADIO_SHORTS_END_DISABLE_Msk |         \
 	 RADIO_SHORTS_ADDRESS_RSSISTART_Msk |                                  \
@@ -108,8 +120,6 @@ struct pipe_info {
 struct payload_wrap {
 	/* Pointer to the ACK payload. */
 	struct esb_payload  *p_payload;
-	/* Value used to determine if the current payload pointer is used. */
-	bool in_use;
 	/* Pointer to the next ACK payload queued on the same pipe. */
 	struct payload_wrap *p_next;
 };
@@ -124,14 +134,19 @@ struct payload_tx_fifo {
 	uint32_t count;	/* Number of elements in the queue. */
 };
 
-/* First-in, first-out queue of received payloads. */
-struct payload_rx_fifo {
-	 /* Payload queue */
-	struct esb_payload *payload[CONFIG_ESB_RX_FIFO_SIZE];
-
-	uint32_t back;	/* Back of the queue (last in). */
-	uint32_t front;	/* Front of queue (first out). */
-	uint32_t count;	/* Number of elements in the queue. */
+/* Buffer the radio receives packets into. A received packet stays in its
+ * buffer until the application reads or releases it, so it is never copied
+ * within the module.
+ */
+struct rx_slot {
+	/* Radio packet: length, S1 field and payload. */
+	uint8_t buf[CONFIG_ESB_MAX_PAYLOAD_LENGTH + 2];
+
+	uint8_t length;	/* Length of the payload. */
+	uint8_t pipe;	/* Pipe the packet was received on. */
+	int8_t rssi;	/* RSSI of the packet. */
+	uint8_t pid;	/* Packet ID. */
+	uint8_t noack;	/* Flag indicating that the packet was not acknowledged. */
 };
 
 /* Enhanced ShockBurst address.
@@ -175,13 +190,23 @@ static struct esb_payload *current_payload;
 
 /* FIFOs and buffers */
 static struct payload_tx_fifo tx_fifo;
-static struct payload_rx_fifo rx_fifo;
 static uint8_t tx_payload_buffer[CONFIG_ESB_MAX_PAYLOAD_LENGTH + 2];
-static uint8_t rx_payload_buffer[CONFIG_ESB_MAX_PAYLOAD_LENGTH + 2];
+
+/* Received packets are queued as indexes of the RX slots. */
+static struct esb_buf_fifo rx_fifo;
+static struct rx_slot rx_slots[RX_SLOT_COUNT];
+static struct esb_buf_pool rx_slot_pool;
+/* RX slots read with esb_read_rx_payload_ref() and not released yet. */
+static uint32_t rx_slot_held_mask;
+static uint8_t rx_slot_current;
+/* Radio packet buffer of the RX slot the radio currently receives into. */
+static uint8_t *rx_payload_buffer;
 
 /* Random access buffer variables for ACK payload handling */
 struct payload_wrap ack_pl_wrap[CONFIG_ESB_TX_FIFO_SIZE];
 struct payload_wrap *ack_pl_wrap_pipe[CONFIG_ESB_PIPE_COUNT];
+static struct payload_wrap *ack_pl_wrap_pipe_tail[CONFIG_ESB_PIPE_COUNT];
+static struct esb_buf_pool ack_pl_wrap_pool;
 
 /* Run time variables */
 static uint8_t pids[CONFIG_ESB_PIPE_COUNT];
@@ -444,20 +469,26 @@ static bool update_radio_parameters(void)
 	return params_valid;
 }
 
+static void rx_slot_set_current(uint8_t idx)
+{
+	rx_slot_current = idx;
+	rx_payload_buffer = rx_slots[idx].buf;
+}
+
 static void reset_fifos(void)
 {
 	tx_fifo.back = 0;
 	tx_fifo.front = 0;
 	tx_fifo.count = 0;
 
-	rx_fifo.back = 0;
-	rx_fifo.front = 0;
-	rx_fifo.count = 0;
+	esb_buf_fifo_init(&rx_fifo, CONFIG_ESB_RX_FIFO_SIZE);
+	esb_buf_pool_init(&rx_slot_pool, RX_SLOT_COUNT);
+	rx_slot_held_mask = 0;
+	rx_slot_set_current(esb_buf_pool_alloc(&rx_slot_pool));
 }
 
 static void initialize_fifos(void)
 {
-	static struct esb_payload rx_payload[CONFIG_ESB_RX_FIFO_SIZE];
 	static struct esb_payload tx_payload[CONFIG_ESB_TX_FIFO_SIZE];
 
 	reset_fifos();
@@ -466,18 +497,16 @@ static void initialize_fifos(void)
 		tx_fifo.payload[i] = &tx_payload[i];
 	}
 
-	for (size_t i = 0; i < CONFIG_ESB_RX_FIFO_SIZE; i++) {
-		rx_fifo.payload[i] = &rx_payload[i];
-	}
-
 	for (size_t i = 0; i < CONFIG_ESB_TX_FIFO_SIZE; i++) {
 		ack_pl_wrap[i].p_payload = &tx_payload[i];
-		ack_pl_wrap[i].in_use = false;
 		ack_pl_wrap[i].p_next = 0;
 	}
 
+	esb_buf_pool_init(&ack_pl_wrap_pool, CONFIG_ESB_TX_FIFO_SIZE);
+
 	for (size_t i = 0; i < CONFIG_ESB_PIPE_COUNT; i++) {
 		ack_pl_wrap_pipe[i] = 0;
+		ack_pl_wrap_pipe_tail[i] = 0;
 	}
 }
 
@@ -497,11 +526,14 @@ static void tx_fifo_remove_last(void)
 	irq_unlock(key);
 }
 
-/*  Function to push the content of the rx_buffer to the RX FIFO.
+/*  Function to push the rx_buffer to the RX FIFO.
  *
  *  The module will point the register NRF_RADIO->PACKETPTR to a buffer for
  *  receiving packets. After receiving a packet the module will call this
- *  function to copy the received data to the RX FIFO.
+ *  function to queue the RX slot holding the buffer and to switch
+ *  rx_payload_buffer to a free RX slot. The payload is not copied. Callers
+ *  must point NRF_RADIO->PACKETPTR to rx_payload_buffer again before the next
+ *  reception.
  *
  *  @param  pipe Pipe number to set for the packet.
  *  @param  pid  Packet ID.
@@ -511,7 +543,10 @@ static void tx_fifo_remove_last(void)
  */
 static bool rx_fifo_push_rfbuf(uint8_t pipe, uint8_t pid)
 {
-	if (rx_fifo.count >= CONFIG_ESB_RX_FIFO_SIZE) {
+	struct rx_slot *slot = &rx_slots[rx_slot_current];
+	int next;
+
+	if (esb_buf_fifo_is_full(&rx_fifo)) {
 		return false;
 	}
 
@@ -519,26 +554,29 @@ static bool rx_fifo_push_rfbuf(uint8_t pipe, uint8_t pid)
 		if (rx_payload_buffer[0] > CONFIG_ESB_MAX_PAYLOAD_LENGTH) {
 			return false;
 		}
-		rx_fifo.payload[rx_fifo.back]->length = rx_payload_buffer[0];
+		slot->length = rx_payload_buffer[0];
 	} else if (esb_cfg.mode == ESB_MODE_PTX) {
 		/* Received packet is an acknowledgment */
-		rx_fifo.payload[rx_fifo.back]->length = 0;
+		slot->length = 0;
 	} else {
-		rx_fifo.payload[rx_fifo.back]->length = esb_cfg.payload_length;
+		slot->length = esb_cfg.payload_length;
 	}
 
-	memcpy(rx_fifo.payload[rx_fifo.back]->data, &rx_payload_buffer[2],
-	       rx_fifo.payload[rx_fifo.back]->length);
+	/* All other slots are queued or held by the application. Keep
+	 * receiving into the current slot and drop the packet.
+	 */
+	next = esb_buf_pool_alloc(&rx_slot_pool);
+	if (next < 0) {
+		return false;
+	}
 
-	rx_fifo.payload[rx_fifo.back]->pipe = pipe;
-	rx_fifo.payload[rx_fifo.back]->rssi = NRF_RADIO->RSSISAMPLE;
-	rx_fifo.payload[rx_fifo.back]->pid = pid;
-	rx_fifo.payload[rx_fifo.back]->noack = !(rx_payload_buffer[1] & 0x01);
+	slot->pipe = pipe;
+	slot->rssi = NRF_RADIO->RSSISAMPLE;
+	slot->pid = pid;
+	slot->noack = !(rx_payload_buffer[1] & 0x01);
 
-	if (++rx_fifo.back >= CONFIG_ESB_RX_FIFO_SIZE) {
-		rx_fifo.back = 0;
-	}
-	rx_fifo.count++;
+	esb_buf_fifo_push(&rx_fifo, rx_slot_current);
+	rx_slot_set_current(next);
 
 	return true;
 }
@@ -810,7 +848,8 @@ static void on_radio_disabled_rx_dpl(bool retransmit_payload,
 		/* Pipe stays in ACK with payload until TX FIFO is empty */
 		/* Do not report TX success on first ack payload or retransmit */
 		if (pipe_info->ack_payload == true && !retransmit_payload) {
-			ack_pl_wrap_pipe[pipe]->in_use = false;
+			esb_buf_pool_free(&ack_pl_wrap_pool,
+					  ack_pl_wrap_pipe[pipe] - ack_pl_wrap);
 			ack_pl_wrap_pipe[pipe] = ack_pl_wrap_pipe[pipe]->p_next;
 			tx_fifo.count--;
 			if (tx_fifo.count > 0 && ack_pl_wrap_pipe[pipe] != 0) {
@@ -849,6 +888,7 @@ static void on_radio_disabled_rx(void)
 {
 	bool retransmit_payload = false;
 	bool send_rx_event = true;
+	bool send_ack;
 	struct pipe_info *pipe_info;
 
 	if (NRF_RADIO->CRCSTATUS == 0) {
@@ -856,7 +896,13 @@ static void on_radio_disabled_rx(void)
 		return;
 	}
 
-	if (rx_fifo.count >= CONFIG_ESB_RX_FIFO_SIZE) {
+	/* Do not acknowledge a packet that cannot be stored. The pid and CRC
+	 * of the pipe are not updated either, so that the retransmission is
+	 * not discarded as a duplicate. There is no free slot when all slots
+	 * are queued or held by the application.
+	 */
+	if (esb_buf_fifo_is_full(&rx_fifo) ||
+	    esb_buf_pool_is_empty(&rx_slot_pool)) {
 		clear_events_restart_rx();
 		return;
 	}
@@ -872,8 +918,10 @@ static void on_radio_disabled_rx(void)
 	pipe_info->crc = NRF_RADIO->RXCRC;
 
 	/* Check if an ack should be sent */
-	if ((esb_cfg.selective_auto_ack == false) ||
-	    ((rx_payload_buffer[1] & 0x01) == 1)) {
+	send_ack = (esb_cfg.selective_auto_ack == false) ||
+		   ((rx_payload_buffer[1] & 0x01) == 1);
+
+	if (send_ack) {
 		NRF_RADIO->SHORTS = radio_shorts_common |
 				    RADIO_SHORTS_DISABLED_RXEN_Msk;
 
@@ -894,8 +942,6 @@ static void on_radio_disabled_rx(void)
 
 		NRF_RADIO->PACKETPTR = (uint32_t)tx_payload_buffer;
 		on_radio_disabled = on_radio_disabled_rx_ack;
-	} else {
-		clear_events_restart_rx();
 	}
 
 	if (send_rx_event) {
@@ -908,6 +954,13 @@ static void on_radio_disabled_rx(void)
 			NVIC_SetPendingIRQ(ESB_EVT_IRQ);
 		}
 	}
+
+	/* Restart reception only after the push, as it changes the buffer
+	 * the radio receives into.
+	 */
+	if (!send_ack) {
+		clear_events_restart_rx();
+	}
 }
 
 static void on_radio_disabled_rx_ack(void)
@@ -1095,11 +1148,16 @@ bool esb_is_idle(void)
 
 static struct payload_wrap *find_free_payload_cont(void)
 {
-	for (int i = 0; i < CONFIG_ESB_TX_FIFO_SIZE; i++) {
-		if (!ack_pl_wrap[i].in_use)
-			return &ack_pl_wrap[i];
-	}
-	return 0;
+	int idx = esb_buf_pool_alloc(&ack_pl_wrap_pool);
+
+	return (idx < 0) ? 0 : &ack_pl_wrap[idx];
+}
+
+static void payload_copy(struct esb_payload *dst,
+			 const struct esb_payload *src)
+{
+	/* Copy the header and only the used part of the data. */
+	memcpy(dst, src, offsetof(struct esb_payload, data) + src->length);
 }
 
 int esb_write_payload(const struct esb_payload *payload)
@@ -1126,8 +1184,7 @@ int esb_write_payload(const struct esb_payload *payload)
 	uint32_t key = irq_lock();
 
 	if (esb_cfg.mode == ESB_MODE_PTX) {
-		memcpy(tx_fifo.payload[tx_fifo.back], payload,
-			sizeof(struct esb_payload));
+		payload_copy(tx_fifo.payload[tx_fifo.back], payload);
 
 		pids[payload->pipe] = (pids[payload->pipe] + 1) % (PID_MAX + 1);
 		tx_fifo.payload[tx_fifo.back]->pid = pids[payload->pipe];
@@ -1141,9 +1198,8 @@ int esb_write_payload(const struct esb_payload *payload)
 		struct payload_wrap *new_ack_payload = find_free_payload_cont();
 
 		if (new_ack_payload != 0) {
-			new_ack_payload->in_use = true;
 			new_ack_payload->p_next = 0;
-			memcpy(new_ack_payload->p_payload, payload, sizeof(struct esb_payload));
+			payload_copy(new_ack_payload->p_payload, payload);
 
 			pids[payload->pipe] = (pids[payload->pipe] + 1) % (PID_MAX + 1);
 			new_ack_payload->p_payload->pid = pids[payload->pipe];
@@ -1151,13 +1207,10 @@ int esb_write_payload(const struct esb_payload *payload)
 			if (ack_pl_wrap_pipe[payload->pipe] == 0) {
 				ack_pl_wrap_pipe[payload->pipe] = new_ack_payload;
 			} else {
-				struct payload_wrap *pl = ack_pl_wrap_pipe[payload->pipe];
-
-				while (pl->p_next != 0) {
-					pl = (struct payload_wrap *)pl->p_next;
-				}
-				pl->p_next = (struct payload_wrap *)new_ack_payload;
+				ack_pl_wrap_pipe_tail[payload->pipe]->p_next =
+					new_ack_payload;
 			}
+			ack_pl_wrap_pipe_tail[payload->pipe] = new_ack_payload;
 			tx_fifo.count++;
 		}
 	}
@@ -1187,20 +1240,80 @@ int esb_read_rx_payload(struct esb_payload *payload)
 	}
 
 	uint32_t key = irq_lock();
+	int idx = esb_buf_fifo_pop(&rx_fifo);
+	struct rx_slot *slot = &rx_slots[idx];
+
+	payload->length = slot->length;
+	payload->pipe = slot->pipe;
+	payload->rssi = slot->rssi;
+	payload->pid = slot->pid;
+	payload->noack = slot->noack;
+	memcpy(payload->data, &slot->buf[2], payload->length);
+
+	esb_buf_pool_free(&rx_slot_pool, idx);
+
+	irq_unlock(key);
+
+	return 0;
+}
+
+int esb_read_rx_payload_ref(struct esb_payload_ref *ref)
+{
+	if (!esb_initialized) {
+		return -EACCES;
+	}
+	if (ref == NULL) {
+		return -EINVAL;
+	}
+
+	if (rx_fifo.count == 0) {
+		return -ENODATA;
+	}
+
+	uint32_t key = irq_lock();
+	int idx = esb_buf_fifo_pop(&rx_fifo);
+	struct rx_slot *slot = &rx_slots[idx];
 
-	payload->length = rx_fifo.payload[rx_fifo.front]->length;
-	payload->pipe = rx_fifo.payload[rx_fifo.front]->pipe;
-	payload->rssi = rx_fifo.payload[rx_fifo.front]->rssi;
-	payload->pid = rx_fifo.payload[rx_fifo.front]->pid;
-	payload->noack = rx_fifo.payload[rx_fifo.front]->noack;
-	memcpy(payload->data, rx_fifo.payload[rx_fifo.front]->data,
-	       payload->length);
+	rx_slot_held_mask |= BIT(idx);
 
-	if (++rx_fifo.front >= CONFIG_ESB_RX_FIFO_SIZE) {
-		rx_fifo.front = 0;
+	irq_unlock(key);
+
+	ref->data = &slot->buf[2];
+	ref->length = slot->length;
+	ref->pipe = slot->pipe;
+	ref->rssi = slot->rssi;
+	ref->pid = slot->pid;
+	ref->noack = slot->noack;
+	ref->id = idx;
+
+	return 0;
+}
+
+int esb_release_rx_payload(const struct esb_payload_ref *ref)
+{
+	if (!esb_initialized) {
+		return -EACCES;
+	}
+	if ((ref == NULL) || (ref->id >= RX_SLOT_COUNT) ||
+	    (ref->data != &rx_slots[ref->id].buf[2])) {
+		return -EINVAL;
 	}
 
-	rx_fifo.count--;
+	uint32_t key = irq_lock();
+
+	/* Reject a reference that is not held, for example one released
+	 * already. Freeing its slot would hand it to the radio while it is
+	 * queued or in use.
+	 */
+	if (!(rx_slot_held_mask & BIT(ref->id))) {
+		irq_unlock(key);
+		return -EINVAL;
+	}
+
+	__ASSERT_NO_MSG(!esb_buf_pool_is_free(&rx_slot_pool, ref->id));
+
+	rx_slot_held_mask &= ~BIT(ref->id);
+	esb_buf_pool_free(&rx_slot_pool, ref->id);
 
 	irq_unlock(key);
 
@@ -1318,10 +1431,12 @@ int esb_flush_rx(void)
 	}
 
 	uint32_t key = irq_lock();
+	int idx;
 
-	rx_fifo.count = 0;
-	rx_fifo.back = 0;
-	rx_fifo.front = 0;
+	/* Slots held by the application stay allocated until released. */
+	while ((idx = esb_buf_fifo_pop(&rx_fifo)) >= 0) {
+		esb_buf_pool_free(&rx_slot_pool, idx);
+	}
 
 	memset(rx_pipe_info, 0, sizeof(rx_pipe_info));
 
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef ESB_BUF_POOL_H_
+#define ESB_BUF_POOL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr.h>
+
+/* Maximum number of buffers managed by a pool or a FIFO. */
+#define ESB_BUF_POOL_MAX_SIZE 32
+
+/* Pool of buffer indexes. A set bit in the mask marks a free buffer, so
+ * a free buffer is found in constant time.
+ */
+struct esb_buf_pool {
+	uint32_t free_mask;
+};
+
+/* First-in, first-out queue of buffer indexes. */
+struct esb_buf_fifo {
+	uint8_t idx[ESB_BUF_POOL_MAX_SIZE];
+
+	uint8_t size;	/* Capacity of the queue. */
+	uint8_t back;	/* Back of the queue (last in). */
+	uint8_t front;	/* Front of queue (first out). */
+	uint8_t count;	/* Number of elements in the queue. */
+};
+
+/* The functions below are not reentrant. The caller must make sure the pool
+ * or the FIFO is not modified from an interrupt at the same time.
+ */
+
+static inline void esb_buf_pool_init(struct esb_buf_pool *pool, uint8_t count)
+{
+	pool->free_mask = (count >= ESB_BUF_POOL_MAX_SIZE) ?
+			  UINT32_MAX : (BIT(count) - 1);
+}
+
+static inline bool esb_buf_pool_is_empty(const struct esb_buf_pool *pool)
+{
+	return pool->free_mask == 0;
+}
+
+/* Returns the index of a free buffer or -1 if all buffers are in use. */
+static inline int esb_buf_pool_alloc(struct esb_buf_pool *pool)
+{
+	int idx;
+
+	if (esb_buf_pool_is_empty(pool)) {
+		return -1;
+	}
+
+	idx = find_lsb_set(pool->free_mask) - 1;
+	pool->free_mask &= ~BIT(idx);
+
+	return idx;
+}
+
+static inline bool esb_buf_pool_is_free(const struct esb_buf_pool *pool,
+					uint8_t idx)
+{
+	return (pool->free_mask & BIT(idx)) != 0;
+}
+
+static inline void esb_buf_pool_free(struct esb_buf_pool *pool, uint8_t idx)
+{
+	pool->free_mask |= BIT(idx);
+}
+
+static inline void esb_buf_fifo_init(struct esb_buf_fifo *fifo, uint8_t size)
+{
+	fifo->size = MIN(size, ESB_BUF_POOL_MAX_SIZE);
+	fifo->back = 0;
+	fifo->front = 0;
+	fifo->count = 0;
+}
+
+static inline bool esb_buf_fifo_is_full(const struct esb_buf_fifo *fifo)
+{
+	return fifo->count >= fifo->size;
+}
+
+static inline bool esb_buf_fifo_push(struct esb_buf_fifo *fifo, uint8_t idx)
+{
+	if (esb_buf_fifo_is_full(fifo)) {
+		return false;
+	}
+
+	fifo->idx[fifo->back] = idx;
+	if (++fifo->back >= fifo->size) {
+		fifo->back = 0;
+	}
+	fifo->count++;
+
+	return true;
+}
+
+/* Returns the index at the front of the queue or -1 if the queue is empty. */
+static inline int esb_buf_fifo_pop(struct esb_buf_fifo *fifo)
+{
+	uint8_t idx;
+
+	if (fifo->count == 0) {
+		return -1;
+	}
+
+	idx = fifo->idx[fifo->front];
+	if (++fifo->front >= fifo->size) {
+		fifo->front = 0;
+	}
+	fifo->count--;
+
+	return idx;
+}
+
+#endif /* ESB_BUF_POOL_H_ */
@@ -54,7 +54,8 @@ extern "C" {
  *
  * @return 0 if the Job Execution object is empty, 1 if Job Execution object was
  *	     correctly decoded, otherwise a negative error code is returned
- *	     identicating reason of failure.
+ *	     identicating reason of failure. -ENOMEM is returned if the document
+ *	     has more than CONFIG_AWS_FOTA_JSON_MAX_TOKENS tokens.
  **/
 int aws_fota_parse_DescribeJobExecution_rsp(const char *job_document,
 					    uint32_t payload_len,
@@ -73,7 +74,8 @@ int aws_fota_parse_DescribeJobExecution_rsp(const char *job_document,
  * @param[out] status  String with the AWS Job status after an update.
 
  * @return 0 for an successful parsing or a negative error code identicating
- *	   reason of failure.
+ *	   reason of failure. -ENOMEM is returned if the document has more than
+ *	   CONFIG_AWS_FOTA_JSON_MAX_TOKENS tokens.
  */
 int aws_fota_parse_UpdateJobExecution_rsp(const char *update_rsp_document,
 					  size_t payload_len,
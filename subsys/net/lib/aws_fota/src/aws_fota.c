@@ -17,6 +17,7 @@
 LOG_MODULE_REGISTER(aws_fota, CONFIG_AWS_FOTA_LOG_LEVEL);
 
 #define AWS_JOB_ID_DEFAULT "INVALID-JOB-ID"
+#define AWS_JOB_ID_NEXT "$next"
 
 static enum internal_state {
 	STATE_UNINIT,
@@ -25,16 +26,6 @@ static enum internal_state {
 	STATE_DOWNLOAD_COMPLETE,
 } internal_state = STATE_UNINIT;
 
-/* Enum used when parsing AWS jobs topics messages are received on. */
-enum jobs_topic {
-	TOPIC_INVALID,
-	TOPIC_GET_NEXT,
-	TOPIC_GET_ACCEPTED,
-	TOPIC_NOTIFY_NEXT,
-	TOPIC_UPDATE_ACCEPTED,
-	TOPIC_UPDATE_REJECTED
-};
-
 /* Pointer to internal reference of an initialized MQTT client instance. */
 static struct mqtt_client *client_internal;
 
@@ -52,6 +43,11 @@ static size_t download_progress;
 /* Variable that keeps tracks of the MQTT connection state. */
 static bool connected;
 
+/* Topics of the client, used for classifying the topics that messages are
+ * received on.
+ */
+static struct aws_jobs_topics topics;
+
 /* Allocated strings for topics. */
 static uint8_t notify_next_topic[AWS_JOBS_TOPIC_MAX_LEN];
 static uint8_t update_topic[AWS_JOBS_TOPIC_MAX_LEN];
@@ -105,8 +101,9 @@ static void reset_library(void)
 	LOG_DBG("Library reset");
 }
 
-/* Function that returns AWS jobs specific topic enums depending on the incoming topic. */
-static enum jobs_topic topic_type_get(const char *incoming_topic, size_t topic_len)
+/* Function that returns the type of the incoming topic, and the job ID in it. */
+static enum aws_jobs_topic_type topic_type_get(const char *incoming_topic, size_t topic_len,
+					       const char **job_id, size_t *job_id_len)
 {
 #if defined(CONFIG_AWS_FOTA_LOG_LEVEL_DBG)
 	char debug_log[topic_len + 1];
@@ -116,19 +113,7 @@ static enum jobs_topic topic_type_get(const char *incoming_topic, size_t topic_l
 	LOG_DBG("Received topic: %s", log_strdup(debug_log)); /* Make this debug */
 #endif
 
-	if (aws_jobs_cmp(get_topic, incoming_topic, topic_len, "")) {
-		return TOPIC_GET_NEXT;
-	} else if (aws_jobs_cmp(get_topic, incoming_topic, topic_len, "accepted")) {
-		return TOPIC_GET_ACCEPTED;
-	} else if (aws_jobs_cmp(notify_next_topic, incoming_topic, topic_len, "")) {
-		return TOPIC_NOTIFY_NEXT;
-	} else if (aws_jobs_cmp(update_topic, incoming_topic, topic_len, "accepted")) {
-		return TOPIC_UPDATE_ACCEPTED;
-	} else if (aws_jobs_cmp(update_topic, incoming_topic, topic_len, "rejected")) {
-		return TOPIC_UPDATE_REJECTED;
-	}
-
-	return TOPIC_INVALID;
+	return aws_jobs_topic_type_get(&topics, incoming_topic, topic_len, job_id, job_id_len);
 }
 
 /**
@@ -395,27 +380,17 @@ static int job_update_rejected(struct mqtt_client *const client,
 }
 
 /**
- * @brief Check if topic contains job ID string.
+ * @brief Check if a job ID is the one currently being handled.
  *
- * @param[in] topic Pointer to a string with topic to be checked.
- * @param[in] topic_len Length of the topic.
- * @param[in] job_id Pointer to a NULL terminated string that contains a job ID.
+ * @param[in] job_id Pointer to the job ID, not null-terminated.
+ * @param[in] job_id_len Length of the job ID.
  *
- * @return True if job ID is present in the topic string. Otherwise false is returned.
+ * @return True if the job ID is the one being handled. Otherwise false is returned.
  */
-static int is_job_id_in_topic(const char *topic, size_t topic_len, const char *job_id)
+static bool is_job_id_handled(const char *job_id, size_t job_id_len)
 {
-	/* strstr() depends on job_id being null terminated and smaller than topic. */
-	if (topic_len < strlen(job_id)) {
-		LOG_WRN("Job ID cannot be larger than incoming topic");
-		return false;
-	}
-
-	if (strstr(topic, job_id) == NULL) {
-		return false;
-	}
-
-	return true;
+	return (job_id_len == strlen(job_id_handling)) &&
+	       (memcmp(job_id, job_id_handling, job_id_len) == 0);
 }
 
 /**
@@ -437,37 +412,49 @@ static int on_publish_evt(struct mqtt_client *const client,
 				   uint32_t payload_len)
 {
 	int err;
-	enum jobs_topic type = topic_type_get(topic, topic_len);
+	const char *job_id = NULL;
+	size_t job_id_len = 0;
+	enum aws_jobs_topic_type type = topic_type_get(topic, topic_len, &job_id, &job_id_len);
 
 	switch (type) {
-	case TOPIC_GET_NEXT:
-	case TOPIC_GET_ACCEPTED:
-	case TOPIC_NOTIFY_NEXT:
+	case AWS_JOBS_TOPIC_GET:
+	case AWS_JOBS_TOPIC_GET_ACCEPTED:
+	case AWS_JOBS_TOPIC_GET_REJECTED:
+		/* Only the request for the next job and its responses are
+		 * handled.
+		 */
+		if ((job_id_len != sizeof(AWS_JOB_ID_NEXT) - 1) ||
+		    (memcmp(job_id, AWS_JOB_ID_NEXT, job_id_len) != 0)) {
+			return 1;
+		}
+
+		/* Fall through */
+	case AWS_JOBS_TOPIC_NOTIFY_NEXT:
 		if (internal_state != STATE_INIT) {
 			goto read_payload;
 		}
 
 		LOG_DBG("Checking for an available job");
 		return get_job_execution(client, payload_len);
-	case TOPIC_UPDATE_ACCEPTED:
+	case AWS_JOBS_TOPIC_UPDATE_ACCEPTED:
 		if (internal_state != STATE_INIT &&
 		    internal_state != STATE_DOWNLOAD_COMPLETE) {
 			goto read_payload;
 		}
 
-		if (!is_job_id_in_topic(topic, topic_len, job_id_handling)) {
+		if (!is_job_id_handled(job_id, job_id_len)) {
 			LOG_WRN("The currently handled job ID is not in incoming accepted topic");
 			goto read_payload;
 		}
 
 		return job_update_accepted(client, payload_len);
-	case TOPIC_UPDATE_REJECTED:
+	case AWS_JOBS_TOPIC_UPDATE_REJECTED:
 		if (internal_state != STATE_INIT &&
 		    internal_state != STATE_DOWNLOAD_COMPLETE) {
 			goto read_payload;
 		}
 
-		if (!is_job_id_in_topic(topic, topic_len, job_id_handling)) {
+		if (!is_job_id_handled(job_id, job_id_len)) {
 			LOG_WRN("The currently handled job ID is not in incoming rejected topic");
 			goto read_payload;
 		}
@@ -500,6 +487,12 @@ static int on_connack_evt(struct mqtt_client *const client)
 {
 	int err;
 
+	err = aws_jobs_topics_init(&topics, client->client_id.utf8);
+	if (err) {
+		LOG_ERR("Unable to construct the AWS IoT Jobs topics");
+		return err;
+	}
+
 	switch (internal_state) {
 	case STATE_INIT:
 		err = aws_jobs_subscribe_topic_notify_next(client, notify_next_topic);
@@ -508,7 +501,7 @@ static int on_connack_evt(struct mqtt_client *const client)
 			return err;
 		}
 
-		err = aws_jobs_subscribe_topic_get(client, "$next", get_topic);
+		err = aws_jobs_subscribe_topic_get(client, AWS_JOB_ID_NEXT, get_topic);
 		if (err) {
 			LOG_ERR("Unable to subscribe to jobs/$next/get");
 			return err;
@@ -544,7 +537,7 @@ static int on_suback_evt(struct mqtt_client *const client, uint16_t message_id)
 	case SUBSCRIBE_NOTIFY_NEXT:
 		LOG_DBG("Subscribed to notify-next topic");
 
-		err = aws_jobs_get_job_execution(client, "$next", get_topic);
+		err = aws_jobs_get_job_execution(client, AWS_JOB_ID_NEXT, get_topic);
 		if (err) {
 			LOG_ERR("aws_jobs_get_job_execution failed, error: %d", err);
 			return err;
@@ -752,7 +745,7 @@ static void http_fota_handler(const struct fota_download_evt *evt)
 		/* If the FOTA download fails it might be due to the image being deleted.
 		 * Try to get the next job if any exist.
 		 */
-		(void)aws_jobs_get_job_execution(client_internal, "$next", get_topic);
+		(void)aws_jobs_get_job_execution(client_internal, AWS_JOB_ID_NEXT, get_topic);
 		break;
 
 	case FOTA_DOWNLOAD_EVT_PROGRESS:
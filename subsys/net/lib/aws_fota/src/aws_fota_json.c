@@ -6,22 +6,574 @@
 
 #include <zephyr.h>
 #include <string.h>
-#include <cJSON.h>
+#include <limits.h>
 #include <sys/util.h>
 #include <net/aws_jobs.h>
 
 #include "aws_fota_json.h"
 
-/**@brief Copy max maxlen bytes from src to dst. Insert null-terminator.
+/* The documents are split into tokens by a single pass over the data, and the
+ * fields are then looked up among the tokens. The tokens only refer to the
+ * data, nothing is copied or allocated until a field value is copied to the
+ * output buffers.
+ *
+ * The tokens are stored in the order the values appear in the document. The
+ * value of an object member follows its key, and the members of an object or
+ * array follow the token of the object or array.
+ */
+
+enum json_type {
+	JSON_OBJECT,
+	JSON_ARRAY,
+	JSON_STRING,
+	JSON_NUMBER,
+	JSON_LITERAL,
+};
+
+struct json_tok {
+	/* Offsets of the first character of the value and the one after it.
+	 * The quotes of strings are not part of the value.
+	 */
+	uint16_t start;
+	uint16_t end;
+	/* Index of the token following the value and the values it contains.
+	 * While an object or array is being tokenized, it holds the index of
+	 * its parent instead.
+	 */
+	uint16_t next;
+	uint8_t type;
+};
+
+/* Index of the parent of the top-level value. */
+#define JSON_TOK_NONE UINT16_MAX
+
+/* What can follow in the document. */
+enum json_expect {
+	EXPECT_VALUE,
+	EXPECT_VALUE_OR_END,
+	EXPECT_KEY,
+	EXPECT_KEY_OR_END,
+	EXPECT_COLON,
+	EXPECT_COMMA_OR_END,
+	EXPECT_NOTHING,
+};
+
+struct json_doc {
+	const char *js;
+	struct json_tok *tok;
+	size_t count;
+};
+
+/* The documents are parsed from the MQTT event callback, one at a time, so
+ * the tokens of all of them are kept here instead of on the stack.
+ */
+static struct json_tok tokens[CONFIG_AWS_FOTA_JSON_MAX_TOKENS];
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+/* Returns the code unit of a \uXXXX escape starting at js, or -1. */
+static int32_t utf16_get(const char *js, size_t len)
+{
+	int32_t unit = 0;
+
+	if (len < 6 || js[0] != '\\' || js[1] != 'u') {
+		return -1;
+	}
+
+	for (size_t i = 2; i < 6; i++) {
+		int digit = hex_digit(js[i]);
+
+		if (digit < 0) {
+			return -1;
+		}
+
+		unit = (unit << 4) | digit;
+	}
+
+	return unit;
+}
+
+/* Returns the code point of the escape sequence starting at js, or -1 if it
+ * is not valid. The length of the escape sequence is stored in esc_len.
+ */
+static int32_t escape_get(const char *js, size_t len, size_t *esc_len)
+{
+	static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+	int32_t high;
+	int32_t low;
+
+	if (len < 2) {
+		return -1;
+	}
+
+	if (js[1] != 'u') {
+		for (size_t i = 0; i < sizeof(escapes) - 1; i += 2) {
+			if (js[1] == escapes[i]) {
+				*esc_len = 2;
+				return escapes[i + 1];
+			}
+		}
+
+		return -1;
+	}
+
+	high = utf16_get(js, len);
+	if (high < 0 || (high >= 0xDC00 && high <= 0xDFFF)) {
+		return -1;
+	} else if (high < 0xD800 || high > 0xDBFF) {
+		*esc_len = 6;
+		return high;
+	}
+
+	/* Characters outside the Basic Multilingual Plane are escaped as
+	 * surrogate pairs.
+	 */
+	low = utf16_get(js + 6, len - 6);
+	if (low < 0xDC00 || low > 0xDFFF) {
+		return -1;
+	}
+
+	*esc_len = 12;
+
+	return 0x10000 + (((high & 0x3FF) << 10) | (low & 0x3FF));
+}
+
+/* Returns the offset of the closing quote of the string starting at pos. */
+static int string_scan(const char *js, size_t len, size_t pos)
+{
+	size_t esc_len;
+
+	for (pos++; pos < len; pos++) {
+		if (js[pos] == '"') {
+			return pos;
+		} else if (js[pos] != '\\') {
+			continue;
+		}
+
+		if (escape_get(&js[pos], len - pos, &esc_len) < 0) {
+			return -ENODATA;
+		}
+
+		pos += esc_len - 1;
+	}
+
+	return -ENODATA;
+}
+
+static size_t digits_scan(const char *js, size_t len, size_t pos)
+{
+	while (pos < len && js[pos] >= '0' && js[pos] <= '9') {
+		pos++;
+	}
+
+	return pos;
+}
+
+/* Returns the offset following the number starting at pos. */
+static int number_scan(const char *js, size_t len, size_t pos)
+{
+	size_t digits;
+
+	if (js[pos] == '-') {
+		pos++;
+	}
+
+	/* No leading zeros. */
+	if (pos < len && js[pos] == '0') {
+		pos++;
+	} else {
+		digits = pos;
+		pos = digits_scan(js, len, pos);
+
+		if (pos == digits) {
+			return -ENODATA;
+		}
+	}
+
+	if (pos < len && js[pos] == '.') {
+		digits = ++pos;
+		pos = digits_scan(js, len, pos);
+
+		if (pos == digits) {
+			return -ENODATA;
+		}
+	}
+
+	if (pos < len && (js[pos] == 'e' || js[pos] == 'E')) {
+		pos++;
+
+		if (pos < len && (js[pos] == '+' || js[pos] == '-')) {
+			pos++;
+		}
+
+		digits = pos;
+		pos = digits_scan(js, len, pos);
+
+		if (pos == digits) {
+			return -ENODATA;
+		}
+	}
+
+	return pos;
+}
+
+/* Returns the offset following the literal starting at pos. */
+static int literal_scan(const char *js, size_t len, size_t pos)
+{
+	static const char *const literals[] = { "true", "false", "null" };
+
+	for (size_t i = 0; i < ARRAY_SIZE(literals); i++) {
+		size_t literal_len = strlen(literals[i]);
+
+		if ((len - pos >= literal_len) &&
+		    (memcmp(&js[pos], literals[i], literal_len) == 0)) {
+			return pos + literal_len;
+		}
+	}
+
+	return -ENODATA;
+}
+
+/* Split the first JSON value in js into tokens. Anything following it is
+ * ignored.
+ */
+static int json_tokenize(struct json_doc *doc, const char *js, size_t len)
+{
+	enum json_expect expect = EXPECT_VALUE;
+	uint16_t parent = JSON_TOK_NONE;
+	struct json_tok *tok;
+	size_t pos = 0;
+	int end;
+
+	if (len >= JSON_TOK_NONE) {
+		return -EMSGSIZE;
+	}
+
+	doc->js = js;
+	doc->tok = tokens;
+	doc->count = 0;
+
+	while ((pos < len) && (expect != EXPECT_NOTHING)) {
+		char c = js[pos];
+
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+			pos++;
+			continue;
+		}
+
+		switch (expect) {
+		case EXPECT_COLON:
+			if (c != ':') {
+				return -ENODATA;
+			}
+
+			expect = EXPECT_VALUE;
+			pos++;
+			continue;
+		case EXPECT_COMMA_OR_END:
+			if (c == ',') {
+				expect = (doc->tok[parent].type == JSON_OBJECT) ?
+					 EXPECT_KEY : EXPECT_VALUE;
+				pos++;
+				continue;
+			} else if (c != '}' && c != ']') {
+				return -ENODATA;
+			}
+
+			break;
+		case EXPECT_KEY:
+		case EXPECT_KEY_OR_END:
+			if (c != '"' && !(c == '}' && expect == EXPECT_KEY_OR_END)) {
+				return -ENODATA;
+			}
+
+			break;
+		case EXPECT_VALUE:
+			if (c == '}' || c == ']') {
+				return -ENODATA;
+			}
+
+			break;
+		default:
+			break;
+		}
+
+		if (c == '}' || c == ']') {
+			/* End of an object or array, the members are complete. */
+			tok = &doc->tok[parent];
+
+			if (tok->type != ((c == '}') ? JSON_OBJECT : JSON_ARRAY)) {
+				return -ENODATA;
+			}
+
+			tok->end = ++pos;
+			parent = tok->next;
+			tok->next = doc->count;
+		} else if (c == ',' || c == ':') {
+			return -ENODATA;
+		} else {
+			if (doc->count == ARRAY_SIZE(tokens)) {
+				return -ENOMEM;
+			}
+
+			tok = &doc->tok[doc->count++];
+			tok->start = pos;
+			tok->next = doc->count;
+
+			if (c == '{' || c == '[') {
+				tok->type = (c == '{') ? JSON_OBJECT : JSON_ARRAY;
+				tok->next = parent;
+				parent = doc->count - 1;
+				expect = (c == '{') ? EXPECT_KEY_OR_END :
+						      EXPECT_VALUE_OR_END;
+				pos++;
+				continue;
+			} else if (c == '"') {
+				tok->type = JSON_STRING;
+				tok->start = pos + 1;
+				end = string_scan(js, len, pos);
+				if (end < 0) {
+					return end;
+				}
+
+				tok->end = end;
+				pos = end + 1;
+
+				if (expect == EXPECT_KEY ||
+				    expect == EXPECT_KEY_OR_END) {
+					expect = EXPECT_COLON;
+					continue;
+				}
+			} else {
+				if (c == '-' || (c >= '0' && c <= '9')) {
+					tok->type = JSON_NUMBER;
+					end = number_scan(js, len, pos);
+				} else {
+					tok->type = JSON_LITERAL;
+					end = literal_scan(js, len, pos);
+				}
+
+				if (end < 0) {
+					return end;
+				}
+
+				tok->end = end;
+				pos = end;
+			}
+		}
+
+		/* A value is complete. */
+		expect = (parent == JSON_TOK_NONE) ? EXPECT_NOTHING :
+						     EXPECT_COMMA_OR_END;
+	}
+
+	if (expect != EXPECT_NOTHING) {
+		/* The document ended in the middle of a value. */
+		return -ENODATA;
+	}
+
+	return 0;
+}
+
+/* Append n bytes to the string of length len in dst, as many as fit. Returns
+ * the length of the string if nothing was left out.
  */
-static void strncpy_nullterm(char *dst, const char *src, size_t maxlen)
+static size_t string_append(char *dst, size_t dst_size, size_t len,
+			    const void *src, size_t n)
+{
+	if (len + 1 < dst_size) {
+		memcpy(&dst[len], src, MIN(n, dst_size - 1 - len));
+	}
+
+	return len + n;
+}
+
+/* Copy the value of a string token to dst, unescaped. At most dst_size bytes
+ * are written, including the null-terminator. Returns the length of the
+ * whole value, which is larger than dst_size - 1 if it was truncated.
+ */
+static size_t json_string_copy(const struct json_doc *doc,
+			       const struct json_tok *tok,
+			       char *dst, size_t dst_size)
+{
+	const char *js = doc->js;
+	size_t pos = tok->start;
+	size_t len = 0;
+
+	while (pos < tok->end) {
+		const char *esc = memchr(&js[pos], '\\', tok->end - pos);
+		size_t run = (esc ? (size_t)(esc - js) : tok->end) - pos;
+		uint8_t utf8[4];
+		size_t utf8_len;
+		size_t esc_len;
+		int32_t code;
+
+		/* The characters up to the next escape are copied as they are. */
+		len = string_append(dst, dst_size, len, &js[pos], run);
+		pos += run;
+
+		if (esc == NULL) {
+			break;
+		}
+
+		/* Escapes were validated when tokenizing. */
+		code = escape_get(&js[pos], tok->end - pos, &esc_len);
+		pos += esc_len;
+
+		if (code == 0) {
+			/* An escaped null character ends a C string. */
+			break;
+		} else if (code < 0x80) {
+			utf8[0] = code;
+			utf8_len = 1;
+		} else if (code < 0x800) {
+			utf8[0] = 0xC0 | (code >> 6);
+			utf8[1] = 0x80 | (code & 0x3F);
+			utf8_len = 2;
+		} else if (code < 0x10000) {
+			utf8[0] = 0xE0 | (code >> 12);
+			utf8[1] = 0x80 | ((code >> 6) & 0x3F);
+			utf8[2] = 0x80 | (code & 0x3F);
+			utf8_len = 3;
+		} else {
+			utf8[0] = 0xF0 | (code >> 18);
+			utf8[1] = 0x80 | ((code >> 12) & 0x3F);
+			utf8[2] = 0x80 | ((code >> 6) & 0x3F);
+			utf8[3] = 0x80 | (code & 0x3F);
+			utf8_len = 4;
+		}
+
+		len = string_append(dst, dst_size, len, utf8, utf8_len);
+	}
+
+	if (dst_size > 0) {
+		dst[MIN(len, dst_size - 1)] = '\0';
+	}
+
+	return len;
+}
+
+/* Returns the value of the first member of the object with the given name, or
+ * NULL if there is none.
+ */
+static const struct json_tok *json_obj_get(const struct json_doc *doc,
+					   const struct json_tok *obj,
+					   const char *name)
+{
+	size_t name_len = strlen(name);
+	size_t i = (obj - doc->tok) + 1;
+
+	if (obj->type != JSON_OBJECT) {
+		return NULL;
+	}
+
+	while (i < obj->next) {
+		const struct json_tok *key = &doc->tok[i];
+		const struct json_tok *value = &doc->tok[i + 1];
+
+		/* Keys with escapes are compared after unescaping them, the
+		 * rest as they are.
+		 */
+		if (memchr(&doc->js[key->start], '\\', key->end - key->start)) {
+			char buf[name_len + 2];
+
+			if (json_string_copy(doc, key, buf, sizeof(buf)) == name_len &&
+			    memcmp(buf, name, name_len) == 0) {
+				return value;
+			}
+		} else if ((key->end - key->start == name_len) &&
+			   (memcmp(&doc->js[key->start], name, name_len) == 0)) {
+			return value;
+		}
+
+		i = value->next;
+	}
+
+	return NULL;
+}
+
+static const struct json_tok *json_obj_get_type(const struct json_doc *doc,
+						const struct json_tok *obj,
+						const char *name,
+						enum json_type type)
 {
-	size_t len = strlen(src) + 1;
+	const struct json_tok *value = json_obj_get(doc, obj, name);
 
-	memcpy(dst, src, MIN(len, maxlen));
-	if (len > maxlen) {
-		dst[maxlen - 1] = '\0';
+	if (value == NULL || value->type != type) {
+		return NULL;
 	}
+
+	return value;
+}
+
+/* Integer part of a number token, limited to the range of int. */
+static int json_number_to_int(const struct json_doc *doc,
+			      const struct json_tok *tok)
+{
+	const char *js = doc->js;
+	size_t pos = tok->start;
+	bool negative = false;
+	double value = 0;
+	double scale = 1;
+	int exponent = 0;
+	bool exponent_negative = false;
+
+	if (js[pos] == '-') {
+		negative = true;
+		pos++;
+	}
+
+	for (; pos < tok->end && js[pos] >= '0' && js[pos] <= '9'; pos++) {
+		value = value * 10 + (js[pos] - '0');
+	}
+
+	if (pos < tok->end && js[pos] == '.') {
+		for (pos++; pos < tok->end && js[pos] >= '0' && js[pos] <= '9'; pos++) {
+			scale /= 10;
+			value += (js[pos] - '0') * scale;
+		}
+	}
+
+	if (pos < tok->end) {
+		/* Exponent, the number was validated when tokenizing. */
+		pos++;
+
+		if (js[pos] == '+' || js[pos] == '-') {
+			exponent_negative = (js[pos] == '-');
+			pos++;
+		}
+
+		for (; pos < tok->end && exponent < 1000; pos++) {
+			exponent = exponent * 10 + (js[pos] - '0');
+		}
+
+		for (; exponent > 0; exponent--) {
+			value = exponent_negative ? value / 10 : value * 10;
+		}
+	}
+
+	if (negative) {
+		value = -value;
+	}
+
+	if (value >= INT_MAX) {
+		return INT_MAX;
+	} else if (value <= (double)INT_MIN) {
+		return INT_MIN;
+	}
+
+	return (int)value;
 }
 
 int aws_fota_parse_UpdateJobExecution_rsp(const char *update_rsp_document,
@@ -31,29 +583,23 @@ int aws_fota_parse_UpdateJobExecution_rsp(const char *update_rsp_document,
 		return -EINVAL;
 	}
 
+	struct json_doc doc;
+	const struct json_tok *status;
 	int ret;
 
-	cJSON *update_response = cJSON_Parse(update_rsp_document);
-
-	if (update_response == NULL) {
-		ret = -ENODATA;
-		goto cleanup;
+	ret = json_tokenize(&doc, update_rsp_document, payload_len);
+	if (ret) {
+		return ret;
 	}
 
-	cJSON *status = cJSON_GetObjectItemCaseSensitive(update_response,
-							  "status");
-	if (cJSON_IsString(status) && status->valuestring != NULL) {
-		strncpy_nullterm(status_buf, status->valuestring,
-				 STATUS_MAX_LEN);
-	} else {
-		ret = -ENODATA;
-		goto cleanup;
+	status = json_obj_get_type(&doc, &doc.tok[0], "status", JSON_STRING);
+	if (status == NULL) {
+		return -ENODATA;
 	}
 
-	ret = 0;
-cleanup:
-	cJSON_Delete(update_response);
-	return ret;
+	json_string_copy(&doc, status, status_buf, STATUS_MAX_LEN);
+
+	return 0;
 }
 
 int aws_fota_parse_DescribeJobExecution_rsp(const char *job_document,
@@ -71,74 +617,52 @@ int aws_fota_parse_DescribeJobExecution_rsp(const char *job_document,
 		return -EINVAL;
 	}
 
+	struct json_doc doc;
+	const struct json_tok *execution;
+	const struct json_tok *job_id;
+	const struct json_tok *job_data;
+	const struct json_tok *location;
+	const struct json_tok *hostname;
+	const struct json_tok *path;
+	const struct json_tok *version_number;
 	int ret;
 
-	cJSON *json_data = cJSON_Parse(job_document);
-
-	if (json_data == NULL) {
-		ret = -ENODATA;
-		goto cleanup;
+	ret = json_tokenize(&doc, job_document, payload_len);
+	if (ret) {
+		return ret;
 	}
 
-	cJSON *execution = cJSON_GetObjectItemCaseSensitive(json_data,
-							    "execution");
+	execution = json_obj_get(&doc, &doc.tok[0], "execution");
 	if (execution == NULL) {
-		ret = 0;
-		goto cleanup;
+		return 0;
 	}
 
-	cJSON *job_id = cJSON_GetObjectItemCaseSensitive(execution, "jobId");
-
-	if (cJSON_GetStringValue(job_id) != NULL) {
-		strncpy_nullterm(job_id_buf, job_id->valuestring,
-				AWS_JOBS_JOB_ID_MAX_LEN);
-	} else {
-		ret = -ENODATA;
-		goto cleanup;
+	job_id = json_obj_get_type(&doc, execution, "jobId", JSON_STRING);
+	job_data = json_obj_get_type(&doc, execution, "jobDocument",
+				     JSON_OBJECT);
+	if (job_id == NULL || job_data == NULL) {
+		return -ENODATA;
 	}
 
-	cJSON *job_data = cJSON_GetObjectItemCaseSensitive(execution,
-							   "jobDocument");
-
-	if (!cJSON_IsObject(job_data)) {
-		ret = -ENODATA;
-		goto cleanup;
-	}
-
-	cJSON *location = cJSON_GetObjectItemCaseSensitive(job_data,
-							    "location");
-
-	if (!cJSON_IsObject(location)) {
-		ret = -ENODATA;
-		goto cleanup;
+	location = json_obj_get_type(&doc, job_data, "location", JSON_OBJECT);
+	if (location == NULL) {
+		return -ENODATA;
 	}
 
-	cJSON *hostname = cJSON_GetObjectItemCaseSensitive(location, "host");
-	cJSON *path = cJSON_GetObjectItemCaseSensitive(location, "path");
-
-	if ((cJSON_GetStringValue(hostname) != NULL)
-	   && (cJSON_GetStringValue(path) != NULL)) {
-		strncpy_nullterm(hostname_buf, hostname->valuestring,
-				CONFIG_AWS_FOTA_HOSTNAME_MAX_LEN);
-		strncpy_nullterm(file_path_buf, path->valuestring,
-				CONFIG_AWS_FOTA_FILE_PATH_MAX_LEN);
-	} else {
-		ret = -ENODATA;
-		goto cleanup;
+	hostname = json_obj_get_type(&doc, location, "host", JSON_STRING);
+	path = json_obj_get_type(&doc, location, "path", JSON_STRING);
+	version_number = json_obj_get_type(&doc, execution, "versionNumber",
+					   JSON_NUMBER);
+	if (hostname == NULL || path == NULL || version_number == NULL) {
+		return -ENODATA;
 	}
 
-	cJSON *version_number = cJSON_GetObjectItemCaseSensitive(
-					execution, "versionNumber");
-
-	if (cJSON_IsNumber(version_number)) {
-		*execution_version_number = version_number->valueint;
-	} else {
-		ret = -ENODATA;
-		goto cleanup;
-	}
+	json_string_copy(&doc, job_id, job_id_buf, AWS_JOBS_JOB_ID_MAX_LEN);
+	json_string_copy(&doc, hostname, hostname_buf,
+			 CONFIG_AWS_FOTA_HOSTNAME_MAX_LEN);
+	json_string_copy(&doc, path, file_path_buf,
+			 CONFIG_AWS_FOTA_FILE_PATH_MAX_LEN);
+	*execution_version_number = json_number_to_int(&doc, version_number);
 
-	ret = 1;
-cleanup:
-	cJSON_Delete(json_data);
-	return ret;
+	return 1;
 }
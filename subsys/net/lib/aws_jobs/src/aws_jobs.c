@@ -6,6 +6,7 @@
 #include <zephyr.h>
 #include <random/rand32.h>
 #include <stdio.h>
+#include <string.h>
 #include <net/mqtt.h>
 #include <logging/log.h>
 #include <net/aws_jobs.h>
@@ -27,33 +28,71 @@ static const char *execution_status_strings[] = {
 struct topic_conf {
 	int msg_id;
 	const uint8_t *name;
+	size_t name_len;
 	const char *suffix;
+	size_t suffix_len;
 };
 
-const struct topic_conf TOPIC_NOTIFY_NEXT_CONF = {
-	.msg_id = SUBSCRIBE_NOTIFY_NEXT,
-	.name = "notify-next",
-	.suffix = "",
+#define TOPIC_CONF(_msg_id, _name, _suffix) {				\
+	.msg_id = _msg_id,						\
+	.name = _name,							\
+	.name_len = sizeof(_name) - 1,					\
+	.suffix = _suffix,						\
+	.suffix_len = sizeof(_suffix) - 1,				\
+}
+
+const struct topic_conf TOPIC_NOTIFY_NEXT_CONF =
+	TOPIC_CONF(SUBSCRIBE_NOTIFY_NEXT, "notify-next", "");
+
+const struct topic_conf TOPIC_NOTIFY_CONF =
+	TOPIC_CONF(SUBSCRIBE_NOTIFY, "notify", "");
+
+const struct topic_conf TOPIC_GET_CONF =
+	TOPIC_CONF(SUBSCRIBE_JOB_ID_GET, "get", "/#");
+
+const struct topic_conf TOPIC_UPDATE_CONF =
+	TOPIC_CONF(SUBSCRIBE_JOB_ID_UPDATE, "update", "/#");
+
+#define TOPIC_JOBS "/jobs/"
+#define TOPIC_JOBS_LEN (sizeof(TOPIC_JOBS) - 1)
+
+/* Topics that are not specific to a job, "<prefix><name>". */
+static const struct topic_conf *const client_topics[] = {
+	&TOPIC_NOTIFY_CONF,
+	&TOPIC_NOTIFY_NEXT_CONF,
+};
+
+static const enum aws_jobs_topic_type client_topic_types[] = {
+	AWS_JOBS_TOPIC_NOTIFY,
+	AWS_JOBS_TOPIC_NOTIFY_NEXT,
 };
 
-const struct topic_conf TOPIC_NOTIFY_CONF = {
-	.msg_id = SUBSCRIBE_NOTIFY,
-	.name = "notify",
-	.suffix = "",
+/* Topics of a job, "<prefix><job ID>/<operation>/<result>". The types are
+ * indexed by operation and result.
+ */
+static const struct topic_conf *const job_operations[] = {
+	&TOPIC_GET_CONF,
+	&TOPIC_UPDATE_CONF,
 };
 
-const struct topic_conf TOPIC_GET_CONF = {
-	.msg_id = SUBSCRIBE_JOB_ID_GET,
-	.name = "get",
-	.suffix = "/#",
+#define JOB_RESULT_LEN (sizeof("accepted") - 1)
+static const char *const job_results[] = {
+	"accepted",
+	"rejected",
 };
 
-const struct topic_conf TOPIC_UPDATE_CONF = {
-	.msg_id = SUBSCRIBE_JOB_ID_UPDATE,
-	.name = "update",
-	.suffix = "/#",
+static const enum aws_jobs_topic_type job_topic_types[][ARRAY_SIZE(job_results)] = {
+	{ AWS_JOBS_TOPIC_GET_ACCEPTED, AWS_JOBS_TOPIC_GET_REJECTED },
+	{ AWS_JOBS_TOPIC_UPDATE_ACCEPTED, AWS_JOBS_TOPIC_UPDATE_REJECTED },
 };
 
+static char *append(char *dst, const char *src, size_t len)
+{
+	memcpy(dst, src, len);
+
+	return dst + len;
+}
+
 /**
  * @brief Constructs a topic for AWS jobs.
  *
@@ -68,7 +107,6 @@ const struct topic_conf TOPIC_UPDATE_CONF = {
  * @retval 0 If sucessful otherwise an error message.
  *
  */
-#define TOPIC_TEMPLATE "$aws/things/%s/jobs/%s%s%s%s"
 static int construct_topic(const uint8_t *client_id, const uint8_t *job_id,
 			   const struct topic_conf *conf, uint8_t *out_buf,
 			   struct mqtt_topic *topic, bool remove_suffix)
@@ -79,23 +117,37 @@ static int construct_topic(const uint8_t *client_id, const uint8_t *job_id,
 		return -EINVAL;
 	}
 
-	const char *suffix = remove_suffix  ? "" : conf->suffix;
-	const char *slash_after_job_id = strlen(job_id) > 0 ? "/" : "";
-	int ret = snprintf(out_buf, AWS_JOBS_TOPIC_MAX_LEN, TOPIC_TEMPLATE,
-			client_id, job_id, slash_after_job_id, conf->name,
-			suffix);
-
-	if (ret >= AWS_JOBS_TOPIC_MAX_LEN) {
+	/* The topic is "$aws/things/<client ID>/jobs/[<job ID>/]<name><suffix>".
+	 * All lengths are known up front, so the parts are copied as they are
+	 * instead of formatting the topic.
+	 */
+	size_t client_id_len = strlen(client_id);
+	size_t job_id_len = strlen(job_id);
+	size_t suffix_len = remove_suffix ? 0 : conf->suffix_len;
+	size_t len = AWS_LEN + client_id_len + TOPIC_JOBS_LEN + job_id_len +
+		     (job_id_len > 0 ? 1 : 0) + conf->name_len + suffix_len;
+	char *pos = (char *)out_buf;
+
+	if (len >= AWS_JOBS_TOPIC_MAX_LEN) {
 		LOG_ERR("Unable to fit formated string into to allocate "
 			"memory for %s", log_strdup(conf->name));
 		return -ENOMEM;
-	} else if (ret < 0) {
-		LOG_ERR("Output error for %s was encountered with return value "
-			"%d", log_strdup(conf->name), ret);
-		return ret;
 	}
 
-	topic->topic.size = ret;
+	pos = append(pos, AWS, AWS_LEN);
+	pos = append(pos, client_id, client_id_len);
+	pos = append(pos, TOPIC_JOBS, TOPIC_JOBS_LEN);
+
+	if (job_id_len > 0) {
+		pos = append(pos, job_id, job_id_len);
+		pos = append(pos, "/", 1);
+	}
+
+	pos = append(pos, conf->name, conf->name_len);
+	pos = append(pos, conf->suffix, suffix_len);
+	*pos = '\0';
+
+	topic->topic.size = len;
 	topic->topic.utf8 = out_buf;
 	topic->qos = MQTT_QOS_1_AT_LEAST_ONCE;
 	return 0;
@@ -309,3 +361,153 @@ bool aws_jobs_cmp(const char *sub, const char *pub, size_t pub_len,
 		return ret == 0;
 	}
 }
+
+int aws_jobs_topics_init(struct aws_jobs_topics *topics, const char *client_id)
+{
+	if (topics == NULL || client_id == NULL) {
+		return -EINVAL;
+	}
+
+	size_t client_id_len = strlen(client_id);
+	char *pos = topics->prefix;
+
+	if (client_id_len > CONFIG_CLIENT_ID_MAX_LEN) {
+		LOG_ERR("Client ID is too long");
+		return -ENOMEM;
+	}
+
+	pos = append(pos, AWS, AWS_LEN);
+	pos = append(pos, client_id, client_id_len);
+	pos = append(pos, TOPIC_JOBS, TOPIC_JOBS_LEN);
+	*pos = '\0';
+
+	topics->prefix_len = pos - topics->prefix;
+
+	return 0;
+}
+
+static bool segment_equal(const char *segment, size_t segment_len,
+			  const char *name, size_t name_len)
+{
+	return (segment_len == name_len) &&
+	       (memcmp(segment, name, name_len) == 0);
+}
+
+/* Returns the last slash in str, or NULL if there is none. */
+static const char *slash_find_last(const char *str, size_t len)
+{
+	while (len > 0) {
+		len--;
+
+		if (str[len] == '/') {
+			return &str[len];
+		}
+	}
+
+	return NULL;
+}
+
+/* Returns the type of a job topic from its operation and result. */
+static enum aws_jobs_topic_type job_topic_type_get(const char *operation,
+						   size_t operation_len,
+						   const char *result)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(job_operations); i++) {
+		if (!segment_equal(operation, operation_len,
+				   job_operations[i]->name,
+				   job_operations[i]->name_len)) {
+			continue;
+		}
+
+		for (size_t j = 0; j < ARRAY_SIZE(job_results); j++) {
+			if (memcmp(result, job_results[j], JOB_RESULT_LEN) == 0) {
+				return job_topic_types[i][j];
+			}
+		}
+	}
+
+	return AWS_JOBS_TOPIC_UNKNOWN;
+}
+
+enum aws_jobs_topic_type aws_jobs_topic_type_get(const struct aws_jobs_topics *topics,
+						 const char *topic, size_t topic_len,
+						 const char **job_id, size_t *job_id_len)
+{
+	enum aws_jobs_topic_type type;
+	const char *name;
+	const char *operation;
+	const char *result;
+	const char *slash;
+	size_t name_len;
+	size_t operation_len;
+	size_t id_len;
+
+	if (topics == NULL || topic == NULL ||
+	    topic_len <= topics->prefix_len ||
+	    memcmp(topic, topics->prefix, topics->prefix_len) != 0) {
+		return AWS_JOBS_TOPIC_UNKNOWN;
+	}
+
+	name = topic + topics->prefix_len;
+	name_len = topic_len - topics->prefix_len;
+
+	for (size_t i = 0; i < ARRAY_SIZE(client_topics); i++) {
+		if (segment_equal(name, name_len, client_topics[i]->name,
+				  client_topics[i]->name_len)) {
+			return client_topic_types[i];
+		}
+	}
+
+	/* Split "<job ID>/<operation>/<result>" at the last two slashes. A get
+	 * request has no result, "<job ID>/get", and is received back on the
+	 * subscription to "<job ID>/get/#".
+	 */
+	slash = slash_find_last(name, name_len);
+	if (slash == NULL) {
+		return AWS_JOBS_TOPIC_UNKNOWN;
+	}
+
+	operation = slash + 1;
+	operation_len = name + name_len - operation;
+
+	if (segment_equal(operation, operation_len, TOPIC_GET_CONF.name,
+			  TOPIC_GET_CONF.name_len)) {
+		type = AWS_JOBS_TOPIC_GET;
+	} else {
+		/* Both results have the same length. */
+		result = operation;
+		if (operation_len != JOB_RESULT_LEN) {
+			return AWS_JOBS_TOPIC_UNKNOWN;
+		}
+
+		slash = slash_find_last(name, slash - name);
+		if (slash == NULL) {
+			return AWS_JOBS_TOPIC_UNKNOWN;
+		}
+
+		operation = slash + 1;
+		operation_len = result - 1 - operation;
+
+		type = job_topic_type_get(operation, operation_len, result);
+		if (type == AWS_JOBS_TOPIC_UNKNOWN) {
+			return AWS_JOBS_TOPIC_UNKNOWN;
+		}
+	}
+
+	id_len = slash - name;
+
+	if (id_len == 0 || id_len >= AWS_JOBS_JOB_ID_MAX_LEN ||
+	    memchr(name, '/', id_len) != NULL) {
+		return AWS_JOBS_TOPIC_UNKNOWN;
+	}
+
+	if (job_id != NULL) {
+		*job_id = name;
+	}
+
+	if (job_id_len != NULL) {
+		*job_id_len = id_len;
+	}
+
+	return type;
+}
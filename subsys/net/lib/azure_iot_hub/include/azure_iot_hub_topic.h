@@ -36,6 +36,31 @@ enum topic_type {
 	TOPIC_TYPE_EMPTY,
 };
 
+/* Part of a topic buffer. Not null-terminated. */
+struct topic_parser_str {
+	const char *ptr;
+	size_t len;
+};
+
+/* Elements of a topic, pointing into the topic buffer. */
+struct topic_parser_tokens {
+	/* Topic type. */
+	enum topic_type type;
+	/* Dynamic topic level: the device ID for TOPIC_TYPE_DEVICEBOUND, the
+	 * method name for TOPIC_TYPE_DIRECT_METHOD or the status code for
+	 * TOPIC_TYPE_TWIN_UPDATE_RESULT and TOPIC_TYPE_DPS_REG_RESULT.
+	 */
+	struct topic_parser_str value;
+	/* Property bags, iterated over with azure_iot_hub_prop_bag_iter_next(). */
+	struct topic_parser_str prop_bags;
+};
+
+/* Property bag iterator. */
+struct topic_parser_prop_bag_iter {
+	const char *pos;
+	const char *end;
+};
+
 struct topic_parser_prop_bag {
 	/* Null-terminated key string. */
 	char key[TOPIC_PROP_BAG_FIELD_MAX_LEN + 1];
@@ -89,13 +114,51 @@ static inline void azure_iot_hub_prop_bag_free(char *buf)
  */
 enum topic_type topic_type_get(const char *buf, const size_t len);
 
+/* @brief Split a topic into its elements, without copying or modifying the
+ *	  topic buffer. The topic type is determined from the topic prefix.
+ *
+ * @param topic Topic buffer, not necessarily null-terminated.
+ * @param topic_len Length of topic buffer.
+ * @param tokens Pointer to structure where the topic elements are stored.
+ *		 The elements point into the topic buffer, and are valid as
+ *		 long as the buffer is.
+ *
+ * @return 0 on success, also for topics of unexpected type.
+ *	   -EINVAL if the topic is empty, -EFAULT if the topic is malformed.
+ */
+int azure_iot_hub_topic_tokenize(const char *topic, size_t topic_len,
+				 struct topic_parser_tokens *const tokens);
+
+/* @brief Initialize an iterator over the property bags of a topic.
+ *
+ * @param iter Pointer to iterator.
+ * @param tokens Pointer to topic elements from azure_iot_hub_topic_tokenize().
+ */
+void azure_iot_hub_prop_bag_iter_init(struct topic_parser_prop_bag_iter *iter,
+				      const struct topic_parser_tokens *tokens);
+
+/* @brief Get the next property bag, on the format "<key>[=[<value>]]".
+ *
+ * @param iter Pointer to iterator.
+ * @param key Pointer to where the key is stored.
+ * @param value Pointer to where the value is stored. The value pointer is
+ *		NULL if the property bag has no '=', the length is zero if
+ *		the value is empty.
+ *
+ * @return true if a property bag was found, false if there are no more.
+ */
+bool azure_iot_hub_prop_bag_iter_next(struct topic_parser_prop_bag_iter *iter,
+				      struct topic_parser_str *key,
+				      struct topic_parser_str *value);
+
 /* @brief Parse topic.
  *
  * @param data Pointer to topic data structure. The structure must
  *	       be initialized with a topic buffer pointer and topic
- *	       length. The struct member type must be set to
- *	       TOPIC_TYPE_UNKNOWN if the topic type has not already
- *	       been correctly determined.
+ *	       length. The topic type is determined from the topic.
+ *	       The first TOPIC_PROP_BAG_COUNT property bags are copied
+ *	       to the structure, use azure_iot_hub_topic_tokenize() to
+ *	       access all of them.
  *
  * @return 0 on success, otherwise negative error code.
  */
@@ -18,12 +18,20 @@ LOG_MODULE_REGISTER(azure_iot_hub_topic, CONFIG_AZURE_IOT_HUB_LOG_LEVEL);
 #define PROP_BAG_STR_EMPTY_VAL	"%s="
 #define PROP_BAG_STR_NO_VAL	"%s"
 
-static char *topic_prefixes[] = {
-	[TOPIC_TYPE_DEVICEBOUND] = TOPIC_PREFIX_DEVICEBOUND,
-	[TOPIC_TYPE_TWIN_UPDATE_DESIRED] = TOPIC_PREFIX_TWIN_DESIRED,
-	[TOPIC_TYPE_TWIN_UPDATE_RESULT] = TOPIC_PREFIX_TWIN_RES,
-	[TOPIC_TYPE_DPS_REG_RESULT] = TOPIC_PREFIX_DPS_REG_RESULT,
-	[TOPIC_TYPE_DIRECT_METHOD] = TOPIC_PREFIX_DIRECT_METHOD,
+struct topic_prefix {
+	const char *str;
+	size_t len;
+};
+
+#define TOPIC_PREFIX(_type, _str) \
+	[_type] = { .str = _str, .len = sizeof(_str) - 1 }
+
+static const struct topic_prefix topic_prefixes[] = {
+	TOPIC_PREFIX(TOPIC_TYPE_DEVICEBOUND, TOPIC_PREFIX_DEVICEBOUND),
+	TOPIC_PREFIX(TOPIC_TYPE_TWIN_UPDATE_DESIRED, TOPIC_PREFIX_TWIN_DESIRED),
+	TOPIC_PREFIX(TOPIC_TYPE_TWIN_UPDATE_RESULT, TOPIC_PREFIX_TWIN_RES),
+	TOPIC_PREFIX(TOPIC_TYPE_DPS_REG_RESULT, TOPIC_PREFIX_DPS_REG_RESULT),
+	TOPIC_PREFIX(TOPIC_TYPE_DIRECT_METHOD, TOPIC_PREFIX_DIRECT_METHOD),
 };
 
 /* If the topic type is TOPIC_TYPE_DEVICEBOUND, the dynamic value in the
@@ -34,206 +42,184 @@ static char *topic_prefixes[] = {
  * consistently enforced on the cloud side, and the topic may or may not
  * contain '?' as separator.
  */
-#define TOPIC_DEVICE_BOUND_SUFFIX	"messages/devicebound/"
+#define TOPIC_DEVICE_BOUND_SUFFIX	"messages/devicebound"
+#define TOPIC_DEVICE_BOUND_SUFFIX_LEN	(sizeof(TOPIC_DEVICE_BOUND_SUFFIX) - 1)
 
-/* Move a pointer forward by the number of bytes corresponding to the
- * prefix length of the relevant topic.
- */
-static inline char *skip_prefix(char *const buf, enum topic_type type)
+/* Copy a part of the topic to a buffer as a null-terminated string. */
+static int str_copy(char *buf, size_t buf_size,
+		    const struct topic_parser_str *str)
 {
-	return buf + strlen(topic_prefixes[type]);
-}
+	if (str->len >= buf_size) {
+		return -ENOMEM;
+	}
 
-/* Get the next occurence of a character within a string, where the length
- * of the string to inspect is set by the max argument.
- */
-static inline char *get_next_occurrence(char *str, char c, size_t max)
-{
-	for (size_t i = 0; i < max; i++) {
-		if (str[i] == c) {
-			return &str[i];
-		}
+	if (str->len > 0) {
+		memcpy(buf, str->ptr, str->len);
 	}
 
-	return NULL;
+	buf[str->len] = '\0';
+
+	return 0;
 }
 
-/* Gets the next property bag, on the format "<key>[=[<value>]]", where '=' and
- * value are optional.
- *
- * @retval the length of parsed property bag on success.
- * @retval 0 if there was no property bag the provided buffer.
- * @retval -ENOMEM if the key or value is too long for the buffer set by
- *	   CONFIG_AZURE_IOT_HUB_TOPIC_ELEMENT_MAX_LEN.
- */
-static int get_next_prop_bag(char *buf, size_t buf_len,
-			     struct topic_parser_prop_bag *const bag)
+enum topic_type topic_type_get(const char *buf, const size_t len)
 {
-	char *start_ptr = buf;
-	const char *max_ptr = buf + buf_len;
-	char *end_ptr;
-	size_t len;
-	size_t parsed_len;
-
-	if (buf_len == 0) {
-		return 0;
+	if (buf == NULL || len == 0) {
+		return TOPIC_TYPE_EMPTY;
 	}
 
-	/* Skip forward to next property bag */
-	if ((*start_ptr == '?') || (*start_ptr == '&')) {
-		start_ptr += 1;
-		if (start_ptr >= max_ptr) {
-			return 0;
-		}
-	} else if ((*(start_ptr + 1) == '?') || (*(start_ptr + 1) == '&')) {
-		start_ptr += 2;
-		if (start_ptr >= max_ptr) {
-			return 0;
+	for (size_t i = 0; i < ARRAY_SIZE(topic_prefixes); i++) {
+		if ((len >= topic_prefixes[i].len) &&
+		    (memcmp(topic_prefixes[i].str, buf,
+			    topic_prefixes[i].len) == 0)) {
+			return i;
 		}
 	}
 
-	parsed_len = buf - start_ptr;
-
-	/* Pointer is at '/', '?' or '&', move to first character of the key */
+	return TOPIC_TYPE_UNEXPECTED;
+}
 
-	/* The key has one of three formats:
-	 *	<key>
-	 *	<key>=
-	 *	<key>=<value>
-	 *
-	 * The end of the key can be detected in following ways:
-	 *	<key><end of buffer>
-	 *	<key>&
-	 *	<key>=
-	 */
-	end_ptr = start_ptr;
+int azure_iot_hub_topic_tokenize(const char *topic, size_t topic_len,
+				 struct topic_parser_tokens *const tokens)
+{
+	const char *ptr, *end;
 
-	while ((*end_ptr != '=') &&
-	       (*end_ptr != '&') &&
-	       (end_ptr < max_ptr)) {
-		end_ptr++;
-	}
+	memset(tokens, 0, sizeof(*tokens));
 
-	len = end_ptr - start_ptr;
+	tokens->type = topic_type_get(topic, topic_len);
 
-	if (len > TOPIC_PROP_BAG_FIELD_MAX_LEN) {
-		LOG_ERR("Property bag element is too long for buffer");
-		return -ENOMEM;
+	if (tokens->type == TOPIC_TYPE_EMPTY) {
+		return -EINVAL;
+	} else if (tokens->type == TOPIC_TYPE_UNEXPECTED) {
+		return 0;
 	}
 
-	memcpy(bag->key, start_ptr, len);
-	bag->key[len] = '\0';
-
-	LOG_DBG("Key: %s", log_strdup(bag->key));
+	/* This is the common format for topics:
+	 *	<prefix>/<dynamic value>/<suffix>/<property bags>
+	 *
+	 * Where <dynamic value> and <suffix> fields are not present for all.
+	 */
+	ptr = topic + topic_prefixes[tokens->type].len;
+	end = topic + topic_len;
 
-	if (end_ptr == max_ptr) {
+	/* Detect if the topic carries more information than just the prefix. */
+	if (ptr == end) {
 		return 0;
-	} else if (*end_ptr == '&') {
-		LOG_DBG("No value in bag");
-		bag->value[0] = '\0';
-
-		return len;
-	} else if (end_ptr + 1 == max_ptr) {
-		LOG_DBG("Value is empty string");
-
-		return len + 1;
 	}
 
-	/* Set start_ptr to first character of value */
-	start_ptr = end_ptr + 1;
-	end_ptr = start_ptr;
+	/* Get the dynamic value for topics that have one */
+	if (tokens->type != TOPIC_TYPE_TWIN_UPDATE_DESIRED) {
+		const char *slash = memchr(ptr, '/', end - ptr);
 
-	while ((*end_ptr != '&') && (end_ptr < max_ptr)) {
-		end_ptr++;
-	}
+		if ((slash == NULL) || (slash == ptr)) {
+			return -EFAULT;
+		}
 
-	len = end_ptr - start_ptr;
+		tokens->value.ptr = ptr;
+		tokens->value.len = slash - ptr;
 
-	if (len > TOPIC_PROP_BAG_FIELD_MAX_LEN) {
-		LOG_ERR("Property bag element is too long for buffer");
-		return -ENOMEM;
-	}
+		ptr = slash + 1;
+
+		if (tokens->type == TOPIC_TYPE_DEVICEBOUND) {
+			if (((size_t)(end - ptr) < TOPIC_DEVICE_BOUND_SUFFIX_LEN) ||
+			    (memcmp(ptr, TOPIC_DEVICE_BOUND_SUFFIX,
+				    TOPIC_DEVICE_BOUND_SUFFIX_LEN) != 0)) {
+				return -EFAULT;
+			}
 
-	parsed_len = start_ptr - buf + len;
+			ptr += TOPIC_DEVICE_BOUND_SUFFIX_LEN;
 
-	memcpy(bag->value, start_ptr, len);
-	bag->value[len] = '\0';
+			if ((ptr < end) && (*ptr == '/')) {
+				ptr++;
+			}
+		}
+	}
 
-	LOG_DBG("Value: %s", log_strdup(bag->value));
+	tokens->prop_bags.ptr = ptr;
+	tokens->prop_bags.len = end - ptr;
 
-	return parsed_len;
+	return 0;
 }
 
-enum topic_type topic_type_get(const char *buf, const size_t len)
+void azure_iot_hub_prop_bag_iter_init(struct topic_parser_prop_bag_iter *iter,
+				      const struct topic_parser_tokens *tokens)
 {
-	if (buf == NULL || len == 0) {
-		return TOPIC_TYPE_EMPTY;
-	}
+	iter->pos = tokens->prop_bags.ptr;
+	iter->end = tokens->prop_bags.ptr + tokens->prop_bags.len;
 
-	for (size_t i = 0; i < ARRAY_SIZE(topic_prefixes); i++) {
-		if (strncmp(topic_prefixes[i], buf,
-			    MIN(strlen(topic_prefixes[i]), len)) == 0) {
-			return i;
-		}
+	/* The property bags may or may not start with '?'. */
+	if ((iter->pos < iter->end) && (*iter->pos == '?')) {
+		iter->pos++;
 	}
-
-	return TOPIC_TYPE_UNEXPECTED;
 }
 
-int azure_iot_hub_topic_parse(struct topic_parser_data *const data)
+bool azure_iot_hub_prop_bag_iter_next(struct topic_parser_prop_bag_iter *iter,
+				      struct topic_parser_str *key,
+				      struct topic_parser_str *value)
 {
-	char *start_ptr, *stop_ptr;
-	const char *max_ptr = data->topic + data->topic_len;
-	size_t len;
+	/* Property bags have the following format:
+	 *	<key 1>=<value 1>&<key 2>=<value 2>&...
+	 *
+	 * Where the value field may be left empty. It's also allowed to leave
+	 * out the '=' sign.
+	 */
+	while (iter->pos < iter->end) {
+		const char *start = iter->pos;
+		const char *equals = NULL;
+		const char *ptr;
+
+		for (ptr = start; (ptr < iter->end) && (*ptr != '&'); ptr++) {
+			if ((*ptr == '=') && (equals == NULL)) {
+				equals = ptr;
+			}
+		}
 
-	if (!data->topic || (data->topic_len == 0)) {
-		return -EINVAL;
-	}
+		iter->pos = (ptr < iter->end) ? ptr + 1 : ptr;
+
+		/* Skip empty property bags, "&&" */
+		if (ptr == start) {
+			continue;
+		}
 
-	if (data->type >= TOPIC_TYPE_UNKNOWN) {
-		data->type = topic_type_get(data->topic, data->topic_len);
+		key->ptr = start;
 
-		if ((data->type == TOPIC_TYPE_EMPTY) ||
-		    (data->type == TOPIC_TYPE_UNEXPECTED)) {
-			return 0;
+		if (equals) {
+			key->len = equals - start;
+			value->ptr = equals + 1;
+			value->len = ptr - equals - 1;
+		} else {
+			key->len = ptr - start;
+			value->ptr = NULL;
+			value->len = 0;
 		}
+
+		return true;
 	}
 
-	start_ptr = skip_prefix((char *)data->topic, data->type);
+	return false;
+}
 
-	/* This is the common format for topics:
-	 *	<prefix>/<dynamic value>/<suffix>/<property bags>
-	 *
-	 * Where <dynamic value> and <suffix> fields are not present for all.
-	 *
-	 * Property bags have the following format:
-	 *	<key 1>=<value 1>&<key 2>=<value 2>&...
-	 *
-	 * Where the value field may be left empty. It's also allowed to leave
-	 * out the '=' sign.
-	 */
+int azure_iot_hub_topic_parse(struct topic_parser_data *const data)
+{
+	struct topic_parser_tokens tokens;
+	struct topic_parser_prop_bag_iter iter;
+	struct topic_parser_str key, value;
+	int err;
 
-	/* Detect if the topic carries more information than just the prefix. */
-	if (start_ptr == max_ptr) {
-		return 0;
-	}
+	data->prop_bag_count = 0;
 
-	/* Get the dynamic value for topics that have one */
-	if (data->type != TOPIC_TYPE_TWIN_UPDATE_DESIRED) {
-		stop_ptr = get_next_occurrence(start_ptr, '/',
-					data->topic_len -
-					(start_ptr - data->topic));
-		len = stop_ptr ? stop_ptr - start_ptr : 0;
+	err = azure_iot_hub_topic_tokenize(data->topic, data->topic_len,
+					   &tokens);
+	data->type = tokens.type;
+	if (err) {
+		return err;
+	}
 
-		if (len == 0) {
-			return -EFAULT;
-		} else if (len > TOPIC_DYNAMIC_VALUE_MAX_LEN) {
+	if (tokens.value.len > 0) {
+		if (str_copy(data->name, sizeof(data->name), &tokens.value)) {
 			return -ENOMEM;
 		}
 
-		memcpy(data->name, start_ptr, len);
-		data->name[len] = '\0';
-
 		LOG_DBG("Dynamic value: %s", log_strdup(data->name));
 
 		if ((data->type == TOPIC_TYPE_TWIN_UPDATE_RESULT) ||
@@ -247,33 +233,33 @@ int azure_iot_hub_topic_parse(struct topic_parser_data *const data)
 				LOG_ERR("Failed to parse string as number");
 				return -EFAULT;
 			}
-		} else if (data->type == TOPIC_TYPE_DEVICEBOUND) {
-			stop_ptr += sizeof(TOPIC_DEVICE_BOUND_SUFFIX) - 1;
 		}
-
-		/* Move the start pointer to the end of the method name plus the
-		 * subsequent '/'. start_ptr will now be at the start of the
-		 * property bags, if there are any.
-		 */
-		start_ptr = stop_ptr + 1;
 	}
 
-	data->prop_bag_count = 0;
+	azure_iot_hub_prop_bag_iter_init(&iter, &tokens);
 
-	while ((start_ptr < max_ptr) &&
-	       (data->prop_bag_count < TOPIC_PROP_BAG_COUNT)) {
-		int ret = get_next_prop_bag(start_ptr, max_ptr - start_ptr,
-				&data->prop_bag[data->prop_bag_count]);
+	while (azure_iot_hub_prop_bag_iter_next(&iter, &key, &value)) {
+		struct topic_parser_prop_bag *bag;
 
-		if (ret <= 0) {
-			return ret;
+		if (data->prop_bag_count == TOPIC_PROP_BAG_COUNT) {
+			LOG_DBG("Too many property bags, ignoring the rest");
+			break;
 		}
 
+		bag = &data->prop_bag[data->prop_bag_count];
+
+		if (str_copy(bag->key, sizeof(bag->key), &key) ||
+		    str_copy(bag->value, sizeof(bag->value), &value)) {
+			LOG_ERR("Property bag element is too long for buffer");
+			return -ENOMEM;
+		}
+
+		LOG_DBG("Key: %s, value: %s", log_strdup(bag->key),
+			log_strdup(bag->value));
+
 		data->prop_bag_count += 1;
-		start_ptr  += ret;
 	}
 
-
 	return 0;
 }
 
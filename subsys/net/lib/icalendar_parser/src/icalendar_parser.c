@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <stddef.h>
 #include <strings.h>
 #include <zephyr.h>
 #include <zephyr/types.h>
@@ -14,388 +15,368 @@
 
 LOG_MODULE_REGISTER(icalendar_parser, CONFIG_ICAL_PARSER_LOG_LEVEL);
 
-static size_t unfold_contentline(const char *buf, char *prop_buf)
+/* The parser processes the data one byte at a time, and keeps only the
+ * state of the current content line. Property values are written directly
+ * to the component that is being built, so no line buffer is needed.
+ *
+ * A content line has the following format:
+ *	<name>[;<param>=<param value>...]:<value><CRLF>
+ *
+ * Long content lines are folded by inserting a line break followed by a
+ * space or a tab, which are removed when the line is unfolded.
+ * Reference: RFC 5545 3.1 Content Lines
+ */
+
+enum line_state {
+	LINE_NAME,
+	LINE_PARAM,
+	LINE_VALUE,
+};
+
+/* Kinds of content lines, the properties are indices of props[]. */
+enum line_kind {
+	LINE_IGNORED = -1,
+	LINE_BEGIN = -2,
+	LINE_END = -3,
+};
+
+/* Type of the top-level component when it is not known. */
+#define COM_UNKNOWN -1
+
+struct ical_prop {
+	const char *name;
+	size_t offset;
+	size_t size;
+	enum ical_parser_error_id error;
+	bool params_allowed;
+};
+
+#define ICAL_PROP(_name, _field, _size, _error, _params) {		\
+	.name = _name,							\
+	.offset = offsetof(struct ical_component, _field),		\
+	.size = _size,							\
+	.error = _error,						\
+	.params_allowed = _params,					\
+}
+
+/* Properties of VEVENT components that are parsed. */
+static const struct ical_prop props[] = {
+	ICAL_PROP("SUMMARY", summary, CONFIG_ICAL_PARSER_SUMMARY_SIZE,
+		  ICAL_ERROR_SUMMARY, false),
+	ICAL_PROP("LOCATION", location, CONFIG_ICAL_PARSER_LOCATION_SIZE,
+		  ICAL_ERROR_LOCATION, false),
+	ICAL_PROP("DESCRIPTION", description, CONFIG_ICAL_PARSER_DESCRIPTION_SIZE,
+		  ICAL_ERROR_DESCRIPTION, false),
+	/* Date-time properties may have a TZID or VALUE parameter. */
+	ICAL_PROP("DTSTART", dtstart, CONFIG_ICAL_PARSER_DTSTART_SIZE,
+		  ICAL_ERROR_DTSTART, true),
+	ICAL_PROP("DTEND", dtend, CONFIG_ICAL_PARSER_DTEND_SIZE,
+		  ICAL_ERROR_DTEND, true),
+};
+
+static const struct {
+	const char *name;
+	enum ical_parser_evt_id id;
+} components[] = {
+	{ "VEVENT", ICAL_EVT_VEVENT },
+	{ "VTODO", ICAL_EVT_VTODO },
+	{ "VJOURNAL", ICAL_EVT_VJOURNAL },
+	{ "VFREEBUSY", ICAL_EVT_VFREEBUSY },
+	{ "VTIMEZONE", ICAL_EVT_VTIMEZONE },
+};
+
+static void line_reset(struct icalendar_parser *ical)
 {
-	const char *sol = buf;
-	char *eol;
-	uint16_t total_line_len = 0, single_line_len = 0;
-
-	while (1) {
-		eol = strstr(sol, "\r\n");
-		if (!eol) {
-			return 0;
-		}
-		single_line_len = eol - sol;
-		if ((total_line_len + single_line_len) <= CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE) {
-			memcpy(prop_buf + total_line_len, sol, single_line_len);
-			total_line_len += single_line_len;
-		} else {
-			LOG_WRN("Property value overflow."
-				"Increase CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE.");
-			return 0;
-		}
-		if (!strncmp(eol, "\r\n ", strlen("\r\n "))) {
-			/* Long content line is split into multiple lines.
-			 * Copy the folded part to unfolded buffer.
-			 */
-			sol = eol + strlen("\r\n ");
-		} else {
-			/* Content line is delimited. */
-			break;
-		}
-	}
-	prop_buf[total_line_len] = '\0';
+	ical->name_len = 0;
+	ical->name[0] = '\0';
+	ical->state = LINE_NAME;
+	ical->line = LINE_IGNORED;
+	ical->quoted = false;
+	ical->params = false;
+	ical->overflow = false;
+	ical->value_len = 0;
+}
 
-	return total_line_len;
+static char *prop_value_buf(struct icalendar_parser *ical)
+{
+	return (char *)&ical->evt.ical_com + props[ical->line].offset;
 }
 
-static bool parse_desc_props(const char *buf,
-			     const char *name,
-			     size_t name_size,
-			     char *value,
-			     size_t max_value_len)
+/* Name of the current line is complete, find out what to do with it. */
+static void line_name_end(struct icalendar_parser *ical)
 {
-	bool ret;
-	size_t unfold_size;
-	char ical_prop_buf[CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE + 1];
-
-	unfold_size = unfold_contentline(buf, ical_prop_buf);
-	if (unfold_size <= 0) {
-		/* Property wrong format - no parameter or value. */
-		LOG_ERR("%s no value/param.", name);
-		return false;
+	if (!strcasecmp(ical->name, "BEGIN")) {
+		ical->line = LINE_BEGIN;
+		return;
+	} else if (!strcasecmp(ical->name, "END")) {
+		ical->line = LINE_END;
+		return;
 	}
 
-	if (ical_prop_buf[name_size] == ':') {
-		size_t value_len = unfold_size - name_size - 1;
+	/* Only the properties of VEVENT components are parsed, not the ones
+	 * of the components nested in them. Parsing stops at the first error.
+	 */
+	if (!ical->icalobject_begin || (ical->depth != 1) ||
+	    (ical->com != ICAL_EVT_VEVENT) ||
+	    (ical->evt.error != ICAL_ERROR_NONE)) {
+		return;
+	}
 
-		if (value_len <= max_value_len) {
-			memcpy(value, ical_prop_buf + name_size + 1, value_len);
-			value[value_len] = '\0';
-			ret = true;
-		} else {
-			/* Property value overflow. */
-			LOG_ERR("%s value overflow.", name);
-			ret = false;
+	for (size_t i = 0; i < ARRAY_SIZE(props); i++) {
+		if (!strcasecmp(ical->name, props[i].name)) {
+			ical->line = i;
+			return;
 		}
-	} else if (ical_prop_buf[name_size] == ';') {
-		/* Does not support property parameter. */
-		LOG_ERR("%s param not supported.", name);
-		ret = false;
-	} else {
-		/* Property wrong format - no parameter or value. */
-		LOG_ERR("%s wrong format.", name);
-		ret = false;
 	}
-
-	return ret;
 }
 
-static bool parse_datetime_props(const char *buf,
-				 const char *name,
-				 size_t name_size,
-				 char *value,
-				 size_t max_value_len)
+static void name_append(struct icalendar_parser *ical, char c)
 {
-	bool ret;
-	size_t unfold_size;
-	char ical_prop_buf[CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE + 1];
-
-	unfold_size = unfold_contentline(buf, ical_prop_buf);
-	if (unfold_size <= 0) {
-		/* Property wrong format - fail to unfold property. */
-		LOG_ERR("%s wrong format. Fail to unfold property", name);
-		return false;
-	}
-
-	if (ical_prop_buf[name_size] == ':') {
-		size_t value_len = unfold_size - name_size - 1;
-
-		if (value_len <= max_value_len) {
-			memcpy(value, ical_prop_buf + name_size + 1, value_len);
-			value[value_len] = '\0';
-			ret = true;
-		} else {
-			/* Property value overflow. */
-			LOG_ERR("%s value overflow.", name);
-			ret = false;
-		}
-	} else if (ical_prop_buf[name_size] == ';') {
-		char *dtvalue;
-
-		dtvalue = strchr(ical_prop_buf, ':');
-		if (dtvalue) {
-			dtvalue = dtvalue + 1;
-			size_t value_len;
-
-			value_len = unfold_size - (dtvalue - ical_prop_buf);
-			if (value_len <= max_value_len) {
-				memcpy(value, dtvalue, value_len);
-				value[value_len] = '\0';
-				ret = true;
-			} else {
-				/* Property value overflow. */
-				LOG_ERR("%s value overflow.", name);
-				ret = false;
-			}
-		} else {
-			/* Property wrong format - no value. */
-			LOG_ERR("%s wrong format - no value.", name);
-			ret = false;
-		}
+	if (ical->name_len < ICAL_PARSER_NAME_MAX_LEN) {
+		ical->name[ical->name_len++] = c;
+		ical->name[ical->name_len] = '\0';
 	} else {
-		/* Property wrong format - no parameter or value. */
-		LOG_ERR("%s wrong format.", name);
-		ret = false;
+		/* Longer than any name that is parsed. */
+		ical->overflow = true;
 	}
+}
 
-	return ret;
+static void name_end(struct icalendar_parser *ical)
+{
+	/* A name that does not fit matches nothing that is parsed. */
+	if (!ical->overflow) {
+		line_name_end(ical);
+	}
 }
 
-static size_t parse_calprops(const char *buf)
+static void component_begin(struct icalendar_parser *ical)
 {
-	const char *parsed = buf;
-	char *end = NULL;
-	char prop_value[CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE + 1];
+	if (!ical->icalobject_begin) {
+		/* Check begin of iCalendar object delimiter
+		 * Reference: RFC 5545 3.4 iCalendar Object
+		 */
+		if (!strcasecmp(ical->name, "VCALENDAR")) {
+			LOG_DBG("Found a calendar stream");
+			ical->icalobject_begin = true;
+			ical->depth = 0;
+		}
 
-	parsed = strstr(parsed, "BEGIN:VCALENDAR\r\n");
-	if (parsed == NULL) {
-		return 0;
+		return;
 	}
-	parsed += strlen("BEGIN:VCALENDAR\r\n");
 
-	end = strstr(parsed, "\r\nBEGIN:");
-	if (end == NULL) {
-		return 0;
+	ical->depth++;
+
+	if (ical->depth > 1) {
+		/* Nested component, for example VALARM in VEVENT. */
+		return;
 	}
-	end += strlen("\r\n");
-
-	while (parsed < end) {
-		memset(prop_value, 0, sizeof(prop_value));
-		if (!strncmp(parsed, "PRODID", 6)) {
-			if (!parse_desc_props(parsed, "PRODID", 6,
-					prop_value, sizeof(prop_value))) {
-				LOG_ERR("Wrong PRODID");
-			}
-		} else if (!strncmp(parsed, "VERSION", 7)) {
-			if (!parse_desc_props(parsed, "VERSION", 7,
-					prop_value, sizeof(prop_value))) {
-				LOG_ERR("Wrong VERSION");
-			}
+
+	memset(&ical->evt, 0, sizeof(ical->evt));
+	ical->com = COM_UNKNOWN;
+
+	for (size_t i = 0; i < ARRAY_SIZE(components); i++) {
+		if (!strcasecmp(ical->name, components[i].name)) {
+			ical->com = components[i].id;
+			break;
 		}
-		parsed = strstr(parsed, "\r\n");
-		parsed += strlen("\r\n");
 	}
 
-	return (parsed - buf);
-}
+	if (ical->com == COM_UNKNOWN) {
+		LOG_DBG("Skipping %s component", log_strdup(ical->name));
+		return;
+	}
 
-static size_t parse_eventprop(const char *buf, struct ical_parser_evt *evt)
-{
-	const char *parsed = buf;
-	char *com_end;
+	ical->evt.id = ical->com;
 
-	if (strncmp(buf, "BEGIN:VEVENT\r\n", strlen("BEGIN:VEVENT\r\n"))) {
-		return 0;
+	if (ical->com != ICAL_EVT_VEVENT) {
+		ical->evt.error = ICAL_ERROR_COM_NOT_SUPPORTED;
 	}
+}
 
-	com_end = strstr(buf, "END:VEVENT\r\n");
-	if (com_end == NULL) {
+/* Returns the return value of the callback, if it was called. */
+static int component_end(struct icalendar_parser *ical)
+{
+	if (!ical->icalobject_begin) {
 		return 0;
 	}
 
-	evt->id = ICAL_EVT_VEVENT;
-	evt->error = ICAL_ERROR_NONE;
-	com_end += strlen("END:VEVENT\r\n");
-	while (parsed < com_end) {
-		if (!strncasecmp(parsed, "SUMMARY", 7)) {
-			if (!parse_desc_props(
-				parsed, "SUMMARY", 7,
-				evt->ical_com.summary,
-				CONFIG_ICAL_PARSER_SUMMARY_SIZE)) {
-				evt->error = ICAL_ERROR_SUMMARY;
-				parsed = com_end;
-			}
-		} else if (!strncasecmp(parsed, "LOCATION", 8)) {
-			if (!parse_desc_props(
-				parsed, "LOCATION", 8,
-				evt->ical_com.location,
-				CONFIG_ICAL_PARSER_LOCATION_SIZE)) {
-				evt->error = ICAL_ERROR_LOCATION;
-				parsed = com_end;
-			}
-		} else if (!strncasecmp(parsed, "DESCRIPTION", 11)) {
-			if (!parse_desc_props(
-				parsed, "DESCRIPTION", 11,
-				evt->ical_com.description,
-				CONFIG_ICAL_PARSER_DESCRIPTION_SIZE)) {
-				evt->error = ICAL_ERROR_DESCRIPTION;
-				parsed = com_end;
-			}
-		} else if (!strncasecmp(parsed, "DTSTART", 7)) {
-			if (!parse_datetime_props(
-				parsed, "DTSTART", 7,
-				evt->ical_com.dtstart,
-				CONFIG_ICAL_PARSER_DTSTART_SIZE)) {
-				evt->error = ICAL_ERROR_DTSTART;
-				parsed = com_end;
-			}
-		} else if (!strncasecmp(parsed,
-					"DTEND", 5)) {
-			if (!parse_datetime_props(
-				parsed, "DTEND", 5,
-				evt->ical_com.dtend,
-				CONFIG_ICAL_PARSER_DTEND_SIZE)) {
-				evt->error = ICAL_ERROR_DTEND;
-				parsed = com_end;
-			}
+	if (ical->depth == 0) {
+		if (!strcasecmp(ical->name, "VCALENDAR")) {
+			LOG_DBG("End of calendar stream");
+			ical->icalobject_begin = false;
 		}
 
-		/* Move parsed pointer to end of line break */
-		parsed = strstr(parsed, "\r\n") + 2;
+		return 0;
 	}
 
-	return parsed - buf;
-}
+	ical->depth--;
 
-static size_t parse_todoprop(const char *buf, struct ical_parser_evt *evt)
-{
-	const char *parsed = buf;
-	char *com_end;
-
-	com_end = strstr(buf, "END:VTODO\r\n");
-	if (com_end) {
-		parsed = com_end + strlen("END:VTODO\r\n");
+	if ((ical->depth > 0) || (ical->com == COM_UNKNOWN)) {
+		return 0;
 	}
-	evt->id = ICAL_EVT_VTODO;
-	evt->error = ICAL_ERROR_COM_NOT_SUPPORTED;
 
-	return parsed - buf;
+	return ical->callback(&ical->evt);
 }
 
-static size_t parse_jourprop(const char *buf,
-				struct ical_parser_evt *evt)
+static void prop_end(struct icalendar_parser *ical)
 {
-	const char *parsed = buf;
-	char *com_end;
+	const struct ical_prop *prop = &props[ical->line];
 
-	com_end = strstr(buf, "END:VJOURNAL\r\n");
-	if (com_end) {
-		parsed = com_end + strlen("END:VJOURNAL\r\n");
+	if (ical->state != LINE_VALUE) {
+		/* Property wrong format - no value. */
+		LOG_ERR("%s wrong format - no value.", prop->name);
+		ical->evt.error = prop->error;
+	} else if (ical->params && !prop->params_allowed) {
+		/* Does not support property parameter. */
+		LOG_ERR("%s param not supported.", prop->name);
+		ical->evt.error = prop->error;
+	} else if (ical->overflow) {
+		/* Property value overflow. */
+		LOG_ERR("%s value overflow.", prop->name);
+		ical->evt.error = prop->error;
 	}
-	evt->id = ICAL_EVT_VJOURNAL;
-	evt->error = ICAL_ERROR_COM_NOT_SUPPORTED;
-
-	return parsed - buf;
 }
 
-static size_t parse_fbprop(const char *buf, struct ical_parser_evt *evt)
+/* Returns non-zero if the callback asked to stop parsing. */
+static int line_end(struct icalendar_parser *ical)
 {
-	const char *parsed = buf;
-	char *com_end;
+	int ret = 0;
 
-	com_end = strstr(buf, "END:VFREEBUSY\r\n");
-	if (com_end) {
-		parsed = com_end + strlen("END:VFREEBUSY\r\n");
+	if (ical->state == LINE_NAME) {
+		name_end(ical);
 	}
-	evt->id = ICAL_EVT_VFREEBUSY;
-	evt->error = ICAL_ERROR_COM_NOT_SUPPORTED;
 
-	return parsed - buf;
+	if (ical->line == LINE_BEGIN) {
+		if (ical->state == LINE_VALUE) {
+			component_begin(ical);
+		}
+	} else if (ical->line == LINE_END) {
+		if (ical->state == LINE_VALUE) {
+			ret = component_end(ical);
+		}
+	} else if (ical->line >= 0) {
+		prop_end(ical);
+	}
+
+	line_reset(ical);
+
+	return ret;
 }
 
-static size_t parse_tzprop(const char *buf, struct ical_parser_evt *evt)
+static void value_start(struct icalendar_parser *ical)
 {
-	const char *parsed = buf;
-	char *com_end;
-
-	com_end = strstr(buf, "END:VTIMEZONE\r\n");
-	if (com_end) {
-		parsed = com_end + strlen("END:VTIMEZONE\r\n");
+	if (ical->state == LINE_NAME) {
+		name_end(ical);
 	}
-	evt->id = ICAL_EVT_VTIMEZONE;
-	evt->error = ICAL_ERROR_COM_NOT_SUPPORTED;
 
-	return parsed - buf;
+	ical->state = LINE_VALUE;
+
+	/* The value of BEGIN and END is a component name, keep it in the
+	 * name buffer.
+	 */
+	if ((ical->line == LINE_BEGIN) || (ical->line == LINE_END)) {
+		ical->name_len = 0;
+		ical->name[0] = '\0';
+	} else if (ical->line >= 0) {
+		prop_value_buf(ical)[0] = '\0';
+	}
 }
 
-static size_t parse_component(char *buf, struct ical_parser_evt *evt)
+static void value_append(struct icalendar_parser *ical, char c)
 {
-	char *com_begin = buf;
-	size_t ret = 0;
-
-	/* Search begin of component */
-	if (!strncmp(com_begin, "BEGIN:VEVENT\r\n", 14)) {
-		ret += parse_eventprop(com_begin, evt);
-	} else if (!strncmp(com_begin, "BEGIN:VTODO\r\n", 13)) {
-		ret += parse_todoprop(com_begin, evt);
-	} else if (!strncmp(com_begin, "BEGIN:VJOURNAL\r\n", 16)) {
-		ret += parse_jourprop(com_begin, evt);
-	} else if (!strncmp(com_begin, "BEGIN:VFREEBUSY\r\n", 17)) {
-		ret += parse_fbprop(com_begin, evt);
-	} else if (!strncmp(com_begin, "BEGIN:VTIMEZONE\r\n", 17)) {
-		ret += parse_tzprop(com_begin, evt);
+	if ((ical->line == LINE_BEGIN) || (ical->line == LINE_END)) {
+		name_append(ical, c);
+		return;
+	} else if (ical->line < 0) {
+		return;
 	}
 
-	return ret;
+	if (ical->value_len < props[ical->line].size) {
+		char *value = prop_value_buf(ical);
+
+		value[ical->value_len++] = c;
+		value[ical->value_len] = '\0';
+	} else {
+		ical->overflow = true;
+	}
 }
 
-static size_t parse_icalbody(char *buf,	icalendar_parser_callback_t callback)
+static void char_parse(struct icalendar_parser *ical, char c)
 {
-	size_t parsed_bytes = 0, parsed_offset = 0;
-
-	do {
-		struct ical_parser_evt evt;
-
-		parsed_bytes = parse_component(buf + parsed_offset, &evt);
-		parsed_offset += parsed_bytes;
-		if (parsed_bytes > 0) {
-			callback(&evt);
+	switch (ical->state) {
+	case LINE_NAME:
+		if (c == ';') {
+			name_end(ical);
+			ical->params = true;
+			ical->state = LINE_PARAM;
+		} else if (c == ':') {
+			value_start(ical);
+		} else {
+			name_append(ical, c);
 		}
-	} while (parsed_bytes > 0);
-
-	return parsed_offset;
+		break;
+	case LINE_PARAM:
+		/* Parameter values may contain ':' when quoted. */
+		if (c == '"') {
+			ical->quoted = !ical->quoted;
+		} else if ((c == ':') && !ical->quoted) {
+			value_start(ical);
+		}
+		break;
+	case LINE_VALUE:
+		value_append(ical, c);
+		break;
+	default:
+		break;
+	}
 }
 
 size_t ical_parser_parse(struct icalendar_parser *ical, const char *data, size_t len)
 {
-	size_t parsed_offset = 0;
+	for (size_t i = 0; i < len; i++) {
+		char c = data[i];
 
-	if (CONFIG_ICAL_PARSER_BUFFER_SIZE < (ical->offset + len)) {
-		return -ENOBUFS;
-	}
+		if (c == '\r') {
+			continue;
+		}
 
-	memcpy(ical->buf + ical->offset, data, len);
-	ical->buf[ical->offset + len] = '\0';
+		if (ical->eol) {
+			ical->eol = false;
 
-	/* Check begin of iCalendar object delimiter
-	 * Reference: RFC 5545 3.4 iCalendar Object
-	 */
-	if (!ical->icalobject_begin) {
-		/* The body of the iCalendar object consists of
-		 * a sequence of calendar properties and
-		 * one or more calendar components.
-		 *
-		 * Reference: RFC 5545 3.6 Calendar Components
-		 */
-		parsed_offset += parse_calprops(ical->buf);
-		if (parsed_offset > 0) {
-			LOG_DBG("Found a calendar stream");
-			ical->icalobject_begin = true;
+			if ((c == ' ') || (c == '\t')) {
+				/* Folded line, the content line continues. */
+				continue;
+			}
+
+			/* The character starts a new content line. If the
+			 * callback asks to stop, it is left unparsed.
+			 */
+			if (line_end(ical)) {
+				return i;
+			}
 		}
-	}
 
-	/* If we got a calendar property, start parsing calendar body. */
-	if (ical->icalobject_begin) {
-		parsed_offset += parse_icalbody(ical->buf + parsed_offset, ical->callback);
-	}
+		if (c == '\n') {
+			if ((ical->line == LINE_BEGIN) || (ical->line == LINE_END)) {
+				/* BEGIN and END lines are not unfolded, they end
+				 * at the line break. A component is then complete
+				 * without waiting for the data that follows it,
+				 * which may never come at the end of the stream.
+				 */
+				if (line_end(ical)) {
+					return i + 1;
+				}
+			} else {
+				ical->eol = true;
+			}
 
-	if (parsed_offset) {
-		ical->offset = ical->offset + len - parsed_offset;
-		memcpy(ical->buf, ical->buf + parsed_offset, ical->offset);
+			continue;
+		}
+
+		char_parse(ical, c);
 	}
 
-	return parsed_offset;
+	return len;
 }
 
 int ical_parser_init(struct icalendar_parser *ical, icalendar_parser_callback_t callback)
@@ -404,9 +385,12 @@ int ical_parser_init(struct icalendar_parser *ical, icalendar_parser_callback_t
 		return -EINVAL;
 	}
 
+	memset(ical, 0, sizeof(*ical));
+
 	ical->callback = callback;
 	ical->icalobject_begin = false;
-	ical->offset = 0;
+	ical->com = COM_UNKNOWN;
+	line_reset(ical);
 
 	return 0;
 }
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef NRF_CLOUD_AGPS_INJECT_H_
+#define NRF_CLOUD_AGPS_INJECT_H_
+
+#include <zephyr.h>
+#include "nrf_cloud_agps_schema_v1.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Injection pipeline for binary A-GPS data.
+ *
+ * The data is parsed as it is passed in, in chunks of any size. Complete
+ * elements are put in a queue of CONFIG_NRF_CLOUD_AGPS_INJECT_QUEUE_LEN
+ * entries and sent to the modem by the injection thread, so that parsing
+ * and receiving more data overlap with writes to the modem. If the queue is
+ * full, nagps_inject_data() blocks until an element has been sent.
+ *
+ * Queued elements are sent in order of priority: system time first, then
+ * location, ephemerides of the satellites set with
+ * nagps_inject_visible_sv_set(), other ephemerides, other elements and
+ * almanacs last. Elements of the same priority are sent in the order they
+ * were received.
+ *
+ * Only one message can be injected at a time.
+ */
+
+/**@brief Function sending an element to the modem, called from the
+ * injection thread.
+ */
+typedef int (*nagps_inject_send_t)(struct nrf_cloud_apgs_element *element);
+
+/**@brief Start injecting a message.
+ *
+ * @param send Function sending elements to the modem.
+ */
+void nagps_inject_start(nagps_inject_send_t send);
+
+/**@brief Parse the next chunk of the message and queue the elements that are
+ * complete.
+ *
+ * @return 0 on success, -EBADMSG if the message is invalid or the first
+ *         error returned by the send function.
+ */
+int nagps_inject_data(const uint8_t *buf, size_t len);
+
+/**@brief Wait until all queued elements are sent to the modem.
+ *
+ * @return 0 on success, -EBADMSG if the message is invalid, ends in the
+ *         middle of a header or before all elements announced by a header,
+ *         or the first error returned by the send function.
+ */
+int nagps_inject_end(void);
+
+/**@brief Set the satellites whose ephemerides are injected first.
+ *
+ * @param sv_mask Bitmask of satellites, bit 0 is satellite 1.
+ */
+void nagps_inject_visible_sv_set(uint32_t sv_mask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NRF_CLOUD_AGPS_INJECT_H_ */
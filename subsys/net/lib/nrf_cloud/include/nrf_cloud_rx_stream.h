@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef NRF_CLOUD_RX_STREAM_H__
+#define NRF_CLOUD_RX_STREAM_H__
+
+#include <net/mqtt.h>
+#include <net/nrf_cloud.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Receiver of data channel messages that are read in chunks.
+ *
+ * The payload of a message is read in chunks of at most
+ * CONFIG_NRF_CLOUD_MQTT_PAYLOAD_BUFFER_LEN bytes and passed to the receiver
+ * as it arrives, so messages can be larger than the payload buffer. Messages
+ * taken by a receiver are not notified as @ref NCT_EVT_DC_RX_DATA.
+ * The callbacks are called from the MQTT event handler.
+ */
+struct nct_rx_stream {
+	/** Called with the first chunk of the payload of a message, which is
+	 *  empty if the payload is. Returns true to take the message.
+	 */
+	bool (*start)(const struct nrf_cloud_topic *topic, const uint8_t *buf,
+		      size_t len, size_t total_len);
+	/** Called with every chunk of the payload, the first one included.
+	 *  If a negative error code is returned, the rest of the payload is
+	 *  discarded.
+	 */
+	int (*data)(const uint8_t *buf, size_t len);
+	/** Called after the last chunk, with 0 or the negative error code
+	 *  that ended the message.
+	 */
+	void (*end)(int err);
+};
+
+/**@brief Offer a message to the receivers.
+ *
+ * @param[in] streams    Receivers, NULL terminated.
+ * @param[in] topic      Topic of the message.
+ * @param[in] buf        First chunk of the payload.
+ * @param[in] chunk_len  Length of the first chunk.
+ * @param[in] total_len  Length of the whole payload.
+ *
+ * @return The first receiver that took the message, or NULL.
+ */
+const struct nct_rx_stream *nct_rx_stream_find(
+	const struct nct_rx_stream *const *streams,
+	const struct nrf_cloud_topic *topic, const uint8_t *buf,
+	size_t chunk_len, size_t total_len);
+
+/**@brief Pass the payload of a message to its receiver chunk by chunk.
+ *
+ * The first chunk is already in the buffer, the following chunks are read
+ * to the same buffer. A payload rejected by the receiver is discarded.
+ *
+ * @param[in] client     MQTT client the payload is read from.
+ * @param[in] stream     Receiver that took the message.
+ * @param[in] buf        Buffer for the payload chunks.
+ * @param[in] buf_len    Length of the buffer.
+ * @param[in] chunk_len  Length of the first chunk.
+ * @param[in] total_len  Length of the whole payload.
+ *
+ * @retval 0 If the whole payload was read.
+ *           Otherwise, a (negative) error code of reading the payload.
+ */
+int nct_rx_stream_read(struct mqtt_client *client,
+		       const struct nct_rx_stream *stream, uint8_t *buf,
+		       size_t buf_len, size_t chunk_len, size_t total_len);
+
+/**@brief Read and drop a part of a payload, so that the connection stays
+ * usable.
+ *
+ * @param[in] client   MQTT client the payload is read from.
+ * @param[in] buf      Buffer for the payload chunks.
+ * @param[in] buf_len  Length of the buffer.
+ * @param[in] len      Length of the payload to drop.
+ *
+ * @retval 0 If the payload was dropped.
+ *           Otherwise, a (negative) error code of reading the payload.
+ */
+int nct_payload_discard(struct mqtt_client *client, uint8_t *buf,
+			size_t buf_len, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NRF_CLOUD_RX_STREAM_H__ */
@@ -8,6 +8,7 @@
 #define NRF_CLOUD_TRANSPORT_H__
 
 #include <net/nrf_cloud.h>
+#include "nrf_cloud_rx_stream.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -58,6 +59,11 @@ struct nct_evt {
 	enum nct_evt_type type;
 };
 
+#if defined(CONFIG_NRF_CLOUD_AGPS_RX_STREAM)
+/**@brief Receiver of binary A-GPS data, see nrf_cloud_agps.c. */
+extern const struct nct_rx_stream nrf_cloud_agps_rx_stream;
+#endif
+
 int nct_socket_get(void);
 
 /**@brief Initialization routine for the transport. */
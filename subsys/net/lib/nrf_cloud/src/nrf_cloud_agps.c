@@ -23,6 +23,7 @@ LOG_MODULE_REGISTER(nrf_cloud_agps, CONFIG_NRF_CLOUD_GPS_LOG_LEVEL);
 
 #include "nrf_cloud_transport.h"
 #include "nrf_cloud_agps_schema_v1.h"
+#include "nrf_cloud_agps_inject.h"
 
 
 #define AGPS_JSON_MSG_TYPE_KEY		"messageType"
@@ -601,85 +602,13 @@ static int agps_send_to_modem(struct nrf_cloud_apgs_element *agps_data)
 	return 0;
 }
 
-static size_t get_next_agps_element(struct nrf_cloud_apgs_element *element,
-				    const char *buf)
-{
-	static uint16_t elements_left_to_process;
-	static enum nrf_cloud_agps_type element_type;
-	size_t len = 0;
-
-	/* Check if there are more elements left in the array to process.
-	 * The element type is only given once before the array, and not for
-	 * each element.
-	 */
-	if (elements_left_to_process == 0) {
-		element->type =
-			(enum nrf_cloud_agps_type)buf[NRF_CLOUD_AGPS_BIN_TYPE_OFFSET];
-		element_type = element->type;
-		elements_left_to_process =
-			*(uint16_t *)&buf[NRF_CLOUD_AGPS_BIN_COUNT_OFFSET] - 1;
-		len += NRF_CLOUD_AGPS_BIN_TYPE_SIZE +
-			NRF_CLOUD_AGPS_BIN_COUNT_SIZE;
-	} else {
-		element->type = element_type;
-		elements_left_to_process -= 1;
-	}
-
-	switch (element->type) {
-	case NRF_CLOUD_AGPS_UTC_PARAMETERS:
-		element->utc = (struct nrf_cloud_agps_utc *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_utc);
-		break;
-	case NRF_CLOUD_AGPS_EPHEMERIDES:
-		element->ephemeris = (struct nrf_cloud_agps_ephemeris *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_ephemeris);
-		break;
-	case NRF_CLOUD_AGPS_ALMANAC:
-		element->almanac = (struct nrf_cloud_agps_almanac *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_almanac);
-		break;
-	case NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION:
-		element->ion_correction.klobuchar =
-			(struct nrf_cloud_agps_klobuchar *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_klobuchar);
-		break;
-	case NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK:
-		element->time_and_tow =
-			(struct nrf_cloud_agps_system_time *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_system_time) -
-			sizeof(element->time_and_tow->sv_tow) + 4;
-		break;
-	case NRF_CLOUD_AGPS_GPS_TOWS:
-		element->tow =
-			(struct nrf_cloud_agps_tow_element *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_tow_element);
-		break;
-	case NRF_CLOUD_AGPS_LOCATION:
-		element->location = (struct nrf_cloud_agps_location *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_location);
-		break;
-	case NRF_CLOUD_AGPS_INTEGRITY:
-		element->integrity =
-			(struct nrf_cloud_agps_integrity *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_integrity);
-		break;
-	default:
-		LOG_DBG("Unhandled A-GPS data type: %d", element->type);
-		return 0;
-	}
-
-	return len;
-}
-
-int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
+/* Start an injection, to the GNSS socket if given, otherwise with the GPS
+ * driver. Injections are serialized, the caller must call agps_inject_finish()
+ * if this function succeeds.
+ */
+static int agps_inject_begin(const int *socket)
 {
 	int err;
-	struct nrf_cloud_apgs_element element = {0};
-	struct nrf_cloud_agps_system_time sys_time = {0};
-	uint32_t sv_mask = 0;
-	size_t parsed_len = 0;
-	uint8_t version;
-
 
 	err = k_sem_take(&agps_injection_active, K_FOREVER);
 	if (err) {
@@ -688,17 +617,6 @@ int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
 	}
 	LOG_DBG("A-GPS_injection_active LOCKED");
 
-	version = buf[NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_INDEX];
-	parsed_len += NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_SIZE;
-
-	if (version != NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION) {
-		LOG_ERR("Cannot parse schema version: %d", version);
-		return -EBADMSG;
-	}
-
-	LOG_DBG("Received AGPS data. Schema version: %d, length: %d",
-		version, buf_len);
-
 	if (socket) {
 		LOG_DBG("Using user-provided socket, fd %d", fd);
 
@@ -714,44 +632,24 @@ int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
 		}
 	}
 
-	while (parsed_len < buf_len) {
-		size_t element_size =
-			get_next_agps_element(&element, &buf[parsed_len]);
-
-		if (element_size == 0) {
-			LOG_DBG("Parsing finished\n");
-			break;
-		}
-
-		parsed_len += element_size;
+	nagps_inject_start(agps_send_to_modem);
 
-		LOG_DBG("Parsed_len: %d\n", parsed_len);
-
-		if (element.type == NRF_CLOUD_AGPS_GPS_TOWS) {
-			memcpy(&sys_time.sv_tow[element.tow->sv_id - 1],
-				element.tow,
-				sizeof(sys_time.sv_tow[0]));
-			if (element.tow->flags || element.tow->tlm) {
-				sv_mask |= 1 << (element.tow->sv_id - 1);
-			}
+	return 0;
+}
 
-			LOG_DBG("TOW %d copied", element.tow->sv_id - 1);
+/* Wait until the injection is complete. If err is set, it is returned
+ * instead of the result of the injection.
+ */
+static int agps_inject_finish(int err)
+{
+	int inject_err = nagps_inject_end();
 
-			continue;
-		} else if (element.type == NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK) {
-			memcpy(&sys_time, element.time_and_tow,
-				sizeof(sys_time) - sizeof(sys_time.sv_tow));
-			sys_time.sv_mask = sv_mask | element.time_and_tow->sv_mask;
-			LOG_DBG("TOWs copied, bitmask: 0x%08x",
-				sys_time.sv_mask);
-			element.time_and_tow = &sys_time;
-		}
+	if (err == 0) {
+		err = inject_err;
+	}
 
-		err = agps_send_to_modem(&element);
-		if (err) {
-			LOG_ERR("Failed to send data to modem, error: %d", err);
-			break;
-		}
+	if (err) {
+		LOG_ERR("Failed to send data to modem, error: %d", err);
 	}
 
 	LOG_DBG("A-GPS_inject_active UNLOCKED");
@@ -760,9 +658,95 @@ int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
 	return err;
 }
 
+int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
+{
+	int err;
+
+	if (buf[NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_INDEX] !=
+	    NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION) {
+		LOG_ERR("Cannot parse schema version: %d",
+			buf[NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_INDEX]);
+		return -EBADMSG;
+	}
+
+	LOG_DBG("Received AGPS data. Schema version: %d, length: %d",
+		buf[NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_INDEX], buf_len);
+
+	err = agps_inject_begin(socket);
+	if (err) {
+		return err;
+	}
+
+	err = nagps_inject_data((const uint8_t *)buf, buf_len);
+
+	return agps_inject_finish(err);
+}
+
+void nrf_cloud_agps_visible_sv_set(uint32_t sv_mask)
+{
+	nagps_inject_visible_sv_set(sv_mask);
+}
+
 void nrf_cloud_agps_processed(struct gps_agps_request *received_elements)
 {
 	if (received_elements) {
 		memcpy(received_elements, &processed, sizeof(struct gps_agps_request));
 	}
 }
+
+#if defined(CONFIG_NRF_CLOUD_AGPS_RX_STREAM)
+/* A-GPS data received from the transport is injected as it arrives. */
+static int rx_stream_err;
+
+static bool rx_stream_start(const struct nrf_cloud_topic *topic,
+			    const uint8_t *buf, size_t len, size_t total_len)
+{
+	ARG_UNUSED(topic);
+
+	/* A-GPS data is binary and starts with the schema version, other
+	 * messages on the data channel are JSON. An empty first chunk cannot
+	 * be told apart and is left to the regular receive path.
+	 */
+	if ((len <= NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_INDEX) ||
+	    (buf[NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_INDEX] !=
+	     NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION)) {
+		return false;
+	}
+
+	LOG_DBG("Receiving AGPS data, length: %zu", total_len);
+
+	rx_stream_err = agps_inject_begin(NULL);
+
+	/* The data is taken even if it cannot be injected, it is of no use
+	 * to the application either.
+	 */
+	return true;
+}
+
+static int rx_stream_data(const uint8_t *buf, size_t len)
+{
+	if (rx_stream_err) {
+		return rx_stream_err;
+	}
+
+	return nagps_inject_data(buf, len);
+}
+
+static void rx_stream_end(int err)
+{
+	if (rx_stream_err) {
+		return;
+	}
+
+	err = agps_inject_finish(err);
+	if (err) {
+		LOG_ERR("A-GPS data processing failed, error: %d", err);
+	}
+}
+
+const struct nct_rx_stream nrf_cloud_agps_rx_stream = {
+	.start = rx_stream_start,
+	.data = rx_stream_data,
+	.end = rx_stream_end,
+};
+#endif /* CONFIG_NRF_CLOUD_AGPS_RX_STREAM */
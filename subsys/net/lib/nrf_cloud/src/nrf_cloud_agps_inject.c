@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#include <logging/log.h>
+
+#include "nrf_cloud_agps_inject.h"
+
+LOG_MODULE_REGISTER(nrf_cloud_agps_inject, CONFIG_NRF_CLOUD_GPS_LOG_LEVEL);
+
+#define QUEUE_LEN CONFIG_NRF_CLOUD_AGPS_INJECT_QUEUE_LEN
+
+#define HEADER_SIZE (NRF_CLOUD_AGPS_BIN_TYPE_SIZE + \
+		     NRF_CLOUD_AGPS_BIN_COUNT_SIZE)
+
+/* The system clock element in the binary format holds no TOWs. They are sent
+ * as separate elements. The element is followed by four unused bytes.
+ */
+#define SYSTEM_CLOCK_SIZE (offsetof(struct nrf_cloud_agps_system_time, sv_tow))
+#define SYSTEM_CLOCK_ELEMENT_SIZE (SYSTEM_CLOCK_SIZE + 4)
+
+/* Elements in the order they are sent to the modem. The modem needs time and
+ * location to make use of ephemerides, almanacs are only needed when there
+ * are no ephemerides.
+ */
+enum inject_prio {
+	PRIO_TIME,
+	PRIO_LOCATION,
+	PRIO_EPHEMERIS_VISIBLE,
+	PRIO_EPHEMERIS,
+	PRIO_OTHER,
+	PRIO_ALMANAC,
+};
+
+enum entry_state {
+	ENTRY_FREE,
+	ENTRY_QUEUED,
+	ENTRY_SENDING,
+};
+
+union element_data {
+	struct nrf_cloud_agps_utc utc;
+	struct nrf_cloud_agps_ephemeris ephemeris;
+	struct nrf_cloud_agps_almanac almanac;
+	struct nrf_cloud_agps_klobuchar klobuchar;
+	struct nrf_cloud_agps_tow_element tow;
+	struct nrf_cloud_agps_system_time time_and_tow;
+	struct nrf_cloud_agps_location location;
+	struct nrf_cloud_agps_integrity integrity;
+};
+
+struct queue_entry {
+	enum entry_state state;
+	enum nrf_cloud_agps_type type;
+	enum inject_prio prio;
+	uint32_t seq;
+	union element_data data;
+};
+
+enum parse_state {
+	PARSE_VERSION,
+	PARSE_HEADER,
+	PARSE_ELEMENT,
+	PARSE_DONE,
+	PARSE_ERROR,
+};
+
+static struct queue_entry queue[QUEUE_LEN];
+static K_MUTEX_DEFINE(queue_lock);
+static K_SEM_DEFINE(queue_free, QUEUE_LEN, QUEUE_LEN);
+static K_SEM_DEFINE(queue_used, 0, QUEUE_LEN);
+
+static nagps_inject_send_t send_element;
+static atomic_t send_err;
+static atomic_t visible_sv_mask;
+
+static struct {
+	enum parse_state state;
+	/* Bytes of the current header or element received so far. */
+	union {
+		uint8_t buf[sizeof(union element_data)];
+		union element_data element;
+	};
+	size_t len;
+	size_t size;
+	enum nrf_cloud_agps_type type;
+	uint16_t elements_left;
+	/* TOWs are collected and sent with the system clock element. */
+	struct nrf_cloud_agps_system_time sys_time;
+	uint32_t tow_mask;
+	uint32_t seq;
+	int64_t start_time;
+} parser;
+
+static size_t element_size(enum nrf_cloud_agps_type type)
+{
+	switch (type) {
+	case NRF_CLOUD_AGPS_UTC_PARAMETERS:
+		return sizeof(struct nrf_cloud_agps_utc);
+	case NRF_CLOUD_AGPS_EPHEMERIDES:
+		return sizeof(struct nrf_cloud_agps_ephemeris);
+	case NRF_CLOUD_AGPS_ALMANAC:
+		return sizeof(struct nrf_cloud_agps_almanac);
+	case NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION:
+		return sizeof(struct nrf_cloud_agps_klobuchar);
+	case NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK:
+		return SYSTEM_CLOCK_ELEMENT_SIZE;
+	case NRF_CLOUD_AGPS_GPS_TOWS:
+		return sizeof(struct nrf_cloud_agps_tow_element);
+	case NRF_CLOUD_AGPS_LOCATION:
+		return sizeof(struct nrf_cloud_agps_location);
+	case NRF_CLOUD_AGPS_INTEGRITY:
+		return sizeof(struct nrf_cloud_agps_integrity);
+	default:
+		return 0;
+	}
+}
+
+static enum inject_prio prio_get(enum nrf_cloud_agps_type type,
+				 const union element_data *data)
+{
+	uint8_t sv_id;
+
+	switch (type) {
+	case NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK:
+		return PRIO_TIME;
+	case NRF_CLOUD_AGPS_LOCATION:
+		return PRIO_LOCATION;
+	case NRF_CLOUD_AGPS_EPHEMERIDES:
+		sv_id = data->ephemeris.sv_id;
+
+		if ((sv_id >= 1) && (sv_id <= NRF_CLOUD_AGPS_MAX_SV_TOW) &&
+		    ((uint32_t)atomic_get(&visible_sv_mask) & BIT(sv_id - 1))) {
+			return PRIO_EPHEMERIS_VISIBLE;
+		}
+
+		return PRIO_EPHEMERIS;
+	case NRF_CLOUD_AGPS_ALMANAC:
+		return PRIO_ALMANAC;
+	default:
+		return PRIO_OTHER;
+	}
+}
+
+/* Put an element in a free queue entry, waiting for one if the queue is full.
+ */
+static void queue_put(enum nrf_cloud_agps_type type, const void *data,
+		      size_t len)
+{
+	struct queue_entry *entry = NULL;
+
+	k_sem_take(&queue_free, K_FOREVER);
+	k_mutex_lock(&queue_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(queue); i++) {
+		if (queue[i].state == ENTRY_FREE) {
+			entry = &queue[i];
+			break;
+		}
+	}
+
+	__ASSERT_NO_MSG(entry != NULL);
+
+	entry->type = type;
+	entry->seq = parser.seq++;
+	memcpy(&entry->data, data, len);
+	entry->prio = prio_get(type, &entry->data);
+	entry->state = ENTRY_QUEUED;
+
+	k_mutex_unlock(&queue_lock);
+	k_sem_give(&queue_used);
+}
+
+/* Get the queued entry that is sent next and mark it as being sent. */
+static struct queue_entry *queue_get(void)
+{
+	struct queue_entry *next = NULL;
+
+	k_sem_take(&queue_used, K_FOREVER);
+	k_mutex_lock(&queue_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(queue); i++) {
+		if (queue[i].state != ENTRY_QUEUED) {
+			continue;
+		}
+
+		if ((next == NULL) || (queue[i].prio < next->prio) ||
+		    ((queue[i].prio == next->prio) &&
+		     ((int32_t)(queue[i].seq - next->seq) < 0))) {
+			next = &queue[i];
+		}
+	}
+
+	__ASSERT_NO_MSG(next != NULL);
+
+	next->state = ENTRY_SENDING;
+
+	k_mutex_unlock(&queue_lock);
+
+	return next;
+}
+
+static void queue_release(struct queue_entry *entry)
+{
+	k_mutex_lock(&queue_lock, K_FOREVER);
+	entry->state = ENTRY_FREE;
+	k_mutex_unlock(&queue_lock);
+
+	k_sem_give(&queue_free);
+}
+
+static void inject_thread(void)
+{
+	struct nrf_cloud_apgs_element element;
+	struct queue_entry *entry;
+	int err;
+
+	while (true) {
+		entry = queue_get();
+
+		/* Elements following a failed one are dropped. */
+		if (atomic_get(&send_err) == 0) {
+			element.type = entry->type;
+			/* All members of the element union point to the
+			 * element data.
+			 */
+			element.utc = &entry->data.utc;
+
+			err = send_element(&element);
+			if (err) {
+				(void)atomic_cas(&send_err, 0, err);
+			}
+		}
+
+		queue_release(entry);
+	}
+}
+
+K_THREAD_DEFINE(nagps_inject_thread, CONFIG_NRF_CLOUD_AGPS_INJECT_STACK_SIZE,
+		inject_thread, NULL, NULL, NULL,
+		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
+static void expect(enum parse_state state, size_t size)
+{
+	parser.state = state;
+	parser.size = size;
+	parser.len = 0;
+}
+
+static void element_handle(void)
+{
+	const struct nrf_cloud_agps_tow_element *tow = &parser.element.tow;
+
+	switch (parser.type) {
+	case NRF_CLOUD_AGPS_GPS_TOWS:
+		if ((tow->sv_id < 1) || (tow->sv_id > NRF_CLOUD_AGPS_MAX_SV_TOW)) {
+			LOG_WRN("Invalid TOW satellite: %d", tow->sv_id);
+			break;
+		}
+
+		memcpy(&parser.sys_time.sv_tow[tow->sv_id - 1], tow,
+		       sizeof(parser.sys_time.sv_tow[0]));
+		if (tow->flags || tow->tlm) {
+			parser.tow_mask |= BIT(tow->sv_id - 1);
+		}
+
+		LOG_DBG("TOW %d copied", tow->sv_id - 1);
+		break;
+	case NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK:
+		memcpy(&parser.sys_time, &parser.element.time_and_tow,
+		       SYSTEM_CLOCK_SIZE);
+		parser.sys_time.sv_mask |= parser.tow_mask;
+		LOG_DBG("TOWs copied, bitmask: 0x%08x", parser.sys_time.sv_mask);
+
+		queue_put(parser.type, &parser.sys_time, sizeof(parser.sys_time));
+		break;
+	default:
+		queue_put(parser.type, &parser.element, parser.size);
+		break;
+	}
+}
+
+/* Handle the header or element that has been received completely. */
+static void parse_next(void)
+{
+	switch (parser.state) {
+	case PARSE_VERSION:
+		if (parser.buf[0] != NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION) {
+			LOG_ERR("Cannot parse schema version: %d", parser.buf[0]);
+			parser.state = PARSE_ERROR;
+			break;
+		}
+
+		expect(PARSE_HEADER, HEADER_SIZE);
+		break;
+	case PARSE_HEADER:
+		/* The element type and count are only given once before an
+		 * array of elements.
+		 */
+		parser.type = parser.buf[NRF_CLOUD_AGPS_BIN_TYPE_OFFSET];
+		parser.elements_left =
+			sys_get_le16(&parser.buf[NRF_CLOUD_AGPS_BIN_COUNT_OFFSET]);
+
+		if (element_size(parser.type) == 0) {
+			LOG_DBG("Unhandled A-GPS data type: %d", parser.type);
+			parser.state = PARSE_DONE;
+		} else if (parser.elements_left == 0) {
+			expect(PARSE_HEADER, HEADER_SIZE);
+		} else {
+			expect(PARSE_ELEMENT, element_size(parser.type));
+		}
+		break;
+	case PARSE_ELEMENT:
+		element_handle();
+
+		if (--parser.elements_left == 0) {
+			expect(PARSE_HEADER, HEADER_SIZE);
+		} else {
+			expect(PARSE_ELEMENT, parser.size);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void nagps_inject_start(nagps_inject_send_t send)
+{
+	send_element = send;
+	atomic_set(&send_err, 0);
+
+	memset(&parser, 0, sizeof(parser));
+	expect(PARSE_VERSION, NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_SIZE);
+	parser.start_time = k_uptime_get();
+}
+
+int nagps_inject_data(const uint8_t *buf, size_t len)
+{
+	size_t copy_len;
+	int err;
+
+	while ((len > 0) && (parser.state != PARSE_DONE) &&
+	       (parser.state != PARSE_ERROR)) {
+		err = atomic_get(&send_err);
+		if (err) {
+			return err;
+		}
+
+		copy_len = MIN(len, parser.size - parser.len);
+		memcpy(&parser.buf[parser.len], buf, copy_len);
+		parser.len += copy_len;
+		buf += copy_len;
+		len -= copy_len;
+
+		if (parser.len == parser.size) {
+			parse_next();
+		}
+	}
+
+	if (parser.state == PARSE_ERROR) {
+		return -EBADMSG;
+	}
+
+	return atomic_get(&send_err);
+}
+
+int nagps_inject_end(void)
+{
+	int err;
+
+	/* All entries are free when the last element has been sent. */
+	for (size_t i = 0; i < QUEUE_LEN; i++) {
+		k_sem_take(&queue_free, K_FOREVER);
+	}
+
+	for (size_t i = 0; i < QUEUE_LEN; i++) {
+		k_sem_give(&queue_free);
+	}
+
+	err = atomic_get(&send_err);
+	if (err) {
+		return err;
+	}
+
+	if (parser.state == PARSE_ERROR) {
+		return -EBADMSG;
+	}
+
+	/* Data is complete only if it ends where the next header would start,
+	 * after all elements announced by the previous header.
+	 */
+	if ((parser.state != PARSE_DONE) &&
+	    ((parser.state != PARSE_HEADER) || (parser.len > 0) ||
+	     (parser.elements_left > 0))) {
+		LOG_ERR("A-GPS data ended in the middle of a header or element");
+		return -EBADMSG;
+	}
+
+	LOG_DBG("A-GPS data injected in %lld ms",
+		k_uptime_get() - parser.start_time);
+
+	return 0;
+}
+
+void nagps_inject_visible_sv_set(uint32_t sv_mask)
+{
+	atomic_set(&visible_sv_mask, (atomic_val_t)sv_mask);
+}
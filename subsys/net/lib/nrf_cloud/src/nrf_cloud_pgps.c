@@ -872,7 +872,7 @@ int nrf_cloud_pgps_inject(struct nrf_cloud_pgps_prediction *p,
 	}
 
 	if (remainder.system_time_tow) {
-		struct pgps_sys_time sys_time;
+		struct pgps_sys_time sys_time = {0};
 		uint16_t day;
 		uint32_t sec;
 
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "nrf_cloud_rx_stream.h"
+#include <zephyr.h>
+#include <sys/util.h>
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(nrf_cloud_rx_stream, CONFIG_NRF_CLOUD_LOG_LEVEL);
+
+const struct nct_rx_stream *nct_rx_stream_find(
+	const struct nct_rx_stream *const *streams,
+	const struct nrf_cloud_topic *topic, const uint8_t *buf,
+	size_t chunk_len, size_t total_len)
+{
+	for (size_t i = 0; streams[i] != NULL; i++) {
+		if (streams[i]->start(topic, buf, chunk_len, total_len)) {
+			return streams[i];
+		}
+	}
+
+	return NULL;
+}
+
+int nct_payload_discard(struct mqtt_client *client, uint8_t *buf,
+			size_t buf_len, size_t len)
+{
+	while (len > 0) {
+		size_t chunk_len = MIN(len, buf_len);
+		int ret = mqtt_readall_publish_payload(client, buf, chunk_len);
+
+		if (ret) {
+			return ret;
+		}
+
+		len -= chunk_len;
+	}
+
+	return 0;
+}
+
+int nct_rx_stream_read(struct mqtt_client *client,
+		       const struct nct_rx_stream *stream, uint8_t *buf,
+		       size_t buf_len, size_t chunk_len, size_t total_len)
+{
+	size_t read_len = chunk_len;
+	int err = stream->data(buf, chunk_len);
+
+	while ((err == 0) && (read_len < total_len)) {
+		chunk_len = MIN(total_len - read_len, buf_len);
+
+		err = mqtt_readall_publish_payload(client, buf, chunk_len);
+		if (err) {
+			stream->end(err);
+			return err;
+		}
+
+		read_len += chunk_len;
+		err = stream->data(buf, chunk_len);
+	}
+
+	stream->end(err);
+
+	if (err) {
+		LOG_ERR("Stream receiver failed: %d, discarding %zu bytes",
+			err, total_len - read_len);
+		return nct_payload_discard(client, buf, buf_len,
+					   total_len - read_len);
+	}
+
+	return 0;
+}
@@ -122,6 +122,17 @@ static struct nct {
 	uint8_t payload_buf[CONFIG_NRF_CLOUD_MQTT_PAYLOAD_BUFFER_LEN + 1];
 } nct;
 
+/* Payloads larger than the payload buffer are read in chunks of this size. */
+#define NCT_PAYLOAD_CHUNK_LEN CONFIG_NRF_CLOUD_MQTT_PAYLOAD_BUFFER_LEN
+
+/* Receivers of data channel messages, NULL terminated. */
+static const struct nct_rx_stream *const rx_streams[] = {
+#if defined(CONFIG_NRF_CLOUD_AGPS_RX_STREAM)
+	&nrf_cloud_agps_rx_stream,
+#endif
+	NULL
+};
+
 #define CC_RX_LIST_CNT 3
 static struct mqtt_topic nct_cc_rx_list[CC_RX_LIST_CNT];
 #define CC_TX_LIST_CNT 2
@@ -756,6 +767,39 @@ static int publish_get_payload(struct mqtt_client *client, size_t length)
 	return ret;
 }
 
+/* Read and drop the rest of a payload, so that the connection stays usable. */
+static int publish_discard_payload(struct mqtt_client *client, size_t length)
+{
+	return nct_payload_discard(client, nct.payload_buf,
+				   NCT_PAYLOAD_CHUNK_LEN, length);
+}
+
+/* Offer a data channel message to the stream receivers. The first chunk of
+ * the payload has been read to the payload buffer.
+ */
+static const struct nct_rx_stream *rx_stream_find(
+	const struct mqtt_topic *topic, size_t chunk_len, size_t total_len)
+{
+	const struct nrf_cloud_topic rx_topic = {
+		.ptr = topic->topic.utf8,
+		.len = topic->topic.size
+	};
+
+	return nct_rx_stream_find(rx_streams, &rx_topic, nct.payload_buf,
+				  chunk_len, total_len);
+}
+
+/* Pass the payload to a stream receiver chunk by chunk, reusing the payload
+ * buffer.
+ */
+static int rx_stream_read(struct mqtt_client *client,
+			  const struct nct_rx_stream *stream,
+			  size_t chunk_len, size_t total_len)
+{
+	return nct_rx_stream_read(client, stream, nct.payload_buf,
+				  NCT_PAYLOAD_CHUNK_LEN, chunk_len, total_len);
+}
+
 /* Handle MQTT events. */
 static void nct_mqtt_evt_handler(struct mqtt_client *const mqtt_client,
 				 const struct mqtt_evt *_mqtt_evt)
@@ -796,14 +840,16 @@ static void nct_mqtt_evt_handler(struct mqtt_client *const mqtt_client,
 	}
 	case MQTT_EVT_PUBLISH: {
 		const struct mqtt_publish_param *p = &_mqtt_evt->param.publish;
+		const struct nct_rx_stream *stream = NULL;
+		size_t chunk_len = MIN(p->message.payload.len,
+				       NCT_PAYLOAD_CHUNK_LEN);
+		bool cc_topic;
 
 		LOG_DBG("MQTT_EVT_PUBLISH: id = %d len = %d",
 			p->message_id,
 			p->message.payload.len);
 
-		int err = publish_get_payload(mqtt_client,
-					      p->message.payload.len);
-
+		err = publish_get_payload(mqtt_client, chunk_len);
 		if (err < 0) {
 			LOG_ERR("publish_get_payload: failed %d", err);
 			nrf_cloud_disconnect();
@@ -814,8 +860,23 @@ static void nct_mqtt_evt_handler(struct mqtt_client *const mqtt_client,
 		/* If the data arrives on one of the subscribed control channel
 		 * topic. Then we notify the same.
 		 */
-		if (control_channel_topic_match(NCT_RX_LIST, &p->message.topic,
-						&cc.opcode)) {
+		cc_topic = control_channel_topic_match(NCT_RX_LIST,
+						       &p->message.topic,
+						       &cc.opcode);
+		if (!cc_topic) {
+			stream = rx_stream_find(&p->message.topic, chunk_len,
+						p->message.payload.len);
+		}
+
+		if (stream != NULL) {
+			err = rx_stream_read(mqtt_client, stream, chunk_len,
+					     p->message.payload.len);
+		} else if (chunk_len < p->message.payload.len) {
+			LOG_ERR("Payload of %d bytes does not fit in buffer",
+				p->message.payload.len);
+			err = publish_discard_payload(mqtt_client,
+				p->message.payload.len - chunk_len);
+		} else if (cc_topic) {
 			cc.id = p->message_id;
 			cc.data.ptr = nct.payload_buf;
 			cc.data.len = p->message.payload.len;
@@ -838,6 +899,12 @@ static void nct_mqtt_evt_handler(struct mqtt_client *const mqtt_client,
 			event_notify = true;
 		}
 
+		if (err < 0) {
+			LOG_ERR("Failed to read payload: %d", err);
+			nrf_cloud_disconnect();
+			break;
+		}
+
 		if (p->message.topic.qos == MQTT_QOS_1_AT_LEAST_ONCE) {
 			const struct mqtt_puback_param ack = {
 				.message_id = p->message_id
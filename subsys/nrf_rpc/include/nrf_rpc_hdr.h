@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef NRF_RPC_HDR_H_
+#define NRF_RPC_HDR_H_
+
+#include <zephyr.h>
+
+#include "nrf_rpc.h"
+
+/**
+ * @file
+ * @brief Layout of the nRF RPC packet header.
+ *
+ * The header is encoded by nRF RPC and holds, one byte each, the source
+ * context ID, the packet type, the command or event ID, the destination
+ * context ID and the group ID. The OS abstraction and the transports look
+ * into it to decide how a packet is handled.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Offset of the packet type in the nRF RPC packet header. */
+#define NRF_RPC_HDR_TYPE_OFFSET 1
+
+/** @brief Offset of the group ID in the nRF RPC packet header. */
+#define NRF_RPC_HDR_GROUP_ID_OFFSET 4
+
+#if defined(_NRF_RPC_HEADER_SIZE)
+BUILD_ASSERT(NRF_RPC_HDR_GROUP_ID_OFFSET == _NRF_RPC_HEADER_SIZE - 1,
+	     "The group ID must be the last byte of the nRF RPC header");
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NRF_RPC_HDR_H_ */
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef NRF_RPC_TR_LOOPBACK_H_
+#define NRF_RPC_TR_LOOPBACK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @defgroup nrf_rpc_tr_loopback nRF PRC loopback transport
+ * @{
+ * @brief nRF PRC transport that delivers sent packets back to the sender.
+ *
+ * The local nRF RPC instance acts as its own remote side, so commands and
+ * events are executed by the decoders registered in the same image. It is
+ * intended for measuring serialization and dispatch cost without a second
+ * core.
+ *
+ * API is compatible with nrf_rpc_tr API. For API documentation
+ * @see nrf_rpc_tr_tmpl.h
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NRF_RPC_TR_MAX_HEADER_SIZE 0
+#define NRF_RPC_TR_AUTO_FREE_RX_BUF 1
+
+/** @brief Loopback transport statistics. */
+struct nrf_rpc_loopback_stats {
+	/** Number of packets sent. */
+	uint32_t packets;
+
+	/** Number of bytes copied by the transport. */
+	uint64_t bytes;
+};
+
+typedef void (*nrf_rpc_tr_receive_handler_t)(const uint8_t *packet, size_t len);
+
+int nrf_rpc_tr_init(nrf_rpc_tr_receive_handler_t callback);
+
+static inline void nrf_rpc_tr_free_rx_buf(const uint8_t *buf)
+{
+}
+
+#define nrf_rpc_tr_alloc_tx_buf(buf, len)				       \
+	uint32_t _nrf_rpc_tr_buf_vla[(sizeof(uint32_t) - 1 + (len)) /	       \
+				     sizeof(uint32_t)];			       \
+	*(buf) = (uint8_t *)(&_nrf_rpc_tr_buf_vla)
+
+#define nrf_rpc_tr_free_tx_buf(buf)
+
+int nrf_rpc_tr_send(uint8_t *buf, size_t len);
+
+/** @brief Get the loopback transport statistics.
+ *
+ * @param[out] stats Statistics collected since initialization.
+ */
+void nrf_rpc_loopback_stats_get(struct nrf_rpc_loopback_stats *stats);
+
+/** @brief Reset the loopback transport statistics. */
+void nrf_rpc_loopback_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ *@}
+ */
+
+#endif /* NRF_RPC_TR_LOOPBACK_H_ */
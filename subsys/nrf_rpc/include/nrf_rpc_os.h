@@ -34,10 +34,57 @@ struct nrf_rpc_os_msg {
 
 typedef void (*nrf_rpc_os_work_t)(const uint8_t *data, size_t len);
 
+/** @brief Thread pool queues. */
+enum nrf_rpc_os_pool_queue {
+	/** Queue for groups selected by
+	 *  CONFIG_NRF_RPC_THREAD_POOL_PRIO_GROUP_MASK.
+	 */
+	NRF_RPC_OS_POOL_QUEUE_PRIO,
+
+	/** Queue for all other groups. */
+	NRF_RPC_OS_POOL_QUEUE_NORMAL,
+
+	NRF_RPC_OS_POOL_QUEUE_COUNT
+};
+
+/** @brief Statistics of one thread pool queue. */
+struct nrf_rpc_os_pool_queue_stats {
+	/** Number of packets passed to the thread pool. */
+	uint32_t count;
+
+	/** Maximum number of packets waiting in the queue. */
+	uint32_t max_depth;
+
+	/** Maximum time between receiving a packet and starting its handler
+	 *  in microseconds.
+	 */
+	uint32_t max_latency_us;
+
+	/** Sum of the latencies of all handled packets in microseconds. */
+	uint64_t total_latency_us;
+};
+
+/** @brief Thread pool statistics. */
+struct nrf_rpc_os_pool_stats {
+	/** Statistics for each queue. */
+	struct nrf_rpc_os_pool_queue_stats queue[NRF_RPC_OS_POOL_QUEUE_COUNT];
+
+	/** Number of started threads. */
+	uint32_t threads;
+};
+
 int nrf_rpc_os_init(nrf_rpc_os_work_t callback);
 
 void nrf_rpc_os_thread_pool_send(const uint8_t *data, size_t len);
 
+/** @brief Get the thread pool statistics.
+ *
+ * Requires CONFIG_NRF_RPC_THREAD_POOL_STATS.
+ *
+ * @param[out] stats Statistics collected since initialization.
+ */
+void nrf_rpc_os_thread_pool_stats_get(struct nrf_rpc_os_pool_stats *stats);
+
 static inline int nrf_rpc_os_event_init(struct nrf_rpc_os_event *event)
 {
 	return k_sem_init(&event->sem, 0, 1);
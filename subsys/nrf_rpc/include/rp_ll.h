@@ -13,6 +13,8 @@
 #include <metal/alloc.h>
 #include <openamp/open_amp.h>
 
+#include "rp_ll_batch.h"
+
 /**
  * @file
  * @brief Experimental layer to simplify rpmsg communication between cores
@@ -28,6 +30,12 @@ enum rp_ll_event_type {
 	RP_LL_EVENT_CONNECTED,  /**< @brief Handshake was successful */
 	RP_LL_EVENT_ERROR,      /**< @brief Endpoint was not able to connect */
 	RP_LL_EVENT_DATA,       /**< @brief New packet arrived */
+	RP_LL_EVENT_SEND_ERROR, /**< @brief Packets accepted by rp_ll_send()
+				 *   could not be sent and were lost
+				 */
+	RP_LL_EVENT_RECV_ERROR, /**< @brief Malformed data was received and
+				 *   packets in it were lost
+				 */
 };
 
 struct rp_ll_endpoint;
@@ -35,6 +43,9 @@ struct rp_ll_endpoint;
 /** @brief Callback called from endpoint's rx thread when an asynchronous event
  * occurred.
  *
+ * RP_LL_EVENT_SEND_ERROR is called from the thread that failed to send
+ * a batch, when CONFIG_NRF_RPC_TR_RPMSG_BATCH is enabled.
+ *
  * @param endpoint  endpoint on which event was generated
  * @param event     type of event
  * @param buf       pointer to data buffer for RP_LL_EVENT_DATA event
@@ -51,6 +62,9 @@ struct rp_ll_endpoint {
 	struct rpmsg_endpoint rpmsg_ep;
 	rp_ll_event_handler callback;
 	uint32_t flags;
+#if defined(CONFIG_NRF_RPC_TR_RPMSG_BATCH)
+	struct rp_ll_batch_tx batch_tx;
+#endif
 };
 
 /** @brief Initializes the communication
@@ -88,6 +102,24 @@ void rp_ll_endpoint_uninit(struct rp_ll_endpoint *endpoint);
 int rp_ll_send(struct rp_ll_endpoint *endpoint, const uint8_t *buf,
 	       size_t buf_len);
 
+/** @brief Sends packets waiting in the pending batch of an endpoint.
+ *
+ * Does nothing if CONFIG_NRF_RPC_TR_RPMSG_BATCH is disabled.
+ *
+ * @param endpoint  endpoint to use
+ */
+int rp_ll_flush(struct rp_ll_endpoint *endpoint);
+
+/** @brief Gets packet batching statistics of an endpoint.
+ *
+ * Requires CONFIG_NRF_RPC_TR_RPMSG_BATCH.
+ *
+ * @param endpoint  endpoint to read statistics from
+ * @param stats     statistics collected since the endpoint was initialized
+ */
+void rp_ll_batch_stats_get(struct rp_ll_endpoint *endpoint,
+			   struct rp_ll_batch_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
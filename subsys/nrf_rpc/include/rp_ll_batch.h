@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef RP_LL_BATCH_H_
+#define RP_LL_BATCH_H_
+
+#include <zephyr.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * @brief Packing of multiple packets into a single rpmsg buffer.
+ *
+ * Each packet in a batch is preceded by its length encoded as a 16-bit
+ * little-endian value.
+ *
+ * The sending side is independent of rpmsg. Buffers are obtained and sent
+ * through the operations given to rp_ll_batch_tx_init(), so that it can be
+ * used with other transports and tested without the peer core.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Size of the header preceding each packet in a batch. */
+#define RP_LL_BATCH_HDR_SIZE 2
+
+/** @brief Batch under construction. */
+struct rp_ll_batch {
+	/** Buffer holding the batch. */
+	uint8_t *buf;
+
+	/** Size of @a buf. */
+	size_t size;
+
+	/** Number of bytes used in @a buf. */
+	size_t len;
+
+	/** Number of packets in the batch. */
+	uint16_t count;
+};
+
+/** @brief Callback called for each packet found in a received batch.
+ *
+ * @param data       packet data
+ * @param len        packet length
+ * @param user_data  transparent data pointer passed to rp_ll_batch_parse()
+ */
+typedef void (*rp_ll_batch_packet_cb)(const uint8_t *data, size_t len,
+				      void *user_data);
+
+/** @brief Start a new batch in a buffer.
+ *
+ * @param batch  batch to initialize
+ * @param buf    buffer for the batch
+ * @param size   size of @a buf
+ */
+void rp_ll_batch_init(struct rp_ll_batch *batch, uint8_t *buf, size_t size);
+
+/** @brief Append a packet to a batch.
+ *
+ * @param batch  batch to append to
+ * @param data   packet data
+ * @param len    packet length
+ *
+ * @retval 0        packet was appended
+ * @retval -EINVAL  packet is empty or too long to be encoded
+ * @retval -ENOMEM  not enough space left in the batch
+ */
+int rp_ll_batch_add(struct rp_ll_batch *batch, const uint8_t *data,
+		    size_t len);
+
+/** @brief Get the space needed in a batch to append a packet.
+ *
+ * @param len  packet length
+ *
+ * @return Number of bytes the packet takes in a batch.
+ */
+static inline size_t rp_ll_batch_packet_size(size_t len)
+{
+	return RP_LL_BATCH_HDR_SIZE + len;
+}
+
+/** @brief Split a received batch into packets.
+ *
+ * @param buf        received batch
+ * @param len        length of @a buf
+ * @param callback   callback called for each packet in order
+ * @param user_data  transparent data pointer for @a callback
+ *
+ * @return Number of packets found or -EBADMSG if the batch is malformed.
+ *         Packets preceding the malformed part were already passed to
+ *         @a callback.
+ */
+int rp_ll_batch_parse(const uint8_t *buf, size_t len,
+		      rp_ll_batch_packet_cb callback, void *user_data);
+
+/** @brief Packet batching statistics */
+struct rp_ll_batch_stats {
+	/** @brief Number of packets sent */
+	uint32_t packets;
+	/** @brief Number of rpmsg buffers sent */
+	uint32_t batches;
+	/** @brief Number of peer notifications saved by batching */
+	uint32_t notifications_saved;
+	/** @brief Number of packets lost because a batch could not be sent */
+	uint32_t packets_lost;
+};
+
+struct rp_ll_batch_tx;
+
+/** @brief Operations used to send batches. */
+struct rp_ll_batch_tx_ops {
+	/** @brief Get a buffer for a new batch.
+	 *
+	 * May block until a buffer is available.
+	 *
+	 * @param tx    batch sender
+	 * @param size  size of the returned buffer
+	 *
+	 * @return Buffer or NULL if none is available.
+	 */
+	uint8_t *(*buf_get)(struct rp_ll_batch_tx *tx, size_t *size);
+
+	/** @brief Send a batch.
+	 *
+	 * The buffer is owned by the transport only if sending succeeds.
+	 *
+	 * @param tx   batch sender
+	 * @param buf  buffer returned by @a buf_get
+	 * @param len  length of the batch
+	 *
+	 * @return 0 on success or a negative error code.
+	 */
+	int (*send)(struct rp_ll_batch_tx *tx, uint8_t *buf, size_t len);
+
+	/** @brief Report packets that were accepted, but could not be sent.
+	 *
+	 * @param tx     batch sender
+	 * @param err    error returned by @a send
+	 * @param count  number of packets lost
+	 */
+	void (*error)(struct rp_ll_batch_tx *tx, int err, uint16_t count);
+};
+
+/** @brief Batch sender.
+ *
+ * Content is not important for user of the API.
+ */
+struct rp_ll_batch_tx {
+	const struct rp_ll_batch_tx_ops *ops;
+	struct k_work_q *work_q;
+	k_timeout_t timeout;
+	struct k_mutex lock;
+	struct k_work_delayable work;
+	struct rp_ll_batch batch;
+	struct rp_ll_batch_stats stats;
+};
+
+/** @brief Initialize a batch sender.
+ *
+ * @param tx       batch sender to initialize
+ * @param ops      operations used to get buffers and send batches
+ * @param work_q   work queue used to send batches when @a timeout elapses.
+ *                 It must not block on the receiving side of the transport.
+ * @param timeout  maximum time between adding the first packet to a batch
+ *                 and sending the batch
+ */
+void rp_ll_batch_tx_init(struct rp_ll_batch_tx *tx,
+			 const struct rp_ll_batch_tx_ops *ops,
+			 struct k_work_q *work_q, k_timeout_t timeout);
+
+/** @brief Add a packet to the pending batch.
+ *
+ * The pending batch is sent first if the packet does not fit into it.
+ *
+ * @param tx    batch sender
+ * @param data  packet data
+ * @param len   packet length
+ *
+ * @retval 0        packet was added to the pending batch
+ * @retval -EINVAL  packet is empty or does not fit into an empty batch
+ * @retval -ENOMEM  no buffer is available for a new batch
+ * @return Error returned by the send operation if the pending batch could
+ *         not be sent. The packet is not added in that case and the packets
+ *         of the pending batch are reported as lost.
+ */
+int rp_ll_batch_tx_send(struct rp_ll_batch_tx *tx, const uint8_t *data,
+			size_t len);
+
+/** @brief Send the pending batch without waiting for the timeout.
+ *
+ * @param tx  batch sender
+ *
+ * @return 0 on success or error returned by the send operation.
+ */
+int rp_ll_batch_tx_flush(struct rp_ll_batch_tx *tx);
+
+/** @brief Get statistics of a batch sender.
+ *
+ * @param tx     batch sender
+ * @param stats  statistics collected since the sender was initialized
+ */
+void rp_ll_batch_tx_stats_get(struct rp_ll_batch_tx *tx,
+			      struct rp_ll_batch_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RP_LL_BATCH_H_ */
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#define NRF_RPC_LOG_MODULE NRF_RPC_TR
+#include <nrf_rpc_log.h>
+
+#include <zephyr.h>
+#include <string.h>
+
+#include "nrf_rpc.h"
+#include "nrf_rpc_loopback.h"
+
+/* Packet waiting for the receive thread. */
+struct loopback_packet {
+	void *fifo_reserved;
+	size_t len;
+	uint8_t data[];
+};
+
+K_HEAP_DEFINE(loopback_heap, CONFIG_NRF_RPC_TR_LOOPBACK_HEAP_SIZE);
+
+static K_FIFO_DEFINE(loopback_fifo);
+
+static K_THREAD_STACK_DEFINE(rx_thread_stack,
+			     CONFIG_NRF_RPC_TR_LOOPBACK_RX_STACK_SIZE);
+static struct k_thread rx_thread;
+
+/* Upper level callbacks */
+static nrf_rpc_tr_receive_handler_t receive_callback;
+
+static struct nrf_rpc_loopback_stats stats;
+static struct k_spinlock stats_lock;
+
+static void rx_thread_entry(void *p1, void *p2, void *p3)
+{
+	struct loopback_packet *packet;
+
+	do {
+		packet = k_fifo_get(&loopback_fifo, K_FOREVER);
+
+		/* The packet is freed after the callback returns, because
+		 * the transport uses NRF_RPC_TR_AUTO_FREE_RX_BUF.
+		 */
+		receive_callback(packet->data, packet->len);
+		k_heap_free(&loopback_heap, packet);
+	} while (1);
+}
+
+int nrf_rpc_tr_init(nrf_rpc_tr_receive_handler_t callback)
+{
+	NRF_RPC_ASSERT(callback != NULL);
+
+	receive_callback = callback;
+
+	k_thread_create(&rx_thread, rx_thread_stack,
+			K_THREAD_STACK_SIZEOF(rx_thread_stack),
+			rx_thread_entry, NULL, NULL, NULL,
+			CONFIG_NRF_RPC_TR_LOOPBACK_RX_PRIORITY, 0, K_NO_WAIT);
+
+	NRF_RPC_DBG("nRF RPC loopback initialized");
+
+	return 0;
+}
+
+int nrf_rpc_tr_send(uint8_t *buf, size_t len)
+{
+	struct loopback_packet *packet;
+	k_spinlock_key_t key;
+
+	NRF_RPC_ASSERT(buf != NULL);
+
+	packet = k_heap_alloc(&loopback_heap, sizeof(*packet) + len, K_FOREVER);
+	if (!packet) {
+		return -NRF_ENOMEM;
+	}
+
+	packet->len = len;
+	memcpy(packet->data, buf, len);
+
+	key = k_spin_lock(&stats_lock);
+	stats.packets++;
+	stats.bytes += len;
+	k_spin_unlock(&stats_lock, key);
+
+	k_fifo_put(&loopback_fifo, packet);
+
+	return 0;
+}
+
+void nrf_rpc_loopback_stats_get(struct nrf_rpc_loopback_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+
+	k_spin_unlock(&stats_lock, key);
+}
+
+void nrf_rpc_loopback_stats_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	memset(&stats, 0, sizeof(stats));
+
+	k_spin_unlock(&stats_lock, key);
+}
@@ -8,6 +8,7 @@
 #include <nrf_rpc_log.h>
 
 #include "nrf_rpc_os.h"
+#include "nrf_rpc_hdr.h"
 
 /* Maximum number of remote thread that this implementation allows. */
 #define MAX_REMOTE_THREADS 255
@@ -19,15 +20,42 @@
 	(~(((atomic_val_t)1 << (8 * sizeof(atomic_val_t) -		       \
 				CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE)) - 1))
 
+#if defined(CONFIG_NRF_RPC_THREAD_POOL_DYNAMIC)
+#define POOL_INITIAL_SIZE (CONFIG_NRF_RPC_THREAD_POOL_PRIO_THREADS +	       \
+			   CONFIG_NRF_RPC_THREAD_POOL_MIN_SIZE)
+#else
+#define POOL_INITIAL_SIZE CONFIG_NRF_RPC_THREAD_POOL_SIZE
+#endif
+
 struct pool_start_msg {
 	const uint8_t *data;
 	size_t len;
+#if defined(CONFIG_NRF_RPC_THREAD_POOL_STATS)
+	uint32_t timestamp;
+#endif
+};
+
+struct pool_queue {
+	struct pool_start_msg buf[CONFIG_NRF_RPC_THREAD_POOL_QUEUE_SIZE];
+	struct k_msgq msgq;
 };
 
 static nrf_rpc_os_work_t thread_pool_callback;
 
-static struct pool_start_msg pool_start_msg_buf[2];
-static struct k_msgq pool_start_msg;
+static struct pool_queue pool_queues[NRF_RPC_OS_POOL_QUEUE_COUNT];
+
+/* Counts packets waiting in any queue. Taken by threads serving both queues
+ * before they look into the queues.
+ */
+static struct k_sem pool_pending;
+
+static atomic_t pool_idle_threads;
+static atomic_t pool_started_threads;
+
+#if defined(CONFIG_NRF_RPC_THREAD_POOL_STATS)
+static struct nrf_rpc_os_pool_stats pool_stats;
+static struct k_spinlock pool_stats_lock;
+#endif
 
 static struct k_sem context_reserved;
 static atomic_t context_mask;
@@ -48,17 +76,109 @@ BUILD_ASSERT(CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE <= 8 * sizeof(atomic_val_t),
 	     "CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE too big");
 BUILD_ASSERT(sizeof(uint32_t) == sizeof(atomic_val_t),
 	     "Only atomic_val_t is implemented that is the same as uint32_t");
+BUILD_ASSERT(CONFIG_NRF_RPC_THREAD_POOL_PRIO_THREADS <
+	     CONFIG_NRF_RPC_THREAD_POOL_SIZE,
+	     "At least one thread must handle the normal queue");
+BUILD_ASSERT(POOL_INITIAL_SIZE <= CONFIG_NRF_RPC_THREAD_POOL_SIZE,
+	     "CONFIG_NRF_RPC_THREAD_POOL_MIN_SIZE too big");
+
+static void pool_stats_enqueued(enum nrf_rpc_os_pool_queue queue,
+				uint32_t depth)
+{
+#if defined(CONFIG_NRF_RPC_THREAD_POOL_STATS)
+	struct nrf_rpc_os_pool_queue_stats *stats = &pool_stats.queue[queue];
+	k_spinlock_key_t key = k_spin_lock(&pool_stats_lock);
+
+	stats->count++;
+	stats->max_depth = MAX(stats->max_depth, depth);
+
+	k_spin_unlock(&pool_stats_lock, key);
+#endif
+}
+
+static void pool_stats_update(enum nrf_rpc_os_pool_queue queue,
+			      const struct pool_start_msg *msg)
+{
+#if defined(CONFIG_NRF_RPC_THREAD_POOL_STATS)
+	struct nrf_rpc_os_pool_queue_stats *stats = &pool_stats.queue[queue];
+	uint32_t latency = k_cyc_to_us_floor32(k_cycle_get_32() -
+					       msg->timestamp);
+	k_spinlock_key_t key = k_spin_lock(&pool_stats_lock);
+
+	stats->total_latency_us += latency;
+	stats->max_latency_us = MAX(stats->max_latency_us, latency);
+
+	k_spin_unlock(&pool_stats_lock, key);
+#endif
+}
+
+static void pool_handle(enum nrf_rpc_os_pool_queue queue,
+			const struct pool_start_msg *msg)
+{
+	pool_stats_update(queue, msg);
+	thread_pool_callback(msg->data, msg->len);
+}
 
 static void thread_pool_entry(void *p1, void *p2, void *p3)
+{
+	struct pool_start_msg msg;
+	int queue;
+
+	do {
+		atomic_inc(&pool_idle_threads);
+		k_sem_take(&pool_pending, K_FOREVER);
+		atomic_dec(&pool_idle_threads);
+
+		/* Any thread takes the oldest packet of the most important
+		 * non-empty queue. A packet taken by a thread reserved for the
+		 * priority queue leaves an extra count in the semaphore, so
+		 * the queues may turn out empty here.
+		 */
+		for (queue = 0; queue < NRF_RPC_OS_POOL_QUEUE_COUNT; queue++) {
+			if (k_msgq_get(&pool_queues[queue].msgq, &msg,
+				       K_NO_WAIT) == 0) {
+				pool_handle(queue, &msg);
+				break;
+			}
+		}
+	} while (1);
+}
+
+static void thread_pool_prio_entry(void *p1, void *p2, void *p3)
 {
 	struct pool_start_msg msg;
 
 	do {
-		k_msgq_get(&pool_start_msg, &msg, K_FOREVER);
-		thread_pool_callback(msg.data, msg.len);
+		k_msgq_get(&pool_queues[NRF_RPC_OS_POOL_QUEUE_PRIO].msgq, &msg,
+			   K_FOREVER);
+		pool_handle(NRF_RPC_OS_POOL_QUEUE_PRIO, &msg);
 	} while (1);
 }
 
+/* Reserves a slot for a new thread and starts the thread in it. Returns false
+ * if all threads of the pool are already started.
+ */
+static bool pool_thread_start(void)
+{
+	atomic_val_t i;
+
+	do {
+		i = atomic_get(&pool_started_threads);
+		if (i >= CONFIG_NRF_RPC_THREAD_POOL_SIZE) {
+			return false;
+		}
+	} while (!atomic_cas(&pool_started_threads, i, i + 1));
+
+	k_thread_create(&pool_threads[i], pool_stacks[i],
+		K_THREAD_STACK_SIZEOF(pool_stacks[i]),
+		(i < CONFIG_NRF_RPC_THREAD_POOL_PRIO_THREADS) ?
+			thread_pool_prio_entry : thread_pool_entry,
+		NULL, NULL, NULL,
+		CONFIG_NRF_RPC_THREAD_PRIORITY, 0, K_NO_WAIT);
+
+	return true;
+}
+
 int nrf_rpc_os_init(nrf_rpc_os_work_t callback)
 {
 	int err;
@@ -82,28 +202,84 @@ int nrf_rpc_os_init(nrf_rpc_os_work_t callback)
 
 	atomic_set(&context_mask, CONTEXT_MASK_INIT_VALUE);
 
-	k_msgq_init(&pool_start_msg, (char *)pool_start_msg_buf,
-		    sizeof(struct pool_start_msg),
-		    ARRAY_SIZE(pool_start_msg_buf));
+	err = k_sem_init(&pool_pending, 0, K_SEM_MAX_LIMIT);
+	if (err < 0) {
+		return err;
+	}
+
+	for (i = 0; i < NRF_RPC_OS_POOL_QUEUE_COUNT; i++) {
+		k_msgq_init(&pool_queues[i].msgq, (char *)pool_queues[i].buf,
+			    sizeof(struct pool_start_msg),
+			    ARRAY_SIZE(pool_queues[i].buf));
+	}
+
+	atomic_set(&pool_idle_threads, 0);
+	atomic_set(&pool_started_threads, 0);
 
-	for (i = 0; i < CONFIG_NRF_RPC_THREAD_POOL_SIZE; i++) {
-		k_thread_create(&pool_threads[i], pool_stacks[i],
-			K_THREAD_STACK_SIZEOF(pool_stacks[i]),
-			thread_pool_entry,
-			NULL, NULL, NULL,
-			CONFIG_NRF_RPC_THREAD_PRIORITY, 0, K_NO_WAIT);
+	for (i = 0; i < POOL_INITIAL_SIZE; i++) {
+		(void)pool_thread_start();
 	}
 
 	return 0;
 }
 
+static enum nrf_rpc_os_pool_queue pool_queue_select(const uint8_t *data,
+						    size_t len)
+{
+	uint8_t group_id;
+
+	if (len <= NRF_RPC_HDR_GROUP_ID_OFFSET) {
+		return NRF_RPC_OS_POOL_QUEUE_NORMAL;
+	}
+
+	group_id = data[NRF_RPC_HDR_GROUP_ID_OFFSET];
+
+	if ((group_id < 32) &&
+	    (CONFIG_NRF_RPC_THREAD_POOL_PRIO_GROUP_MASK & BIT(group_id))) {
+		return NRF_RPC_OS_POOL_QUEUE_PRIO;
+	}
+
+	return NRF_RPC_OS_POOL_QUEUE_NORMAL;
+}
+
 void nrf_rpc_os_thread_pool_send(const uint8_t *data, size_t len)
 {
 	struct pool_start_msg msg;
+	enum nrf_rpc_os_pool_queue queue = pool_queue_select(data, len);
+	struct k_msgq *msgq = &pool_queues[queue].msgq;
 
 	msg.data = data;
 	msg.len = len;
-	k_msgq_put(&pool_start_msg, &msg, K_FOREVER);
+#if defined(CONFIG_NRF_RPC_THREAD_POOL_STATS)
+	msg.timestamp = k_cycle_get_32();
+#endif
+
+	if (IS_ENABLED(CONFIG_NRF_RPC_THREAD_POOL_DYNAMIC) &&
+	    (atomic_get(&pool_idle_threads) == 0) &&
+	    pool_thread_start()) {
+		NRF_RPC_DBG("No idle thread, started thread %d",
+			    (int)atomic_get(&pool_started_threads) - 1);
+	}
+
+	k_msgq_put(msgq, &msg, K_FOREVER);
+	pool_stats_enqueued(queue, k_msgq_num_used_get(msgq));
+	k_sem_give(&pool_pending);
+}
+
+void nrf_rpc_os_thread_pool_stats_get(struct nrf_rpc_os_pool_stats *stats)
+{
+#if defined(CONFIG_NRF_RPC_THREAD_POOL_STATS)
+	k_spinlock_key_t key = k_spin_lock(&pool_stats_lock);
+
+	*stats = pool_stats;
+	stats->threads = atomic_get(&pool_started_threads);
+
+	k_spin_unlock(&pool_stats_lock, key);
+#else
+	ARG_UNUSED(stats);
+
+	__ASSERT(false, "CONFIG_NRF_RPC_THREAD_POOL_STATS is disabled");
+#endif
 }
 
 void nrf_rpc_os_msg_set(struct nrf_rpc_os_msg *msg, const uint8_t *data,
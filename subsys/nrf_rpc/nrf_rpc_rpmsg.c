@@ -16,6 +16,7 @@
 
 #include "rp_ll.h"
 #include "nrf_rpc.h"
+#include "nrf_rpc_hdr.h"
 #include "nrf_rpc_rpmsg.h"
 
 /* Utility macro for dumping content of the packets with limit of 32 bytes
@@ -72,6 +73,22 @@ static void ll_event_handler(struct rp_ll_endpoint *endpoint,
 		k_sem_give(&handshake_sem);
 		return;
 
+	} else if (event == RP_LL_EVENT_SEND_ERROR) {
+
+		/* The lost packets are not known, so no command waiting for
+		 * a response can be completed. Report the error, so that
+		 * the application can recover instead of waiting forever.
+		 */
+		nrf_rpc_err(-NRF_EIO, NRF_RPC_ERR_SRC_SEND, NULL,
+			    NRF_RPC_ID_UNKNOWN, NRF_RPC_PACKET_TYPE_CMD);
+		return;
+
+	} else if (event == RP_LL_EVENT_RECV_ERROR) {
+
+		nrf_rpc_err(-EBADMSG, NRF_RPC_ERR_SRC_RECV, NULL,
+			    NRF_RPC_ID_UNKNOWN, NRF_RPC_PACKET_TYPE_CMD);
+		return;
+
 	} else if (event != RP_LL_EVENT_DATA) {
 
 		return;
@@ -115,6 +132,23 @@ error_exit:
 	return translate_error(err);
 }
 
+/* Commands and responses block a thread until the peer answers, so they are
+ * not kept waiting in a batch.
+ */
+static bool is_blocking(const uint8_t *buf, size_t len)
+{
+	uint8_t type;
+
+	if (len <= NRF_RPC_HDR_TYPE_OFFSET) {
+		return false;
+	}
+
+	type = buf[NRF_RPC_HDR_TYPE_OFFSET];
+
+	return (type == NRF_RPC_PACKET_TYPE_CMD) ||
+	       (type == NRF_RPC_PACKET_TYPE_RSP);
+}
+
 int nrf_rpc_tr_send(uint8_t *buf, size_t len)
 {
 	int err;
@@ -125,5 +159,9 @@ int nrf_rpc_tr_send(uint8_t *buf, size_t len)
 
 	err = rp_ll_send(&ll_endpoint, buf, len);
 
+	if ((err == 0) && is_blocking(buf, len)) {
+		err = rp_ll_flush(&ll_endpoint);
+	}
+
 	return translate_error(err);
 }
@@ -6,6 +6,7 @@
  */
 #include <zephyr.h>
 #include <errno.h>
+#include <string.h>
 #include <drivers/ipm.h>
 
 #include <openamp/open_amp.h>
@@ -131,6 +132,13 @@ static void ipm_callback(const struct device *ipmdev, void *user_data, uint32_t
 	k_work_submit_to_queue(&my_work_q, &work_item);
 }
 
+static void batch_packet_cb(const uint8_t *data, size_t len, void *user_data)
+{
+	struct rp_ll_endpoint *my_ep = user_data;
+
+	my_ep->callback(my_ep, RP_LL_EVENT_DATA, data, len);
+}
+
 /* Callback launch right after virtqueue_notification from rx_thread. */
 static int endpoint_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
 		       uint32_t src, void *priv)
@@ -148,6 +156,15 @@ static int endpoint_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
 		return RPMSG_SUCCESS;
 	}
 
+	if (IS_ENABLED(CONFIG_NRF_RPC_TR_RPMSG_BATCH)) {
+		if (rp_ll_batch_parse(data, len, batch_packet_cb, my_ep) < 0) {
+			LOG_ERR("Malformed batch received");
+			my_ep->callback(my_ep, RP_LL_EVENT_RECV_ERROR, NULL, 0);
+		}
+
+		return RPMSG_SUCCESS;
+	}
+
 	my_ep->callback(my_ep, RP_LL_EVENT_DATA, data, len);
 
 	return RPMSG_SUCCESS;
@@ -164,11 +181,135 @@ void work_callback(struct k_work *item)
 	virtqueue_notification(IS_ENABLED(CONFIG_RPMSG_MASTER) ? vq[0] : vq[1]);
 }
 
+#if defined(CONFIG_NRF_RPC_TR_RPMSG_BATCH)
+
+/* Batches are sent on timeout from a separate queue, so that packets waiting
+ * in a batch do not depend on the progress of the receive handlers.
+ */
+static struct k_work_q batch_work_q;
+static K_THREAD_STACK_DEFINE(batch_thread_stack,
+	CONFIG_NRF_RPC_TR_RPMSG_BATCH_STACK_SIZE);
+
+static uint8_t *batch_buf_get(struct rp_ll_batch_tx *tx, size_t *size)
+{
+	struct rp_ll_endpoint *endpoint = CONTAINER_OF(tx,
+		struct rp_ll_endpoint, batch_tx);
+	uint32_t buf_size;
+	uint8_t *buf;
+
+	buf = rpmsg_get_tx_payload_buffer(&endpoint->rpmsg_ep, &buf_size, true);
+	*size = buf_size;
+
+	return buf;
+}
+
+static int batch_buf_send(struct rp_ll_batch_tx *tx, uint8_t *buf, size_t len)
+{
+	struct rp_ll_endpoint *endpoint = CONTAINER_OF(tx,
+		struct rp_ll_endpoint, batch_tx);
+	int ret;
+
+	ret = rpmsg_send_nocopy(&endpoint->rpmsg_ep, buf, len);
+
+	return (ret < 0) ? ret : 0;
+}
+
+static void batch_error(struct rp_ll_batch_tx *tx, int err, uint16_t count)
+{
+	struct rp_ll_endpoint *endpoint = CONTAINER_OF(tx,
+		struct rp_ll_endpoint, batch_tx);
+
+	LOG_ERR("Failed to send batch: %d, %u packets lost", err, count);
+
+	endpoint->callback(endpoint, RP_LL_EVENT_SEND_ERROR, NULL, 0);
+}
+
+static const struct rp_ll_batch_tx_ops batch_tx_ops = {
+	.buf_get = batch_buf_get,
+	.send = batch_buf_send,
+	.error = batch_error,
+};
+
+static void batch_tx_init(struct rp_ll_endpoint *endpoint)
+{
+	rp_ll_batch_tx_init(&endpoint->batch_tx, &batch_tx_ops, &batch_work_q,
+		K_USEC(CONFIG_NRF_RPC_TR_RPMSG_BATCH_TIMEOUT_US));
+}
+
+static void batch_work_q_start(void)
+{
+	k_work_queue_start(&batch_work_q, batch_thread_stack,
+		K_THREAD_STACK_SIZEOF(batch_thread_stack),
+		CONFIG_NRF_RPC_TR_RPMSG_BATCH_PRIORITY, NULL);
+}
+
+static int batch_send(struct rp_ll_endpoint *endpoint, const uint8_t *buf,
+		      size_t buf_len)
+{
+	int ret;
+
+	if (rp_ll_batch_packet_size(buf_len) >
+	    rpmsg_virtio_get_buffer_size(rdev)) {
+		return RPMSG_ERR_BUFF_SIZE;
+	}
+
+	ret = rp_ll_batch_tx_send(&endpoint->batch_tx, buf, buf_len);
+	if (ret == -ENOMEM) {
+		return RPMSG_ERR_NO_BUFF;
+	}
+
+	return ret;
+}
+
+static int batch_flush(struct rp_ll_endpoint *endpoint)
+{
+	return rp_ll_batch_tx_flush(&endpoint->batch_tx);
+}
+
+void rp_ll_batch_stats_get(struct rp_ll_endpoint *endpoint,
+			   struct rp_ll_batch_stats *stats)
+{
+	rp_ll_batch_tx_stats_get(&endpoint->batch_tx, stats);
+}
+
+#else
+
+static void batch_tx_init(struct rp_ll_endpoint *endpoint)
+{
+}
+
+static void batch_work_q_start(void)
+{
+}
+
+static int batch_send(struct rp_ll_endpoint *endpoint, const uint8_t *buf,
+		      size_t buf_len)
+{
+	return RPMSG_ERR_PARAM;
+}
+
+static int batch_flush(struct rp_ll_endpoint *endpoint)
+{
+	return 0;
+}
+
+void rp_ll_batch_stats_get(struct rp_ll_endpoint *endpoint,
+			   struct rp_ll_batch_stats *stats)
+{
+	__ASSERT(false, "CONFIG_NRF_RPC_TR_RPMSG_BATCH is disabled");
+}
+
+#endif /* defined(CONFIG_NRF_RPC_TR_RPMSG_BATCH) */
+
 int rp_ll_send(struct rp_ll_endpoint *endpoint, const uint8_t *buf,
 	size_t buf_len)
 {
 	int ret;
 
+	if (IS_ENABLED(CONFIG_NRF_RPC_TR_RPMSG_BATCH)) {
+		return batch_send(endpoint, buf, buf_len);
+	}
+
 	ret = rpmsg_send(&endpoint->rpmsg_ep, buf, buf_len);
 	if (ret > 0) {
 		ret = 0;
@@ -176,6 +317,18 @@ int rp_ll_send(struct rp_ll_endpoint *endpoint, const uint8_t *buf,
 	return ret;
 }
 
+int rp_ll_flush(struct rp_ll_endpoint *endpoint)
+{
+	int ret;
+
+	ret = batch_flush(endpoint);
+	if (ret == -ENOMEM) {
+		return RPMSG_ERR_NO_BUFF;
+	}
+
+	return ret;
+}
+
 int rp_ll_init(void)
 {
 	int err;
@@ -282,6 +435,8 @@ int rp_ll_init(void)
 		CONFIG_NRF_RPC_TR_PRMSG_RX_PRIORITY, NULL);
 	k_work_init(&work_item, work_callback);
 
+	batch_work_q_start();
+
 	LOG_DBG("initializing %s: SUCCESS", __func__);
 
 	return 0;
@@ -295,6 +450,8 @@ int rp_ll_endpoint_init(struct rp_ll_endpoint *endpoint,
 
 	endpoint->callback = callback;
 
+	batch_tx_init(endpoint);
+
 	err = rpmsg_create_ept(&endpoint->rpmsg_ep, rdev, "", endpoint_number,
 		endpoint_number, endpoint_cb, rpmsg_service_unbind);
 
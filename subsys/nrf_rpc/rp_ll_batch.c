@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/byteorder.h>
+
+#include "rp_ll_batch.h"
+
+void rp_ll_batch_init(struct rp_ll_batch *batch, uint8_t *buf, size_t size)
+{
+	batch->buf = buf;
+	batch->size = size;
+	batch->len = 0;
+	batch->count = 0;
+}
+
+int rp_ll_batch_add(struct rp_ll_batch *batch, const uint8_t *data,
+		    size_t len)
+{
+	if ((len == 0) || (len > UINT16_MAX)) {
+		return -EINVAL;
+	}
+
+	if (batch->size - batch->len < rp_ll_batch_packet_size(len)) {
+		return -ENOMEM;
+	}
+
+	sys_put_le16(len, &batch->buf[batch->len]);
+	memcpy(&batch->buf[batch->len + RP_LL_BATCH_HDR_SIZE], data, len);
+
+	batch->len += rp_ll_batch_packet_size(len);
+	batch->count++;
+
+	return 0;
+}
+
+int rp_ll_batch_parse(const uint8_t *buf, size_t len,
+		      rp_ll_batch_packet_cb callback, void *user_data)
+{
+	size_t offset = 0;
+	size_t packet_len;
+	int count = 0;
+
+	while (offset < len) {
+		if (len - offset < RP_LL_BATCH_HDR_SIZE) {
+			return -EBADMSG;
+		}
+
+		packet_len = sys_get_le16(&buf[offset]);
+		offset += RP_LL_BATCH_HDR_SIZE;
+
+		if ((packet_len == 0) || (packet_len > len - offset)) {
+			return -EBADMSG;
+		}
+
+		callback(&buf[offset], packet_len, user_data);
+
+		offset += packet_len;
+		count++;
+	}
+
+	return count;
+}
+
+/* Sends the pending batch. Must be called with the lock held. The number of
+ * packets lost if the batch could not be sent is stored in lost.
+ */
+static int tx_flush(struct rp_ll_batch_tx *tx, uint16_t *lost)
+{
+	struct rp_ll_batch *batch = &tx->batch;
+	int ret;
+
+	if (batch->count == 0) {
+		return 0;
+	}
+
+	k_work_cancel_delayable(&tx->work);
+
+	ret = tx->ops->send(tx, batch->buf, batch->len);
+	if (ret < 0) {
+		/* The buffer still belongs to the batch, the next batch is
+		 * built in it.
+		 */
+		*lost = batch->count;
+		tx->stats.packets_lost += batch->count;
+		rp_ll_batch_init(batch, batch->buf, batch->size);
+
+		return ret;
+	}
+
+	tx->stats.packets += batch->count;
+	tx->stats.batches++;
+	tx->stats.notifications_saved += batch->count - 1;
+
+	rp_ll_batch_init(batch, NULL, 0);
+
+	return 0;
+}
+
+/* Adds a packet to the pending batch. Must be called with the lock held. */
+static int tx_add(struct rp_ll_batch_tx *tx, const uint8_t *data, size_t len)
+{
+	struct rp_ll_batch *batch = &tx->batch;
+	uint8_t *buf;
+	size_t size;
+	int ret;
+
+	if (!batch->buf) {
+		buf = tx->ops->buf_get(tx, &size);
+		if (!buf) {
+			return -ENOMEM;
+		}
+
+		rp_ll_batch_init(batch, buf, size);
+	}
+
+	ret = rp_ll_batch_add(batch, data, len);
+	if ((ret == 0) && (batch->count == 1)) {
+		k_work_reschedule_for_queue(tx->work_q, &tx->work, tx->timeout);
+	} else if ((ret == -ENOMEM) && (batch->count == 0)) {
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static void tx_work_handler(struct k_work *item)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(item);
+	struct rp_ll_batch_tx *tx = CONTAINER_OF(dwork, struct rp_ll_batch_tx,
+						 work);
+
+	(void)rp_ll_batch_tx_flush(tx);
+}
+
+void rp_ll_batch_tx_init(struct rp_ll_batch_tx *tx,
+			 const struct rp_ll_batch_tx_ops *ops,
+			 struct k_work_q *work_q, k_timeout_t timeout)
+{
+	tx->ops = ops;
+	tx->work_q = work_q;
+	tx->timeout = timeout;
+
+	k_mutex_init(&tx->lock);
+	k_work_init_delayable(&tx->work, tx_work_handler);
+	rp_ll_batch_init(&tx->batch, NULL, 0);
+	memset(&tx->stats, 0, sizeof(tx->stats));
+}
+
+int rp_ll_batch_tx_send(struct rp_ll_batch_tx *tx, const uint8_t *data,
+			size_t len)
+{
+	uint16_t lost = 0;
+	int ret;
+
+	k_mutex_lock(&tx->lock, K_FOREVER);
+
+	ret = tx_add(tx, data, len);
+	if ((ret == -ENOMEM) && (tx->batch.count > 0)) {
+		/* The packet does not fit into the pending batch. */
+		ret = tx_flush(tx, &lost);
+		if (ret == 0) {
+			ret = tx_add(tx, data, len);
+		}
+	}
+
+	k_mutex_unlock(&tx->lock);
+
+	if (lost > 0) {
+		tx->ops->error(tx, ret, lost);
+	}
+
+	return ret;
+}
+
+int rp_ll_batch_tx_flush(struct rp_ll_batch_tx *tx)
+{
+	uint16_t lost = 0;
+	int ret;
+
+	k_mutex_lock(&tx->lock, K_FOREVER);
+	ret = tx_flush(tx, &lost);
+	k_mutex_unlock(&tx->lock);
+
+	if (lost > 0) {
+		tx->ops->error(tx, ret, lost);
+	}
+
+	return ret;
+}
+
+void rp_ll_batch_tx_stats_get(struct rp_ll_batch_tx *tx,
+			      struct rp_ll_batch_stats *stats)
+{
+	k_mutex_lock(&tx->lock, K_FOREVER);
+	*stats = tx->stats;
+	k_mutex_unlock(&tx->lock);
+}
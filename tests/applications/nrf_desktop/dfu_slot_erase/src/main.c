@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <ztest.h>
+
+#include "dfu_slot_erase.h"
+
+#define PAGE_SIZE	DFU_SLOT_ERASE_PAGE_SIZE
+#define PAGE_CNT	8
+#define SLOT_SIZE	(PAGE_CNT * PAGE_SIZE)
+#define TRAILER_SIZE	PAGE_SIZE
+
+#define STALE_VAL	0xAA
+#define IMAGE_VAL	0x5C
+#define TRAILER_VAL	0x77
+
+/* Secondary image slot simulated in RAM. */
+static uint8_t slot_mem[SLOT_SIZE];
+static size_t erase_cnt[PAGE_CNT];
+static const struct flash_area slot = {
+	.fa_size = SLOT_SIZE,
+};
+static struct dfu_slot_erase slot_erase;
+
+int flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+		    size_t len)
+{
+	zassert_true(off + len <= fa->fa_size, "Read outside the slot");
+	memcpy(dst, &slot_mem[off], len);
+
+	return 0;
+}
+
+int flash_area_write(const struct flash_area *fa, off_t off, const void *src,
+		     size_t len)
+{
+	const uint8_t *data = src;
+
+	zassert_true(off + len <= fa->fa_size, "Write outside the slot");
+
+	/* Writing can only clear bits. */
+	for (size_t i = 0; i < len; i++) {
+		slot_mem[off + i] &= data[i];
+	}
+
+	return 0;
+}
+
+int flash_area_erase(const struct flash_area *fa, off_t off, size_t len)
+{
+	zassert_equal(off % PAGE_SIZE, 0, "Unaligned erase");
+	zassert_equal(len, PAGE_SIZE, "Erase of more than a page");
+	zassert_true(off + len <= fa->fa_size, "Erase outside the slot");
+
+	memset(&slot_mem[off], 0xFF, len);
+	erase_cnt[off / PAGE_SIZE]++;
+
+	return 0;
+}
+
+static void slot_fill(uint8_t val)
+{
+	memset(slot_mem, val, sizeof(slot_mem));
+	memset(erase_cnt, 0, sizeof(erase_cnt));
+}
+
+static bool slot_check(size_t off, size_t len, uint8_t val)
+{
+	for (size_t i = off; i < off + len; i++) {
+		if (slot_mem[i] != val) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Writes the image the way the DFU module does, erasing the pages that the
+ * background erase did not reach yet.
+ */
+static void image_store(size_t len)
+{
+	static uint8_t image[PAGE_SIZE];
+
+	memset(image, IMAGE_VAL, sizeof(image));
+
+	for (size_t off = 0; off < len; off += PAGE_SIZE) {
+		size_t chunk = MIN(len - off, PAGE_SIZE);
+
+		while (!dfu_slot_erase_is_erased(&slot_erase, off)) {
+			zassert_ok(dfu_slot_erase_page(&slot_erase, &slot),
+				   "Erase failed");
+		}
+
+		zassert_ok(flash_area_write(&slot, off, image, chunk),
+			   "Write failed");
+	}
+}
+
+static void trailer_write(void)
+{
+	static uint8_t trailer[TRAILER_SIZE];
+
+	memset(trailer, TRAILER_VAL, sizeof(trailer));
+	zassert_ok(flash_area_write(&slot, SLOT_SIZE - TRAILER_SIZE, trailer,
+				    sizeof(trailer)),
+		   "Write failed");
+}
+
+/* Runs the background erase the way the DFU module does after the upgrade
+ * is requested.
+ */
+static void background_erase_run(void)
+{
+	while (!dfu_slot_erase_is_done(&slot_erase)) {
+		zassert_ok(dfu_slot_erase_page(&slot_erase, &slot),
+			   "Erase failed");
+	}
+}
+
+static void test_clean_pages_skipped(void)
+{
+	slot_fill(0xFF);
+	slot_mem[2 * PAGE_SIZE + 100] = STALE_VAL;
+
+	dfu_slot_erase_init(&slot_erase, TRAILER_SIZE);
+	background_erase_run();
+
+	for (size_t i = 0; i < PAGE_CNT; i++) {
+		zassert_equal(erase_cnt[i], (i == 2) ? 1 : 0,
+			      "Wrong erase count of page %zu", i);
+	}
+	zassert_true(slot_check(0, SLOT_SIZE, 0xFF), "Slot not clean");
+}
+
+static void test_trailer_kept_after_transfer(void)
+{
+	size_t img_len = 2 * PAGE_SIZE + PAGE_SIZE / 2;
+
+	slot_fill(STALE_VAL);
+	dfu_slot_erase_init(&slot_erase, TRAILER_SIZE);
+
+	/* Transfer completes after only the first page is erased ahead. */
+	zassert_ok(dfu_slot_erase_page(&slot_erase, &slot), "Erase failed");
+	image_store(img_len);
+
+	zassert_ok(dfu_slot_erase_complete(&slot_erase, &slot),
+		   "Cannot complete erase");
+	zassert_true(dfu_slot_erase_is_done(&slot_erase), "Erase not done");
+	zassert_true(slot_check(SLOT_SIZE - TRAILER_SIZE, TRAILER_SIZE, 0xFF),
+		     "Trailer not erased");
+
+	/* Upgrade request. */
+	trailer_write();
+
+	background_erase_run();
+
+	zassert_true(slot_check(0, img_len, IMAGE_VAL), "Image damaged");
+	zassert_true(slot_check(SLOT_SIZE - TRAILER_SIZE, TRAILER_SIZE,
+				TRAILER_VAL),
+		     "Trailer damaged");
+
+	/* Pages between the image and the trailer are not erased. */
+	for (size_t i = 3; i < PAGE_CNT - 1; i++) {
+		zassert_equal(erase_cnt[i], 0, "Page %zu erased", i);
+	}
+	zassert_equal(erase_cnt[PAGE_CNT - 1], 1, "Trailer erased again");
+}
+
+static void test_image_in_trailer_page(void)
+{
+	size_t img_len = SLOT_SIZE - 100;
+
+	slot_fill(STALE_VAL);
+	dfu_slot_erase_init(&slot_erase, TRAILER_SIZE);
+
+	image_store(img_len);
+
+	zassert_ok(dfu_slot_erase_complete(&slot_erase, &slot),
+		   "Cannot complete erase");
+	zassert_true(dfu_slot_erase_is_done(&slot_erase), "Erase not done");
+	zassert_true(slot_check(0, img_len, IMAGE_VAL), "Image damaged");
+
+	for (size_t i = 0; i < PAGE_CNT; i++) {
+		zassert_equal(erase_cnt[i], 1, "Wrong erase count of page %zu",
+			      i);
+	}
+}
+
+static void test_no_trailer(void)
+{
+	slot_fill(STALE_VAL);
+	dfu_slot_erase_init(&slot_erase, 0);
+
+	image_store(PAGE_SIZE);
+
+	zassert_ok(dfu_slot_erase_complete(&slot_erase, &slot),
+		   "Cannot complete erase");
+	zassert_true(dfu_slot_erase_is_done(&slot_erase), "Erase not done");
+
+	for (size_t i = 1; i < PAGE_CNT; i++) {
+		zassert_equal(erase_cnt[i], 0, "Page %zu erased", i);
+	}
+
+	/* The next transfer erases the slot from the start. */
+	dfu_slot_erase_restart(&slot_erase);
+	zassert_false(dfu_slot_erase_is_done(&slot_erase), "Erase done");
+	zassert_false(dfu_slot_erase_is_erased(&slot_erase, 0),
+		      "Page erased");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(dfu_slot_erase,
+			 ztest_unit_test(test_clean_pages_skipped),
+			 ztest_unit_test(test_trailer_kept_after_transfer),
+			 ztest_unit_test(test_image_in_trailer_page),
+			 ztest_unit_test(test_no_trailer)
+			 );
+
+	ztest_run_test_suite(dfu_slot_erase);
+}
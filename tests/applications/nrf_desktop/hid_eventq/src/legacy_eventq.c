@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* List based HID event queue previously used by the hid_state module. Kept
+ * as a reference for the ring buffer based queue.
+ */
+
+#include <zephyr.h>
+
+#include "legacy_eventq.h"
+
+void legacy_eventq_reset(struct legacy_eventq *eventq)
+{
+	struct legacy_event *event;
+	struct legacy_event *tmp;
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&eventq->root, event, tmp, node) {
+		sys_slist_remove(&eventq->root, NULL, &event->node);
+
+		k_free(event);
+	}
+
+	sys_slist_init(&eventq->root);
+	eventq->len = 0;
+}
+
+bool legacy_eventq_is_full(const struct legacy_eventq *eventq)
+{
+	return (eventq->len >= CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE);
+}
+
+
+bool legacy_eventq_is_empty(struct legacy_eventq *eventq)
+{
+	bool empty = sys_slist_is_empty(&eventq->root);
+
+	__ASSERT_NO_MSG(!empty == (eventq->len != 0));
+
+	return empty;
+}
+
+struct legacy_event *legacy_eventq_get(struct legacy_eventq *eventq)
+{
+	sys_snode_t *node = sys_slist_get(&eventq->root);
+
+	if (!node) {
+		return NULL;
+	}
+
+	eventq->len--;
+
+	return CONTAINER_OF(node, struct legacy_event, node);
+}
+
+void legacy_eventq_append(struct legacy_eventq *eventq, uint16_t usage_id,
+			  int16_t value, uint32_t timestamp)
+{
+	struct legacy_event *hid_event = k_malloc(sizeof(*hid_event));
+
+	if (!hid_event) {
+		__ASSERT_NO_MSG(false);
+		return;
+	}
+
+	hid_event->item.usage_id = usage_id;
+	hid_event->item.value = value;
+	hid_event->timestamp = timestamp;
+
+	/* Add a new event to the queue. */
+	sys_slist_append(&eventq->root, &hid_event->node);
+
+	eventq->len++;
+}
+
+static size_t legacy_eventq_region_purge(struct legacy_eventq *eventq,
+					 sys_snode_t *last_to_purge)
+{
+	sys_snode_t *tmp;
+	sys_snode_t *tmp_safe;
+	size_t cnt = 0;
+
+	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, tmp, tmp_safe) {
+		sys_slist_remove(&eventq->root, NULL, tmp);
+
+		k_free(CONTAINER_OF(tmp, struct legacy_event, node));
+		cnt++;
+
+		if (tmp == last_to_purge) {
+			break;
+		}
+	}
+
+	eventq->len -= cnt;
+
+	return cnt;
+}
+
+
+void legacy_eventq_cleanup(struct legacy_eventq *eventq, uint32_t timestamp)
+{
+	/* Find timed out events. */
+
+	sys_snode_t *first_valid;
+
+	SYS_SLIST_FOR_EACH_NODE(&eventq->root, first_valid) {
+		uint32_t diff = timestamp - CONTAINER_OF(
+			first_valid, struct legacy_event, node)->timestamp;
+
+		if (diff < CONFIG_DESKTOP_HID_REPORT_EXPIRATION) {
+			break;
+		}
+	}
+
+	/* Remove events but only if key up was generated for each removed
+	 * key down.
+	 */
+
+	sys_snode_t *maxfound = sys_slist_peek_head(&eventq->root);
+	size_t maxfound_pos = 0;
+
+	sys_snode_t *cur;
+	size_t cur_pos = 0;
+
+	sys_snode_t *tmp_safe;
+
+	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, cur, tmp_safe) {
+		const struct item cur_item =
+			CONTAINER_OF(cur, struct legacy_event, node)->item;
+
+		if (cur_item.value > 0) {
+			/* Every key down must be paired with key up.
+			 * Set hit count to value as we just detected
+			 * first key down for this usage.
+			 */
+
+			unsigned int hit_count = cur_item.value;
+			sys_snode_t *j = cur;
+			size_t j_pos = cur_pos;
+
+			SYS_SLIST_ITERATE_FROM_NODE(&eventq->root, j) {
+				j_pos++;
+				if (j == first_valid) {
+					break;
+				}
+
+				const struct item item =
+					CONTAINER_OF(j,
+						     struct legacy_event,
+						     node)->item;
+
+				if (cur_item.usage_id == item.usage_id) {
+					hit_count += item.value;
+
+					if (hit_count == 0) {
+						/* All events with this usage
+						 * are paired.
+						 */
+						break;
+					}
+				}
+			}
+
+			if (j == first_valid) {
+				/* Pair not found. */
+				break;
+			}
+
+			if (j_pos > maxfound_pos) {
+				maxfound = j;
+				maxfound_pos = j_pos;
+			}
+		}
+
+
+		if (cur == first_valid) {
+			break;
+		}
+
+		if (cur == maxfound) {
+			/* All events up to this point have pairs and can
+			 * be deleted.
+			 */
+			legacy_eventq_region_purge(eventq, maxfound);
+		}
+
+		cur_pos++;
+	}
+}
+
+void legacy_eventq_purge_oldest(struct legacy_eventq *eventq)
+{
+	sys_snode_t *i;
+
+	SYS_SLIST_FOR_EACH_NODE(&eventq->root, i) {
+		uint32_t timestamp =
+			CONTAINER_OF(i, struct legacy_event, node)->timestamp +
+			CONFIG_DESKTOP_HID_REPORT_EXPIRATION;
+
+		legacy_eventq_cleanup(eventq, timestamp);
+
+		if (!legacy_eventq_is_full(eventq)) {
+			break;
+		}
+	}
+}
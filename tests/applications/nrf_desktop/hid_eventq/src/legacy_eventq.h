@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _LEGACY_EVENTQ_H_
+#define _LEGACY_EVENTQ_H_
+
+#include <sys/slist.h>
+
+struct item {
+	uint16_t usage_id;
+	int16_t value;
+};
+
+struct legacy_event {
+	sys_snode_t node;
+	struct item item;
+	uint32_t timestamp;
+};
+
+struct legacy_eventq {
+	sys_slist_t root;
+	size_t len;
+};
+
+void legacy_eventq_reset(struct legacy_eventq *eventq);
+bool legacy_eventq_is_full(const struct legacy_eventq *eventq);
+bool legacy_eventq_is_empty(struct legacy_eventq *eventq);
+struct legacy_event *legacy_eventq_get(struct legacy_eventq *eventq);
+void legacy_eventq_append(struct legacy_eventq *eventq, uint16_t usage_id,
+			  int16_t value, uint32_t timestamp);
+void legacy_eventq_cleanup(struct legacy_eventq *eventq, uint32_t timestamp);
+void legacy_eventq_purge_oldest(struct legacy_eventq *eventq);
+
+#endif /* _LEGACY_EVENTQ_H_ */
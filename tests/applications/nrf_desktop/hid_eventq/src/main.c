@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+#include <random/rand32.h>
+
+#include "hid_eventq.h"
+#include "legacy_eventq.h"
+
+#define KEY_COUNT 6
+#define REPLAY_EVENT_COUNT 5000
+#define REPLAY_BURST_LEN 4
+
+struct replay_event {
+	uint16_t usage_id;
+	int16_t value;
+	uint32_t timestamp;
+};
+
+static struct replay_event replay[REPLAY_EVENT_COUNT];
+static struct hid_eventq eventq;
+static struct legacy_eventq legacy;
+
+/* Key presses and releases with random time gaps. Bursts of events share
+ * a timestamp, as they do when many keys change within one scan.
+ */
+static void replay_generate(void)
+{
+	bool pressed[KEY_COUNT] = {0};
+	uint32_t timestamp = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(replay); i++) {
+		uint32_t rnd = sys_rand32_get();
+		uint16_t key = rnd % KEY_COUNT;
+
+		if ((i % REPLAY_BURST_LEN) == 0) {
+			timestamp += (rnd >> 8) % (CONFIG_DESKTOP_HID_REPORT_EXPIRATION / 2);
+		}
+
+		pressed[key] = !pressed[key];
+
+		replay[i].usage_id = 0x04 + key;
+		replay[i].value = pressed[key] ? 1 : -1;
+		replay[i].timestamp = timestamp;
+	}
+}
+
+/* Apply the queued events to released keys, as the hid_state module does
+ * when connection is established, and compare with the keys that are
+ * pressed. Keys pressed when the queue was reset are not known.
+ */
+static void check_key_state(const bool pressed[], const bool unknown[])
+{
+	int cnt[KEY_COUNT] = {0};
+
+	for (size_t i = 0; i < eventq.len; i++) {
+		const struct hid_eventq_event *e =
+			&eventq.event[(eventq.head + i) % HID_EVENTQ_SIZE];
+		size_t key = e->usage_id - 0x04;
+
+		cnt[key] = MAX(cnt[key] + e->value, 0);
+	}
+
+	for (size_t key = 0; key < KEY_COUNT; key++) {
+		if (!unknown[key]) {
+			zassert_equal(cnt[key] > 0, pressed[key],
+				      "Wrong state of key %zu", key);
+		}
+	}
+}
+
+/* Same sequence as the hid_state module uses while disconnected. */
+static bool enqueue(const struct replay_event *re)
+{
+	bool reset = false;
+
+	hid_eventq_cleanup(&eventq, re->timestamp);
+
+	if (hid_eventq_is_full(&eventq)) {
+		hid_eventq_purge_oldest(&eventq);
+
+		if (hid_eventq_is_full(&eventq)) {
+			hid_eventq_reset(&eventq);
+			reset = true;
+		}
+	}
+
+	hid_eventq_append(&eventq, re->usage_id, re->value, re->timestamp);
+
+	return reset;
+}
+
+static void legacy_enqueue(const struct replay_event *re)
+{
+	legacy_eventq_cleanup(&legacy, re->timestamp);
+
+	if (legacy_eventq_is_full(&legacy)) {
+		legacy_eventq_purge_oldest(&legacy);
+
+		if (legacy_eventq_is_full(&legacy)) {
+			legacy_eventq_reset(&legacy);
+		}
+	}
+
+	legacy_eventq_append(&legacy, re->usage_id, re->value, re->timestamp);
+}
+
+static void test_replay_disconnected(void)
+{
+	bool pressed[KEY_COUNT] = {0};
+	bool unknown[KEY_COUNT] = {0};
+
+	hid_eventq_reset(&eventq);
+
+	for (size_t i = 0; i < ARRAY_SIZE(replay); i++) {
+		size_t key = replay[i].usage_id - 0x04;
+
+		if (enqueue(&replay[i])) {
+			memcpy(unknown, pressed, sizeof(unknown));
+		}
+
+		pressed[key] = (replay[i].value > 0);
+		if (!pressed[key]) {
+			unknown[key] = false;
+		}
+
+		check_key_state(pressed, unknown);
+	}
+}
+
+static void test_pairing(void)
+{
+	struct hid_eventq_event event;
+
+	hid_eventq_reset(&eventq);
+
+	/* Key A is not released, so nothing can be removed. */
+	hid_eventq_append(&eventq, 0x04, 1, 0);
+	hid_eventq_append(&eventq, 0x05, 1, 0);
+	hid_eventq_append(&eventq, 0x05, -1, 0);
+	zassert_equal(hid_eventq_cleanup(&eventq, UINT32_MAX / 2), 0,
+		      "Unpaired key down removed");
+
+	/* Release of key A pairs all key downs. */
+	hid_eventq_append(&eventq, 0x04, -1, 100);
+	zassert_equal(hid_eventq_cleanup(&eventq,
+			100 + CONFIG_DESKTOP_HID_REPORT_EXPIRATION - 1), 0,
+		      "Not expired events removed");
+	zassert_equal(hid_eventq_cleanup(&eventq,
+			100 + CONFIG_DESKTOP_HID_REPORT_EXPIRATION), 4,
+		      "Expired events not removed");
+	zassert_true(hid_eventq_is_empty(&eventq), "Queue not empty");
+
+	/* Key up without key down can be removed alone. */
+	hid_eventq_append(&eventq, 0x04, -1, 0);
+	hid_eventq_append(&eventq, 0x05, 1, 0);
+	zassert_equal(hid_eventq_purge_oldest(&eventq), 1,
+		      "Unpaired key up not removed");
+
+	zassert_true(hid_eventq_get(&eventq, &event), "Queue empty");
+	zassert_equal(event.usage_id, 0x05, "Wrong event");
+	zassert_false(hid_eventq_get(&eventq, &event), "Queue not empty");
+}
+
+/* Replays bursts of events into a queue that is drained after each burst,
+ * as when reports are sent over a connection with long interval.
+ */
+static void test_replay_benchmark(void)
+{
+	uint32_t start;
+	uint32_t cycles = 0;
+	uint32_t legacy_cycles = 0;
+	struct hid_eventq_event event;
+
+	hid_eventq_reset(&eventq);
+	legacy_eventq_reset(&legacy);
+
+	for (size_t i = 0; i < ARRAY_SIZE(replay); i += REPLAY_BURST_LEN) {
+		start = k_cycle_get_32();
+		for (size_t j = i; j < i + REPLAY_BURST_LEN; j++) {
+			enqueue(&replay[j]);
+		}
+		while (hid_eventq_get(&eventq, &event)) {
+		}
+		cycles += k_cycle_get_32() - start;
+
+		start = k_cycle_get_32();
+		for (size_t j = i; j < i + REPLAY_BURST_LEN; j++) {
+			legacy_enqueue(&replay[j]);
+		}
+		while (!legacy_eventq_is_empty(&legacy)) {
+			k_free(legacy_eventq_get(&legacy));
+		}
+		legacy_cycles += k_cycle_get_32() - start;
+	}
+
+	printk("HID event replay (%u events): ring buffer %u us, list %u us\n",
+	       REPLAY_EVENT_COUNT, k_cyc_to_us_floor32(cycles),
+	       k_cyc_to_us_floor32(legacy_cycles));
+}
+
+void test_main(void)
+{
+	replay_generate();
+
+	ztest_test_suite(hid_eventq,
+			 ztest_unit_test(test_pairing),
+			 ztest_unit_test(test_replay_disconnected),
+			 ztest_unit_test(test_replay_benchmark)
+			 );
+
+	ztest_run_test_suite(hid_eventq);
+}
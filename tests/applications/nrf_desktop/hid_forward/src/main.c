@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+
+#include "drr.h"
+#include "hid_mouse_report.h"
+#include "hid_report_mouse.h"
+
+#define FLOW_COUNT	3
+#define QUANTUM		32
+
+/* Flow that does not share the link. */
+#define FLOW_UNLINKED	2
+
+struct flow {
+	uint16_t deficit;
+	size_t packet_size;
+	size_t packet_cnt;
+	size_t sent_bytes;
+};
+
+static struct flow flows[FLOW_COUNT];
+static size_t cur_flow;
+
+static uint16_t *flow_get(size_t flow_id, size_t *head_size, void *user_data)
+{
+	struct flow *flow = &flows[flow_id];
+
+	zassert_equal_ptr(user_data, flows, "Wrong user data");
+
+	if (flow_id == FLOW_UNLINKED) {
+		return NULL;
+	}
+
+	*head_size = (flow->packet_cnt > 0) ? flow->packet_size : 0;
+
+	return &flow->deficit;
+}
+
+static int flow_send(void)
+{
+	int flow_id = drr_next(FLOW_COUNT, &cur_flow, QUANTUM, flow_get, flows);
+
+	if (flow_id >= 0) {
+		struct flow *flow = &flows[flow_id];
+
+		zassert_true(flow->packet_cnt > 0, "Idle flow selected");
+		flow->packet_cnt--;
+		flow->sent_bytes += flow->packet_size;
+	}
+
+	return flow_id;
+}
+
+static void flows_init(void)
+{
+	memset(flows, 0, sizeof(flows));
+	cur_flow = 0;
+}
+
+static void test_drr_fairness(void)
+{
+	/* A burst of small reports and a stream of large ones. */
+	flows[0].packet_size = 4;
+	flows[0].packet_cnt = 1000;
+	flows[1].packet_size = 20;
+	flows[1].packet_cnt = 1000;
+	flows[FLOW_UNLINKED].packet_size = 4;
+	flows[FLOW_UNLINKED].packet_cnt = 1000;
+
+	while ((flows[0].sent_bytes < 2000) && (flows[1].sent_bytes < 2000)) {
+		int flow_id = flow_send();
+
+		zassert_true(flow_id >= 0, "No flow selected");
+		zassert_not_equal(flow_id, FLOW_UNLINKED, "Unlinked flow selected");
+
+		/* Neither flow gets ahead by more than a quantum. */
+		zassert_within(flows[0].sent_bytes, flows[1].sent_bytes,
+			       QUANTUM + flows[1].packet_size,
+			       "Link not shared fairly");
+	}
+
+	zassert_equal(flows[FLOW_UNLINKED].sent_bytes, 0, "Unlinked flow served");
+}
+
+static void test_drr_burst(void)
+{
+	int flow_id;
+
+	/* A burst of one flow delays a report of the other flow by at most
+	 * one quantum.
+	 */
+	flows[0].packet_size = 4;
+	flows[0].packet_cnt = 100;
+	flows[1].packet_size = 4;
+
+	for (size_t i = 0; i < 5; i++) {
+		zassert_equal(flow_send(), 0, "Wrong flow selected");
+	}
+
+	flows[1].packet_cnt = 1;
+
+	for (size_t i = 0; i <= QUANTUM / flows[0].packet_size; i++) {
+		flow_id = flow_send();
+
+		if (flow_id == 1) {
+			break;
+		}
+	}
+
+	zassert_equal(flow_id, 1, "Report delayed by the burst");
+	zassert_equal(flows[1].packet_cnt, 0, "Report not sent");
+
+	/* Only the bursting flow is left. */
+	zassert_equal(flow_send(), 0, "Wrong flow selected");
+}
+
+static void test_drr_large_report(void)
+{
+	/* A report larger than the quantum is still sent. */
+	flows[1].packet_size = 3 * QUANTUM;
+	flows[1].packet_cnt = 2;
+
+	zassert_equal(flow_send(), 1, "Large report not sent");
+	zassert_equal(flow_send(), 1, "Large report not sent");
+	zassert_true(flow_send() < 0, "Flow selected with nothing to send");
+}
+
+static void test_drr_idle(void)
+{
+	size_t run = 0;
+
+	flows[0].packet_size = 4;
+	flows[1].packet_size = 4;
+	flows[1].packet_cnt = 50;
+
+	while (flows[1].packet_cnt > 0) {
+		zassert_equal(flow_send(), 1, "Wrong flow selected");
+	}
+
+	/* Idle flow does not save the quantum for later. */
+	zassert_equal(flows[0].deficit, 0, "Idle flow saved the quantum");
+	zassert_true(flow_send() < 0, "Idle flow selected");
+
+	flows[0].packet_cnt = 50;
+	flows[1].packet_cnt = 50;
+
+	while (flow_send() == 0) {
+		run++;
+	}
+
+	zassert_true(run <= QUANTUM / flows[0].packet_size,
+		     "Flow sent more than a quantum after being idle");
+}
+
+static void mouse_report_set(uint8_t *data, uint8_t buttons, int8_t wheel,
+			     int16_t x, int16_t y)
+{
+	data[0] = buttons;
+	data[1] = wheel;
+	data[2] = x & 0xff;
+	data[3] = ((y & 0x0f) << 4) | ((x >> 8) & 0x0f);
+	data[4] = (y >> 4) & 0xff;
+}
+
+static void test_coalesce(void)
+{
+	uint8_t queued[REPORT_SIZE_MOUSE];
+	uint8_t report[REPORT_SIZE_MOUSE];
+	uint8_t expected[REPORT_SIZE_MOUSE];
+
+	mouse_report_set(queued, 0x01, 1, 100, -200);
+	mouse_report_set(report, 0x01, -3, -150, 50);
+	mouse_report_set(expected, 0x01, -2, -50, -150);
+
+	zassert_true(hid_mouse_report_coalesce(queued, report), "Reports not merged");
+	zassert_mem_equal(queued, expected, sizeof(expected), "Wrong merged report");
+
+	/* Sums equal to the limits still fit into the report. */
+	mouse_report_set(queued, 0x00, MOUSE_REPORT_WHEEL_MAX - 1,
+			 MOUSE_REPORT_XY_MAX - 1, MOUSE_REPORT_XY_MIN + 1);
+	mouse_report_set(report, 0x00, 1, 1, -1);
+	mouse_report_set(expected, 0x00, MOUSE_REPORT_WHEEL_MAX,
+			 MOUSE_REPORT_XY_MAX, MOUSE_REPORT_XY_MIN);
+
+	zassert_true(hid_mouse_report_coalesce(queued, report), "Reports not merged");
+	zassert_mem_equal(queued, expected, sizeof(expected), "Wrong merged report");
+}
+
+static void coalesce_reject_check(uint8_t *queued, const uint8_t *report)
+{
+	uint8_t expected[REPORT_SIZE_MOUSE];
+
+	memcpy(expected, queued, sizeof(expected));
+
+	zassert_false(hid_mouse_report_coalesce(queued, report), "Reports merged");
+	zassert_mem_equal(queued, expected, sizeof(expected), "Queued report changed");
+}
+
+static void test_coalesce_reject(void)
+{
+	uint8_t queued[REPORT_SIZE_MOUSE];
+	uint8_t report[REPORT_SIZE_MOUSE];
+
+	/* Button state changed. */
+	mouse_report_set(queued, 0x01, 0, 10, 10);
+	mouse_report_set(report, 0x03, 0, 10, 10);
+	coalesce_reject_check(queued, report);
+
+	/* Motion does not fit into the report. */
+	mouse_report_set(queued, 0x00, 0, MOUSE_REPORT_XY_MAX, 0);
+	mouse_report_set(report, 0x00, 0, 1, 0);
+	coalesce_reject_check(queued, report);
+
+	mouse_report_set(queued, 0x00, 0, 0, MOUSE_REPORT_XY_MIN);
+	mouse_report_set(report, 0x00, 0, 0, -1);
+	coalesce_reject_check(queued, report);
+
+	mouse_report_set(queued, 0x00, MOUSE_REPORT_WHEEL_MIN, 0, 0);
+	mouse_report_set(report, 0x00, -1, 0, 0);
+	coalesce_reject_check(queued, report);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(hid_forward,
+		ztest_unit_test_setup_teardown(test_drr_fairness, flows_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_drr_burst, flows_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_drr_large_report, flows_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_drr_idle, flows_init,
+					       unit_test_noop),
+		ztest_unit_test(test_coalesce),
+		ztest_unit_test(test_coalesce_reject)
+	);
+
+	ztest_run_test_suite(hid_forward);
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+
+#include "hid_items.h"
+
+/* Keyboard report holds up to six keys. */
+#define KEY_COUNT_MAX 6
+
+#define KEY_A		0x04
+#define KEY_LEFT_CTRL	0xE0
+#define USAGE_NO_BM	0x0300
+
+static struct hid_items items;
+
+static void items_init(void)
+{
+	memset(&items, 0, sizeof(items));
+	items.item_count_max = KEY_COUNT_MAX;
+	hid_items_clear(&items);
+}
+
+/* Check that the recorded usages are the given ones, in the given order. */
+static void items_check(const uint16_t *usage_id, size_t cnt)
+{
+	zassert_equal(items.item_count, cnt, "Wrong number of items");
+
+	for (size_t i = 0; i < cnt; i++) {
+		zassert_equal(items.item[i].usage_id, usage_id[i],
+			      "Wrong usage of item %zu", i);
+		zassert_not_null(hid_items_find(&items, usage_id[i]),
+				 "Item %zu not found", i);
+	}
+
+	/* Unused items are cleared. */
+	for (size_t i = cnt; i < ARRAY_SIZE(items.item); i++) {
+		zassert_equal(items.item[i].usage_id, 0, "Unused item %zu set", i);
+		zassert_equal(items.item[i].value, 0, "Unused item %zu set", i);
+	}
+}
+
+static void test_press_order(void)
+{
+	static const uint16_t pressed[] = {
+		KEY_A + 3, KEY_LEFT_CTRL, KEY_A, USAGE_NO_BM, KEY_A + 1
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(pressed); i++) {
+		zassert_true(hid_items_value_set(&items, pressed[i], 1),
+			     "Key press not reported");
+	}
+
+	/* Items are kept in the order of key presses, not sorted. */
+	items_check(pressed, ARRAY_SIZE(pressed));
+
+	zassert_is_null(hid_items_find(&items, KEY_A + 2), "Unknown key found");
+	zassert_is_null(hid_items_find(&items, USAGE_NO_BM + 1), "Unknown usage found");
+}
+
+static void test_release(void)
+{
+	static const uint16_t pressed[] = {KEY_A, KEY_A + 1, KEY_A + 2, KEY_A + 3};
+	static const uint16_t left_middle[] = {KEY_A, KEY_A + 2, KEY_A + 3};
+	static const uint16_t left_edges[] = {KEY_A + 2};
+
+	for (size_t i = 0; i < ARRAY_SIZE(pressed); i++) {
+		zassert_true(hid_items_value_set(&items, pressed[i], 1),
+			     "Key press not reported");
+	}
+
+	/* Releasing a key keeps the order of the remaining ones. */
+	zassert_true(hid_items_value_set(&items, KEY_A + 1, -1),
+		     "Key release not reported");
+	items_check(left_middle, ARRAY_SIZE(left_middle));
+
+	zassert_true(hid_items_value_set(&items, KEY_A + 3, -1),
+		     "Key release not reported");
+	zassert_true(hid_items_value_set(&items, KEY_A, -1),
+		     "Key release not reported");
+	items_check(left_edges, ARRAY_SIZE(left_edges));
+
+	/* Release of a key that is not pressed is ignored. */
+	zassert_false(hid_items_value_set(&items, KEY_A, -1),
+		      "Release of a released key reported");
+	zassert_false(hid_items_value_set(&items, KEY_LEFT_CTRL, -1),
+		      "Release of a released key reported");
+	items_check(left_edges, ARRAY_SIZE(left_edges));
+
+	zassert_true(hid_items_value_set(&items, KEY_A + 2, -1),
+		     "Key release not reported");
+	items_check(NULL, 0);
+
+	for (size_t i = 0; i < ARRAY_SIZE(items.usage_bm); i++) {
+		zassert_equal(items.usage_bm[i], 0, "Usage bitmask not cleared");
+	}
+}
+
+static void test_reference_count(void)
+{
+	static const uint16_t pressed[] = {KEY_LEFT_CTRL};
+
+	/* The same key mapped from two buttons is released with both. */
+	zassert_true(hid_items_value_set(&items, KEY_LEFT_CTRL, 1),
+		     "Key press not reported");
+	zassert_false(hid_items_value_set(&items, KEY_LEFT_CTRL, 1),
+		      "Second press of a pressed key reported");
+	items_check(pressed, ARRAY_SIZE(pressed));
+	zassert_equal(items.item[0].value, 2, "Wrong reference count");
+
+	zassert_false(hid_items_value_set(&items, KEY_LEFT_CTRL, -1),
+		      "Release of a key pressed twice reported");
+	items_check(pressed, ARRAY_SIZE(pressed));
+
+	zassert_true(hid_items_value_set(&items, KEY_LEFT_CTRL, -1),
+		     "Key release not reported");
+	items_check(NULL, 0);
+}
+
+static void test_rollover(void)
+{
+	uint16_t pressed[KEY_COUNT_MAX];
+
+	for (size_t i = 0; i < ARRAY_SIZE(pressed); i++) {
+		pressed[i] = KEY_A + i;
+		zassert_true(hid_items_value_set(&items, pressed[i], 1),
+			     "Key press not reported");
+	}
+
+	zassert_true(hid_items_is_full(&items), "Set not full");
+
+	/* Keys pressed beyond the limit are not recorded. */
+	zassert_false(hid_items_value_set(&items, KEY_A + KEY_COUNT_MAX, 1),
+		      "Key beyond the limit recorded");
+	zassert_is_null(hid_items_find(&items, KEY_A + KEY_COUNT_MAX),
+			"Key beyond the limit found");
+	items_check(pressed, ARRAY_SIZE(pressed));
+
+	/* A recorded key can still be pressed again. */
+	zassert_false(hid_items_value_set(&items, KEY_A, 1),
+		      "Second press of a pressed key reported");
+	zassert_equal(items.item[0].value, 2, "Wrong reference count");
+
+	/* Release of the key that was not recorded is ignored. */
+	zassert_false(hid_items_value_set(&items, KEY_A + KEY_COUNT_MAX, -1),
+		      "Release of a key that was not recorded reported");
+
+	/* A key pressed after a release is recorded as the newest one. */
+	zassert_true(hid_items_value_set(&items, KEY_A + 1, -1),
+		     "Key release not reported");
+	zassert_true(hid_items_value_set(&items, KEY_A + KEY_COUNT_MAX, 1),
+		     "Key press not reported");
+
+	memmove(&pressed[1], &pressed[2], (ARRAY_SIZE(pressed) - 2) * sizeof(pressed[0]));
+	pressed[ARRAY_SIZE(pressed) - 1] = KEY_A + KEY_COUNT_MAX;
+	items_check(pressed, ARRAY_SIZE(pressed));
+}
+
+void test_main(void)
+{
+	ztest_test_suite(hid_items,
+		ztest_unit_test_setup_teardown(test_press_order, items_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_release, items_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_reference_count, items_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_rollover, items_init,
+					       unit_test_noop)
+	);
+
+	ztest_run_test_suite(hid_items);
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+
+#include "led_keyframes.h"
+
+#define START_DELAY	CONFIG_DESKTOP_LED_STREAM_KEYFRAME_DELAY
+#define SUBSTEP_TIME	CONFIG_DESKTOP_LED_STREAM_SUBSTEP_TIME
+
+static struct led_keyframes kfs;
+
+static void kfs_init(void)
+{
+	led_keyframes_reset(&kfs);
+}
+
+static struct led_keyframe keyframe(uint16_t timestamp)
+{
+	struct led_keyframe kf = {
+		.color.c = {timestamp & 0xff, timestamp >> 8, 0},
+		.timestamp = timestamp,
+	};
+
+	return kf;
+}
+
+static void keyframe_add(uint16_t timestamp, uint32_t now)
+{
+	struct led_keyframe kf = keyframe(timestamp);
+
+	zassert_ok(led_keyframes_add(&kfs, &kf, 1, now), "Keyframe not added");
+}
+
+/* Get the next step and check that it reaches the keyframe color after the
+ * given duration.
+ */
+static void step_check(uint16_t timestamp, uint32_t now, uint32_t duration)
+{
+	struct led_keyframe kf = keyframe(timestamp);
+	struct led_effect_step step;
+
+	zassert_true(led_keyframes_step_get(&kfs, now, &step), "No step");
+	zassert_mem_equal(&step.color, &kf.color, sizeof(kf.color), "Wrong color");
+
+	if (duration == 0) {
+		zassert_equal(step.substep_count, 1, "Late keyframe interpolated");
+		zassert_equal(step.substep_time, 0, "Late keyframe delayed");
+		return;
+	}
+
+	zassert_equal(step.substep_count, DIV_ROUND_UP(duration, SUBSTEP_TIME),
+		      "Wrong number of substeps");
+	zassert_true(step.substep_time <= SUBSTEP_TIME, "Substep too long");
+	zassert_within(step.substep_count * step.substep_time, duration,
+		       step.substep_count - 1, "Wrong step duration");
+}
+
+static void test_interpolation(void)
+{
+	uint32_t now = 5000;
+	struct led_keyframe kf[3] = {keyframe(1000), keyframe(1100), keyframe(1255)};
+
+	zassert_ok(led_keyframes_add(&kfs, kf, ARRAY_SIZE(kf), now),
+		   "Keyframes not added");
+
+	/* The first keyframe is displayed after the start delay. */
+	step_check(1000, now, START_DELAY);
+	now += START_DELAY;
+
+	step_check(1100, now, 100);
+
+	/* Delays of the LED effect do not accumulate, the next keyframe is
+	 * still displayed at its time.
+	 */
+	now += 100 + 7;
+	step_check(1255, now, 155 - 7);
+
+	zassert_false(led_keyframes_step_get(&kfs, now, &(struct led_effect_step){0}),
+		      "Step from an empty queue");
+}
+
+static void test_late_keyframe(void)
+{
+	uint32_t now = 0;
+
+	keyframe_add(100, now);
+	keyframe_add(150, now);
+	keyframe_add(400, now);
+
+	step_check(100, now, START_DELAY);
+
+	/* The second keyframe is reached late, it is displayed at once. */
+	now += START_DELAY + 80;
+	step_check(150, now, 0);
+
+	/* Later keyframes keep the timeline of the stream. */
+	step_check(400, now, 400 - 150 - 30);
+}
+
+static void test_timestamp_wrap(void)
+{
+	uint32_t now = UINT32_MAX - 50;
+
+	keyframe_add(UINT16_MAX - 20, now);
+	keyframe_add(30, now);
+
+	step_check(UINT16_MAX - 20, now, START_DELAY);
+	now += START_DELAY;
+	step_check(30, now, 51);
+}
+
+static void test_out_of_order(void)
+{
+	struct led_keyframe kf[2] = {keyframe(1000), keyframe(900)};
+
+	zassert_equal(led_keyframes_add(&kfs, kf, ARRAY_SIZE(kf), 0), -EINVAL,
+		      "Keyframes out of order added");
+	zassert_true(led_keyframes_is_empty(&kfs), "Keyframe added");
+
+	keyframe_add(1000, 0);
+
+	kf[0] = keyframe(999);
+	zassert_equal(led_keyframes_add(&kfs, kf, 1, 0), -EINVAL,
+		      "Keyframe older than the queued one added");
+
+	/* Keyframes that follow the one being displayed are accepted. */
+	step_check(1000, 0, START_DELAY);
+	zassert_equal(led_keyframes_add(&kfs, kf, 1, 0), -EINVAL,
+		      "Keyframe older than the displayed one added");
+
+	keyframe_add(1050, START_DELAY);
+	step_check(1050, START_DELAY, 50);
+}
+
+static void test_queue_overflow(void)
+{
+	struct led_keyframe kf[3];
+	uint16_t timestamp = 0;
+
+	zassert_equal(led_keyframes_free_count(&kfs), LED_KEYFRAMES_QUEUE_SIZE,
+		      "Wrong free count");
+
+	for (size_t i = 0; i < LED_KEYFRAMES_QUEUE_SIZE; i++) {
+		keyframe_add(timestamp, 0);
+		timestamp += 10;
+	}
+
+	zassert_equal(led_keyframes_free_count(&kfs), 0, "Queue not full");
+
+	kf[0] = keyframe(timestamp);
+	zassert_equal(led_keyframes_add(&kfs, kf, 1, 0), -ENOMEM,
+		      "Keyframe added to a full queue");
+
+	/* A frame is added whole or not at all. */
+	step_check(0, 0, START_DELAY);
+	step_check(10, START_DELAY, 10);
+
+	for (size_t i = 0; i < ARRAY_SIZE(kf); i++) {
+		kf[i] = keyframe(timestamp + 10 * i);
+	}
+
+	zassert_equal(led_keyframes_add(&kfs, kf, ARRAY_SIZE(kf), 0), -ENOMEM,
+		      "Frame added to a queue without enough space");
+	zassert_equal(led_keyframes_free_count(&kfs), 2, "Wrong free count");
+
+	zassert_ok(led_keyframes_add(&kfs, kf, 2, 0), "Keyframes not added");
+	zassert_equal(led_keyframes_free_count(&kfs), 0, "Queue not full");
+
+	/* Keyframes are taken in order. */
+	for (size_t i = 2; i < LED_KEYFRAMES_QUEUE_SIZE + 2; i++) {
+		step_check(10 * i, START_DELAY + 10 * (i - 1), 10);
+	}
+
+	zassert_true(led_keyframes_is_empty(&kfs), "Queue not empty");
+}
+
+static void test_new_timeline(void)
+{
+	keyframe_add(1000, 0);
+	step_check(1000, 0, START_DELAY);
+
+	/* The stream stopped, a keyframe with an older timestamp starts a new
+	 * timeline after the start delay.
+	 */
+	led_keyframes_stop(&kfs);
+
+	keyframe_add(10, 500);
+	step_check(10, 500, START_DELAY);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(led_keyframes,
+		ztest_unit_test_setup_teardown(test_interpolation, kfs_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_late_keyframe, kfs_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_timestamp_wrap, kfs_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_out_of_order, kfs_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_queue_overflow, kfs_init,
+					       unit_test_noop),
+		ztest_unit_test_setup_teardown(test_new_timeline, kfs_init,
+					       unit_test_noop)
+	);
+
+	ztest_run_test_suite(led_keyframes);
+}
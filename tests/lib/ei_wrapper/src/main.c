@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+#include <ei_wrapper.h>
+
+#include "stub_classifier.h"
+
+#define FRAME_SIZE	2
+#define WINDOW_SIZE	8
+#define BUF_SIZE	20
+#define RESULT_TIMEOUT	K_MSEC(500)
+
+static K_SEM_DEFINE(result_sem, 0, 1);
+static float result_value;
+static int result_err;
+static size_t next_value;
+
+
+static void result_ready_cb(int err)
+{
+	const char *label;
+	float anomaly;
+
+	result_err = err;
+	if (!err) {
+		result_err = ei_wrapper_get_classification_results(&label,
+								   &result_value,
+								   &anomaly);
+	}
+
+	k_sem_give(&result_sem);
+}
+
+static void reset(void)
+{
+	bool cancelled;
+
+	stub_classifier_block(false);
+	zassert_ok(ei_wrapper_clear_data(&cancelled), "Cannot clear data");
+	ei_wrapper_reset_stats();
+	k_sem_reset(&result_sem);
+	next_value = 0;
+}
+
+/* Add subsequent values, so that every value is equal to its position in
+ * the input stream.
+ */
+static int add_values(size_t cnt)
+{
+	float data[cnt];
+
+	for (size_t i = 0; i < cnt; i++) {
+		data[i] = next_value + i;
+	}
+
+	int err = ei_wrapper_add_data(data, cnt);
+
+	if (!err) {
+		next_value += cnt;
+	}
+
+	return err;
+}
+
+static int add_values_fixed(size_t cnt, uint8_t frac_bits)
+{
+	int32_t data[cnt];
+
+	for (size_t i = 0; i < cnt; i++) {
+		data[i] = (next_value + i) << frac_bits;
+	}
+
+	int err = ei_wrapper_add_data_fixed(data, cnt, frac_bits);
+
+	if (!err) {
+		next_value += cnt;
+	}
+
+	return err;
+}
+
+static void verify_result(size_t window_start)
+{
+	size_t len;
+	const float *window;
+
+	zassert_ok(k_sem_take(&result_sem, RESULT_TIMEOUT), "No result");
+	zassert_ok(result_err, "Result error");
+	zassert_equal(result_value, window_start, "Invalid result");
+
+	window = stub_classifier_get_window(&len);
+	zassert_equal(len, WINDOW_SIZE, "Invalid window size");
+
+	for (size_t i = 0; i < len; i++) {
+		zassert_equal(window[i], window_start + i,
+			      "Invalid window data");
+	}
+}
+
+static void test_init(void)
+{
+	zassert_equal(ei_wrapper_get_frame_size(), FRAME_SIZE, "Invalid frame size");
+	zassert_equal(ei_wrapper_get_window_size(), WINDOW_SIZE, "Invalid window size");
+	zassert_ok(ei_wrapper_init(result_ready_cb), "Cannot initialize");
+}
+
+static void test_invalid_size(void)
+{
+	reset();
+
+	zassert_equal(add_values(FRAME_SIZE + 1), -EINVAL, "Invalid size accepted");
+	zassert_equal(add_values(BUF_SIZE), -ENOMEM, "Too much data accepted");
+}
+
+static void test_window(void)
+{
+	reset();
+
+	zassert_ok(add_values(WINDOW_SIZE), "Cannot add data");
+	zassert_ok(ei_wrapper_start_prediction(0, 0), "Cannot start");
+	verify_result(0);
+}
+
+static void test_delayed_start(void)
+{
+	reset();
+
+	zassert_ok(ei_wrapper_start_prediction(0, 0), "Cannot start");
+	zassert_ok(add_values(WINDOW_SIZE - FRAME_SIZE), "Cannot add data");
+	zassert_equal(k_sem_take(&result_sem, K_MSEC(100)), -EAGAIN,
+		      "Prediction started without data");
+
+	zassert_ok(add_values(FRAME_SIZE), "Cannot add data");
+	verify_result(0);
+}
+
+static void test_sliding_window(void)
+{
+	reset();
+
+	zassert_ok(add_values(WINDOW_SIZE), "Cannot add data");
+	zassert_ok(ei_wrapper_start_prediction(0, 0), "Cannot start");
+	verify_result(0);
+
+	/* Windows are shifted by a frame and wrap around the buffer end. */
+	for (size_t i = 1; i <= 3 * BUF_SIZE; i++) {
+		if (i % 2) {
+			zassert_ok(add_values(FRAME_SIZE), "Cannot add data");
+		} else {
+			zassert_ok(add_values_fixed(FRAME_SIZE, 8), "Cannot add data");
+		}
+
+		zassert_ok(ei_wrapper_start_prediction(0, 1), "Cannot start");
+		verify_result(i * FRAME_SIZE);
+	}
+
+	struct ei_wrapper_stats stats;
+
+	ei_wrapper_get_stats(&stats);
+	zassert_equal(stats.window_cnt, 3 * BUF_SIZE + 1, "Invalid window count");
+	zassert_equal(stats.late_window_cnt, 0, "Invalid late window count");
+	zassert_equal(stats.skipped_window_cnt, 0, "Invalid skipped window count");
+	zassert_true(stats.latency_min <= stats.latency_max, "Invalid latency");
+}
+
+static void test_add_during_prediction(void)
+{
+	reset();
+	stub_classifier_block(true);
+
+	zassert_ok(add_values(WINDOW_SIZE), "Cannot add data");
+	zassert_ok(ei_wrapper_start_prediction(0, 0), "Cannot start");
+	zassert_ok(stub_classifier_wait_start(), "Classifier not started");
+
+	/* Data is added while the classifier runs. The processed window
+	 * must not be overwritten.
+	 */
+	size_t free_space = BUF_SIZE - WINDOW_SIZE - 1;
+
+	zassert_ok(add_values(free_space - (free_space % FRAME_SIZE)),
+		   "Cannot add data");
+	zassert_equal(add_values(FRAME_SIZE), -ENOMEM, "Window overwritten");
+
+	stub_classifier_unblock();
+	verify_result(0);
+
+	/* Next window is processed using the data added meanwhile. */
+	stub_classifier_block(false);
+	zassert_ok(ei_wrapper_start_prediction(1, 0), "Cannot start");
+	verify_result(WINDOW_SIZE);
+}
+
+static void test_skip_late_windows(void)
+{
+	reset();
+	stub_classifier_block(true);
+
+	zassert_ok(add_values(WINDOW_SIZE), "Cannot add data");
+	zassert_ok(ei_wrapper_start_prediction(0, 0), "Cannot start");
+	zassert_ok(stub_classifier_wait_start(), "Classifier not started");
+
+	/* Three frames are added while the classifier runs. */
+	zassert_ok(add_values(3 * FRAME_SIZE), "Cannot add data");
+
+	stub_classifier_unblock();
+	verify_result(0);
+
+	/* Windows that start at values 2 and 4 are skipped, the newest
+	 * complete window is processed.
+	 */
+	stub_classifier_block(false);
+	zassert_ok(ei_wrapper_start_prediction(0, 1), "Cannot start");
+	verify_result(3 * FRAME_SIZE);
+
+	struct ei_wrapper_stats stats;
+
+	ei_wrapper_get_stats(&stats);
+	zassert_equal(stats.window_cnt, 2, "Invalid window count");
+	zassert_equal(stats.skipped_window_cnt, 2, "Invalid skipped window count");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(ei_wrapper,
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_invalid_size),
+			 ztest_unit_test(test_window),
+			 ztest_unit_test(test_delayed_start),
+			 ztest_unit_test(test_sliding_window),
+			 ztest_unit_test(test_add_during_prediction),
+			 ztest_unit_test(test_skip_late_windows)
+			 );
+
+	ztest_run_test_suite(ei_wrapper);
+}
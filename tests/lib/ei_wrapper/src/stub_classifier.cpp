@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <ei_run_classifier.h>
+
+#include "stub_classifier.h"
+
+static K_SEM_DEFINE(start_sem, 0, 1);
+static K_SEM_DEFINE(unblock_sem, 0, 1);
+
+static bool blocked;
+static float window[EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE];
+
+
+void stub_classifier_block(bool block)
+{
+	blocked = block;
+	k_sem_reset(&start_sem);
+}
+
+void stub_classifier_unblock(void)
+{
+	k_sem_give(&unblock_sem);
+}
+
+int stub_classifier_wait_start(void)
+{
+	return k_sem_take(&start_sem, K_SECONDS(1));
+}
+
+const float *stub_classifier_get_window(size_t *len)
+{
+	*len = ARRAY_SIZE(window);
+
+	return window;
+}
+
+EI_IMPULSE_ERROR run_classifier(signal_t *signal, ei_impulse_result_t *result,
+				bool debug)
+{
+	ARG_UNUSED(debug);
+
+	k_sem_give(&start_sem);
+
+	if (blocked) {
+		k_sem_take(&unblock_sem, K_FOREVER);
+	}
+
+	/* Read the window in two parts, as the library reads it per frame. */
+	size_t half = signal->total_length / 2;
+
+	signal->get_data(0, half, &window[0]);
+	signal->get_data(half, signal->total_length - half, &window[half]);
+
+	/* The result value is the first value of the window. */
+	result->classification[0].label = "stub";
+	result->classification[0].value = window[0];
+	result->anomaly = 0.0;
+	result->timing.dsp = 0;
+	result->timing.classification = 0;
+	result->timing.anomaly = 0;
+
+	return EI_IMPULSE_OK;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _STUB_CLASSIFIER_H_
+#define _STUB_CLASSIFIER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Make the classifier wait for stub_classifier_unblock before it reads
+ * the input window.
+ */
+void stub_classifier_block(bool block);
+
+void stub_classifier_unblock(void);
+
+/* Wait until the classifier is started. */
+int stub_classifier_wait_start(void);
+
+/* Get the input window read by the last classifier run. */
+const float *stub_classifier_get_window(size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STUB_CLASSIFIER_H_ */
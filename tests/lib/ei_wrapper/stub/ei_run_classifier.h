@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _EI_RUN_CLASSIFIER_H_
+#define _EI_RUN_CLASSIFIER_H_
+
+/* Minimal subset of the Edge Impulse library API used by the wrapper. */
+
+#include <stddef.h>
+
+#define EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME	2
+#define EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE	8
+#define EI_CLASSIFIER_HAS_ANOMALY		0
+#define EI_CLASSIFIER_LABEL_COUNT		1
+
+typedef enum {
+	EI_IMPULSE_OK = 0,
+} EI_IMPULSE_ERROR;
+
+typedef struct {
+	int (*get_data)(size_t offset, size_t length, float *out_ptr);
+	size_t total_length;
+} signal_t;
+
+typedef struct {
+	const char *label;
+	float value;
+} ei_impulse_result_classification_t;
+
+typedef struct {
+	int dsp;
+	int classification;
+	int anomaly;
+} ei_impulse_result_timing_t;
+
+typedef struct {
+	ei_impulse_result_classification_t classification[EI_CLASSIFIER_LABEL_COUNT];
+	float anomaly;
+	ei_impulse_result_timing_t timing;
+} ei_impulse_result_t;
+
+EI_IMPULSE_ERROR run_classifier(signal_t *signal, ei_impulse_result_t *result,
+				bool debug);
+
+#endif /* _EI_RUN_CLASSIFIER_H_ */
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "location_cache.h"
+#include "http_response.h"
+
+#define NCELLS_COUNT		4
+#define CACHE_SIZE		CONFIG_MULTICELL_LOCATION_CACHE_SIZE
+#define CACHE_MAX_AGE_MS	(CONFIG_MULTICELL_LOCATION_CACHE_MAX_AGE * 1000)
+
+/* Time for a caller to reach the request in flight. */
+#define JOIN_WAIT_MS		50
+
+#define THREAD_STACK_SIZE	2048
+#define THREAD_COUNT		2
+
+static int request_count;
+static int request_err;
+static bool request_gated;
+
+static K_SEM_DEFINE(request_entered, 0, 1);
+static K_SEM_DEFINE(request_gate, 0, 1);
+
+static int location_request(const struct lte_lc_cells_info *cell_data,
+			    struct multicell_location *location)
+{
+	request_count++;
+
+	if (request_gated) {
+		k_sem_give(&request_entered);
+		k_sem_take(&request_gate, K_FOREVER);
+	}
+
+	if (request_err) {
+		return request_err;
+	}
+
+	location->latitude = cell_data->current_cell.id;
+	location->longitude = request_count;
+	location->accuracy = 1000;
+
+	return 0;
+}
+
+static struct lte_lc_ncell ncells[NCELLS_COUNT] = {
+	{ .earfcn = 6200, .phys_cell_id = 1 },
+	{ .earfcn = 6200, .phys_cell_id = 2 },
+	{ .earfcn = 1650, .phys_cell_id = 3 },
+	{ .earfcn = 300, .phys_cell_id = 4 },
+};
+
+static void cells_init(struct lte_lc_cells_info *cells, uint32_t id)
+{
+	memset(cells, 0, sizeof(*cells));
+
+	cells->current_cell.mcc = 242;
+	cells->current_cell.mnc = 1;
+	cells->current_cell.tac = 0x1234;
+	cells->current_cell.id = id;
+	cells->ncells_count = NCELLS_COUNT;
+	cells->neighbor_cells = ncells;
+}
+
+static int location_get(uint32_t id, struct multicell_location *location)
+{
+	struct lte_lc_cells_info cells;
+
+	cells_init(&cells, id);
+
+	return location_cache_get(&cells, location, location_request);
+}
+
+static void setup(void)
+{
+	location_cache_clear();
+	request_count = 0;
+	request_err = 0;
+	request_gated = false;
+}
+
+static void test_cache_hit(void)
+{
+	struct multicell_location first, second;
+	int err;
+
+	setup();
+
+	err = location_get(1, &first);
+	zassert_equal(err, 0, "Request failed: %d", err);
+	zassert_equal(request_count, 1, "Location not requested");
+
+	err = location_get(1, &second);
+	zassert_equal(err, 0, "Cached location failed: %d", err);
+	zassert_equal(request_count, 1, "Location requested again");
+	zassert_mem_equal(&first, &second, sizeof(first),
+			  "Cached location differs");
+}
+
+static void test_cache_ncell_order(void)
+{
+	struct lte_lc_ncell reversed[NCELLS_COUNT];
+	struct lte_lc_cells_info cells;
+	struct multicell_location location;
+	int err;
+
+	setup();
+
+	err = location_get(1, &location);
+	zassert_equal(err, 0, "Request failed: %d", err);
+
+	for (size_t i = 0; i < NCELLS_COUNT; i++) {
+		reversed[i] = ncells[NCELLS_COUNT - 1 - i];
+	}
+
+	cells_init(&cells, 1);
+	cells.neighbor_cells = reversed;
+
+	err = location_cache_get(&cells, &location, location_request);
+	zassert_equal(err, 0, "Cached location failed: %d", err);
+	zassert_equal(request_count, 1, "Order of neighbor cells matters");
+
+	/* A different set of neighbor cells is a cache miss. */
+	cells.ncells_count = NCELLS_COUNT - 1;
+
+	err = location_cache_get(&cells, &location, location_request);
+	zassert_equal(err, 0, "Request failed: %d", err);
+	zassert_equal(request_count, 2, "Different neighbor cells were cached");
+}
+
+static void test_cache_lru(void)
+{
+	struct multicell_location location;
+
+	setup();
+
+	for (uint32_t id = 1; id <= CACHE_SIZE; id++) {
+		zassert_equal(location_get(id, &location), 0, "Request failed");
+	}
+
+	/* Cell 1 is used, cell 2 is the least recently used. */
+	k_sleep(K_MSEC(10));
+	zassert_equal(location_get(1, &location), 0, "Cached location failed");
+	zassert_equal(location_get(CACHE_SIZE + 1, &location), 0,
+		      "Request failed");
+	zassert_equal(request_count, CACHE_SIZE + 1, "Unexpected requests");
+
+	zassert_equal(location_get(1, &location), 0, "Cached location failed");
+	zassert_equal(request_count, CACHE_SIZE + 1, "Used location evicted");
+
+	zassert_equal(location_get(2, &location), 0, "Request failed");
+	zassert_equal(request_count, CACHE_SIZE + 2, "Location not evicted");
+}
+
+static void test_cache_max_age(void)
+{
+	struct multicell_location location;
+
+	setup();
+
+	zassert_equal(location_get(1, &location), 0, "Request failed");
+	zassert_equal(location_get(1, &location), 0, "Cached location failed");
+	zassert_equal(request_count, 1, "Location requested again");
+
+	k_sleep(K_MSEC(CACHE_MAX_AGE_MS + 100));
+
+	zassert_equal(location_get(1, &location), 0, "Request failed");
+	zassert_equal(request_count, 2, "Expired location used");
+}
+
+static void test_cache_error(void)
+{
+	struct multicell_location location;
+	int err;
+
+	setup();
+
+	request_err = -EIO;
+	err = location_get(1, &location);
+	zassert_equal(err, -EIO, "Unexpected error: %d", err);
+
+	request_err = 0;
+	err = location_get(1, &location);
+	zassert_equal(err, 0, "Request failed: %d", err);
+	zassert_equal(request_count, 2, "Failed request was cached");
+}
+
+struct caller {
+	struct k_thread thread;
+	uint32_t id;
+	int err;
+	struct multicell_location location;
+};
+
+static K_THREAD_STACK_ARRAY_DEFINE(caller_stacks, THREAD_COUNT,
+				   THREAD_STACK_SIZE);
+static struct caller callers[THREAD_COUNT];
+static K_SEM_DEFINE(caller_done, 0, THREAD_COUNT);
+
+static void caller_entry(void *p1, void *p2, void *p3)
+{
+	struct caller *caller = p1;
+
+	caller->err = location_get(caller->id, &caller->location);
+	k_sem_give(&caller_done);
+}
+
+static void caller_start(size_t i, uint32_t id)
+{
+	callers[i].id = id;
+	callers[i].err = 1;
+
+	k_thread_create(&callers[i].thread, caller_stacks[i],
+			K_THREAD_STACK_SIZEOF(caller_stacks[i]), caller_entry,
+			&callers[i], NULL, NULL,
+			K_LOWEST_APPLICATION_THREAD_PRIO, 0, K_NO_WAIT);
+}
+
+/* Start a caller whose request blocks, then a second caller, and let the
+ * request complete once the second caller is waiting.
+ */
+static void callers_run(uint32_t first_id, uint32_t second_id)
+{
+	request_gated = true;
+
+	caller_start(0, first_id);
+	k_sem_take(&request_entered, K_FOREVER);
+
+	caller_start(1, second_id);
+	k_sleep(K_MSEC(JOIN_WAIT_MS));
+
+	request_gated = false;
+	k_sem_give(&request_gate);
+
+	for (size_t i = 0; i < THREAD_COUNT; i++) {
+		k_sem_take(&caller_done, K_FOREVER);
+	}
+}
+
+static void test_coalesce_same_cells(void)
+{
+	setup();
+
+	/* Errors are not cached, so the second caller can only get the error
+	 * from the request in flight.
+	 */
+	request_err = -EIO;
+	callers_run(1, 1);
+
+	zassert_equal(request_count, 1, "Requests not coalesced");
+	zassert_equal(callers[0].err, -EIO, "Unexpected error: %d",
+		      callers[0].err);
+	zassert_equal(callers[1].err, -EIO, "Unexpected error: %d",
+		      callers[1].err);
+
+	request_err = 0;
+	callers_run(1, 1);
+
+	zassert_equal(request_count, 2, "Requests not coalesced");
+	zassert_equal(callers[0].err, 0, "Request failed");
+	zassert_equal(callers[1].err, 0, "Request failed");
+	zassert_mem_equal(&callers[0].location, &callers[1].location,
+			  sizeof(callers[0].location), "Locations differ");
+}
+
+static void test_coalesce_different_cells(void)
+{
+	setup();
+
+	callers_run(1, 2);
+
+	zassert_equal(request_count, 2, "Different cells coalesced");
+	zassert_equal(callers[0].err, 0, "Request failed");
+	zassert_equal(callers[1].err, 0, "Request failed");
+	zassert_equal(callers[0].location.latitude, 1, "Wrong location");
+	zassert_equal(callers[1].location.latitude, 2, "Wrong location");
+}
+
+static bool response_complete(const char *response, bool *keep_alive)
+{
+	return http_response_complete(response, strlen(response), keep_alive);
+}
+
+static void test_http_response_content_length(void)
+{
+	bool keep_alive;
+
+	zassert_false(response_complete("HTTP/1.1 200 OK\r\n"
+					 "Content-Length: 4\r\n",
+					 &keep_alive),
+		      "Incomplete headers");
+	zassert_false(response_complete("HTTP/1.1 200 OK\r\n"
+					 "Content-Length: 4\r\n\r\n{}",
+					 &keep_alive),
+		      "Incomplete body");
+	zassert_true(response_complete("HTTP/1.1 200 OK\r\n"
+				       "content-length:4\r\n\r\n{\"\"}",
+				       &keep_alive),
+		     "Complete response");
+	zassert_true(keep_alive, "HTTP/1.1 connection not kept alive");
+
+	zassert_true(response_complete("HTTP/1.1 200 OK\r\n"
+				       "Connection: Close\r\n"
+				       "Content-Length: 0\r\n\r\n",
+				       &keep_alive),
+		     "Complete response");
+	zassert_false(keep_alive, "Closed connection kept alive");
+
+	zassert_true(response_complete("HTTP/1.0 200 OK\r\n"
+				       "Content-Length: 0\r\n\r\n",
+				       &keep_alive),
+		     "Complete response");
+	zassert_false(keep_alive, "HTTP/1.0 connection kept alive");
+}
+
+static void test_http_response_chunked(void)
+{
+	bool keep_alive;
+
+	zassert_false(response_complete("HTTP/1.1 200 OK\r\n"
+					 "Transfer-Encoding: chunked\r\n\r\n"
+					 "10\r\n\r\n",
+					 &keep_alive),
+		      "Incomplete chunk taken as the last chunk");
+	zassert_true(response_complete("HTTP/1.1 200 OK\r\n"
+				       "Transfer-Encoding: chunked\r\n\r\n"
+				       "2\r\n{}\r\n0\r\n\r\n",
+				       &keep_alive),
+		     "Complete response");
+	zassert_true(keep_alive, "Connection not kept alive");
+	zassert_true(response_complete("HTTP/1.1 204 No Content\r\n"
+				       "Transfer-Encoding: chunked\r\n\r\n"
+				       "0\r\n\r\n",
+				       &keep_alive),
+		     "Empty response");
+}
+
+static void test_http_response_until_close(void)
+{
+	bool keep_alive;
+
+	zassert_false(response_complete("HTTP/1.1 200 OK\r\n"
+					 "Content-Type: application/json\r\n\r\n"
+					 "{}",
+					 &keep_alive),
+		      "Response without length is complete");
+	zassert_false(keep_alive, "Connection without length kept alive");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(multicell_location_cache,
+		ztest_unit_test(test_cache_hit),
+		ztest_unit_test(test_cache_ncell_order),
+		ztest_unit_test(test_cache_lru),
+		ztest_unit_test(test_cache_max_age),
+		ztest_unit_test(test_cache_error),
+		ztest_unit_test(test_coalesce_same_cells),
+		ztest_unit_test(test_coalesce_different_cells)
+	);
+
+	ztest_test_suite(multicell_location_http_response,
+		ztest_unit_test(test_http_response_content_length),
+		ztest_unit_test(test_http_response_chunked),
+		ztest_unit_test(test_http_response_until_close)
+	);
+
+	ztest_run_test_suite(multicell_location_cache);
+	ztest_run_test_suite(multicell_location_http_response);
+}
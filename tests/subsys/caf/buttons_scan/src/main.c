@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+
+#include <caf/key_id.h>
+
+#include "buttons_scan.h"
+
+#define COLS 3
+#define ROWS 4
+#define SCAN_INTERVAL 2000
+#define DEBOUNCE_TIME 2000
+#define EVENT_LIMIT 3
+#define EVENT_MAX 16
+
+struct key_event {
+	uint16_t key_id;
+	bool pressed;
+};
+
+static struct buttons_scan scan;
+static struct buttons_scan_key keys[COLS * ROWS];
+static struct key_event events[EVENT_MAX];
+static size_t event_cnt;
+static uint32_t now;
+
+/* Switches of the simulated key matrix. */
+static bool matrix[COLS][ROWS];
+
+static void key_cb(uint16_t key_id, bool pressed)
+{
+	zassert_true(event_cnt < ARRAY_SIZE(events), "Too many events");
+
+	events[event_cnt].key_id = key_id;
+	events[event_cnt].pressed = pressed;
+	event_cnt++;
+}
+
+/* Rows read while the column is driven. Without diodes, the current also
+ * flows through pressed keys of other columns, what results in ghost keys.
+ */
+static uint32_t matrix_read_column(size_t col)
+{
+	uint32_t cols = BIT(col);
+	uint32_t rows = 0;
+	uint32_t prev_cols;
+
+	do {
+		prev_cols = cols;
+
+		for (size_t i = 0; i < COLS; i++) {
+			for (size_t j = 0; j < ROWS; j++) {
+				if (matrix[i][j] && (cols & BIT(i))) {
+					rows |= BIT(j);
+				}
+			}
+		}
+
+		for (size_t i = 0; i < COLS; i++) {
+			for (size_t j = 0; j < ROWS; j++) {
+				if (matrix[i][j] && (rows & BIT(j))) {
+					cols |= BIT(i);
+				}
+			}
+		}
+	} while (cols != prev_cols);
+
+	return rows;
+}
+
+static bool matrix_scan(void)
+{
+	uint32_t raw_state[COLS];
+
+	for (size_t i = 0; i < COLS; i++) {
+		raw_state[i] = matrix_read_column(i);
+	}
+
+	bool idle = buttons_scan_process(&scan, raw_state, now);
+
+	now += SCAN_INTERVAL;
+
+	return idle;
+}
+
+static void scan_times(size_t cnt)
+{
+	for (size_t i = 0; i < cnt; i++) {
+		matrix_scan();
+	}
+}
+
+static void check_event(size_t idx, size_t col, size_t row, bool pressed)
+{
+	zassert_true(idx < event_cnt, "Missing event");
+	zassert_equal(events[idx].key_id, KEY_ID(col, row), "Wrong key");
+	zassert_equal(events[idx].pressed, pressed, "Wrong key state");
+}
+
+static void setup(void)
+{
+	memset(matrix, 0, sizeof(matrix));
+	event_cnt = 0;
+	now = 0;
+
+	buttons_scan_init(&scan, keys, COLS, ROWS, DEBOUNCE_TIME, EVENT_LIMIT,
+			  key_cb);
+}
+
+static void test_press_release(void)
+{
+	setup();
+
+	zassert_true(matrix_scan(), "Matrix not idle");
+
+	matrix[1][2] = true;
+	zassert_false(matrix_scan(), "Change not noticed");
+	zassert_equal(event_cnt, 0, "Press reported before debounce");
+
+	matrix_scan();
+	zassert_equal(event_cnt, 1, "Press not reported");
+	check_event(0, 1, 2, true);
+
+	matrix[1][2] = false;
+	zassert_false(matrix_scan(), "Idle before release is reported");
+	zassert_true(matrix_scan(), "Matrix not idle");
+	check_event(1, 1, 2, false);
+
+	zassert_equal(scan.stats.event_cnt, 2, "Wrong event count");
+	zassert_equal(scan.stats.latency_max, SCAN_INTERVAL, "Wrong latency");
+	zassert_equal(scan.stats.bounce_cnt, 0, "Unexpected bounce");
+}
+
+static void test_bounce(void)
+{
+	setup();
+
+	/* Pin state changes on every scan. */
+	for (size_t i = 0; i < 6; i++) {
+		matrix[0][0] = !matrix[0][0];
+		matrix_scan();
+	}
+
+	zassert_equal(event_cnt, 0, "Bouncing key reported");
+	zassert_equal(scan.stats.bounce_cnt, 3, "Wrong bounce count");
+
+	/* Bouncing of one key does not delay another one. */
+	matrix[0][0] = true;
+	matrix[2][3] = true;
+	matrix_scan();
+	matrix[0][0] = false;
+	matrix_scan();
+
+	zassert_equal(event_cnt, 1, "Stable key not reported");
+	check_event(0, 2, 3, true);
+}
+
+static void test_ghosting(void)
+{
+	setup();
+
+	matrix[0][0] = true;
+	matrix[0][1] = true;
+	scan_times(2);
+	zassert_equal(event_cnt, 2, "Keys not reported");
+
+	/* The fourth corner of the rectangle is a ghost key. Pressed keys
+	 * keep their state and new keys are not reported.
+	 */
+	matrix[1][0] = true;
+	scan_times(4);
+	zassert_equal(event_cnt, 2, "Ghost key reported");
+	zassert_equal(scan.stats.ghost_cnt, 4, "Ghosting not detected");
+
+	/* Key is reported when ghosting is resolved. */
+	matrix[0][1] = false;
+	scan_times(2);
+	zassert_equal(event_cnt, 4, "Keys not reported");
+	check_event(2, 0, 1, false);
+	check_event(3, 1, 0, true);
+}
+
+static void test_event_limit(void)
+{
+	setup();
+
+	for (size_t i = 0; i < ROWS; i++) {
+		matrix[0][i] = true;
+	}
+
+	scan_times(2);
+	zassert_equal(event_cnt, EVENT_LIMIT, "Event limit exceeded");
+	matrix_scan();
+	zassert_equal(event_cnt, ROWS, "Events not reported");
+
+	memset(matrix[0], 0, sizeof(matrix[0]));
+	scan_times(2);
+	zassert_equal(event_cnt, ROWS + EVENT_LIMIT, "Event limit exceeded");
+	zassert_true(matrix_scan(), "Matrix not idle");
+	zassert_equal(event_cnt, 2 * ROWS, "Events not reported");
+}
+
+static void test_latency(void)
+{
+	setup();
+
+	/* Scan is done after the debounce interval since the interrupt. */
+	matrix[1][1] = true;
+	buttons_scan_trigger(&scan, now);
+	now += SCAN_INTERVAL;
+	scan_times(2);
+
+	zassert_equal(event_cnt, 1, "Press not reported");
+	zassert_equal(scan.stats.latency_min, 2 * SCAN_INTERVAL,
+		      "Latency not measured from interrupt");
+
+	buttons_scan_stats_reset(&scan);
+	zassert_equal(scan.stats.event_cnt, 0, "Stats not reset");
+	zassert_equal(scan.stats.latency_min, UINT32_MAX, "Stats not reset");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(caf_buttons_scan,
+			 ztest_unit_test(test_press_release),
+			 ztest_unit_test(test_bounce),
+			 ztest_unit_test(test_ghosting),
+			 ztest_unit_test(test_event_limit),
+			 ztest_unit_test(test_latency)
+			 );
+
+	ztest_run_test_suite(caf_buttons_scan);
+}
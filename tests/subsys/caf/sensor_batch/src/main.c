@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+
+#include "sensor_batch.h"
+
+#define BUF_CNT 2
+#define BATCH_SIZE 4
+#define SAMPLE_VALUES 3
+#define PERIOD 10
+
+struct sample {
+	int32_t val[SAMPLE_VALUES];
+};
+
+static struct sensor_batch batch;
+static struct sample buf[BUF_CNT][BATCH_SIZE];
+static uint32_t sample_seq;
+static int64_t now;
+
+static void setup(uint32_t latency)
+{
+	sample_seq = 0;
+	now = 0;
+
+	sensor_batch_init(&batch, buf, BUF_CNT, BATCH_SIZE, sizeof(struct sample),
+			  PERIOD, latency);
+}
+
+static bool sample_add(void)
+{
+	struct sample sample;
+
+	for (size_t i = 0; i < SAMPLE_VALUES; i++) {
+		sample.val[i] = sample_seq * SAMPLE_VALUES + i;
+	}
+
+	sample_seq++;
+
+	bool ready = sensor_batch_add(&batch, &sample, now);
+
+	now += PERIOD;
+
+	return ready;
+}
+
+static void batch_fill(void)
+{
+	for (size_t i = 0; i < BATCH_SIZE - 1; i++) {
+		zassert_false(sample_add(), "Batch completed too early");
+	}
+
+	zassert_true(sample_add(), "Batch not completed");
+}
+
+/* Take the batch and check that it holds the given samples. */
+static const struct sample *batch_check(uint32_t first_seq, uint16_t sample_cnt,
+					uint16_t dropped_cnt)
+{
+	uint16_t cnt;
+	uint16_t dropped;
+	const struct sample *samples = sensor_batch_take(&batch, &cnt, &dropped);
+
+	zassert_equal(cnt, sample_cnt, "Wrong sample count");
+	zassert_equal(dropped, dropped_cnt, "Wrong dropped count");
+	zassert_true(sensor_batch_is_empty(&batch), "Batch not empty after take");
+
+	for (size_t i = 0; i < cnt; i++) {
+		for (size_t j = 0; j < SAMPLE_VALUES; j++) {
+			zassert_equal(samples[i].val[j],
+				      (first_seq + i) * SAMPLE_VALUES + j,
+				      "Wrong sample data");
+		}
+	}
+
+	return samples;
+}
+
+static void test_full_batch(void)
+{
+	setup(0);
+
+	zassert_true(sensor_batch_is_empty(&batch), "Batch not empty");
+
+	batch_fill();
+	zassert_true(sensor_batch_release(&batch, batch_check(0, BATCH_SIZE, 0)),
+		     "Buffer not released");
+
+	/* Buffers are reused. */
+	for (size_t i = 1; i < 2 * BUF_CNT; i++) {
+		batch_fill();
+		sensor_batch_release(&batch, batch_check(i * BATCH_SIZE, BATCH_SIZE, 0));
+	}
+}
+
+static void test_latency(void)
+{
+	setup(2 * PERIOD + PERIOD / 2);
+
+	/* The third sample is the last one that fits in the latency. */
+	zassert_false(sample_add(), "Batch completed too early");
+	zassert_false(sample_add(), "Batch completed too early");
+	zassert_true(sample_add(), "Batch not completed on latency");
+
+	sensor_batch_release(&batch, batch_check(0, 3, 0));
+
+	/* Latency is measured from the first sample of a batch. */
+	now += 10 * PERIOD;
+	zassert_false(sample_add(), "Batch completed too early");
+}
+
+static void test_flush(void)
+{
+	setup(0);
+
+	zassert_false(sample_add(), "Batch completed too early");
+	zassert_false(sensor_batch_is_empty(&batch), "Sample not added");
+
+	sensor_batch_release(&batch, batch_check(0, 1, 0));
+
+	/* The next batch starts in a free buffer. */
+	batch_fill();
+	sensor_batch_release(&batch, batch_check(1, BATCH_SIZE, 0));
+}
+
+static void test_buffers_busy(void)
+{
+	const struct sample *taken[BUF_CNT];
+
+	setup(0);
+
+	for (size_t i = 0; i < BUF_CNT; i++) {
+		batch_fill();
+		taken[i] = batch_check(i * BATCH_SIZE, BATCH_SIZE, 0);
+	}
+
+	/* All buffers are busy, samples are dropped. */
+	zassert_false(sample_add(), "Sample added without a free buffer");
+	zassert_false(sample_add(), "Sample added without a free buffer");
+	zassert_true(sensor_batch_is_empty(&batch), "Sample added without a free buffer");
+
+	zassert_true(sensor_batch_release(&batch, taken[1]), "Buffer not released");
+	zassert_false(sensor_batch_release(&batch, &taken[1][1]),
+		      "Buffer released for data inside of it");
+
+	/* Dropped samples are reported with the next batch, only once. */
+	sample_seq += BATCH_SIZE - 1;
+	zassert_false(sample_add(), "Batch completed too early");
+	taken[1] = batch_check(sample_seq - 1, 1, 2);
+
+	zassert_equal(taken[1], &buf[1][0], "Busy buffer reused");
+
+	sensor_batch_release(&batch, taken[0]);
+	batch_fill();
+	batch_check(sample_seq - BATCH_SIZE, BATCH_SIZE, 0);
+}
+
+static void test_drop(void)
+{
+	setup(0);
+
+	sensor_batch_drop(&batch, 3);
+	batch_fill();
+	sensor_batch_release(&batch, batch_check(0, BATCH_SIZE, 3));
+
+	batch_fill();
+	sensor_batch_release(&batch, batch_check(BATCH_SIZE, BATCH_SIZE, 0));
+
+	/* Dropped count saturates. */
+	sensor_batch_drop(&batch, UINT16_MAX - 1);
+	sensor_batch_drop(&batch, 5);
+	sensor_batch_drop(&batch, SIZE_MAX);
+	batch_fill();
+	batch_check(2 * BATCH_SIZE, BATCH_SIZE, UINT16_MAX);
+}
+
+static void test_release_unknown(void)
+{
+	static struct sample other;
+
+	setup(0);
+
+	zassert_false(sensor_batch_release(&batch, &other), "Unknown buffer released");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(caf_sensor_batch,
+			 ztest_unit_test(test_full_batch),
+			 ztest_unit_test(test_latency),
+			 ztest_unit_test(test_flush),
+			 ztest_unit_test(test_buffers_busy),
+			 ztest_unit_test(test_drop),
+			 ztest_unit_test(test_release_unknown)
+			 );
+
+	ztest_run_test_suite(caf_sensor_batch);
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+
+#include "sensor_fixed.h"
+
+/* Q15.16 format, the default one. */
+#define FRAC_BITS 16
+#define ONE ((int32_t)BIT(FRAC_BITS))
+
+static int32_t from_value(int32_t val1, int32_t val2, uint8_t frac_bits)
+{
+	struct sensor_value val = {
+		.val1 = val1,
+		.val2 = val2,
+	};
+
+	return sensor_fixed_from_value(&val, frac_bits);
+}
+
+static void test_value(void)
+{
+	zassert_equal(from_value(0, 0, FRAC_BITS), 0, "Wrong zero");
+	zassert_equal(from_value(1, 0, FRAC_BITS), ONE, "Wrong integer");
+	zassert_equal(from_value(-1, 0, FRAC_BITS), -ONE, "Wrong integer");
+	zassert_equal(from_value(0, 500000, FRAC_BITS), ONE / 2, "Wrong fraction");
+	zassert_equal(from_value(0, -500000, FRAC_BITS), -ONE / 2, "Wrong fraction");
+	zassert_equal(from_value(-1, -250000, FRAC_BITS), -ONE - ONE / 4,
+		      "Wrong negative value");
+
+	/* Fractions below the resolution are truncated towards zero. */
+	zassert_equal(from_value(0, 15, FRAC_BITS), 0, "Fraction not truncated");
+	zassert_equal(from_value(0, 16, FRAC_BITS), 1, "Wrong resolution");
+	zassert_equal(from_value(0, -15, FRAC_BITS), 0, "Fraction not truncated");
+	zassert_equal(from_value(5, 999999, 0), 5, "Fraction not truncated");
+	zassert_equal(from_value(-5, -999999, 0), -5, "Fraction not truncated");
+}
+
+static void test_value_saturation(void)
+{
+	/* Limits of the Q15.16 format. */
+	zassert_equal(from_value(32767, 999999, FRAC_BITS), INT32_MAX, "Wrong maximum");
+	zassert_equal(from_value(-32768, 0, FRAC_BITS), INT32_MIN, "Wrong minimum");
+	zassert_equal(from_value(32767, 0, FRAC_BITS), 32767 * ONE, "Wrong value");
+
+	zassert_equal(from_value(32768, 0, FRAC_BITS), INT32_MAX, "Value not saturated");
+	zassert_equal(from_value(-32768, -999999, FRAC_BITS), INT32_MIN,
+		      "Value not saturated");
+	zassert_equal(from_value(-32769, 0, FRAC_BITS), INT32_MIN, "Value not saturated");
+
+	/* Intermediate results do not overflow. */
+	zassert_equal(from_value(INT32_MAX, 999999, SENSOR_FIXED_FRAC_BITS_MAX), INT32_MAX,
+		      "Value not saturated");
+	zassert_equal(from_value(INT32_MIN, -999999, SENSOR_FIXED_FRAC_BITS_MAX), INT32_MIN,
+		      "Value not saturated");
+	zassert_equal(from_value(1, 0, SENSOR_FIXED_FRAC_BITS_MAX),
+		      BIT(SENSOR_FIXED_FRAC_BITS_MAX), "Wrong value");
+	zassert_equal(from_value(2, 0, SENSOR_FIXED_FRAC_BITS_MAX), INT32_MAX,
+		      "Value not saturated");
+	zassert_equal(from_value(-2, 0, SENSOR_FIXED_FRAC_BITS_MAX), INT32_MIN,
+		      "Wrong minimum");
+}
+
+static void test_float(void)
+{
+	zassert_equal(sensor_fixed_from_float(0.0f, FRAC_BITS), 0, "Wrong zero");
+	zassert_equal(sensor_fixed_from_float(1.5f, FRAC_BITS), ONE + ONE / 2,
+		      "Wrong value");
+	zassert_equal(sensor_fixed_from_float(-0.25f, FRAC_BITS), -ONE / 4, "Wrong value");
+	zassert_equal(sensor_fixed_from_float(3.9f, 0), 3, "Fraction not truncated");
+	zassert_equal(sensor_fixed_from_float(-3.9f, 0), -3, "Fraction not truncated");
+}
+
+static void test_float_saturation(void)
+{
+	zassert_equal(sensor_fixed_from_float(32767.0f, FRAC_BITS), 32767 * ONE,
+		      "Wrong value");
+	zassert_equal(sensor_fixed_from_float(-32768.0f, FRAC_BITS), INT32_MIN,
+		      "Wrong minimum");
+
+	zassert_equal(sensor_fixed_from_float(32768.0f, FRAC_BITS), INT32_MAX,
+		      "Value not saturated");
+	zassert_equal(sensor_fixed_from_float(-32769.0f, FRAC_BITS), INT32_MIN,
+		      "Value not saturated");
+	zassert_equal(sensor_fixed_from_float(1e10f, FRAC_BITS), INT32_MAX,
+		      "Value not saturated");
+	zassert_equal(sensor_fixed_from_float(-1e10f, FRAC_BITS), INT32_MIN,
+		      "Value not saturated");
+
+	zassert_equal(sensor_fixed_from_float(1.0f, SENSOR_FIXED_FRAC_BITS_MAX),
+		      BIT(SENSOR_FIXED_FRAC_BITS_MAX), "Wrong value");
+	zassert_equal(sensor_fixed_from_float(2.0f, SENSOR_FIXED_FRAC_BITS_MAX), INT32_MAX,
+		      "Value not saturated");
+	zassert_equal(sensor_fixed_from_float(-2.0f, SENSOR_FIXED_FRAC_BITS_MAX), INT32_MIN,
+		      "Wrong minimum");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(caf_sensor_fixed,
+			 ztest_unit_test(test_value),
+			 ztest_unit_test(test_value_saturation),
+			 ztest_unit_test(test_float),
+			 ztest_unit_test(test_float_saturation)
+			 );
+
+	ztest_run_test_suite(caf_sensor_fixed);
+}
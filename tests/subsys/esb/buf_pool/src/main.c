@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+
+#include "esb_buf_pool.h"
+
+#define RX_FIFO_SIZE 8
+#define RX_SLOT_COUNT (RX_FIFO_SIZE + 1)
+
+static void test_pool_alloc_free(void)
+{
+	struct esb_buf_pool pool;
+	uint32_t used = 0;
+	int idx;
+
+	esb_buf_pool_init(&pool, RX_SLOT_COUNT);
+
+	for (int i = 0; i < RX_SLOT_COUNT; i++) {
+		idx = esb_buf_pool_alloc(&pool);
+		zassert_true((idx >= 0) && (idx < RX_SLOT_COUNT),
+			     "Invalid index %d", idx);
+		zassert_false(used & BIT(idx), "Index %d allocated twice", idx);
+		used |= BIT(idx);
+	}
+
+	zassert_true(esb_buf_pool_is_empty(&pool), "Pool not empty");
+	zassert_equal(esb_buf_pool_alloc(&pool), -1, "Allocated from empty pool");
+
+	zassert_false(esb_buf_pool_is_free(&pool, 5), "Allocated index free");
+
+	esb_buf_pool_free(&pool, 5);
+	zassert_true(esb_buf_pool_is_free(&pool, 5), "Freed index not free");
+	zassert_false(esb_buf_pool_is_empty(&pool), "Pool empty after free");
+	zassert_equal(esb_buf_pool_alloc(&pool), 5, "Freed index not reused");
+}
+
+static void test_pool_full_size(void)
+{
+	struct esb_buf_pool pool;
+
+	esb_buf_pool_init(&pool, ESB_BUF_POOL_MAX_SIZE);
+
+	for (int i = 0; i < ESB_BUF_POOL_MAX_SIZE; i++) {
+		zassert_equal(esb_buf_pool_alloc(&pool), i, "Unexpected index");
+	}
+
+	zassert_true(esb_buf_pool_is_empty(&pool), "Pool not empty");
+
+	esb_buf_pool_free(&pool, ESB_BUF_POOL_MAX_SIZE - 1);
+	zassert_equal(esb_buf_pool_alloc(&pool), ESB_BUF_POOL_MAX_SIZE - 1,
+		      "Last index not reused");
+}
+
+static void test_fifo_order_and_wrap(void)
+{
+	struct esb_buf_fifo fifo;
+	uint8_t next_in = 0;
+	uint8_t next_out = 0;
+
+	esb_buf_fifo_init(&fifo, RX_FIFO_SIZE);
+	zassert_equal(esb_buf_fifo_pop(&fifo), -1, "Popped from empty FIFO");
+
+	/* Run several times around the queue to exercise the wrap around. */
+	for (int round = 0; round < 3 * RX_FIFO_SIZE; round++) {
+		while (!esb_buf_fifo_is_full(&fifo)) {
+			zassert_true(esb_buf_fifo_push(&fifo, next_in++),
+				     "Push failed");
+		}
+
+		zassert_false(esb_buf_fifo_push(&fifo, 0xFF),
+			      "Pushed to full FIFO");
+
+		for (int i = 0; i < (round % RX_FIFO_SIZE) + 1; i++) {
+			zassert_equal(esb_buf_fifo_pop(&fifo), next_out++,
+				      "Wrong order");
+		}
+	}
+
+	while (fifo.count > 0) {
+		zassert_equal(esb_buf_fifo_pop(&fifo), next_out++,
+			      "Wrong order");
+	}
+
+	zassert_equal(next_in, next_out, "Lost elements");
+}
+
+/* Mirrors the RX path of the ESB module: the radio always owns one slot,
+ * received slots are queued and the application holds some of them.
+ */
+static void test_rx_slot_flow(void)
+{
+	struct esb_buf_pool pool;
+	struct esb_buf_fifo fifo;
+	int current;
+	int next;
+	int held[2];
+
+	esb_buf_pool_init(&pool, RX_SLOT_COUNT);
+	esb_buf_fifo_init(&fifo, RX_FIFO_SIZE);
+	current = esb_buf_pool_alloc(&pool);
+
+	/* Fill the FIFO, the radio keeps the last free slot. */
+	for (int i = 0; i < RX_FIFO_SIZE; i++) {
+		next = esb_buf_pool_alloc(&pool);
+		zassert_true(next >= 0, "No free slot");
+		zassert_true(esb_buf_fifo_push(&fifo, current), "Push failed");
+		current = next;
+	}
+
+	zassert_true(esb_buf_fifo_is_full(&fifo), "FIFO not full");
+	zassert_true(esb_buf_pool_is_empty(&pool), "Pool not empty");
+
+	/* The application takes two packets without releasing them. */
+	held[0] = esb_buf_fifo_pop(&fifo);
+	held[1] = esb_buf_fifo_pop(&fifo);
+
+	/* Only slots released by the application can be used. */
+	zassert_equal(esb_buf_pool_alloc(&pool), -1, "Held slot reused");
+
+	esb_buf_pool_free(&pool, held[1]);
+	next = esb_buf_pool_alloc(&pool);
+	zassert_equal(next, held[1], "Released slot not reused");
+	zassert_true(esb_buf_fifo_push(&fifo, current), "Push failed");
+	current = next;
+
+	/* Flush returns queued slots, the held one stays allocated. */
+	while ((next = esb_buf_fifo_pop(&fifo)) >= 0) {
+		esb_buf_pool_free(&pool, next);
+	}
+
+	for (int i = 0; i < RX_SLOT_COUNT - 2; i++) {
+		next = esb_buf_pool_alloc(&pool);
+		zassert_true((next >= 0) && (next != held[0]) &&
+			     (next != current), "Invalid slot %d", next);
+	}
+
+	zassert_true(esb_buf_pool_is_empty(&pool), "Pool not empty");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(esb_buf_pool,
+			 ztest_unit_test(test_pool_alloc_free),
+			 ztest_unit_test(test_pool_full_size),
+			 ztest_unit_test(test_fifo_order_and_wrap),
+			 ztest_unit_test(test_rx_slot_flow)
+			 );
+
+	ztest_run_test_suite(esb_buf_pool);
+}
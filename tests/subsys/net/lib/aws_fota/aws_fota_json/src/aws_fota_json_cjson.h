@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef AWS_FOTA_JSON_CJSON_H__
+#define AWS_FOTA_JSON_CJSON_H__
+
+#include <zephyr/types.h>
+
+/* Same as aws_fota_parse_DescribeJobExecution_rsp(), using cJSON. */
+int cjson_parse_DescribeJobExecution_rsp(const char *job_document,
+					 uint32_t payload_len,
+					 char *job_id_buf,
+					 char *hostname_buf,
+					 char *file_path_buf,
+					 int *execution_version_number);
+
+/* Same as aws_fota_parse_UpdateJobExecution_rsp(), using cJSON. */
+int cjson_parse_UpdateJobExecution_rsp(const char *update_rsp_document,
+					size_t payload_len, char *status_buf);
+
+#endif /* AWS_FOTA_JSON_CJSON_H__ */
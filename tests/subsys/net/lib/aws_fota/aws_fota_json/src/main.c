@@ -7,7 +7,79 @@
 #include <zephyr/types.h>
 #include <stdbool.h>
 #include <ztest.h>
+#include <stdio.h>
 #include <aws_fota_json.h>
+#include <net/aws_jobs.h>
+
+#include "aws_fota_json_cjson.h"
+
+#define JOB_EXECUTION(_job_id, _location) \
+	"{\"timestamp\":1559808907,\"execution\":{\"jobId\":\"" _job_id "\"," \
+	"\"status\":\"QUEUED\",\"queuedAt\":1559808906," \
+	"\"lastUpdatedAt\":1559808906,\"versionNumber\":1," \
+	"\"executionNumber\":1,\"jobDocument\":{\"operation\":" \
+	"\"app_fw_update\",\"fwversion\":\"2\",\"size\":181124," \
+	"\"location\":" _location "}}}"
+
+/* Documents that the parsing is compared with cJSON on, also after removing
+ * any one character of them.
+ */
+static const char *const documents[] = {
+	JOB_EXECUTION("9b5caac6-3e8a-45dd-9273-c1b995762f4a",
+		      "{\"protocol\":\"https:\",\"host\":\"bucket.amazonaws.com\","
+		      "\"path\":\"/update.bin?X-Amz-Algorithm=AWS4-HMAC-SHA256\"}"),
+	JOB_EXECUTION("job", "{\"host\":\"first\",\"host\":\"second\","
+		      "\"path\":\"p\"}"),
+	JOB_EXECUTION("job", "{\"host\":\"h\",\"path\":\"p\",\"extra\":"
+		      "[1, -25e3, true, false, null, {\"a\":[[]]}, {}]}"),
+	JOB_EXECUTION("job", "[\"host\",\"path\"]"),
+	JOB_EXECUTION("job", "{\"host\":1,\"path\":\"p\"}"),
+	JOB_EXECUTION("a-job-id-that-is-longer-than-the-sixty-four-characters-"
+		      "allowed-by-aws", "{\"host\":\"h\",\"path\":\"p\"}"),
+	" \r\n\t{ \"execution\" : { \"versionNumber\" : 12 , \"jobId\" : \"j\" ,"
+	" \"jobDocument\" : { \"location\" : { \"path\" : \"p\" ,"
+	" \"host\" : \"h\" } } } } trailing",
+	"{\"execution\":{\"versionNumber\":-7e1,\"jobId\":\"j\",\"jobDocument\":"
+	"{\"location\":{\"path\":\"p\",\"host\":\"h\"}}}}",
+	"{\"execution\":{\"versionNumber\":\"1\",\"jobId\":\"j\",\"jobDocument\":"
+	"{\"location\":{\"path\":\"p\",\"host\":\"h\"}}}}",
+	"{\"execution\":null}",
+	"{\"execution\":{}}",
+	"[{\"execution\":{}}]",
+	"\"execution\"",
+	"{\"status\":\"IN_PROGRESS\",\"statusDetails\":{\"nextState\":"
+	"\"download_firmware\"},\"expectedVersion\":\"1\",\"clientToken\":\"\"}",
+	"{\"status\":[\"FAILED\"]}",
+	"{\"timestamp\":1559808907}",
+	"{\"a\":1,}",
+	"{\"a\" 1}",
+	"{\"a\":[1,]}",
+	"{\"a\":[1}",
+	"{\"a\":tru}",
+	"{\"a\":-}",
+	"{1:1}",
+	"",
+};
+
+/* Documents that are only compared as they are and truncated. cJSON decodes
+ * invalid \u escapes as null characters and accepts numbers like "1." instead
+ * of rejecting them, so removing characters may give different results.
+ */
+static const char *const documents_unmodified[] = {
+	JOB_EXECUTION("job\\u002d1",
+		      "{\"host\":\"bucket\\/host\",\"path\":"
+		      "\"\\\"\\\\\\b\\f\\n\\r\\t\\u00e9\\u20ac\\ud83d\\ude00\"}"),
+	JOB_EXECUTION("job", "{\"host\":\"first\",\"path\":\"p\","
+		      "\"ho\\u0073t\":\"escaped\"}"),
+	JOB_EXECUTION("job", "{\"ho\\u0073t\":\"escaped\",\"path\":\"p\","
+		      "\"host\":\"second\"}"),
+	"{\"execution\":{\"versionNumber\":12.9,\"jobId\":\"j\",\"jobDocument\":"
+	"{\"location\":{\"path\":\"p\",\"host\":\"h\"}}}}",
+	"{\"status\":\"\\u0053UCCEEDED\"}",
+	"{\"a\":\"\\x\"}",
+	"{\"a\":\"\\ud83d\"}",
+	"{\"a\":\"\\ude00\"}",
+};
 
 static void test_parse_job_execution(void)
 {
@@ -155,6 +227,38 @@ static void test_timestamp_only(void)
 	zassert_equal(ret, 0, "Timestamp decoded correctly");
 }
 
+/* The request for the next job and its rejected response are received on the
+ * same subscription as the accepted response, they hold no job.
+ */
+static void test_get_next_request_and_rejected(void)
+{
+	int ret;
+	char job_id[100];
+	char hostname[100];
+	char file_path[100];
+	char request[] = "{\"clientToken\": \"\"}";
+	char rejected[] = "{\"code\":\"InvalidRequest\","
+			  "\"message\":\"Request is invalid\","
+			  "\"clientToken\":\"\",\"timestamp\":1559808907}";
+	int version_number;
+
+	ret = aws_fota_parse_DescribeJobExecution_rsp(request,
+						      sizeof(request) - 1,
+						      job_id,
+						      hostname,
+						      file_path,
+						      &version_number);
+	zassert_equal(ret, 0, "Job decoded from the request");
+
+	ret = aws_fota_parse_DescribeJobExecution_rsp(rejected,
+						      sizeof(rejected) - 1,
+						      job_id,
+						      hostname,
+						      file_path,
+						      &version_number);
+	zassert_equal(ret, 0, "Job decoded from the rejected response");
+}
+
 static void test_update_job_exec_rsp_minimal(void)
 {
 	char encoded[] = "{\"timestamp\":4096,\"clientToken\":\"token\"}";
@@ -182,6 +286,157 @@ static void test_update_job_exec_rsp(void)
 }
 
 
+static void test_parse_job_execution_escapes(void)
+{
+	int ret;
+	int version_number;
+	char job_id[AWS_JOBS_JOB_ID_MAX_LEN];
+	char hostname[100];
+	char file_path[100];
+
+	ret = aws_fota_parse_DescribeJobExecution_rsp(documents_unmodified[0],
+						      strlen(documents_unmodified[0]),
+						      job_id, hostname,
+						      file_path,
+						      &version_number);
+	zassert_equal(ret, 1, NULL);
+	zassert_true(!strcmp(job_id, "job-1"), NULL);
+	zassert_true(!strcmp(hostname, "bucket/host"), NULL);
+	zassert_true(!strcmp(file_path, "\"\\\b\f\n\r\t\xc3\xa9\xe2\x82\xac"
+				      "\xf0\x9f\x98\x80"), NULL);
+}
+
+static void test_parse_job_execution_payload_len(void)
+{
+	int ret;
+	int version_number;
+	char job_id[AWS_JOBS_JOB_ID_MAX_LEN];
+	char hostname[100];
+	char file_path[100];
+
+	/* The document does not need to be null-terminated, and only
+	 * payload_len characters of it are parsed.
+	 */
+	ret = aws_fota_parse_DescribeJobExecution_rsp(documents[0],
+						      strlen(documents[0]) - 1,
+						      job_id, hostname,
+						      file_path,
+						      &version_number);
+	zassert_equal(ret, -ENODATA, NULL);
+}
+
+static void test_parse_job_execution_too_many_tokens(void)
+{
+	int ret;
+	int version_number;
+	char job_id[AWS_JOBS_JOB_ID_MAX_LEN];
+	char hostname[100];
+	char file_path[100];
+	char encoded[CONFIG_AWS_FOTA_JSON_MAX_TOKENS * 2 + 16];
+	size_t len;
+
+	/* One token for the object, one for the key and one for the array. */
+	len = snprintf(encoded, sizeof(encoded), "{\"a\":[");
+	for (size_t i = 0; i < CONFIG_AWS_FOTA_JSON_MAX_TOKENS - 3; i++) {
+		len += snprintf(&encoded[len], sizeof(encoded) - len, "1,");
+	}
+
+	len += snprintf(&encoded[len], sizeof(encoded) - len, "1]}");
+
+	ret = aws_fota_parse_DescribeJobExecution_rsp(encoded, len, job_id,
+						      hostname, file_path,
+						      &version_number);
+	zassert_equal(ret, -ENOMEM, NULL);
+
+	/* Without the last array element, the tokens fit. */
+	memcpy(&encoded[len - 4], "]}", 3);
+	len -= 2;
+
+	ret = aws_fota_parse_DescribeJobExecution_rsp(encoded, len, job_id,
+						      hostname, file_path,
+						      &version_number);
+	zassert_equal(ret, 0, NULL);
+}
+
+static void parse_compare(const char *encoded, size_t len)
+{
+	/* Too large for the stack of the test. */
+	static char job_id[AWS_JOBS_JOB_ID_MAX_LEN];
+	static char job_id_cjson[AWS_JOBS_JOB_ID_MAX_LEN];
+	static char hostname[CONFIG_AWS_FOTA_HOSTNAME_MAX_LEN];
+	static char hostname_cjson[CONFIG_AWS_FOTA_HOSTNAME_MAX_LEN];
+	static char file_path[CONFIG_AWS_FOTA_FILE_PATH_MAX_LEN];
+	static char file_path_cjson[CONFIG_AWS_FOTA_FILE_PATH_MAX_LEN];
+	char doc[len + 1];
+	char status[STATUS_MAX_LEN];
+	char status_cjson[STATUS_MAX_LEN];
+	int version_number;
+	int version_number_cjson;
+	int ret;
+	int ret_cjson;
+
+	/* cJSON needs a null-terminated document. */
+	memcpy(doc, encoded, len);
+	doc[len] = '\0';
+
+	ret = aws_fota_parse_DescribeJobExecution_rsp(doc, len, job_id,
+						      hostname, file_path,
+						      &version_number);
+	ret_cjson = cjson_parse_DescribeJobExecution_rsp(doc, len,
+							 job_id_cjson,
+							 hostname_cjson,
+							 file_path_cjson,
+							 &version_number_cjson);
+	zassert_equal(ret, ret_cjson, "Different result %d != %d for %s", ret,
+		      ret_cjson, doc);
+
+	if (ret == 1) {
+		zassert_true(!strcmp(job_id, job_id_cjson), "%s", doc);
+		zassert_true(!strcmp(hostname, hostname_cjson), "%s", doc);
+		zassert_true(!strcmp(file_path, file_path_cjson), "%s", doc);
+		zassert_equal(version_number, version_number_cjson, "%s", doc);
+	}
+
+	ret = aws_fota_parse_UpdateJobExecution_rsp(doc, len, status);
+	ret_cjson = cjson_parse_UpdateJobExecution_rsp(doc, len, status_cjson);
+	zassert_equal(ret, ret_cjson, "Different result %d != %d for %s", ret,
+		      ret_cjson, doc);
+
+	if (ret == 0) {
+		zassert_true(!strcmp(status, status_cjson), "%s", doc);
+	}
+}
+
+static void parse_compare_truncated(const char *encoded)
+{
+	size_t len = strlen(encoded);
+
+	for (size_t i = 0; i <= len; i++) {
+		parse_compare(encoded, i);
+	}
+}
+
+static void test_parse_compare_cjson(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(documents); i++) {
+		const char *encoded = documents[i];
+		size_t len = strlen(encoded);
+		char modified[len + 1];
+
+		parse_compare_truncated(encoded);
+
+		for (size_t j = 0; j < len; j++) {
+			memcpy(modified, encoded, j);
+			memcpy(&modified[j], &encoded[j + 1], len - j);
+			parse_compare(modified, len - 1);
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(documents_unmodified); i++) {
+		parse_compare_truncated(documents_unmodified[i]);
+	}
+}
+
 void test_main(void)
 {
 	ztest_test_suite(lib_json_test,
@@ -193,8 +448,13 @@ void test_main(void)
 			 ztest_unit_test(test_update_job_longer_than_max),
 			 ztest_unit_test(test_timestamp_only),
 			 ztest_unit_test(test_parse_malformed_job_execution),
+			 ztest_unit_test(test_get_next_request_and_rejected),
 			 ztest_unit_test(test_update_job_exec_rsp_minimal),
-			 ztest_unit_test(test_update_job_exec_rsp)
+			 ztest_unit_test(test_update_job_exec_rsp),
+			 ztest_unit_test(test_parse_job_execution_escapes),
+			 ztest_unit_test(test_parse_job_execution_payload_len),
+			 ztest_unit_test(test_parse_job_execution_too_many_tokens),
+			 ztest_unit_test(test_parse_compare_cjson)
 			 );
 
 	ztest_run_test_suite(lib_json_test);
@@ -6,6 +6,7 @@
 #include <string.h>
 #include <zephyr/types.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <ztest.h>
 #include <aws_jobs.h>
 #include <net/mqtt.h>
@@ -108,6 +109,299 @@ static void test_aws_jobs_subscribe_topic_get(void)
 	zassert_true(strcmp(expected, topic_buf) == 0, "Should be equal");
 }
 
+static const char *const client_ids[] = {
+	"client_id_123",
+	"c",
+	"nrf-352656100367872",
+};
+
+static const char *const job_ids[] = {
+	"job_id",
+	"$next",
+	"9b5caac6-3e8a-45dd-9273-c1b995762f4a",
+	"j",
+};
+
+static void test_aws_jobs_create_topic_snprintf(void)
+{
+	char topic_buf[AWS_JOBS_TOPIC_MAX_LEN];
+	char expected[AWS_JOBS_TOPIC_MAX_LEN];
+	int ret;
+
+	/* Compare with the topics formatted the way they used to be. */
+	for (size_t i = 0; i < ARRAY_SIZE(client_ids); i++) {
+		struct mqtt_client client = {.client_id.utf8 = client_ids[i]};
+
+		ret = aws_jobs_create_topic_notify_next(&client, topic_buf);
+		zassert_equal(ret, 0, "Should be 0");
+		snprintf(expected, sizeof(expected),
+			 "$aws/things/%s/jobs/notify-next", client_ids[i]);
+		zassert_true(strcmp(expected, topic_buf) == 0, "Should be equal");
+
+		ret = aws_jobs_create_topic_notify(&client, topic_buf);
+		zassert_equal(ret, 0, "Should be 0");
+		snprintf(expected, sizeof(expected),
+			 "$aws/things/%s/jobs/notify", client_ids[i]);
+		zassert_true(strcmp(expected, topic_buf) == 0, "Should be equal");
+
+		for (size_t j = 0; j < ARRAY_SIZE(job_ids); j++) {
+			ret = aws_jobs_create_topic_get(&client, job_ids[j],
+							topic_buf);
+			zassert_equal(ret, 0, "Should be 0");
+			snprintf(expected, sizeof(expected),
+				 "$aws/things/%s/jobs/%s/get/#", client_ids[i],
+				 job_ids[j]);
+			zassert_true(strcmp(expected, topic_buf) == 0,
+				     "Should be equal");
+		}
+
+		ret = aws_jobs_create_topic_get(&client, "", topic_buf);
+		zassert_equal(ret, 0, "Should be 0");
+		snprintf(expected, sizeof(expected),
+			 "$aws/things/%s/jobs/get/#", client_ids[i]);
+		zassert_true(strcmp(expected, topic_buf) == 0, "Should be equal");
+	}
+}
+
+static void test_aws_jobs_create_topic_too_long(void)
+{
+	char client_id[CONFIG_CLIENT_ID_MAX_LEN + 1];
+	char job_id[AWS_JOBS_JOB_ID_MAX_LEN];
+	char topic_buf[AWS_JOBS_TOPIC_MAX_LEN];
+	struct mqtt_client client = {.client_id.utf8 = client_id};
+	int ret;
+
+	memset(client_id, 'c', sizeof(client_id) - 1);
+	client_id[sizeof(client_id) - 1] = '\0';
+	memset(job_id, 'j', sizeof(job_id) - 1);
+	job_id[sizeof(job_id) - 1] = '\0';
+
+	ret = aws_jobs_create_topic_get(&client, job_id, topic_buf);
+	zassert_equal(ret, -ENOMEM, "Should not fit");
+
+	ret = aws_jobs_create_topic_notify_next(&client, topic_buf);
+	zassert_equal(ret, 0, "Should be 0");
+}
+
+static void test_aws_jobs_topics_init(void)
+{
+	char client_id[CONFIG_CLIENT_ID_MAX_LEN + 2];
+	struct aws_jobs_topics topics;
+	int ret;
+
+	ret = aws_jobs_topics_init(NULL, "client_id_123");
+	zassert_equal(ret, -EINVAL, "Should be -EINVAL");
+
+	ret = aws_jobs_topics_init(&topics, NULL);
+	zassert_equal(ret, -EINVAL, "Should be -EINVAL");
+
+	ret = aws_jobs_topics_init(&topics, "client_id_123");
+	zassert_equal(ret, 0, "Should be 0");
+	zassert_true(strcmp(topics.prefix, "$aws/things/client_id_123/jobs/") == 0,
+		     "Should be equal");
+	zassert_equal(topics.prefix_len, strlen(topics.prefix), "Should be equal");
+
+	memset(client_id, 'c', sizeof(client_id) - 1);
+	client_id[sizeof(client_id) - 1] = '\0';
+
+	ret = aws_jobs_topics_init(&topics, client_id);
+	zassert_equal(ret, -ENOMEM, "Should not fit");
+
+	client_id[sizeof(client_id) - 2] = '\0';
+
+	ret = aws_jobs_topics_init(&topics, client_id);
+	zassert_equal(ret, 0, "Should fit");
+}
+
+static enum aws_jobs_topic_type type_get(const struct aws_jobs_topics *topics,
+					 const char *topic)
+{
+	return aws_jobs_topic_type_get(topics, topic, strlen(topic), NULL, NULL);
+}
+
+static void test_aws_jobs_topic_type_get(void)
+{
+	struct aws_jobs_topics topics;
+	const char *job_id = NULL;
+	size_t job_id_len = 0;
+	const char *topic = "$aws/things/nrf-id/jobs/123/update/accepted";
+
+	zassert_equal(aws_jobs_topics_init(&topics, "nrf-id"), 0, "Should be 0");
+
+	zassert_equal(aws_jobs_topic_type_get(&topics, topic, strlen(topic),
+					      &job_id, &job_id_len),
+		      AWS_JOBS_TOPIC_UPDATE_ACCEPTED, "Should be update accepted");
+	zassert_equal(job_id_len, 3, "Wrong job ID length");
+	zassert_true(strncmp(job_id, "123", job_id_len) == 0, "Wrong job ID");
+
+	/* The get request is received back on the subscription to its topic. */
+	topic = "$aws/things/nrf-id/jobs/$next/get";
+	zassert_equal(aws_jobs_topic_type_get(&topics, topic, strlen(topic),
+					      &job_id, &job_id_len),
+		      AWS_JOBS_TOPIC_GET, "Should be get");
+	zassert_equal(job_id_len, 5, "Wrong job ID length");
+	zassert_true(strncmp(job_id, "$next", job_id_len) == 0, "Wrong job ID");
+
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/notify"),
+		      AWS_JOBS_TOPIC_NOTIFY, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/notify-next"),
+		      AWS_JOBS_TOPIC_NOTIFY_NEXT, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/$next/get/accepted"),
+		      AWS_JOBS_TOPIC_GET_ACCEPTED, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/$next/get/rejected"),
+		      AWS_JOBS_TOPIC_GET_REJECTED, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/1/update/rejected"),
+		      AWS_JOBS_TOPIC_UPDATE_REJECTED, NULL);
+
+	/* Topics of other clients, other services and malformed topics. */
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id2/jobs/notify"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/shadow/update/accepted"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/notify-nex"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/notify/"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/get/accepted"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/get"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs//get"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/1/2/get"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/1/update"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs//get/accepted"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/1/2/get/accepted"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/1/get/accepte"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/1/get/#"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/1/delete/accepted"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/1/update/accepted/"),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+	zassert_equal(type_get(&topics, "$aws/things/nrf-id/jobs/"
+				"01234567890123456789012345678901234567890123456789"
+				"012345678901234/update/accepted"),
+		      AWS_JOBS_TOPIC_UNKNOWN, "Job ID is too long");
+	zassert_equal(aws_jobs_topic_type_get(NULL, topic, strlen(topic), NULL, NULL),
+		      AWS_JOBS_TOPIC_UNKNOWN, NULL);
+}
+
+/* Classify a topic by comparing it with each subscribed topic, the way it used
+ * to be done.
+ */
+static enum aws_jobs_topic_type cmp_type_get(struct mqtt_client *client,
+					     const char *job_id,
+					     const char *topic)
+{
+	char sub[AWS_JOBS_TOPIC_MAX_LEN];
+	size_t len = strlen(topic);
+
+	aws_jobs_create_topic_notify_next(client, sub);
+	if (strcmp(sub, topic) == 0) {
+		return AWS_JOBS_TOPIC_NOTIFY_NEXT;
+	}
+
+	aws_jobs_create_topic_notify(client, sub);
+	if (strcmp(sub, topic) == 0) {
+		return AWS_JOBS_TOPIC_NOTIFY;
+	}
+
+	aws_jobs_create_topic_get(client, job_id, sub);
+	if (strcmp(sub, topic) == 0) {
+		return AWS_JOBS_TOPIC_GET;
+	} else if (aws_jobs_cmp(sub, topic, len, "accepted")) {
+		return AWS_JOBS_TOPIC_GET_ACCEPTED;
+	} else if (aws_jobs_cmp(sub, topic, len, "rejected")) {
+		return AWS_JOBS_TOPIC_GET_REJECTED;
+	}
+
+	aws_jobs_subscribe_topic_update(client, job_id, sub);
+	if (aws_jobs_cmp(sub, topic, len, "accepted")) {
+		return AWS_JOBS_TOPIC_UPDATE_ACCEPTED;
+	} else if (aws_jobs_cmp(sub, topic, len, "rejected")) {
+		return AWS_JOBS_TOPIC_UPDATE_REJECTED;
+	}
+
+	return AWS_JOBS_TOPIC_UNKNOWN;
+}
+
+static void test_aws_jobs_topic_type_get_cmp(void)
+{
+	static const char *const topic_names[] = {
+		"notify", "notify-next", "get", "get/accepted", "get/rejected",
+		"update/accepted", "update/rejected",
+	};
+	struct aws_jobs_topics topics;
+	char topic[AWS_JOBS_TOPIC_MAX_LEN];
+
+	for (size_t i = 0; i < ARRAY_SIZE(client_ids); i++) {
+		struct mqtt_client client = {.client_id.utf8 = client_ids[i]};
+
+		zassert_equal(aws_jobs_topics_init(&topics, client_ids[i]), 0,
+			      "Should be 0");
+
+		for (size_t j = 0; j < ARRAY_SIZE(job_ids); j++) {
+			for (size_t k = 0; k < ARRAY_SIZE(topic_names); k++) {
+				const char *job_id = NULL;
+				size_t job_id_len = 0;
+				enum aws_jobs_topic_type type;
+				enum aws_jobs_topic_type expected;
+
+				if (k < 2) {
+					snprintf(topic, sizeof(topic),
+						 "$aws/things/%s/jobs/%s",
+						 client_ids[i], topic_names[k]);
+				} else {
+					snprintf(topic, sizeof(topic),
+						 "$aws/things/%s/jobs/%s/%s",
+						 client_ids[i], job_ids[j],
+						 topic_names[k]);
+				}
+
+				type = aws_jobs_topic_type_get(&topics, topic,
+							       strlen(topic),
+							       &job_id,
+							       &job_id_len);
+				expected = cmp_type_get(&client, job_ids[j],
+							topic);
+				zassert_equal(type, expected,
+					      "Different type for %s", topic);
+
+				if (k >= 2) {
+					zassert_equal(job_id_len,
+						      strlen(job_ids[j]),
+						      "Wrong job ID length");
+					zassert_true(strncmp(job_id, job_ids[j],
+							     job_id_len) == 0,
+						     "Wrong job ID");
+				}
+
+				/* The topic is not one of the other clients. */
+				for (size_t l = 0; l < ARRAY_SIZE(client_ids); l++) {
+					struct aws_jobs_topics other;
+
+					if (l == i) {
+						continue;
+					}
+
+					aws_jobs_topics_init(&other, client_ids[l]);
+					zassert_equal(type_get(&other, topic),
+						      AWS_JOBS_TOPIC_UNKNOWN,
+						      "Should not match");
+				}
+			}
+		}
+	}
+}
+
 void test_main(void)
 {
 	ztest_test_suite(aws_jobs_test,
@@ -116,7 +410,12 @@ void test_main(void)
 			 ztest_unit_test(test_aws_jobs_cmp__no_suffix),
 			 ztest_unit_test(test_aws_jobs_cmp__suffix),
 			 ztest_unit_test(test_aws_jobs_subscribe_topic_update),
-			 ztest_unit_test(test_aws_jobs_subscribe_topic_get)
+			 ztest_unit_test(test_aws_jobs_subscribe_topic_get),
+			 ztest_unit_test(test_aws_jobs_create_topic_snprintf),
+			 ztest_unit_test(test_aws_jobs_create_topic_too_long),
+			 ztest_unit_test(test_aws_jobs_topics_init),
+			 ztest_unit_test(test_aws_jobs_topic_type_get),
+			 ztest_unit_test(test_aws_jobs_topic_type_get_cmp)
 			 );
 	ztest_run_test_suite(aws_jobs_test);
 }
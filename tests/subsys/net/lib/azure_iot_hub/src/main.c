@@ -278,6 +278,215 @@ static void test_topic_prop_bag_too_long(void)
 		      "Incorrect property bag count");
 }
 
+static bool str_equal(const struct topic_parser_str *str, const char *expected)
+{
+	return (str->len == strlen(expected)) &&
+	       (memcmp(str->ptr, expected, str->len) == 0);
+}
+
+static void test_topic_tokenize(void)
+{
+	int err;
+	const char *topic = "$iothub/methods/POST/my_method/?$rid=387&flag&empty=";
+	struct topic_parser_tokens tokens;
+	struct topic_parser_prop_bag_iter iter;
+	struct topic_parser_str key, value;
+
+	err = azure_iot_hub_topic_tokenize(topic, strlen(topic), &tokens);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(tokens.type, TOPIC_TYPE_DIRECT_METHOD,
+		      "Incorrect topic type");
+	zassert_true(str_equal(&tokens.value, "my_method"), NULL);
+	zassert_true(tokens.value.ptr > topic, "Value not in topic buffer");
+
+	azure_iot_hub_prop_bag_iter_init(&iter, &tokens);
+
+	zassert_true(azure_iot_hub_prop_bag_iter_next(&iter, &key, &value), NULL);
+	zassert_true(str_equal(&key, "$rid"), NULL);
+	zassert_true(str_equal(&value, "387"), NULL);
+
+	zassert_true(azure_iot_hub_prop_bag_iter_next(&iter, &key, &value), NULL);
+	zassert_true(str_equal(&key, "flag"), NULL);
+	zassert_is_null(value.ptr, "Value of property bag without '='");
+
+	zassert_true(azure_iot_hub_prop_bag_iter_next(&iter, &key, &value), NULL);
+	zassert_true(str_equal(&key, "empty"), NULL);
+	zassert_not_null(value.ptr, NULL);
+	zassert_equal(value.len, 0, NULL);
+
+	zassert_false(azure_iot_hub_prop_bag_iter_next(&iter, &key, &value),
+		      NULL);
+}
+
+static void test_topic_tokenize_malformed(void)
+{
+	const char *topics[] = {
+		"$iothub/methods/POST/my_method",
+		"$iothub/methods/POST//?$rid=1",
+		"devices/my-device/messages/events/",
+		"devices/my-device",
+	};
+	struct topic_parser_tokens tokens;
+
+	for (size_t i = 0; i < ARRAY_SIZE(topics); i++) {
+		zassert_equal(azure_iot_hub_topic_tokenize(topics[i],
+							   strlen(topics[i]),
+							   &tokens),
+			      -EFAULT, "Malformed topic %zu accepted", i);
+	}
+
+	zassert_equal(azure_iot_hub_topic_tokenize("", 0, &tokens), -EINVAL,
+		      NULL);
+
+	/* A topic shorter than a prefix does not match it. */
+	zassert_equal(topic_type_get("devices", strlen("devices")),
+		      TOPIC_TYPE_UNEXPECTED, "Incorrect topic type");
+}
+
+static void test_topic_prop_bag_iter_unlimited(void)
+{
+	const char *topic =
+		"devices/my-device/messages/devicebound/"
+		"a=1&b=2&&c=3&d=4&e=5&f=6&g=7&h=8&$rid=9";
+	struct topic_parser_tokens tokens;
+	struct topic_parser_prop_bag_iter iter;
+	struct topic_parser_str key, value;
+	size_t count = 0;
+
+	zassert_equal(azure_iot_hub_topic_tokenize(topic, strlen(topic),
+						   &tokens), 0, NULL);
+	zassert_true(str_equal(&tokens.value, "my-device"), NULL);
+
+	azure_iot_hub_prop_bag_iter_init(&iter, &tokens);
+
+	while (azure_iot_hub_prop_bag_iter_next(&iter, &key, &value)) {
+		count++;
+	}
+
+	zassert_true(count > TOPIC_PROP_BAG_COUNT, NULL);
+	zassert_equal(count, 9, "Incorrect property bag count");
+	zassert_true(str_equal(&key, "$rid"), NULL);
+	zassert_true(str_equal(&value, "9"), NULL);
+}
+
+#define FUZZ_ITERATIONS		20000
+#define FUZZ_TOPIC_MAX_LEN	96
+
+static const char * const fuzz_seeds[] = {
+	"devices/my-device/messages/devicebound/%24.mid=4&key1&key2=&key3=v",
+	"$iothub/twin/PATCH/properties/desired/?$version=9",
+	"$iothub/twin/res/200/?$rid=738&$version=135",
+	"$dps/registrations/res/204/?$rid=59765&retry-after=3",
+	"$iothub/methods/POST/my_method/?$rid=387",
+};
+
+static uint32_t fuzz_state = 0x12345678;
+
+static uint32_t fuzz_rand(void)
+{
+	/* xorshift32 */
+	fuzz_state ^= fuzz_state << 13;
+	fuzz_state ^= fuzz_state >> 17;
+	fuzz_state ^= fuzz_state << 5;
+
+	return fuzz_state;
+}
+
+static bool str_in_buf(const struct topic_parser_str *str, const char *buf,
+		       size_t len)
+{
+	if (str->ptr == NULL) {
+		return str->len == 0;
+	}
+
+	return (str->ptr >= buf) && (str->ptr + str->len <= buf + len);
+}
+
+/* Mutate valid topics and check that the tokens stay within the topic
+ * buffer, that the buffer is not modified, and that the topic parser does
+ * not fail in unexpected ways.
+ */
+static void test_topic_fuzz(void)
+{
+	static char topic[FUZZ_TOPIC_MAX_LEN];
+	static char copy[FUZZ_TOPIC_MAX_LEN];
+	static const char alphabet[] = "/?&=$0a";
+
+	for (size_t i = 0; i < FUZZ_ITERATIONS; i++) {
+		const char *seed = fuzz_seeds[fuzz_rand() % ARRAY_SIZE(fuzz_seeds)];
+		size_t len = fuzz_rand() % (strlen(seed) + 1);
+		size_t mutations = fuzz_rand() % 4;
+		struct topic_parser_tokens tokens;
+		struct topic_parser_prop_bag_iter iter;
+		struct topic_parser_str key, value;
+		struct topic_parser_data data = {
+			.topic = topic,
+			.type = TOPIC_TYPE_UNKNOWN,
+		};
+		size_t count = 0;
+		int err;
+
+		memcpy(topic, seed, len);
+
+		for (size_t j = 0; (j < mutations) && (len > 0); j++) {
+			uint32_t r = fuzz_rand();
+
+			topic[r % len] = (r & BIT(31)) ?
+				alphabet[(r >> 8) % (sizeof(alphabet) - 1)] :
+				(char)(r >> 8);
+		}
+
+		memcpy(copy, topic, len);
+
+		err = azure_iot_hub_topic_tokenize(topic, len, &tokens);
+		zassert_true((err == 0) || (err == -EFAULT) || (err == -EINVAL),
+			     "Unexpected error %d", err);
+		zassert_true(str_in_buf(&tokens.value, topic, len), NULL);
+		zassert_true(str_in_buf(&tokens.prop_bags, topic, len), NULL);
+
+		azure_iot_hub_prop_bag_iter_init(&iter, &tokens);
+
+		while (azure_iot_hub_prop_bag_iter_next(&iter, &key, &value)) {
+			zassert_true(str_in_buf(&key, topic, len), NULL);
+			zassert_true(str_in_buf(&value, topic, len), NULL);
+			zassert_true(++count <= len, "Iterator does not end");
+		}
+
+		data.topic_len = len;
+		err = azure_iot_hub_topic_parse(&data);
+		zassert_true((err == 0) || (err == -EFAULT) ||
+			     (err == -EINVAL) || (err == -ENOMEM),
+			     "Unexpected error %d", err);
+		zassert_equal(data.type, tokens.type, "Topic types differ");
+		zassert_true(data.prop_bag_count <= MIN(count, TOPIC_PROP_BAG_COUNT),
+			     NULL);
+
+		zassert_mem_equal(topic, copy, len, "Topic buffer modified");
+	}
+}
+
+#define THROUGHPUT_ITERATIONS	10000
+
+static void test_topic_parse_throughput(void)
+{
+	struct topic_parser_data data = {
+		.topic = fuzz_seeds[0],
+		.topic_len = strlen(fuzz_seeds[0]),
+	};
+	int64_t start = k_uptime_get();
+	int64_t elapsed;
+
+	for (size_t i = 0; i < THROUGHPUT_ITERATIONS; i++) {
+		data.type = TOPIC_TYPE_UNKNOWN;
+		zassert_equal(azure_iot_hub_topic_parse(&data), 0, NULL);
+	}
+
+	elapsed = k_uptime_get() - start;
+
+	TC_PRINT("Parsed %d topics in %lld ms\n", THROUGHPUT_ITERATIONS,
+		 elapsed);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(azure_iot_hub_topic,
@@ -291,7 +500,12 @@ void test_main(void)
 			 ztest_unit_test(test_topic_add_prop_bags),
 			 ztest_unit_test(test_topic_add_prop_bags_reverse),
 			 ztest_unit_test(test_topic_parse_long),
-			 ztest_unit_test(test_topic_prop_bag_too_long)
+			 ztest_unit_test(test_topic_prop_bag_too_long),
+			 ztest_unit_test(test_topic_tokenize),
+			 ztest_unit_test(test_topic_tokenize_malformed),
+			 ztest_unit_test(test_topic_prop_bag_iter_unlimited),
+			 ztest_unit_test(test_topic_fuzz),
+			 ztest_unit_test(test_topic_parse_throughput)
 			 );
 	ztest_run_test_suite(azure_iot_hub_topic);
 }
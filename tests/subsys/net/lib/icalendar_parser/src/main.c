@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+#include <string.h>
+#include <net/icalendar_parser.h>
+
+#define EVT_MAX			8
+#define LARGE_CALENDAR_EVENTS	1000
+
+static const char calendar[] =
+	"BEGIN:VCALENDAR\r\n"
+	"VERSION:2.0\r\n"
+	"PRODID:-//Test//Test//EN\r\n"
+	"BEGIN:VTIMEZONE\r\n"
+	"TZID:Europe/Oslo\r\n"
+	"BEGIN:STANDARD\r\n"
+	"DTSTART:19701025T030000\r\n"
+	"END:STANDARD\r\n"
+	"END:VTIMEZONE\r\n"
+	"BEGIN:VEVENT\r\n"
+	"DTSTART;TZID=Europe/Oslo:20210615T090000\r\n"
+	"DTEND;TZID=\"Europe/Oslo:x\":20210615T100000\r\n"
+	"SUMMARY:Weekly meeting\r\n"
+	"LOCATION:Room 1\r\n"
+	"DESCRIPTION:A long description that is folded over\r\n"
+	" several lines\r\n"
+	"\t of the calendar.\r\n"
+	"BEGIN:VALARM\r\n"
+	"DESCRIPTION:Reminder\r\n"
+	"END:VALARM\r\n"
+	"END:VEVENT\r\n"
+	"BEGIN:VTODO\r\n"
+	"SUMMARY:Todo\r\n"
+	"END:VTODO\r\n"
+	"BEGIN:VEVENT\r\n"
+	"SUMMARY;LANGUAGE=en:Parameter\r\n"
+	"LOCATION:Not parsed after the error\r\n"
+	"END:VEVENT\r\n"
+	"BEGIN:VEVENT\r\n"
+	"summary:Lower case\r\n"
+	"LOCATION:A location that does not fit in the location buffer of the "
+	"event\r\n"
+	"END:VEVENT\r\n"
+	"END:VCALENDAR\r\n";
+
+static struct icalendar_parser ical;
+static struct ical_parser_evt evts[EVT_MAX];
+static size_t evt_count;
+static size_t evt_total;
+static bool stop;
+
+static int ical_callback(const struct ical_parser_evt *evt)
+{
+	if (evt_count < EVT_MAX) {
+		evts[evt_count++] = *evt;
+	}
+
+	evt_total++;
+
+	return stop ? 1 : 0;
+}
+
+static void parser_init(void)
+{
+	int err = ical_parser_init(&ical, ical_callback);
+
+	zassert_equal(err, 0, "Failed to initialize parser: %d", err);
+
+	memset(evts, 0, sizeof(evts));
+	evt_count = 0;
+	evt_total = 0;
+	stop = false;
+}
+
+static void parse_in_fragments(const char *data, size_t len, size_t fragment)
+{
+	for (size_t offset = 0; offset < len; offset += fragment) {
+		size_t fragment_len = MIN(fragment, len - offset);
+		size_t parsed;
+
+		parsed = ical_parser_parse(&ical, data + offset, fragment_len);
+		zassert_equal(parsed, fragment_len, "Fragment not parsed");
+	}
+}
+
+static void calendar_events_check(void)
+{
+	zassert_equal(evt_count, 5, "Incorrect number of events: %d",
+		      evt_count);
+
+	zassert_equal(evts[0].id, ICAL_EVT_VTIMEZONE, NULL);
+	zassert_equal(evts[0].error, ICAL_ERROR_COM_NOT_SUPPORTED, NULL);
+
+	zassert_equal(evts[1].id, ICAL_EVT_VEVENT, NULL);
+	zassert_equal(evts[1].error, ICAL_ERROR_NONE, "Error: %d",
+		      evts[1].error);
+	zassert_true(strcmp(evts[1].ical_com.dtstart, "20210615T090000") == 0,
+		     NULL);
+	zassert_true(strcmp(evts[1].ical_com.dtend, "20210615T100000") == 0,
+		     NULL);
+	zassert_true(strcmp(evts[1].ical_com.summary, "Weekly meeting") == 0,
+		     NULL);
+	zassert_true(strcmp(evts[1].ical_com.location, "Room 1") == 0, NULL);
+	zassert_true(strcmp(evts[1].ical_com.description,
+			    "A long description that is folded over"
+			    "several lines of the calendar.") == 0,
+		     "Incorrect description: %s", evts[1].ical_com.description);
+
+	zassert_equal(evts[2].id, ICAL_EVT_VTODO, NULL);
+	zassert_equal(evts[2].error, ICAL_ERROR_COM_NOT_SUPPORTED, NULL);
+
+	zassert_equal(evts[3].id, ICAL_EVT_VEVENT, NULL);
+	zassert_equal(evts[3].error, ICAL_ERROR_SUMMARY, NULL);
+	zassert_equal(strlen(evts[3].ical_com.location), 0, NULL);
+
+	zassert_equal(evts[4].id, ICAL_EVT_VEVENT, NULL);
+	zassert_equal(evts[4].error, ICAL_ERROR_LOCATION, NULL);
+	zassert_true(strcmp(evts[4].ical_com.summary, "Lower case") == 0, NULL);
+}
+
+static void test_parse_whole(void)
+{
+	parser_init();
+
+	parse_in_fragments(calendar, strlen(calendar), strlen(calendar));
+	calendar_events_check();
+}
+
+static void test_parse_fragments(void)
+{
+	/* Fragment boundaries fall at every position of the content lines,
+	 * line breaks and folds.
+	 */
+	for (size_t fragment = 1; fragment <= 17; fragment++) {
+		parser_init();
+
+		parse_in_fragments(calendar, strlen(calendar), fragment);
+		calendar_events_check();
+	}
+}
+
+static void test_parse_no_calendar(void)
+{
+	const char *data = "BEGIN:VEVENT\r\nSUMMARY:No calendar\r\n"
+			   "END:VEVENT\r\n";
+
+	parser_init();
+
+	parse_in_fragments(data, strlen(data), strlen(data));
+	zassert_equal(evt_count, 0, "Event outside of calendar");
+}
+
+static void test_parse_last_event(void)
+{
+	/* The stream ends with the line break of the END line. */
+	const char *data = "BEGIN:VCALENDAR\r\nBEGIN:VEVENT\r\n"
+			   "SUMMARY:Last event\r\nEND:VEVENT\r\n";
+
+	for (size_t fragment = 1; fragment <= strlen(data); fragment++) {
+		parser_init();
+
+		parse_in_fragments(data, strlen(data), fragment);
+		zassert_equal(evt_count, 1, "Last event not parsed");
+		zassert_equal(evts[0].error, ICAL_ERROR_NONE, NULL);
+		zassert_true(strcmp(evts[0].ical_com.summary, "Last event") == 0,
+			     NULL);
+	}
+}
+
+static void test_parse_calendar_end(void)
+{
+	const char *data = "BEGIN:VEVENT\r\nSUMMARY:After the calendar\r\n"
+			   "END:VEVENT\r\n";
+
+	parser_init();
+
+	parse_in_fragments(calendar, strlen(calendar), strlen(calendar));
+	zassert_false(ical.icalobject_begin, "Calendar not ended");
+
+	/* Components after the end of the calendar are not parsed. */
+	parse_in_fragments(data, strlen(data), strlen(data));
+	zassert_equal(evt_count, 5, "Event outside of calendar");
+}
+
+static void test_parse_stop(void)
+{
+	size_t len = strlen(calendar);
+	size_t offset = 0;
+	size_t calls = 0;
+
+	parser_init();
+	stop = true;
+
+	while (offset < len) {
+		offset += ical_parser_parse(&ical, calendar + offset,
+					    len - offset);
+		calls++;
+		zassert_true(calls <= EVT_MAX, "Parsing did not stop");
+	}
+
+	/* One call per event, and one for the rest of the calendar. */
+	zassert_equal(calls, 6, "Parsing did not stop after each event");
+	calendar_events_check();
+}
+
+static void test_parse_large_calendar(void)
+{
+	const char *begin = "BEGIN:VCALENDAR\r\nVERSION:2.0\r\n";
+	const char *event =
+		"BEGIN:VEVENT\r\n"
+		"DTSTART:20210615T090000Z\r\n"
+		"DTEND:20210615T100000Z\r\n"
+		"SUMMARY:Event\r\n"
+		"DESCRIPTION:Folded\r\n  description\r\n"
+		"END:VEVENT\r\n";
+	const char *end = "END:VCALENDAR\r\n";
+
+	parser_init();
+
+	/* Memory use does not depend on the size of the calendar. */
+	parse_in_fragments(begin, strlen(begin), 7);
+
+	for (size_t i = 0; i < LARGE_CALENDAR_EVENTS; i++) {
+		parse_in_fragments(event, strlen(event), 7);
+	}
+
+	parse_in_fragments(end, strlen(end), 7);
+
+	zassert_equal(evt_total, LARGE_CALENDAR_EVENTS,
+		      "Incorrect number of events");
+	zassert_equal(evts[EVT_MAX - 1].error, ICAL_ERROR_NONE, NULL);
+	zassert_true(strcmp(evts[EVT_MAX - 1].ical_com.description,
+			    "Folded description") == 0, NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(icalendar_parser,
+			 ztest_unit_test(test_parse_whole),
+			 ztest_unit_test(test_parse_fragments),
+			 ztest_unit_test(test_parse_no_calendar),
+			 ztest_unit_test(test_parse_last_event),
+			 ztest_unit_test(test_parse_calendar_end),
+			 ztest_unit_test(test_parse_stop),
+			 ztest_unit_test(test_parse_large_calendar)
+			 );
+	ztest_run_test_suite(icalendar_parser);
+}
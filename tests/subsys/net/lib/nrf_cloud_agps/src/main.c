@@ -0,0 +1,510 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/byteorder.h>
+
+#include "nrf_cloud_agps_inject.h"
+
+#define SV_COUNT		32
+#define MSG_BUF_SIZE		4096
+#define SENT_MAX		128
+
+/* Simulated network and modem GNSS socket. */
+#define CHUNK_SIZE		256
+#define CHUNK_INTERVAL_MS	10
+#define SEND_TIME_MS		2
+
+struct sent_element {
+	enum nrf_cloud_agps_type type;
+	uint8_t sv_id;
+	uint32_t sv_mask;
+};
+
+static uint8_t msg[MSG_BUF_SIZE];
+static size_t msg_len;
+
+static struct sent_element sent[SENT_MAX];
+static size_t sent_count;
+static int send_time_ms;
+static int send_fail_at;
+static bool send_gated;
+
+static K_SEM_DEFINE(send_entered, 0, 1);
+static K_SEM_DEFINE(send_gate, 0, 1);
+
+static void msg_init(void)
+{
+	msg_len = 0;
+	msg[msg_len++] = NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION;
+}
+
+static void msg_header_add(enum nrf_cloud_agps_type type, uint16_t count)
+{
+	msg[msg_len++] = type;
+	sys_put_le16(count, &msg[msg_len]);
+	msg_len += NRF_CLOUD_AGPS_BIN_COUNT_SIZE;
+}
+
+static void msg_element_add(const void *data, size_t len)
+{
+	zassert_true(msg_len + len <= sizeof(msg), "Message buffer too small");
+
+	memcpy(&msg[msg_len], data, len);
+	msg_len += len;
+}
+
+static void msg_ephemerides_add(const uint8_t *sv_ids, size_t count)
+{
+	struct nrf_cloud_agps_ephemeris ephemeris = { .health = 0 };
+
+	msg_header_add(NRF_CLOUD_AGPS_EPHEMERIDES, count);
+
+	for (size_t i = 0; i < count; i++) {
+		ephemeris.sv_id = sv_ids[i];
+		msg_element_add(&ephemeris, sizeof(ephemeris));
+	}
+}
+
+static void msg_almanacs_add(const uint8_t *sv_ids, size_t count)
+{
+	struct nrf_cloud_agps_almanac almanac = { .sv_health = 0 };
+
+	msg_header_add(NRF_CLOUD_AGPS_ALMANAC, count);
+
+	for (size_t i = 0; i < count; i++) {
+		almanac.sv_id = sv_ids[i];
+		msg_element_add(&almanac, sizeof(almanac));
+	}
+}
+
+static void msg_system_clock_add(uint32_t sv_mask)
+{
+	struct nrf_cloud_agps_system_time time = {
+		.date_day = 15000,
+		.time_full_s = 43200,
+		.sv_mask = sv_mask,
+	};
+	const uint8_t unused[4] = {0};
+
+	msg_header_add(NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK, 1);
+	msg_element_add(&time, offsetof(struct nrf_cloud_agps_system_time,
+					sv_tow));
+	msg_element_add(unused, sizeof(unused));
+}
+
+/* Message with all element types, as sent by nRF Cloud for a request of all
+ * assistance data.
+ */
+static size_t msg_full_build(void)
+{
+	uint8_t sv_ids[SV_COUNT];
+	struct nrf_cloud_agps_utc utc = { .delta_tls = 18 };
+	struct nrf_cloud_agps_klobuchar klobuchar = { .alpha0 = 1 };
+	struct nrf_cloud_agps_tow_element tows[] = {
+		{ .sv_id = 3, .tlm = 100 },
+		{ .sv_id = 9, .flags = 1 },
+	};
+	struct nrf_cloud_agps_location location = { .latitude = 1 };
+	struct nrf_cloud_agps_integrity integrity = { .integrity_mask = 0 };
+
+	for (size_t i = 0; i < SV_COUNT; i++) {
+		sv_ids[i] = i + 1;
+	}
+
+	msg_init();
+
+	msg_header_add(NRF_CLOUD_AGPS_UTC_PARAMETERS, 1);
+	msg_element_add(&utc, sizeof(utc));
+	msg_ephemerides_add(sv_ids, SV_COUNT);
+	msg_almanacs_add(sv_ids, SV_COUNT);
+	msg_header_add(NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION, 1);
+	msg_element_add(&klobuchar, sizeof(klobuchar));
+	msg_header_add(NRF_CLOUD_AGPS_GPS_TOWS, ARRAY_SIZE(tows));
+	msg_element_add(tows, sizeof(tows));
+	msg_system_clock_add(BIT(0));
+	msg_header_add(NRF_CLOUD_AGPS_LOCATION, 1);
+	msg_element_add(&location, sizeof(location));
+	msg_header_add(NRF_CLOUD_AGPS_INTEGRITY, 1);
+	msg_element_add(&integrity, sizeof(integrity));
+
+	/* UTC, klobuchar, system clock, location and integrity. TOWs are sent
+	 * with the system clock.
+	 */
+	return 2 * SV_COUNT + 5;
+}
+
+/* Simulated modem GNSS socket. */
+static int modem_send(struct nrf_cloud_apgs_element *element)
+{
+	struct sent_element *s = &sent[sent_count];
+
+	zassert_true(sent_count < SENT_MAX, "Too many elements sent");
+
+	/* Hold the first element until the test releases it. */
+	if (send_gated && (sent_count == 0)) {
+		k_sem_give(&send_entered);
+		k_sem_take(&send_gate, K_FOREVER);
+	}
+
+	if (send_time_ms) {
+		k_sleep(K_MSEC(send_time_ms));
+	}
+
+	memset(s, 0, sizeof(*s));
+	s->type = element->type;
+
+	switch (element->type) {
+	case NRF_CLOUD_AGPS_EPHEMERIDES:
+		s->sv_id = element->ephemeris->sv_id;
+		break;
+	case NRF_CLOUD_AGPS_ALMANAC:
+		s->sv_id = element->almanac->sv_id;
+		break;
+	case NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK:
+		s->sv_mask = element->time_and_tow->sv_mask;
+		break;
+	default:
+		break;
+	}
+
+	if ((int)sent_count++ == send_fail_at) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void inject_reset(void)
+{
+	sent_count = 0;
+	send_time_ms = 0;
+	send_fail_at = -1;
+	send_gated = false;
+	nagps_inject_visible_sv_set(0);
+}
+
+static int inject_chunked(size_t chunk_size, int chunk_interval_ms)
+{
+	int err = 0;
+
+	nagps_inject_start(modem_send);
+
+	for (size_t pos = 0; (pos < msg_len) && (err == 0);
+	     pos += chunk_size) {
+		if (chunk_interval_ms) {
+			k_sleep(K_MSEC(chunk_interval_ms));
+		}
+
+		err = nagps_inject_data(&msg[pos], MIN(chunk_size, msg_len - pos));
+	}
+
+	return nagps_inject_end();
+}
+
+static int sent_cmp(const void *a, const void *b)
+{
+	const struct sent_element *ea = a;
+	const struct sent_element *eb = b;
+
+	if (ea->type != eb->type) {
+		return ea->type - eb->type;
+	}
+
+	return ea->sv_id - eb->sv_id;
+}
+
+static void test_inject_chunked(void)
+{
+	static struct sent_element expected[SENT_MAX];
+	const size_t chunk_sizes[] = { 1, 3, 7, 64, CHUNK_SIZE };
+	size_t expected_count;
+	int err;
+
+	inject_reset();
+	expected_count = msg_full_build();
+
+	err = inject_chunked(msg_len, 0);
+	zassert_equal(err, 0, "Injection failed: %d", err);
+	zassert_equal(sent_count, expected_count, "Wrong number of elements");
+
+	qsort(sent, sent_count, sizeof(sent[0]), sent_cmp);
+	memcpy(expected, sent, sizeof(expected));
+
+	for (size_t i = 0; i < sent_count; i++) {
+		if (sent[i].type == NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK) {
+			zassert_equal(sent[i].sv_mask, BIT(0) | BIT(2) | BIT(8),
+				      "TOWs not merged in system time");
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(chunk_sizes); i++) {
+		inject_reset();
+
+		err = inject_chunked(chunk_sizes[i], 0);
+		zassert_equal(err, 0, "Injection failed: %d", err);
+		zassert_equal(sent_count, expected_count,
+			      "Wrong number of elements, chunk size %d",
+			      chunk_sizes[i]);
+
+		qsort(sent, sent_count, sizeof(sent[0]), sent_cmp);
+		zassert_mem_equal(sent, expected,
+				  expected_count * sizeof(sent[0]),
+				  "Elements differ, chunk size %d",
+				  chunk_sizes[i]);
+	}
+}
+
+static void test_inject_priority(void)
+{
+	const uint8_t ephemerides[] = { 5, 3, 7 };
+	const uint8_t almanacs[] = { 1 };
+	const struct nrf_cloud_agps_utc utc = { .delta_tls = 18 };
+	const struct nrf_cloud_agps_location location = { .latitude = 1 };
+	const struct sent_element expected[] = {
+		{ .type = NRF_CLOUD_AGPS_UTC_PARAMETERS },
+		{ .type = NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK, .sv_mask = BIT(0) },
+		{ .type = NRF_CLOUD_AGPS_LOCATION },
+		{ .type = NRF_CLOUD_AGPS_EPHEMERIDES, .sv_id = 3 },
+		{ .type = NRF_CLOUD_AGPS_EPHEMERIDES, .sv_id = 5 },
+		{ .type = NRF_CLOUD_AGPS_EPHEMERIDES, .sv_id = 7 },
+		{ .type = NRF_CLOUD_AGPS_ALMANAC, .sv_id = 1 },
+	};
+	size_t first_len;
+	int err;
+
+	inject_reset();
+	send_gated = true;
+	nagps_inject_visible_sv_set(BIT(3 - 1));
+
+	msg_init();
+	msg_header_add(NRF_CLOUD_AGPS_UTC_PARAMETERS, 1);
+	msg_element_add(&utc, sizeof(utc));
+	first_len = msg_len;
+	msg_almanacs_add(almanacs, ARRAY_SIZE(almanacs));
+	msg_ephemerides_add(ephemerides, ARRAY_SIZE(ephemerides));
+	msg_header_add(NRF_CLOUD_AGPS_LOCATION, 1);
+	msg_element_add(&location, sizeof(location));
+	msg_system_clock_add(BIT(0));
+
+	/* The remaining elements are queued while the first one is being sent
+	 * and are then sent in order of priority.
+	 */
+	nagps_inject_start(modem_send);
+
+	err = nagps_inject_data(msg, first_len);
+	zassert_equal(err, 0, "Parsing failed: %d", err);
+
+	k_sem_take(&send_entered, K_FOREVER);
+
+	err = nagps_inject_data(&msg[first_len], msg_len - first_len);
+	zassert_equal(err, 0, "Parsing failed: %d", err);
+
+	k_sem_give(&send_gate);
+
+	err = nagps_inject_end();
+	zassert_equal(err, 0, "Injection failed: %d", err);
+	zassert_equal(sent_count, ARRAY_SIZE(expected),
+		      "Wrong number of elements");
+
+	for (size_t i = 0; i < ARRAY_SIZE(expected); i++) {
+		zassert_equal(sent[i].type, expected[i].type,
+			      "Wrong type at %d", i);
+		zassert_equal(sent[i].sv_id, expected[i].sv_id,
+			      "Wrong satellite at %d", i);
+		zassert_equal(sent[i].sv_mask, expected[i].sv_mask,
+			      "Wrong TOW mask at %d", i);
+	}
+}
+
+static void test_inject_time(void)
+{
+	int64_t start;
+	int64_t sequential_ms;
+	int64_t pipelined_ms;
+	size_t expected_count;
+	int err;
+
+	inject_reset();
+	expected_count = msg_full_build();
+
+	/* Reference: all data is received before it is injected. */
+	send_time_ms = SEND_TIME_MS;
+	start = k_uptime_get();
+
+	for (size_t pos = 0; pos < msg_len; pos += CHUNK_SIZE) {
+		k_sleep(K_MSEC(CHUNK_INTERVAL_MS));
+	}
+
+	err = inject_chunked(msg_len, 0);
+	sequential_ms = k_uptime_get() - start;
+
+	zassert_equal(err, 0, "Injection failed: %d", err);
+	zassert_equal(sent_count, expected_count, "Wrong number of elements");
+
+	inject_reset();
+	send_time_ms = SEND_TIME_MS;
+	start = k_uptime_get();
+
+	err = inject_chunked(CHUNK_SIZE, CHUNK_INTERVAL_MS);
+	pipelined_ms = k_uptime_get() - start;
+
+	zassert_equal(err, 0, "Injection failed: %d", err);
+	zassert_equal(sent_count, expected_count, "Wrong number of elements");
+
+	TC_PRINT("Time to inject %d bytes: %lld ms sequential, %lld ms pipelined\n",
+		 msg_len, sequential_ms, pipelined_ms);
+
+	/* Injection overlaps with receiving, all but the last chunk. */
+	zassert_true(pipelined_ms <= sequential_ms -
+		     (int64_t)(msg_len / CHUNK_SIZE) * CHUNK_INTERVAL_MS / 2,
+		     "Injection does not overlap with receiving");
+}
+
+static void test_inject_bad_version(void)
+{
+	int err;
+
+	inject_reset();
+	msg_full_build();
+	msg[0] = NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION + 1;
+
+	err = inject_chunked(msg_len, 0);
+	zassert_equal(err, -EBADMSG, "Invalid version accepted");
+	zassert_equal(sent_count, 0, "Elements sent");
+}
+
+static void test_inject_truncated(void)
+{
+	int err;
+
+	inject_reset();
+	msg_full_build();
+	msg_len -= 2;
+
+	err = inject_chunked(7, 0);
+	zassert_equal(err, -EBADMSG, "Truncated message accepted");
+}
+
+static void test_inject_truncated_header(void)
+{
+	size_t expected_count;
+	int err;
+
+	inject_reset();
+	expected_count = msg_full_build();
+	msg_header_add(NRF_CLOUD_AGPS_LOCATION, 1);
+	msg_len -= 1;
+
+	err = inject_chunked(7, 0);
+	zassert_equal(err, -EBADMSG, "Message ending in a header accepted");
+	zassert_equal(sent_count, expected_count, "Wrong number of elements");
+
+	/* Only the version. */
+	inject_reset();
+	msg_init();
+	msg_header_add(NRF_CLOUD_AGPS_LOCATION, 1);
+	msg_len = NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_SIZE + 1;
+
+	err = inject_chunked(msg_len, 0);
+	zassert_equal(err, -EBADMSG, "Message ending in a header accepted");
+}
+
+static void test_inject_missing_elements(void)
+{
+	const uint8_t ephemerides[] = { 1, 2, 3 };
+	int err;
+
+	/* Header without any of the announced elements. */
+	inject_reset();
+	msg_full_build();
+	msg_header_add(NRF_CLOUD_AGPS_EPHEMERIDES, 2);
+
+	err = inject_chunked(msg_len, 0);
+	zassert_equal(err, -EBADMSG, "Message without elements accepted");
+
+	/* Message ending after a complete element, before the last one. */
+	inject_reset();
+	msg_init();
+	msg_ephemerides_add(ephemerides, ARRAY_SIZE(ephemerides));
+	msg_len -= sizeof(struct nrf_cloud_agps_ephemeris);
+
+	err = inject_chunked(3, 0);
+	zassert_equal(err, -EBADMSG, "Message with missing elements accepted");
+	zassert_equal(sent_count, ARRAY_SIZE(ephemerides) - 1,
+		      "Wrong number of elements");
+
+	/* A header announcing no elements is complete. */
+	inject_reset();
+	msg_init();
+	msg_ephemerides_add(ephemerides, ARRAY_SIZE(ephemerides));
+	msg_header_add(NRF_CLOUD_AGPS_ALMANAC, 0);
+
+	err = inject_chunked(msg_len, 0);
+	zassert_equal(err, 0, "Injection failed: %d", err);
+	zassert_equal(sent_count, ARRAY_SIZE(ephemerides),
+		      "Wrong number of elements");
+}
+
+static void test_inject_unknown_type(void)
+{
+	const uint8_t ephemerides[] = { 1, 2 };
+	const uint8_t garbage[16] = { 0xff };
+	int err;
+
+	inject_reset();
+
+	msg_init();
+	msg_header_add(NRF_CLOUD_AGPS_GPS_TOWS, 0);
+	msg_ephemerides_add(ephemerides, ARRAY_SIZE(ephemerides));
+	msg_header_add(NRF_CLOUD_AGPS_NEQUICK_CORRECTION, 1);
+	msg_element_add(garbage, sizeof(garbage));
+
+	/* Parsing stops at the unknown element type. */
+	err = inject_chunked(5, 0);
+	zassert_equal(err, 0, "Injection failed: %d", err);
+	zassert_equal(sent_count, ARRAY_SIZE(ephemerides),
+		      "Wrong number of elements");
+}
+
+static void test_inject_send_error(void)
+{
+	int err;
+
+	inject_reset();
+	msg_full_build();
+	send_fail_at = 3;
+
+	err = inject_chunked(CHUNK_SIZE, CHUNK_INTERVAL_MS);
+	zassert_equal(err, -EIO, "Send error not returned");
+	zassert_equal(sent_count, (size_t)send_fail_at + 1,
+		      "Elements sent after the error");
+
+	/* The next injection is not affected. */
+	inject_reset();
+	msg_full_build();
+
+	err = inject_chunked(msg_len, 0);
+	zassert_equal(err, 0, "Injection failed: %d", err);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(nrf_cloud_agps_test,
+			 ztest_unit_test(test_inject_chunked),
+			 ztest_unit_test(test_inject_priority),
+			 ztest_unit_test(test_inject_time),
+			 ztest_unit_test(test_inject_bad_version),
+			 ztest_unit_test(test_inject_truncated),
+			 ztest_unit_test(test_inject_truncated_header),
+			 ztest_unit_test(test_inject_missing_elements),
+			 ztest_unit_test(test_inject_unknown_type),
+			 ztest_unit_test(test_inject_send_error)
+			 );
+	ztest_run_test_suite(nrf_cloud_agps_test);
+}
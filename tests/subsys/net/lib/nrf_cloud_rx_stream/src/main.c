@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "nrf_cloud_rx_stream.h"
+
+#define BUF_LEN		8
+#define PAYLOAD_MAX	64
+#define STREAM_COUNT	2
+#define TOPIC		"prod/d/test/agps"
+
+/* Simulated payload of the MQTT message being received. */
+static uint8_t payload[PAYLOAD_MAX];
+static size_t payload_len;
+static size_t read_pos;
+static size_t read_cnt;
+static size_t read_len_max;
+static size_t read_fail_at;
+
+static uint8_t buf[BUF_LEN];
+static struct mqtt_client client;
+static const struct nrf_cloud_topic topic = {
+	.ptr = TOPIC,
+	.len = sizeof(TOPIC) - 1,
+};
+
+struct receiver {
+	bool accept;
+	size_t start_cnt;
+	size_t end_cnt;
+	int end_err;
+	size_t data_cnt;
+	size_t data_fail_at;
+	uint8_t rx[PAYLOAD_MAX];
+	size_t rx_len;
+};
+
+static struct receiver receivers[STREAM_COUNT];
+
+int mqtt_readall_publish_payload(struct mqtt_client *c, uint8_t *buffer,
+				 size_t length)
+{
+	zassert_equal_ptr(c, &client, "Wrong client");
+	zassert_true(read_pos + length <= payload_len, "Read past the payload");
+
+	read_len_max = MAX(read_len_max, length);
+
+	if (read_cnt++ == read_fail_at) {
+		return -EIO;
+	}
+
+	memcpy(buffer, &payload[read_pos], length);
+	read_pos += length;
+
+	return 0;
+}
+
+static bool receiver_start(struct receiver *r, const struct nrf_cloud_topic *t,
+			   const uint8_t *data, size_t len, size_t total_len)
+{
+	zassert_equal_ptr(t, &topic, "Wrong topic");
+	zassert_equal(total_len, payload_len, "Wrong payload length");
+	zassert_equal(len, MIN(payload_len, BUF_LEN), "Wrong first chunk length");
+	zassert_mem_equal(data, payload, len, "Wrong first chunk");
+
+	r->start_cnt++;
+
+	return r->accept;
+}
+
+static int receiver_data(struct receiver *r, const uint8_t *data, size_t len)
+{
+	zassert_equal(r->start_cnt, 1, "Data not taken");
+	zassert_equal(r->end_cnt, 0, "Data after the end");
+	zassert_true(r->rx_len + len <= sizeof(r->rx), "Too much data");
+
+	if (r->data_cnt++ == r->data_fail_at) {
+		return -ENOMEM;
+	}
+
+	memcpy(&r->rx[r->rx_len], data, len);
+	r->rx_len += len;
+
+	return 0;
+}
+
+static void receiver_end(struct receiver *r, int err)
+{
+	r->end_cnt++;
+	r->end_err = err;
+}
+
+#define RECEIVER_DEFINE(idx)							\
+	static bool start_##idx(const struct nrf_cloud_topic *t,		\
+				const uint8_t *data, size_t len,		\
+				size_t total_len)				\
+	{									\
+		return receiver_start(&receivers[idx], t, data, len, total_len); \
+	}									\
+	static int data_##idx(const uint8_t *data, size_t len)		\
+	{									\
+		return receiver_data(&receivers[idx], data, len);		\
+	}									\
+	static void end_##idx(int err)					\
+	{									\
+		receiver_end(&receivers[idx], err);				\
+	}									\
+	static const struct nct_rx_stream stream_##idx = {			\
+		.start = start_##idx,						\
+		.data = data_##idx,						\
+		.end = end_##idx,						\
+	}
+
+RECEIVER_DEFINE(0);
+RECEIVER_DEFINE(1);
+
+static const struct nct_rx_stream *const streams[] = {
+	&stream_0,
+	&stream_1,
+	NULL
+};
+
+static void payload_init(size_t len)
+{
+	payload_len = len;
+	read_pos = 0;
+	read_cnt = 0;
+	read_len_max = 0;
+	read_fail_at = SIZE_MAX;
+
+	for (size_t i = 0; i < len; i++) {
+		payload[i] = i + 1;
+	}
+
+	memset(receivers, 0, sizeof(receivers));
+
+	for (size_t i = 0; i < ARRAY_SIZE(receivers); i++) {
+		receivers[i].data_fail_at = SIZE_MAX;
+	}
+}
+
+/* Read the first chunk and offer the message, as the transport does. */
+static const struct nct_rx_stream *message_start(size_t *chunk_len)
+{
+	*chunk_len = MIN(payload_len, BUF_LEN);
+
+	zassert_ok(mqtt_readall_publish_payload(&client, buf, *chunk_len),
+		   "Cannot read the first chunk");
+
+	return nct_rx_stream_find(streams, &topic, buf, *chunk_len, payload_len);
+}
+
+static void test_chunked(void)
+{
+	const struct nct_rx_stream *stream;
+	size_t chunk_len;
+
+	payload_init(2 * BUF_LEN + BUF_LEN / 2);
+	receivers[1].accept = true;
+
+	stream = message_start(&chunk_len);
+	zassert_equal_ptr(stream, &stream_1, "Wrong receiver");
+	zassert_equal(receivers[0].start_cnt, 1, "Message not offered");
+
+	zassert_ok(nct_rx_stream_read(&client, stream, buf, sizeof(buf), chunk_len,
+				      payload_len), "Cannot read the payload");
+
+	zassert_equal(receivers[1].data_cnt, 3, "Wrong number of chunks");
+	zassert_equal(receivers[1].rx_len, payload_len, "Wrong received length");
+	zassert_mem_equal(receivers[1].rx, payload, payload_len, "Wrong data");
+	zassert_equal(receivers[1].end_cnt, 1, "Stream not ended");
+	zassert_equal(receivers[1].end_err, 0, "Stream ended with error");
+	zassert_equal(receivers[0].data_cnt, 0, "Data passed to a rejecting receiver");
+
+	zassert_equal(read_pos, payload_len, "Payload not read");
+	zassert_true(read_len_max <= BUF_LEN, "Chunk larger than the buffer");
+}
+
+static void test_first_receiver(void)
+{
+	const struct nct_rx_stream *stream;
+	size_t chunk_len;
+
+	payload_init(BUF_LEN);
+	receivers[0].accept = true;
+	receivers[1].accept = true;
+
+	stream = message_start(&chunk_len);
+	zassert_equal_ptr(stream, &stream_0, "Wrong receiver");
+	zassert_equal(receivers[1].start_cnt, 0, "Message offered after it was taken");
+
+	zassert_ok(nct_rx_stream_read(&client, stream, buf, sizeof(buf), chunk_len,
+				      payload_len), "Cannot read the payload");
+	zassert_equal(receivers[0].data_cnt, 1, "Wrong number of chunks");
+	zassert_equal(receivers[0].end_cnt, 1, "Stream not ended");
+}
+
+static void test_empty_payload(void)
+{
+	const struct nct_rx_stream *stream;
+	size_t chunk_len;
+
+	payload_init(0);
+	receivers[0].accept = true;
+
+	stream = message_start(&chunk_len);
+	zassert_equal_ptr(stream, &stream_0, "Empty message not offered");
+
+	zassert_ok(nct_rx_stream_read(&client, stream, buf, sizeof(buf), chunk_len,
+				      payload_len), "Cannot read the payload");
+	zassert_equal(receivers[0].data_cnt, 1, "Empty chunk not passed");
+	zassert_equal(receivers[0].rx_len, 0, "Data received");
+	zassert_equal(receivers[0].end_cnt, 1, "Stream not ended");
+}
+
+static void test_no_receiver(void)
+{
+	size_t chunk_len;
+
+	payload_init(4 * BUF_LEN + 1);
+
+	zassert_is_null(message_start(&chunk_len), "Message taken");
+
+	for (size_t i = 0; i < ARRAY_SIZE(receivers); i++) {
+		zassert_equal(receivers[i].start_cnt, 1, "Message not offered");
+	}
+
+	/* The rest of the payload is discarded, so the connection stays usable. */
+	zassert_ok(nct_payload_discard(&client, buf, sizeof(buf),
+				       payload_len - chunk_len),
+		   "Cannot discard the payload");
+	zassert_equal(read_pos, payload_len, "Payload not discarded");
+	zassert_true(read_len_max <= BUF_LEN, "Chunk larger than the buffer");
+
+	for (size_t i = 0; i < ARRAY_SIZE(receivers); i++) {
+		zassert_equal(receivers[i].data_cnt, 0, "Discarded data passed");
+		zassert_equal(receivers[i].end_cnt, 0, "Stream ended");
+	}
+}
+
+static void test_receiver_error(void)
+{
+	const struct nct_rx_stream *stream;
+	size_t chunk_len;
+
+	payload_init(5 * BUF_LEN);
+	receivers[0].accept = true;
+	receivers[0].data_fail_at = 1;
+
+	stream = message_start(&chunk_len);
+
+	/* Payload rejected by the receiver is not an error of the connection. */
+	zassert_ok(nct_rx_stream_read(&client, stream, buf, sizeof(buf), chunk_len,
+				      payload_len), "Cannot read the payload");
+
+	zassert_equal(receivers[0].data_cnt, 2, "Data passed after an error");
+	zassert_equal(receivers[0].rx_len, BUF_LEN, "Wrong received length");
+	zassert_equal(receivers[0].end_cnt, 1, "Stream not ended once");
+	zassert_equal(receivers[0].end_err, -ENOMEM, "Wrong stream error");
+
+	zassert_equal(read_pos, payload_len, "Rest of the payload not discarded");
+	zassert_true(read_len_max <= BUF_LEN, "Chunk larger than the buffer");
+}
+
+static void test_read_error(void)
+{
+	const struct nct_rx_stream *stream;
+	size_t chunk_len;
+
+	payload_init(3 * BUF_LEN);
+	receivers[0].accept = true;
+
+	/* Reading the second chunk fails. */
+	read_fail_at = 1;
+
+	stream = message_start(&chunk_len);
+
+	zassert_equal(nct_rx_stream_read(&client, stream, buf, sizeof(buf), chunk_len,
+					 payload_len), -EIO, "Read error not returned");
+
+	zassert_equal(receivers[0].data_cnt, 1, "Wrong number of chunks");
+	zassert_equal(receivers[0].end_cnt, 1, "Stream not ended once");
+	zassert_equal(receivers[0].end_err, -EIO, "Wrong stream error");
+	zassert_equal(read_cnt, 2, "Payload read after an error");
+}
+
+static void test_discard_read_error(void)
+{
+	payload_init(3 * BUF_LEN);
+	read_fail_at = 1;
+
+	zassert_equal(nct_payload_discard(&client, buf, sizeof(buf), payload_len), -EIO,
+		      "Read error not returned");
+	zassert_equal(read_cnt, 2, "Payload read after an error");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(nrf_cloud_rx_stream_test,
+			 ztest_unit_test(test_chunked),
+			 ztest_unit_test(test_first_receiver),
+			 ztest_unit_test(test_empty_payload),
+			 ztest_unit_test(test_no_receiver),
+			 ztest_unit_test(test_receiver_error),
+			 ztest_unit_test(test_read_error),
+			 ztest_unit_test(test_discard_read_error)
+			 );
+
+	ztest_run_test_suite(nrf_cloud_rx_stream_test);
+}
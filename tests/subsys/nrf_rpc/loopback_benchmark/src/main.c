@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Throughput and latency benchmark of nRF RPC over the loopback transport.
+ *
+ * The commands mirror the encoding of representative Bluetooth RPC calls, so
+ * that the measured cost follows the cost of the real serialization layer:
+ * - BENCH_GAP_ADV_START_CMD has the layout of bt_le_adv_start(),
+ * - BENCH_CONN_GET_INFO_CMD has the layout of bt_conn_get_info(),
+ * - BENCH_PING_EVT and BENCH_PONG_EVT measure the event round trip.
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+
+#include <tinycbor/cbor.h>
+#include <nrf_rpc_cbor.h>
+#include <nrf_rpc_loopback.h>
+
+#define ITERATIONS 1000
+
+#define AD_COUNT 3
+#define AD_DATA_LEN 8
+#define ADDR_LEN 7
+
+enum bench_rpc_id {
+	BENCH_GAP_ADV_START_CMD,
+	BENCH_CONN_GET_INFO_CMD,
+	BENCH_PING_EVT,
+	BENCH_PONG_EVT,
+};
+
+struct bench_result {
+	uint32_t count;
+	uint64_t time_us;
+	uint64_t max_us;
+	struct nrf_rpc_loopback_stats transport;
+};
+
+NRF_RPC_GROUP_DEFINE(bench_group, "nrf_rpc_bench", NULL, NULL, NULL);
+
+static K_SEM_DEFINE(pong_sem, 0, 1);
+
+static const uint8_t ad_data[AD_DATA_LEN] = { 0x02, 0x01, 0x06, 0x03,
+					      0x03, 0x0F, 0x18, 0x00 };
+static const uint8_t addr[ADDR_LEN] = { 0x00, 0x11, 0x22, 0x33,
+					0x44, 0x55, 0x66 };
+
+static void rpc_err_handler(const struct nrf_rpc_err_report *report)
+{
+	zassert_unreachable("nRF RPC error %d", report->code);
+}
+
+static bool decode_uints(CborValue *value, size_t count)
+{
+	uint64_t tmp;
+
+	for (size_t i = 0; i < count; i++) {
+		if (!cbor_value_is_unsigned_integer(value) ||
+		    (cbor_value_get_uint64(value, &tmp) != CborNoError) ||
+		    (cbor_value_advance_fixed(value) != CborNoError)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool decode_buffer(CborValue *value, uint8_t *buf, size_t size)
+{
+	size_t len = size;
+
+	return cbor_value_is_byte_string(value) &&
+	       (cbor_value_copy_byte_string(value, buf, &len, value) ==
+		CborNoError);
+}
+
+static void rsp_int_handle(CborValue *value, void *handler_data)
+{
+	if (!cbor_value_is_integer(value) ||
+	    (cbor_value_get_int(value, (int *)handler_data) != CborNoError)) {
+		*(int *)handler_data = -EBADMSG;
+	}
+}
+
+static void rsp_conn_info_handle(CborValue *value, void *handler_data)
+{
+	uint8_t buf[ADDR_LEN];
+	bool ok;
+
+	ok = decode_uints(value, 12) &&
+	     decode_buffer(value, buf, sizeof(buf)) &&
+	     decode_buffer(value, buf, sizeof(buf));
+
+	*(int *)handler_data = ok ? 0 : -EBADMSG;
+}
+
+static void send_int_rsp(int result)
+{
+	struct nrf_rpc_cbor_ctx ctx;
+
+	NRF_RPC_CBOR_ALLOC(ctx, 1 + sizeof(int32_t));
+	cbor_encode_int(&ctx.encoder, result);
+	nrf_rpc_cbor_rsp_no_err(&ctx);
+}
+
+static void gap_adv_start_handler(CborValue *value, void *handler_data)
+{
+	uint8_t buf[AD_DATA_LEN];
+	uint64_t count;
+	bool ok;
+
+	/* Scratchpad size, bt_le_adv_param fields and NULL peer address. */
+	ok = decode_uints(value, 7) && cbor_value_is_null(value) &&
+	     (cbor_value_advance_fixed(value) == CborNoError);
+
+	/* Advertising and scan response data arrays. */
+	for (int i = 0; ok && (i < 2); i++) {
+		ok = cbor_value_is_unsigned_integer(value) &&
+		     (cbor_value_get_uint64(value, &count) == CborNoError) &&
+		     (cbor_value_advance_fixed(value) == CborNoError);
+
+		for (uint64_t j = 0; ok && (j < count); j++) {
+			ok = decode_uints(value, 2) &&
+			     decode_buffer(value, buf, sizeof(buf));
+		}
+	}
+
+	nrf_rpc_cbor_decoding_done(value);
+
+	send_int_rsp(ok ? 0 : -EBADMSG);
+}
+
+NRF_RPC_CBOR_CMD_DECODER(bench_group, gap_adv_start, BENCH_GAP_ADV_START_CMD,
+			 gap_adv_start_handler, NULL);
+
+static void conn_get_info_handler(CborValue *value, void *handler_data)
+{
+	struct nrf_rpc_cbor_ctx ctx;
+	bool ok;
+
+	ok = decode_uints(value, 1);
+	nrf_rpc_cbor_decoding_done(value);
+	zassert_true(ok, "Failed to decode connection index");
+
+	NRF_RPC_CBOR_ALLOC(ctx, 12 * (1 + sizeof(uint32_t)) +
+			   2 * (1 + ADDR_LEN));
+
+	/* type, role, id, interval, latency, timeout, security and PHY info */
+	for (uint32_t i = 0; i < 12; i++) {
+		cbor_encode_uint(&ctx.encoder, 0x100 + i);
+	}
+
+	cbor_encode_byte_string(&ctx.encoder, addr, sizeof(addr));
+	cbor_encode_byte_string(&ctx.encoder, addr, sizeof(addr));
+
+	nrf_rpc_cbor_rsp_no_err(&ctx);
+}
+
+NRF_RPC_CBOR_CMD_DECODER(bench_group, conn_get_info, BENCH_CONN_GET_INFO_CMD,
+			 conn_get_info_handler, NULL);
+
+static void ping_handler(CborValue *value, void *handler_data)
+{
+	struct nrf_rpc_cbor_ctx ctx;
+
+	nrf_rpc_cbor_decoding_done(value);
+
+	NRF_RPC_CBOR_ALLOC(ctx, 0);
+	nrf_rpc_cbor_evt_no_err(&bench_group, BENCH_PONG_EVT, &ctx);
+}
+
+NRF_RPC_CBOR_EVT_DECODER(bench_group, ping, BENCH_PING_EVT, ping_handler,
+			 NULL);
+
+static void pong_handler(CborValue *value, void *handler_data)
+{
+	nrf_rpc_cbor_decoding_done(value);
+	k_sem_give(&pong_sem);
+}
+
+NRF_RPC_CBOR_EVT_DECODER(bench_group, pong, BENCH_PONG_EVT, pong_handler,
+			 NULL);
+
+static int gap_adv_start(void)
+{
+	struct nrf_rpc_cbor_ctx ctx;
+	int result;
+
+	NRF_RPC_CBOR_ALLOC(ctx, 7 * (1 + sizeof(uint32_t)) + 1 + 2 * 5 +
+			   AD_COUNT * (2 * (1 + sizeof(uint32_t)) + 1 +
+				       AD_DATA_LEN));
+
+	cbor_encode_uint(&ctx.encoder, AD_COUNT * AD_DATA_LEN);
+
+	/* id, sid, secondary_max_skip, options, interval_min, interval_max */
+	cbor_encode_uint(&ctx.encoder, 0);
+	cbor_encode_uint(&ctx.encoder, 0);
+	cbor_encode_uint(&ctx.encoder, 0);
+	cbor_encode_uint(&ctx.encoder, 0x3);
+	cbor_encode_uint(&ctx.encoder, 0x00a0);
+	cbor_encode_uint(&ctx.encoder, 0x00f0);
+	cbor_encode_null(&ctx.encoder);
+
+	cbor_encode_uint(&ctx.encoder, AD_COUNT - 1);
+	for (int i = 0; i < AD_COUNT - 1; i++) {
+		cbor_encode_uint(&ctx.encoder, i + 1);
+		cbor_encode_uint(&ctx.encoder, sizeof(ad_data));
+		cbor_encode_byte_string(&ctx.encoder, ad_data, sizeof(ad_data));
+	}
+
+	cbor_encode_uint(&ctx.encoder, 1);
+	cbor_encode_uint(&ctx.encoder, 0x09);
+	cbor_encode_uint(&ctx.encoder, sizeof(ad_data));
+	cbor_encode_byte_string(&ctx.encoder, ad_data, sizeof(ad_data));
+
+	nrf_rpc_cbor_cmd_no_err(&bench_group, BENCH_GAP_ADV_START_CMD, &ctx,
+				rsp_int_handle, &result);
+
+	return result;
+}
+
+static int conn_get_info(void)
+{
+	struct nrf_rpc_cbor_ctx ctx;
+	int result;
+
+	NRF_RPC_CBOR_ALLOC(ctx, 1 + sizeof(uint32_t));
+	cbor_encode_uint(&ctx.encoder, 0);
+
+	nrf_rpc_cbor_cmd_no_err(&bench_group, BENCH_CONN_GET_INFO_CMD, &ctx,
+				rsp_conn_info_handle, &result);
+
+	return result;
+}
+
+static int ping(void)
+{
+	struct nrf_rpc_cbor_ctx ctx;
+
+	NRF_RPC_CBOR_ALLOC(ctx, 0);
+	nrf_rpc_cbor_evt_no_err(&bench_group, BENCH_PING_EVT, &ctx);
+
+	return k_sem_take(&pong_sem, K_SECONDS(1));
+}
+
+static void bench_run(const char *name, int (*call)(void))
+{
+	struct bench_result result = { 0 };
+	uint32_t start;
+	uint32_t time_us;
+
+	nrf_rpc_loopback_stats_reset();
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		start = k_cycle_get_32();
+		zassert_equal(call(), 0, "%s failed", name);
+		time_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+		result.count++;
+		result.time_us += time_us;
+		result.max_us = MAX(result.max_us, time_us);
+	}
+
+	nrf_rpc_loopback_stats_get(&result.transport);
+
+	printk("%s: %u calls, avg %llu us, max %llu us, %llu calls/s, "
+	       "%u packets, %llu bytes copied\n",
+	       name, result.count, result.time_us / result.count,
+	       result.max_us,
+	       result.time_us ? (1000000ULL * result.count / result.time_us) :
+				0,
+	       result.transport.packets, result.transport.bytes);
+}
+
+static void test_gap_adv_start(void)
+{
+	bench_run("bt_rpc_gap adv_start", gap_adv_start);
+}
+
+static void test_conn_get_info(void)
+{
+	bench_run("bt_rpc_conn get_info", conn_get_info);
+}
+
+static void test_event_round_trip(void)
+{
+	bench_run("event round trip", ping);
+}
+
+void test_main(void)
+{
+	zassert_equal(nrf_rpc_init(rpc_err_handler), 0,
+		      "nRF RPC initialization failed");
+
+	ztest_test_suite(nrf_rpc_loopback_benchmark,
+			 ztest_unit_test(test_gap_adv_start),
+			 ztest_unit_test(test_conn_get_info),
+			 ztest_unit_test(test_event_round_trip)
+			 );
+
+	ztest_run_test_suite(nrf_rpc_loopback_benchmark);
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <ztest.h>
+
+#include "rp_ll_batch.h"
+
+#define MAX_PACKETS 8
+
+/* Stand-in for the peer core: packets delivered by the batch parser. */
+struct loopback {
+	const uint8_t *data[MAX_PACKETS];
+	size_t len[MAX_PACKETS];
+	int count;
+};
+
+static void loopback_receive(const uint8_t *data, size_t len, void *user_data)
+{
+	struct loopback *peer = user_data;
+
+	zassert_true(peer->count < MAX_PACKETS, "Too many packets");
+
+	peer->data[peer->count] = data;
+	peer->len[peer->count] = len;
+	peer->count++;
+}
+
+static void test_batch_loopback(void)
+{
+	static const uint8_t packet_a[] = { 0x01, 0x02, 0x03 };
+	static const uint8_t packet_b[] = { 0xAA };
+	static const uint8_t packet_c[] = { 0x10, 0x20, 0x30, 0x40, 0x50 };
+	struct rp_ll_batch batch;
+	struct loopback peer = { 0 };
+	uint8_t buf[32];
+	int ret;
+
+	rp_ll_batch_init(&batch, buf, sizeof(buf));
+
+	zassert_equal(rp_ll_batch_add(&batch, packet_a, sizeof(packet_a)), 0,
+		      "Failed to add packet");
+	zassert_equal(rp_ll_batch_add(&batch, packet_b, sizeof(packet_b)), 0,
+		      "Failed to add packet");
+	zassert_equal(rp_ll_batch_add(&batch, packet_c, sizeof(packet_c)), 0,
+		      "Failed to add packet");
+	zassert_equal(batch.count, 3, "Wrong packet count");
+	zassert_equal(batch.len, 3 * RP_LL_BATCH_HDR_SIZE + sizeof(packet_a) +
+		      sizeof(packet_b) + sizeof(packet_c), "Wrong batch length");
+
+	ret = rp_ll_batch_parse(batch.buf, batch.len, loopback_receive, &peer);
+	zassert_equal(ret, 3, "Wrong number of parsed packets");
+
+	zassert_equal(peer.len[0], sizeof(packet_a), "Wrong length");
+	zassert_mem_equal(peer.data[0], packet_a, sizeof(packet_a),
+			  "Wrong data");
+	zassert_equal(peer.len[1], sizeof(packet_b), "Wrong length");
+	zassert_mem_equal(peer.data[1], packet_b, sizeof(packet_b),
+			  "Wrong data");
+	zassert_equal(peer.len[2], sizeof(packet_c), "Wrong length");
+	zassert_mem_equal(peer.data[2], packet_c, sizeof(packet_c),
+			  "Wrong data");
+}
+
+static void test_batch_full(void)
+{
+	static const uint8_t packet[6] = { 0 };
+	struct rp_ll_batch batch;
+	uint8_t buf[2 * (RP_LL_BATCH_HDR_SIZE + sizeof(packet)) + 1];
+
+	rp_ll_batch_init(&batch, buf, sizeof(buf));
+
+	zassert_equal(rp_ll_batch_add(&batch, packet, sizeof(packet)), 0,
+		      "Failed to add packet");
+	zassert_equal(rp_ll_batch_add(&batch, packet, sizeof(packet)), 0,
+		      "Failed to add packet");
+	zassert_equal(rp_ll_batch_add(&batch, packet, sizeof(packet)), -ENOMEM,
+		      "Packet added to a full batch");
+	zassert_equal(rp_ll_batch_add(&batch, packet, 0), -EINVAL,
+		      "Empty packet added");
+	zassert_equal(batch.count, 2, "Wrong packet count");
+}
+
+static void test_batch_malformed(void)
+{
+	struct loopback peer = { 0 };
+	/* Second packet claims more data than received. */
+	static const uint8_t truncated[] = { 0x01, 0x00, 0xAA, 0x05, 0x00, 0xBB };
+	static const uint8_t empty_packet[] = { 0x00, 0x00 };
+	static const uint8_t partial_header[] = { 0x01, 0x00, 0xAA, 0x01 };
+
+	zassert_equal(rp_ll_batch_parse(truncated, sizeof(truncated),
+					loopback_receive, &peer),
+		      -EBADMSG, "Truncated batch accepted");
+	zassert_equal(peer.count, 1, "Valid leading packet not delivered");
+
+	zassert_equal(rp_ll_batch_parse(empty_packet, sizeof(empty_packet),
+					loopback_receive, &peer),
+		      -EBADMSG, "Empty packet accepted");
+	zassert_equal(rp_ll_batch_parse(partial_header, sizeof(partial_header),
+					loopback_receive, &peer),
+		      -EBADMSG, "Partial header accepted");
+}
+
+/* Stand-in for the rpmsg transport of the sending side. */
+#define TX_BUF_COUNT 2
+#define TX_BUF_SIZE 16
+#define TX_TIMEOUT_MS 20
+
+static struct {
+	uint8_t buf[TX_BUF_COUNT][TX_BUF_SIZE];
+	bool taken[TX_BUF_COUNT];
+	/* Batches delivered to the peer. */
+	struct loopback peer;
+	uint8_t sent[MAX_PACKETS][TX_BUF_SIZE];
+	int batches;
+	int send_err;
+	int error_err;
+	int errors;
+	uint16_t lost;
+} transport;
+
+static K_THREAD_STACK_DEFINE(tx_thread_stack, 1024);
+static struct k_work_q tx_work_q;
+static struct rp_ll_batch_tx tx;
+
+static uint8_t *transport_buf_get(struct rp_ll_batch_tx *tx, size_t *size)
+{
+	for (size_t i = 0; i < TX_BUF_COUNT; i++) {
+		if (!transport.taken[i]) {
+			transport.taken[i] = true;
+			*size = TX_BUF_SIZE;
+			return transport.buf[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int transport_send(struct rp_ll_batch_tx *tx, uint8_t *buf, size_t len)
+{
+	size_t i = (buf - transport.buf[0]) / TX_BUF_SIZE;
+	uint8_t *sent;
+
+	zassert_true(i < TX_BUF_COUNT, "Unknown buffer");
+	zassert_true(transport.taken[i], "Buffer not taken");
+
+	if (transport.send_err) {
+		return transport.send_err;
+	}
+
+	/* The peer releases the buffer once the batch is received. */
+	zassert_true(transport.batches < MAX_PACKETS, "Too many batches");
+	sent = transport.sent[transport.batches++];
+	memcpy(sent, buf, len);
+	transport.taken[i] = false;
+
+	zassert_true(rp_ll_batch_parse(sent, len, loopback_receive,
+				       &transport.peer) > 0,
+		     "Malformed batch sent");
+
+	return 0;
+}
+
+static void transport_error(struct rp_ll_batch_tx *tx, int err, uint16_t count)
+{
+	transport.errors++;
+	transport.error_err = err;
+	transport.lost += count;
+}
+
+static const struct rp_ll_batch_tx_ops transport_ops = {
+	.buf_get = transport_buf_get,
+	.send = transport_send,
+	.error = transport_error,
+};
+
+static void tx_setup(void)
+{
+	memset(&transport, 0, sizeof(transport));
+	rp_ll_batch_tx_init(&tx, &transport_ops, &tx_work_q,
+			    K_MSEC(TX_TIMEOUT_MS));
+}
+
+static void tx_teardown(void)
+{
+	struct k_work_sync sync;
+
+	k_work_cancel_delayable_sync(&tx.work, &sync);
+}
+
+static void test_batch_tx_timeout(void)
+{
+	static const uint8_t packet_a[] = { 0x01, 0x02 };
+	static const uint8_t packet_b[] = { 0x03 };
+	struct rp_ll_batch_stats stats;
+
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet_a, sizeof(packet_a)), 0,
+		      "Failed to send packet");
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet_b, sizeof(packet_b)), 0,
+		      "Failed to send packet");
+	zassert_equal(transport.batches, 0, "Batch sent before timeout");
+
+	k_sleep(K_MSEC(2 * TX_TIMEOUT_MS));
+
+	zassert_equal(transport.batches, 1, "Batch not sent on timeout");
+	zassert_equal(transport.peer.count, 2, "Wrong number of packets");
+	zassert_mem_equal(transport.peer.data[0], packet_a, sizeof(packet_a),
+			  "Wrong data");
+	zassert_mem_equal(transport.peer.data[1], packet_b, sizeof(packet_b),
+			  "Wrong data");
+
+	rp_ll_batch_tx_stats_get(&tx, &stats);
+	zassert_equal(stats.packets, 2, "Wrong packet count");
+	zassert_equal(stats.batches, 1, "Wrong batch count");
+	zassert_equal(stats.notifications_saved, 1, "Wrong saved count");
+	zassert_equal(stats.packets_lost, 0, "Wrong lost count");
+
+	/* The next packet starts a new batch and a new timeout. */
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet_b, sizeof(packet_b)), 0,
+		      "Failed to send packet");
+	k_sleep(K_MSEC(2 * TX_TIMEOUT_MS));
+	zassert_equal(transport.batches, 2, "Batch not sent on timeout");
+}
+
+static void test_batch_tx_full(void)
+{
+	static const uint8_t packet[5] = { 0x11, 0x22, 0x33, 0x44, 0x55 };
+	static const uint8_t too_long[TX_BUF_SIZE] = { 0 };
+	struct rp_ll_batch_stats stats;
+
+	BUILD_ASSERT(2 * (RP_LL_BATCH_HDR_SIZE + sizeof(packet)) <= TX_BUF_SIZE);
+	BUILD_ASSERT(3 * (RP_LL_BATCH_HDR_SIZE + sizeof(packet)) > TX_BUF_SIZE);
+
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet, sizeof(packet)), 0,
+		      "Failed to send packet");
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet, sizeof(packet)), 0,
+		      "Failed to send packet");
+	zassert_equal(transport.batches, 0, "Batch sent before it is full");
+
+	/* Does not fit, the pending batch is sent immediately. */
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet, sizeof(packet)), 0,
+		      "Failed to send packet");
+	zassert_equal(transport.batches, 1, "Full batch not sent");
+	zassert_equal(transport.peer.count, 2, "Wrong number of packets");
+
+	zassert_equal(rp_ll_batch_tx_send(&tx, too_long, sizeof(too_long)),
+		      -EINVAL, "Packet longer than a buffer accepted");
+	zassert_equal(transport.batches, 2, "Pending batch not sent");
+
+	zassert_equal(rp_ll_batch_tx_flush(&tx), 0, "Failed to flush");
+	zassert_equal(transport.batches, 2, "Empty batch sent");
+
+	rp_ll_batch_tx_stats_get(&tx, &stats);
+	zassert_equal(stats.packets, 3, "Wrong packet count");
+	zassert_equal(stats.batches, 2, "Wrong batch count");
+	zassert_equal(transport.errors, 0, "Unexpected error");
+}
+
+static void test_batch_tx_error(void)
+{
+	static const uint8_t packet[5] = { 0x11, 0x22, 0x33, 0x44, 0x55 };
+	struct rp_ll_batch_stats stats;
+	int taken;
+
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet, sizeof(packet)), 0,
+		      "Failed to send packet");
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet, sizeof(packet)), 0,
+		      "Failed to send packet");
+
+	/* Sending the full batch fails, the caller gets the error. */
+	transport.send_err = -EIO;
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet, sizeof(packet)), -EIO,
+		      "Send error not returned");
+	zassert_equal(transport.errors, 1, "Lost packets not reported");
+	zassert_equal(transport.error_err, -EIO, "Wrong error reported");
+	zassert_equal(transport.lost, 2, "Wrong number of lost packets");
+
+	/* Sending on timeout fails, the error is reported. */
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet, sizeof(packet)), 0,
+		      "Failed to send packet");
+	k_sleep(K_MSEC(2 * TX_TIMEOUT_MS));
+	zassert_equal(transport.errors, 2, "Lost packet not reported");
+	zassert_equal(transport.lost, 3, "Wrong number of lost packets");
+
+	/* The buffer of the failed batches is reused, not leaked. */
+	taken = 0;
+	for (size_t i = 0; i < TX_BUF_COUNT; i++) {
+		taken += transport.taken[i];
+	}
+	zassert_equal(taken, 1, "Buffer leaked");
+
+	transport.send_err = 0;
+	zassert_equal(rp_ll_batch_tx_send(&tx, packet, sizeof(packet)), 0,
+		      "Failed to send packet");
+	zassert_equal(rp_ll_batch_tx_flush(&tx), 0, "Failed to flush");
+	zassert_equal(transport.batches, 1, "Batch not sent");
+	zassert_equal(transport.peer.count, 1, "Wrong number of packets");
+	zassert_false(transport.taken[0] || transport.taken[1],
+		      "Buffer not released");
+
+	rp_ll_batch_tx_stats_get(&tx, &stats);
+	zassert_equal(stats.packets, 1, "Wrong packet count");
+	zassert_equal(stats.packets_lost, 3, "Wrong lost count");
+}
+
+void test_main(void)
+{
+	k_work_queue_start(&tx_work_q, tx_thread_stack,
+			   K_THREAD_STACK_SIZEOF(tx_thread_stack),
+			   K_PRIO_PREEMPT(0), NULL);
+
+	ztest_test_suite(rp_ll_batch_test,
+			 ztest_unit_test(test_batch_loopback),
+			 ztest_unit_test(test_batch_full),
+			 ztest_unit_test(test_batch_malformed),
+			 ztest_unit_test_setup_teardown(test_batch_tx_timeout,
+							tx_setup, tx_teardown),
+			 ztest_unit_test_setup_teardown(test_batch_tx_full,
+							tx_setup, tx_teardown),
+			 ztest_unit_test_setup_teardown(test_batch_tx_error,
+							tx_setup, tx_teardown)
+			 );
+
+	ztest_run_test_suite(rp_ll_batch_test);
+}